@@ -0,0 +1,86 @@
+//-- Fragment shader for the gradient pass of the fatty filter --
+
+#version 120
+
+//Uniforms
+uniform sampler2D Depth;
+uniform vec2 d[2];         //Texture coordinate step sizes
+uniform vec3 K[10];        //Kernel constants
+uniform vec2 Grid;         //Subdivisions of the displaced plane
+
+//Depth luminance
+const vec3 DepthLum = vec3(0.2990, 0.5870, 0.1140);
+
+//Blur level (mip map LOD bias)
+const float Blur = 0.0;
+
+void main(void)
+   {
+   vec3 Normal;
+
+   //Each fragment stands for one vertex of the displaced plane
+   vec2 Vertex = (gl_FragCoord.xy - vec2(0.5)) / Grid;
+
+   //5x5 kernel offsets
+   vec2 Coord[5];
+   Coord[0] = Vertex - d[1];
+   Coord[1] = Vertex - d[0];
+   Coord[2] = Vertex;
+   Coord[3] = Vertex + d[0];
+   Coord[4] = Vertex + d[1];
+
+   //Edge operator, U direction
+   vec4 Texel[20];
+   Texel[0] = texture2D(Depth, vec2(Coord[4].s, Coord[0].t), Blur) - texture2D(Depth, vec2(Coord[0].s, Coord[0].t), Blur);
+   Texel[1] = texture2D(Depth, vec2(Coord[4].s, Coord[1].t), Blur) - texture2D(Depth, vec2(Coord[0].s, Coord[1].t), Blur);
+   Texel[2] = texture2D(Depth, vec2(Coord[4].s, Coord[2].t), Blur) - texture2D(Depth, vec2(Coord[0].s, Coord[2].t), Blur);
+   Texel[3] = texture2D(Depth, vec2(Coord[4].s, Coord[3].t), Blur) - texture2D(Depth, vec2(Coord[0].s, Coord[3].t), Blur);
+   Texel[4] = texture2D(Depth, vec2(Coord[4].s, Coord[4].t), Blur) - texture2D(Depth, vec2(Coord[0].s, Coord[4].t), Blur);
+
+   Texel[5] = texture2D(Depth, vec2(Coord[3].s, Coord[0].t), Blur) - texture2D(Depth, vec2(Coord[1].s, Coord[0].t), Blur);
+   Texel[6] = texture2D(Depth, vec2(Coord[3].s, Coord[1].t), Blur) - texture2D(Depth, vec2(Coord[1].s, Coord[1].t), Blur);
+   Texel[7] = texture2D(Depth, vec2(Coord[3].s, Coord[2].t), Blur) - texture2D(Depth, vec2(Coord[1].s, Coord[2].t), Blur);
+   Texel[8] = texture2D(Depth, vec2(Coord[3].s, Coord[3].t), Blur) - texture2D(Depth, vec2(Coord[1].s, Coord[3].t), Blur);
+   Texel[9] = texture2D(Depth, vec2(Coord[3].s, Coord[4].t), Blur) - texture2D(Depth, vec2(Coord[1].s, Coord[4].t), Blur);
+
+   //Edge operator, V direction
+   Texel[10] = texture2D(Depth, vec2(Coord[0].s, Coord[0].t), Blur) - texture2D(Depth, vec2(Coord[0].s, Coord[4].t), Blur);
+   Texel[11] = texture2D(Depth, vec2(Coord[1].s, Coord[0].t), Blur) - texture2D(Depth, vec2(Coord[1].s, Coord[4].t), Blur);
+   Texel[12] = texture2D(Depth, vec2(Coord[2].s, Coord[0].t), Blur) - texture2D(Depth, vec2(Coord[2].s, Coord[4].t), Blur);
+   Texel[13] = texture2D(Depth, vec2(Coord[3].s, Coord[0].t), Blur) - texture2D(Depth, vec2(Coord[3].s, Coord[4].t), Blur);
+   Texel[14] = texture2D(Depth, vec2(Coord[4].s, Coord[0].t), Blur) - texture2D(Depth, vec2(Coord[4].s, Coord[4].t), Blur);
+
+   Texel[15] = texture2D(Depth, vec2(Coord[0].s, Coord[1].t), Blur) - texture2D(Depth, vec2(Coord[0].s, Coord[3].t), Blur);
+   Texel[16] = texture2D(Depth, vec2(Coord[1].s, Coord[1].t), Blur) - texture2D(Depth, vec2(Coord[1].s, Coord[3].t), Blur);
+   Texel[17] = texture2D(Depth, vec2(Coord[2].s, Coord[1].t), Blur) - texture2D(Depth, vec2(Coord[2].s, Coord[3].t), Blur);
+   Texel[18] = texture2D(Depth, vec2(Coord[3].s, Coord[1].t), Blur) - texture2D(Depth, vec2(Coord[3].s, Coord[3].t), Blur);
+   Texel[19] = texture2D(Depth, vec2(Coord[4].s, Coord[1].t), Blur) - texture2D(Depth, vec2(Coord[4].s, Coord[3].t), Blur);
+
+   //Compute luminance from each texel, apply kernel weights, and sum them all
+   Normal.s  = dot(Texel[0].rgb, K[0]);
+   Normal.s += dot(Texel[1].rgb, K[1]);
+   Normal.s += dot(Texel[2].rgb, K[2]);
+   Normal.s += dot(Texel[3].rgb, K[3]);
+   Normal.s += dot(Texel[4].rgb, K[4]);
+
+   Normal.s += dot(Texel[5].rgb, K[5]);
+   Normal.s += dot(Texel[6].rgb, K[6]);
+   Normal.s += dot(Texel[7].rgb, K[7]);
+   Normal.s += dot(Texel[8].rgb, K[8]);
+   Normal.s += dot(Texel[9].rgb, K[9]);
+
+   Normal.t  = dot(Texel[10].rgb, K[0]);
+   Normal.t += dot(Texel[11].rgb, K[1]);
+   Normal.t += dot(Texel[12].rgb, K[2]);
+   Normal.t += dot(Texel[13].rgb, K[3]);
+   Normal.t += dot(Texel[14].rgb, K[4]);
+
+   Normal.t += dot(Texel[15].rgb, K[5]);
+   Normal.t += dot(Texel[16].rgb, K[6]);
+   Normal.t += dot(Texel[17].rgb, K[7]);
+   Normal.t += dot(Texel[18].rgb, K[8]);
+   Normal.t += dot(Texel[19].rgb, K[9]);
+
+   //Unnormalised gradient and depth, fetched by the vertex shader
+   gl_FragColor = vec4(Normal.st, dot(texture2D(Depth, Coord[2], Blur).rgb, DepthLum), 1.0);
+   }
\ No newline at end of file
@@ -5,6 +5,7 @@
 uniform sampler2D Texture;
 uniform sampler2D Palette;
 uniform float Select;         //Palette table selection (in normalised texture coordinates)
+uniform float Steps;          //Number of palette steps during indexed capture, or 0 for a smooth lookup
 
 void main(void)
    {
@@ -13,5 +14,8 @@ void main(void)
 
    Lookup = clamp(Lookup, 0.0, 1.0);
 
+   //Snap to the palette steps, so each output colour maps to a capture palette index
+   if (Steps > 0.0) {Lookup = (floor(Lookup * (Steps - 1.0) + 0.5) + 0.5) / Steps;}
+
    gl_FragColor = texture2D(Palette, vec2(Lookup, Select));
    }
\ No newline at end of file
@@ -5,9 +5,11 @@
 //Uniforms
 uniform sampler2D Depth;
 uniform sampler2D Video;
-uniform vec2 TexCoord;
 uniform float Range;
 
+//Per instance grid offset (xy) and texture coordinates (zw)
+attribute vec4 Instance;
+
 //Varying objects
 varying vec3 Normal;
 varying vec3 LightVector;
@@ -23,15 +25,16 @@ const float Blur = 2.0;
 
 void main(void)
    {
-   gl_TexCoord[0] = gl_TextureMatrix[0] * vec4(TexCoord, 0.0, 1.0);
-   gl_TexCoord[1] = gl_TextureMatrix[1] * vec4(TexCoord, 0.0, 1.0);
+   gl_TexCoord[0] = gl_TextureMatrix[0] * vec4(Instance.zw, 0.0, 1.0);
+   gl_TexCoord[1] = gl_TextureMatrix[1] * vec4(Instance.zw, 0.0, 1.0);
 
    Texel = texture2DLod(Depth, gl_TexCoord[0].st, Blur);
    float Z = dot(Texel.rgb, DepthLum);
    SpecularAtten = clamp(1.0 - Z, 0.0, 1.0);
 
-   //Vertex offset
+   //Vertex offset, moved to its grid cell
    vec4 Vertex = gl_Vertex;
+   Vertex.xy += Instance.xy;
    Vertex.z -= Z * Range;
 
    //Base diffuse colour
@@ -0,0 +1,207 @@
+/*===========================================================================
+   Process-Wide Asset Cache
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___ASSET_CACHE_CPP___
+#define ___ASSET_CACHE_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "asset_cache.h"
+#include "common.h"
+#include "debug.h"
+#include "file_png.h"
+#include "file_text.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Static data.
+  ---------------------------------------------------------------------------*/
+Array<AssetCache::Source> AssetCache::Sources;
+Array<AssetCache::Image> AssetCache::Images;
+Array<AssetCache::Object> AssetCache::Objects;
+QMutex AssetCache::Mutex;
+
+
+/*---------------------------------------------------------------------------
+   Appends the contents of a text file to a string, the same way as
+   File::Text::Load( ) does. The file is read only on the first request.
+
+   String : Receives the file contents.
+   Path   : Path to the text file.
+  ---------------------------------------------------------------------------*/
+void AssetCache::LoadText(std::string &String, const std::string &Path)
+   {
+   QMutexLocker Lock(&Mutex);
+
+   for (uiter I = 0; I < Sources.Size(); I++)
+      {
+      const Source* Item = Sources.Pointer() + I;
+      if (Item->Path == Path) {String += Item->Code; return;}
+      }
+
+   Source Item;
+   Item.Path = Path;
+
+   File::Text Text;
+   Text.Load(Item.Code, Path);
+
+   Sources += Item;
+   String += Item.Code;
+   }
+
+/*---------------------------------------------------------------------------
+   Copies a decoded PNG image into a texture. The file is decoded only on
+   the first request. The texture attributes are reset, so set them after
+   this call.
+
+   Image : Receives the image data.
+   Path  : Path to the PNG file.
+  ---------------------------------------------------------------------------*/
+void AssetCache::LoadPNG(Texture &Image, const std::string &Path)
+   {
+   QMutexLocker Lock(&Mutex);
+
+   for (uiter I = 0; I < Images.Size(); I++)
+      {
+      const AssetCache::Image* Item = Images.Pointer() + I;
+      if (Item->Path == Path) {Image = Item->Data; return;}
+      }
+
+   AssetCache::Image Item;
+   Item.Path = Path;
+
+   File::PNG PNG;
+   PNG.Load(Item.Data, Path);
+
+   Images += Item;
+   Image = Item.Data;
+   }
+
+/*---------------------------------------------------------------------------
+   Indicates whether a texture object can be used in an OpenGL context,
+   that is, whether the context shares objects with a context holding it.
+  ---------------------------------------------------------------------------*/
+bool AssetCache::Sharing(const Object &Item, const QGLContext* Context)
+   {
+   const Holder* H = Item.Holders.Pointer();
+
+   for (uiter I = 0; I < Item.Holders.Size(); I++)
+      {
+      if (H[I].Context == Context) {return true;}
+      if (H[I].Context != nullptr && Context != nullptr && QGLContext::areSharing(H[I].Context, Context)) {return true;}
+      }
+
+   return false;
+   }
+
+/*---------------------------------------------------------------------------
+   Makes a texture refer to the shared texture object of an image. If the
+   current OpenGL context has no access to such an object yet, one is
+   generated from the data and attributes of the texture, so load the image
+   with LoadPNG( ) and set the attributes beforehand. Users of the same
+   image must use the same attributes. Must be called within a valid OpenGL
+   context, and balanced with Release( ) in the same context.
+
+   Image : Texture to refer to the shared object.
+   Path  : Path to the image file, identifies the object.
+  ---------------------------------------------------------------------------*/
+void AssetCache::Acquire(Texture &Image, const std::string &Path)
+   {
+   QMutexLocker Lock(&Mutex);
+
+   const QGLContext* Context = QGLContext::currentContext();
+
+   Object* Item = nullptr;
+
+   for (uiter I = 0; I < Objects.Size(); I++)
+      {
+      if (Objects[I].Path == Path && Sharing(Objects[I], Context)) {Item = &Objects[I]; break;}
+      }
+
+   if (Item == nullptr)
+      {
+      Image.Buffer(false);
+      if (Image.GetID() < 1) {return;}
+
+      Object New;
+      New.Path = Path;
+      New.ID = Image.GetID();
+      New.Res = Image.Resolution();
+      New.Type = Image.DataType();
+
+      Item = &Objects[Objects + New];
+      }
+
+   Holder* H = Item->Holders.Pointer();
+   uiter I = 0;
+
+   while (I < Item->Holders.Size() && H[I].Context != Context) {I++;}
+
+   if (I < Item->Holders.Size()) {H[I].Users++;}
+   else
+      {
+      Holder New;
+      New.Context = Context;
+      New.Users = 1;
+      Item->Holders += New;
+      }
+
+   Image.Share(Item->ID, Item->Res, Item->Type);
+   }
+
+/*---------------------------------------------------------------------------
+   Releases a texture acquired with Acquire( ), and deletes the texture
+   object once it has no users left. The texture is destroyed. Must be
+   called within a valid OpenGL context.
+  ---------------------------------------------------------------------------*/
+void AssetCache::Release(Texture &Image)
+   {
+   if (!Image.IsShared()) {return;}
+
+   QMutexLocker Lock(&Mutex);
+
+   const QGLContext* Context = QGLContext::currentContext();
+
+   for (uiter I = 0; I < Objects.Size(); I++)
+      {
+      Object* Item = &Objects[I];
+      if (Item->ID != Image.GetID() || !Sharing(*Item, Context)) {continue;}
+
+      //Prefer the current context, any sharing context holding the object will do otherwise
+      Holder* H = Item->Holders.Pointer();
+      uiter J = 0;
+
+      while (J < Item->Holders.Size() && H[J].Context != Context) {J++;}
+      if (J >= Item->Holders.Size()) {J = 0;}
+
+      if (--H[J].Users < 1) {Item->Holders.Remove(J);}
+
+      if (Item->Holders.Size() < 1)
+         {
+         debug("Released texture ID: %d.\n", Item->ID);
+         glDeleteTextures(1, &Item->ID);
+         Objects.Remove(I);
+         }
+
+      break;
+      }
+
+   Image.Destroy();
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
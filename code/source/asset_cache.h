@@ -0,0 +1,100 @@
+/*===========================================================================
+   Process-Wide Asset Cache
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___ASSET_CACHE_H___
+#define ___ASSET_CACHE_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "texture.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Keeps the assets of the filters for the whole process, so constructing a
+  filter again, or the same filter in both OpenGL widgets, does not read
+  and decode the same files again. Shader sources and decoded images are
+  read once and kept in memory, and callers receive copies.
+
+  Texture objects made from images are shared between all filters whose
+  OpenGL contexts share objects. Each object counts its users per context,
+  and is deleted once the last user releases it.
+  ---------------------------------------------------------------------------*/
+class AssetCache
+   {
+   //---- Constants and definitions ----
+   private:
+
+   struct Source                                   //Cached shader source
+      {
+      std::string Path;                            //File path
+      std::string Code;                            //Source code
+      };
+
+   struct Image                                    //Cached decoded image
+      {
+      std::string Path;                            //File path
+      Texture Data;                                //Image data
+      };
+
+   struct Holder                                   //Users of a texture object in one context
+      {
+      const QGLContext* Context;                   //OpenGL context, or nullptr if not created through Qt
+      uint Users;                                  //Number of textures referring to the object
+      };
+
+   struct Object                                   //Shared texture object
+      {
+      std::string Path;                            //Path of the image file
+      GLuint ID;                                   //Texture object ID
+      vector2u Res;                                //Texture resolution
+      Texture::TexType Type;                       //Texture internal format
+      Array<Holder, 4> Holders;                    //Contexts holding the object
+      };
+
+   //---- Member data ----
+   private:
+
+   static Array<Source> Sources;                   //Shader sources read so far
+   static Array<Image> Images;                     //Images decoded so far
+   static Array<Object> Objects;                   //Texture objects in use
+   static QMutex Mutex;                            //Serialises access to the cache
+
+   //---- Methods ----
+   public:
+
+   AssetCache(void) {}
+   ~AssetCache(void) {}
+
+   private:
+
+   AssetCache(const AssetCache &obj);              //Disable
+   AssetCache &operator = (const AssetCache &obj); //Disable
+
+   static bool Sharing(const Object &Item, const QGLContext* Context);
+
+   public:
+
+   static void LoadText(std::string &String, const std::string &Path);
+   static void LoadPNG(Texture &Image, const std::string &Path);
+   static void Acquire(Texture &Image, const std::string &Path);
+   static void Release(Texture &Image);
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,507 @@
+/*===========================================================================
+   Headless Batch Renderer
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___BATCH_CPP___
+#define ___BATCH_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "batch.h"
+#include "common.h"
+#include "debug.h"
+#include "filter_chain.h"
+#include "filter_fatty.h"
+#include "filter_lines.h"
+#include "filter_lines_cpu.h"
+#include "filter_nmap.h"
+#include "filter_nmap_cpu.h"
+#include "filter_palette.h"
+#include "filter_palette_cpu.h"
+#include "filter_solids.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+Batch::Batch(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Batch::~Batch(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Batch::Clear(void)
+   {
+   Device = nullptr;
+   FX = nullptr;
+   SynthFrames = 0;
+   SynthLeft = 0;
+   Software = false;
+   Check = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Batch::Destroy(void)
+   {
+   Stop();
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Creates a filter by its command line name, see FilterNames( ). Names
+   joined with '+' create a filter chain, such as "nmap+thermal". Returns
+   nullptr if a name is unknown.
+
+   Name     : Filter name.
+   Software : Create the software renderer of the filter, see
+              SoftwareNames( ). Returns nullptr for other filters, and for
+              chains.
+  ---------------------------------------------------------------------------*/
+Filter* Batch::CreateFilter(const std::string &Name, bool Software)
+   {
+   if (Software)
+      {
+      if (Name == "lines") {return new FilterLinesCPU();}
+      if (Name == "nmap") {return new FilterNMapCPU();}
+      if (Name == "grey") {return new FilterPaletteCPU(FilterPalette::Grey);}
+      if (Name == "thermal") {return new FilterPaletteCPU(FilterPalette::Thermal);}
+      if (Name == "spectrum") {return new FilterPaletteCPU(FilterPalette::Spectrum);}
+      if (Name == "saturate") {return new FilterPaletteCPU(FilterPalette::Saturate);}
+
+      return nullptr;
+      }
+
+   if (Name.find('+') != std::string::npos)
+      {
+      FilterChain* Chain = new FilterChain();
+      usize Start = 0;
+
+      while (true)
+         {
+         usize End = Name.find('+', Start);
+         Filter* FX = CreateFilter(Name.substr(Start, End == std::string::npos ? std::string::npos : End - Start));
+         if (FX == nullptr) {delete Chain; return nullptr;}
+         Chain->Append(FX);
+         if (End == std::string::npos) {break;}
+         Start = End + 1;
+         }
+
+      return Chain;
+      }
+
+   if (Name == "video") {return new Filter();}
+   if (Name == "lines") {return new FilterLines();}
+   if (Name == "fatty") {return new FilterFatty();}
+   if (Name == "cubes") {return new FilterSolids(FilterSolids::Cubes);}
+   if (Name == "spheres") {return new FilterSolids(FilterSolids::Spheres);}
+   if (Name == "cubes-tinted") {return new FilterSolids(FilterSolids::CubesTinted);}
+   if (Name == "spheres-tinted") {return new FilterSolids(FilterSolids::SpheresTinted);}
+   if (Name == "cubes-far") {return new FilterSolids(FilterSolids::CubesFar);}
+   if (Name == "spheres-far") {return new FilterSolids(FilterSolids::SpheresFar);}
+   if (Name == "nmap") {return new FilterNMap();}
+   if (Name == "grey") {return new FilterPalette(FilterPalette::Grey);}
+   if (Name == "thermal") {return new FilterPalette(FilterPalette::Thermal);}
+   if (Name == "spectrum") {return new FilterPalette(FilterPalette::Spectrum);}
+   if (Name == "saturate") {return new FilterPalette(FilterPalette::Saturate);}
+
+   return nullptr;
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the list of filter names accepted by CreateFilter( ).
+  ---------------------------------------------------------------------------*/
+const char* Batch::FilterNames(void)
+   {
+   return "video, lines, fatty, cubes, spheres, cubes-tinted, spheres-tinted, "
+          "cubes-far, spheres-far, nmap, grey, thermal, spectrum, saturate, "
+          "or several of these joined with '+' to chain them";
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the list of filters that have a software renderer.
+  ---------------------------------------------------------------------------*/
+const char* Batch::SoftwareNames(void)
+   {
+   return "lines, nmap, grey, thermal, spectrum, saturate";
+   }
+
+/*---------------------------------------------------------------------------
+   Renders generated frames instead of recordings. The depth and video paths
+   passed to Run( ) are ignored.
+
+   Config : Generator configuration. A frame rate of 0 renders as fast as
+            possible.
+   Frames : Number of frames to generate, or 0 to read recordings again.
+  ---------------------------------------------------------------------------*/
+void Batch::SetSynthetic(const Synthetic::Settings &Config, uint64 Frames)
+   {
+   SynthConfig = Config;
+   SynthFrames = Frames;
+   }
+
+/*---------------------------------------------------------------------------
+   Renders with the software filters, without an OpenGL context. Only the
+   filters listed by SoftwareNames( ) can be used.
+  ---------------------------------------------------------------------------*/
+void Batch::SetSoftware(bool Enable)
+   {
+   Software = Enable;
+   }
+
+/*---------------------------------------------------------------------------
+   Compares every rendered frame with the reference renderer of the filter,
+   see Filter::Reference( ). The reference runs outside the timed part of
+   the frame, so the reported rendering rate is not affected.
+  ---------------------------------------------------------------------------*/
+void Batch::SetCheck(bool Enable)
+   {
+   Check = Enable;
+   }
+
+/*---------------------------------------------------------------------------
+   Opens the sources, creates the filter, and the offscreen context unless
+   the filter renders on the CPU.
+  ---------------------------------------------------------------------------*/
+void Batch::Start(const std::string &Name, const std::string &DepthPath, const std::string &VideoPath)
+   {
+   Stop();
+
+   FX = CreateFilter(Name, Software);
+   if (FX == nullptr && Software) {throw dexception("Filter %s has no software renderer. Use one of: %s.", Name.c_str(), SoftwareNames());}
+   if (FX == nullptr) {throw dexception("Unknown filter: %s. Use one of: %s.", Name.c_str(), FilterNames());}
+
+   Device = new Kinect(Buffer);
+
+   if (SynthFrames > 0)
+      {
+      Device->SetSynthetic(&SynthConfig);
+      if (FX->UsesDepth()) {Device->StartDepth();}
+      if (FX->UsesVideo()) {Device->StartVideo();}
+      SynthLeft = SynthFrames;
+      }
+
+   else
+      {
+      if (FX->UsesDepth() && DepthPath.size() < 1) {throw dexception("Filter %s needs a depth recording.", Name.c_str());}
+      if (FX->UsesVideo() && VideoPath.size() < 1) {throw dexception("Filter %s needs a video recording.", Name.c_str());}
+
+      if (FX->UsesDepth())
+         {
+         usize Length = DepthPath.size();
+         bool Stream = Length > 5 && DepthPath.compare(Length - 5, 5, ".kfxp") == 0;
+
+         if (Stream) {DepthStream.Open(DepthPath);}
+         else {DepthFrames.Open(DepthPath);}
+         }
+
+      if (FX->UsesVideo()) {VideoFrames.Open(VideoPath);}
+      }
+
+   if (!FX->UsesGL())
+      {
+      debug("Batch rendering with the %s filter, on the CPU.\n", Name.c_str());
+      return;
+      }
+
+   //Without a usable context, fall back to the software renderer if there is one
+   try {StartGL();}
+
+   catch (std::exception &e)
+      {
+      Filter* CPU = CreateFilter(Name, true);
+      if (CPU == nullptr) {throw;}
+
+      Context.Close();
+      delete FX;
+      FX = CPU;
+
+      debug("%s Batch rendering with the %s filter, on the CPU.\n", e.what(), Name.c_str());
+      return;
+      }
+
+   debug("Batch rendering with the %s filter, on %s.\n", Name.c_str(), (const char*)glGetString(GL_RENDERER));
+   }
+
+/*---------------------------------------------------------------------------
+   Creates the offscreen context. The GL state matches
+   GLWidget::initializeGL( ).
+  ---------------------------------------------------------------------------*/
+void Batch::StartGL(void)
+   {
+   Context.Create();
+
+   GLenum Error = glewInit();
+
+   //A GLEW built for GLX looks for an X display after loading the entry points, which an EGL context doesn't have
+   #if defined (EGL) && defined (GLEW_ERROR_NO_GLX_DISPLAY)
+      if (Error == GLEW_ERROR_NO_GLX_DISPLAY) {Error = GLEW_OK;}
+   #endif
+
+   if (GLEW_OK != Error) {throw dexception("glewInit( ) failed: %s.", glewGetErrorString(Error));}
+
+   if (!GLEW_ARB_framebuffer_object)
+      {throw dexception("Current OpenGL context does not support frame buffer objects.");}
+
+   glEnable(GL_DEPTH_TEST);
+   glEnable(GL_CULL_FACE);
+   glEnable(GL_RESCALE_NORMAL);
+   glCullFace(GL_BACK);
+   glShadeModel(GL_SMOOTH);
+   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   glEnable(GL_POINT_SMOOTH);
+   glEnable(GL_LINE_SMOOTH);
+   glEnable(GL_MULTISAMPLE);
+   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+   }
+
+/*---------------------------------------------------------------------------
+   Releases the filter while its context is still current, then closes the
+   sources and the context.
+  ---------------------------------------------------------------------------*/
+void Batch::Stop(void)
+   {
+   if (FX != nullptr)
+      {
+      if (Context.Ready()) {Context.MakeCurrent();}
+      delete FX;
+      FX = nullptr;
+      }
+
+   delete Device;
+   Device = nullptr;
+
+   Context.Close();
+
+   DepthFrames.Close();
+   DepthStream.Close();
+   VideoFrames.Close();
+   }
+
+/*---------------------------------------------------------------------------
+   Reads the next frame of each source the filter uses, and publishes them
+   into the buffers. Returns false when a source has no more frames.
+  ---------------------------------------------------------------------------*/
+bool Batch::Feed(uint32 Time)
+   {
+   if (Device->IsSynthetic())
+      {
+      if (SynthLeft < 1) {return false;}
+      SynthLeft--;
+      return Device->Update();
+      }
+
+   if (FX->UsesDepth())
+      {
+      bool Read = DepthStream.Ready() ? DepthStream.Read(Depth) : DepthFrames.Read(Depth);
+      if (!Read) {return false;}
+      Device->FeedDepth(Depth, Time);
+      }
+
+   if (FX->UsesVideo())
+      {
+      if (!VideoFrames.Read(Video)) {return false;}
+      Device->FeedVideo(Video, Time);
+      }
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Compares the captured frame with the reference frame, and adds the
+   pixels that differ by more than CheckTolerance to the statistics.
+  ---------------------------------------------------------------------------*/
+void Batch::Compare(Metrics &Stats)
+   {
+   if (Expected.Size() != Frame.Size() || Frame.DataType() != Texture::TypeRGB)
+      {throw dexception("Reference frame does not match the filter output.");}
+
+   const uint8* A = Frame.Pointer();
+   const uint8* B = Expected.Pointer();
+   const usize Pixels = Frame.Size() / 3;
+
+   for (uiter I = 0; I < Pixels; I++, A += 3, B += 3)
+      {
+      uint Error = 0;
+
+      for (uiter C = 0; C < 3; C++)
+         {
+         int D = (int)A[C] - (int)B[C];
+         Error = Math::Max(Error, (uint)((D < 0) ? -D : D));
+         }
+
+      if (Error > Batch::CheckTolerance) {Stats.Mismatches++;}
+      Stats.MaxError = Math::Max(Stats.MaxError, Error);
+      }
+
+   Stats.Checked++;
+   }
+
+/*---------------------------------------------------------------------------
+   Prints a progress line, or the final summary.
+  ---------------------------------------------------------------------------*/
+void Batch::Print(FILE* Report, const Metrics &Stats, bool Final)
+   {
+   if (Report == nullptr) {return;}
+
+   double Seconds = Math::Max(Stats.Seconds, 0.001);
+   double Render = Math::Max(Stats.RenderSeconds, 0.001);
+
+   double Upload = (Stats.Frames > 0) ? Stats.UploadSeconds * 1000.0 / (double)Stats.Frames : 0.0;
+
+   fprintf(Report, "%s%llu frames, %.1f s, %.1f fps, %.1f fps rendering, %.2f ms upload",
+      Final ? "" : "\r", (unsigned long long)Stats.Frames, Stats.Seconds,
+      (double)Stats.Frames / Seconds, (double)Stats.Frames / Render, Upload);
+
+   if (Final && Stats.Checked > 0)
+      {
+      fprintf(Report, ", %llu frames dropped, %llu frames checked, %llu pixels off, max error %u\n",
+         (unsigned long long)Stats.Dropped, (unsigned long long)Stats.Checked, (unsigned long long)Stats.Mismatches, Stats.MaxError);
+      }
+
+   else if (Final) {fprintf(Report, ", %llu frames dropped\n", (unsigned long long)Stats.Dropped);}
+
+   fflush(Report);
+   }
+
+/*---------------------------------------------------------------------------
+   Renders a recorded session through a filter.
+
+   Name      : Filter name, see FilterNames( ).
+   DepthPath : Raw depth capture directory, or packed depth stream (.kfxp).
+   VideoPath : Video capture directory.
+   Target    : Output directory, created if it does not exist. If empty,
+               the frames are rendered but not written, see SetCheck( ).
+   Format    : Output file format.
+   Report    : Stream for progress reports, or nullptr.
+
+   Returns the statistics of the whole run.
+  ---------------------------------------------------------------------------*/
+Batch::Metrics Batch::Run(const std::string &Name, const std::string &DepthPath, const std::string &VideoPath, const std::string &Target, OutputFormat Format, FILE* Report)
+   {
+   Metrics Stats;
+   memset(&Stats, 0, sizeof(Stats));
+
+   const bool Save = Target.size() > 0;
+
+   QDir Dir(QString::fromLocal8Bit(Target.c_str()));
+   if (Save && !Dir.exists() && !Dir.mkpath(Dir.absolutePath())) {throw dexception("Failed to create directory: %s.", Target.c_str());}
+
+   const char* Ext = (Format == Batch::FormatPNG) ? "png" : "tga";
+
+   QTime Clock;
+   QElapsedTimer Timer;
+   Clock.start();
+   int LastReport = 0;
+   qint64 RenderTime = 0;
+   qint64 UploadTime = 0;
+
+   try {
+      Start(Name, DepthPath, VideoPath);
+
+      uint32 Time = 0;
+
+      while (Feed(Time++))
+         {
+         Timer.start();
+
+         if (!FX->Ready())
+            {
+            FX->Setup(Buffer);
+            FX->Assets(Buffer);
+            }
+
+         if (!FX->Update(Buffer)) {Stats.Dropped++; continue;}
+         UploadTime += FX->GetUploadTime();
+
+         FX->SetIndexed(true);
+         FX->Bind();
+         FX->Render();
+         FX->Unbind();
+
+         FX->Capture(Frame, Palette, true);
+
+         RenderTime += Timer.nsecsElapsed();
+
+         if (Check)
+            {
+            if (!FX->Reference(Expected)) {throw dexception("Filter %s has no reference renderer to check against.", Name.c_str());}
+            Compare(Stats);
+            }
+
+         if (Save)
+            {
+            QString FileName = QString("%1.").arg((long)Stats.Frames, Batch::FileNameDigits, 10, QLatin1Char('0')) + Ext;
+            QByteArray Path = Dir.absoluteFilePath(FileName).toLocal8Bit();
+
+            File::Writer::Block* Block = Writer.Acquire();
+
+            if (Format == Batch::FormatPNG) {PNG.Save(Frame, Palette, *Block, File::PNG::CompSpeed);}
+            else {TGA.Save(Frame, Palette, *Block, false, true);}
+
+            Writer.Submit(Block, Path.constData());
+            }
+
+         Stats.Frames++;
+
+         int Elapsed = Clock.elapsed();
+         if (Elapsed - LastReport >= Batch::ReportInterval)
+            {
+            LastReport = Elapsed;
+            Stats.Seconds = (double)Elapsed / 1000.0;
+            Stats.RenderSeconds = (double)RenderTime * 1.0e-9;
+            Stats.UploadSeconds = (double)UploadTime * 1.0e-9;
+            Print(Report, Stats, false);
+            }
+         }
+
+      Writer.Flush();
+      Stop();
+      }
+
+   catch (...)
+      {
+      Stop();
+      throw;
+      }
+
+   Stats.Seconds = (double)Clock.elapsed() / 1000.0;
+   Stats.RenderSeconds = (double)RenderTime * 1.0e-9;
+   Stats.UploadSeconds = (double)UploadTime * 1.0e-9;
+
+   debug("Batch rendered %llu frames in %.1f s, %llu dropped.\n",
+      (unsigned long long)Stats.Frames, Stats.Seconds, (unsigned long long)Stats.Dropped);
+
+   if (Report != nullptr && LastReport > 0) {fprintf(Report, "\n");}
+   Print(Report, Stats, true);
+
+   return Stats;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,141 @@
+/*===========================================================================
+   Headless Batch Renderer
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___BATCH_H___
+#define ___BATCH_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "buffers.h"
+#include "common.h"
+#include "file.h"
+#include "filter.h"
+#include "kinect.h"
+#include "offscreen.h"
+#include "synthetic.h"
+#include "texture.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Renders a recorded session through a filter without a window, as fast as
+  the frames can be decoded, rendered and encoded. The depth frames are raw
+  11-bit captures, either a directory of numbered images or a packed depth
+  stream. Video frames are read from a directory of numbered images. The
+  frames are fed through Kinect::FeedDepth( ) and Kinect::FeedVideo( ), so
+  the filter sees the same buffers as with a live sensor.
+
+  Each filter output is captured from the frame buffer object, and written
+  in the background as a numbered TGA or PNG file.
+
+  Instead of recordings, the frames may come from a Synthetic generator,
+  see SetSynthetic( ). These are published by Kinect::Update( ), the same
+  way as in the interactive mode.
+
+  Filters that have a software renderer run on the CPU, either when
+  requested with SetSoftware( ), or when no OpenGL context with frame
+  buffer object support can be created. With SetCheck( ), every frame is
+  also compared with the reference renderer of the filter.
+  ---------------------------------------------------------------------------*/
+class Batch
+   {
+   //---- Constants and definitions ----
+   public:
+
+   enum OutputFormat                               //Output file format
+      {
+      FormatTGA = 0,                               //RLE compressed TGA files
+      FormatPNG = 1                                //PNG files, fast compression
+      };
+
+   struct Metrics                                  //Rendering statistics
+      {
+      uint64 Frames;                               //Number of frames written
+      uint64 Dropped;                              //Number of frames the filter did not render
+      double Seconds;                              //Elapsed time
+      double RenderSeconds;                        //Time spent rendering and reading back the frames
+      double UploadSeconds;                        //Time spent uploading the input textures
+      uint64 Checked;                              //Number of frames compared with the reference renderer
+      uint64 Mismatches;                           //Number of pixels that differ from the reference by more than CheckTolerance
+      uint MaxError;                               //Largest difference from the reference, in 8-bit steps
+      };
+
+   static const uint FileNameDigits = 8;           //Number of digits to use in the file name counter
+   static const int ReportInterval = 1000;         //Progress report interval, in ms
+   static const uint CheckTolerance = 1;           //Rounding difference allowed against the reference renderer, in 8-bit steps
+
+   //---- Member data ----
+   private:
+
+   Offscreen Context;                              //OpenGL context
+   Buffers Buffer;                                 //Video and depth buffers
+   Kinect* Device;                                 //Publishes the frames into the buffers
+   Filter* FX;                                     //Effects filter
+   File::Sequence DepthFrames;                     //Depth image source
+   File::Packed DepthStream;                       //Packed depth stream source
+   File::Sequence VideoFrames;                     //Video image source
+   File::Writer Writer;                            //Background file writer
+   File::TGA TGA;                                  //Output encoders
+   File::PNG PNG;
+   Texture Depth;                                  //Source frames
+   Texture Video;
+   Texture Frame;                                  //Captured filter output
+   Texture Palette;                                //Colour map of indexed filter output
+   Texture Expected;                               //Output of the reference renderer
+   Synthetic::Settings SynthConfig;                //Generated source configuration
+   uint64 SynthFrames;                             //Number of frames to generate, or 0 to read recordings
+   uint64 SynthLeft;                               //Number of generated frames remaining
+   bool Software;                                  //Render with the software filters
+   bool Check;                                     //Compare each frame with the reference renderer
+
+   //---- Methods ----
+   public:
+
+   Batch(void);
+   ~Batch(void);
+
+   private:
+
+   Batch(const Batch &obj);                        //Disable
+   Batch &operator = (const Batch &obj);           //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Processing
+   void Start(const std::string &Name, const std::string &DepthPath, const std::string &VideoPath);
+   void StartGL(void);
+   void Stop(void);
+   bool Feed(uint32 Time);
+   void Compare(Metrics &Stats);
+   static void Print(FILE* Report, const Metrics &Stats, bool Final);
+
+   public:
+
+   static Filter* CreateFilter(const std::string &Name, bool Software = false);
+   static const char* FilterNames(void);
+   static const char* SoftwareNames(void);
+
+   void SetSynthetic(const Synthetic::Settings &Config, uint64 Frames);
+   void SetSoftware(bool Enable);
+   void SetCheck(bool Enable);
+
+   Metrics Run(const std::string &Name, const std::string &DepthPath, const std::string &VideoPath, const std::string &Target, OutputFormat Format = Batch::FormatTGA, FILE* Report = nullptr);
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
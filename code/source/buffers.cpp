@@ -31,6 +31,8 @@ Buffers::Buffers(void)
    Video[1] = new Texture;
    Depth[0] = new Texture;
    Depth[1] = new Texture;
+   DepthRaw[0] = new Texture;
+   DepthRaw[1] = new Texture;
    }
 
 /*---------------------------------------------------------------------------
@@ -46,9 +48,16 @@ Buffers::Buffers(const Buffers &obj) : MutexHandle()
    Video[1] = (obj.Video[1] != nullptr) ? new Texture(*obj.Video[1]) : new Texture;
    Depth[0] = (obj.Depth[0] != nullptr) ? new Texture(*obj.Depth[0]) : new Texture;
    Depth[1] = (obj.Depth[1] != nullptr) ? new Texture(*obj.Depth[1]) : new Texture;
+   DepthRaw[0] = (obj.DepthRaw[0] != nullptr) ? new Texture(*obj.DepthRaw[0]) : new Texture;
+   DepthRaw[1] = (obj.DepthRaw[1] != nullptr) ? new Texture(*obj.DepthRaw[1]) : new Texture;
+   DepthTable = obj.DepthTable;
    
    VideoCount = obj.VideoCount;
    DepthCount = obj.DepthCount;
+   DepthTableCount = obj.DepthTableCount;
+
+   VideoTime = obj.VideoTime;
+   DepthTime = obj.DepthTime;
    }
 
 /*---------------------------------------------------------------------------
@@ -67,9 +76,16 @@ Buffers &Buffers::operator = (const Buffers &obj)
    Video[1] = (obj.Video[1] != nullptr) ? new Texture(*obj.Video[1]) : new Texture;
    Depth[0] = (obj.Depth[0] != nullptr) ? new Texture(*obj.Depth[0]) : new Texture;
    Depth[1] = (obj.Depth[1] != nullptr) ? new Texture(*obj.Depth[1]) : new Texture;
+   DepthRaw[0] = (obj.DepthRaw[0] != nullptr) ? new Texture(*obj.DepthRaw[0]) : new Texture;
+   DepthRaw[1] = (obj.DepthRaw[1] != nullptr) ? new Texture(*obj.DepthRaw[1]) : new Texture;
+   DepthTable = obj.DepthTable;
 
    VideoCount = obj.VideoCount;
    DepthCount = obj.DepthCount;
+   DepthTableCount = obj.DepthTableCount;
+
+   VideoTime = obj.VideoTime;
+   DepthTime = obj.DepthTime;
 
    return *this;
    }
@@ -91,9 +107,15 @@ void Buffers::Clear(void)
    Video[1] = nullptr;
    Depth[0] = nullptr;
    Depth[1] = nullptr;
+   DepthRaw[0] = nullptr;
+   DepthRaw[1] = nullptr;
    
    VideoCount = 0;
    DepthCount = 0;
+   DepthTableCount = 0;
+
+   VideoTime = 0;
+   DepthTime = 0;
    }
 
 /*---------------------------------------------------------------------------
@@ -105,6 +127,9 @@ void Buffers::Destroy(void)
    delete Video[1];
    delete Depth[0];
    delete Depth[1];
+   delete DepthRaw[0];
+   delete DepthRaw[1];
+   DepthTable.Destroy();
 
    Clear();
    }
@@ -113,9 +138,11 @@ void Buffers::Destroy(void)
    Swaps the buffers, but only if the back and front buffers are unlocked.
    These functions also signal the update flag for each repsective buffer.
    Returns true if the swap was successful.
+
+   Time : Sensor time step of the new front buffer.
   ---------------------------------------------------------------------------*/
 //Swap video buffer
-bool Buffers::VideoSwap(void)
+bool Buffers::VideoSwap(uint32 Time)
    {
    MutexControl Mutex(GetMutexHandle());
    MutexControl Mutex0(Video[0]->GetMutexHandle());
@@ -128,24 +155,34 @@ bool Buffers::VideoSwap(void)
    Math::Swap(Video[0], Video[1]);
 
    VideoCount++;
+   VideoTime = Time;
 
    return true;
    }
 
 //Swap depth buffer
-bool Buffers::DepthSwap(void)
+bool Buffers::DepthSwap(uint32 Time)
    {
    MutexControl Mutex(GetMutexHandle());
    MutexControl Mutex0(Depth[0]->GetMutexHandle());
    MutexControl Mutex1(Depth[1]->GetMutexHandle());
+   MutexControl MutexRaw0(DepthRaw[0]->GetMutexHandle());
+   MutexControl MutexRaw1(DepthRaw[1]->GetMutexHandle());
 
    if (!Mutex.LockRequest()) {return false;}
    if (!Mutex0.LockRequest()) {return false;}
    if (!Mutex1.LockRequest()) {return false;}
 
+   //The raw values swap together with the converted ones, so they never 
+   // belong to different frames
+   if (!MutexRaw0.LockRequest()) {return false;}
+   if (!MutexRaw1.LockRequest()) {return false;}
+
    Math::Swap(Depth[0], Depth[1]);
+   Math::Swap(DepthRaw[0], DepthRaw[1]);
 
    DepthCount++;
+   DepthTime = Time;
 
    return true;
    }
@@ -182,6 +219,40 @@ bool Buffers::DepthUpdated(uiter &ID)
    return true;
    }
 
+/*---------------------------------------------------------------------------
+   Publishes the look-up table that converts raw 11-bit depth values into the
+   values of the depth buffers, so filters working from the raw depth
+   texture can apply it themselves. Signals an update for
+   DepthTableUpdated( ).
+
+   Table : Depth look-up table, indexed by the raw depth value.
+  ---------------------------------------------------------------------------*/
+void Buffers::SetDepthTable(const Array<uint16, 8> &Table)
+   {
+   MutexControl Mutex(GetMutexHandle());
+   Mutex.Lock();
+
+   DepthTable = Table;
+   DepthTableCount++;
+   }
+
+/*---------------------------------------------------------------------------
+   Copies the depth look-up table into Table and returns true, if it was
+   updated since the last test. Works the same way as DepthUpdated( ).
+  ---------------------------------------------------------------------------*/
+bool Buffers::DepthTableUpdated(uiter &ID, Array<uint16, 8> &Table)
+   {
+   MutexControl Mutex(GetMutexHandle());
+   if (!Mutex.LockRequest()) {return false;}
+
+   if (DepthTableCount == ID) {return false;}
+
+   ID = DepthTableCount;
+   Table = DepthTable;
+
+   return true;
+   }
+
 /*---------------------------------------------------------------------------
    Return selected texture buffer. Selects the front texture by default.
   ---------------------------------------------------------------------------*/
@@ -197,6 +268,16 @@ Texture &Buffers::GetDepth(Select I)
    return *Depth[I];
    }
 
+/*---------------------------------------------------------------------------
+   Returns the unprocessed depth texture. It holds the raw 11-bit sensor
+   values of the selected depth buffer, prior to the depth table 
+   conversion. Selects the front texture by default.
+  ---------------------------------------------------------------------------*/
+Texture &Buffers::GetDepthRaw(Select I) 
+   {
+   return *DepthRaw[I];
+   }
+
 /*---------------------------------------------------------------------------
    Returns selected texture resolution. Selects the front texture by default.
   ---------------------------------------------------------------------------*/
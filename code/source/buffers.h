@@ -11,6 +11,7 @@
 /*---------------------------------------------------------------------------
    Header files
   ---------------------------------------------------------------------------*/
+#include "array.h"
 #include "common.h"
 #include "texture.h"
 
@@ -38,9 +39,15 @@ class Buffers : public MutexHandle
 
    Texture* Video[2];                              //Front and back buffer video texture
    Texture* Depth[2];                              //Front and back buffer depth texture
+   Texture* DepthRaw[2];                           //Unprocessed 11-bit copies of the front and back depth textures
+   Array<uint16, 8> DepthTable;                    //Look-up table converting the raw depth values, published by the device
    
    uiter VideoCount;                               //Counts video updates, used for signalling
    uiter DepthCount;                               //Counts depth updates, used for signalling
+   uiter DepthTableCount;                          //Counts depth table updates, used for signalling
+
+   uint32 VideoTime;                               //Sensor time step of the front video texture
+   uint32 DepthTime;                               //Sensor time step of the front depth texture
 
    //---- Methods ----
    public:
@@ -59,20 +66,25 @@ class Buffers : public MutexHandle
    public:
 
    //Buffer control and signalling
-   bool VideoSwap(void);
-   bool DepthSwap(void);
+   bool VideoSwap(uint32 Time = 0);
+   bool DepthSwap(uint32 Time = 0);
    bool VideoUpdated(uiter &ID);
    bool DepthUpdated(uiter &ID);
+   void SetDepthTable(const Array<uint16, 8> &Table);
+   bool DepthTableUpdated(uiter &ID, Array<uint16, 8> &Table);
 
    //Data access
    Texture &GetVideo(Select I = Buffers::Front);
    Texture &GetDepth(Select I = Buffers::Front);
+   Texture &GetDepthRaw(Select I = Buffers::Front);
    vector2u GetVideoResolution(Select I = Buffers::Front) const;
    vector2u GetDepthResolution(Select I = Buffers::Front) const;
    Texture::TexType GetVideoDataType(Select I = Buffers::Front) const;
    Texture::TexType GetDepthDataType(Select I = Buffers::Front) const;
    inline uiter GetVideoCounter(void) const {return VideoCount;}
    inline uiter GetDepthCounter(void) const {return DepthCount;}
+   inline uint32 GetVideoTime(void) const {return VideoTime;}
+   inline uint32 GetDepthTime(void) const {return DepthTime;}
    };
 
 
@@ -11,9 +11,19 @@
 /*---------------------------------------------------------------------------
    Header files
   ---------------------------------------------------------------------------*/
+#include "file_adaptive.h"
+#include "file_archive.h"
+#include "file_binary.h"
+#include "file_delta.h"
+#include "file_index.h"
+#include "file_packed.h"
 #include "file_png.h"
+#include "file_sequence.h"
 #include "file_text.h"
 #include "file_tga.h"
+#include "file_transcoder.h"
+#include "file_writer.h"
+#include "file_y4m.h"
 
 
 //Namespaces
@@ -44,6 +54,8 @@ static const char* const FilterLinesVert = FilterVert;
 static const char* const FilterLinesFrag = "filter_lines.frag";
 static const char* const FilterFattyVert = "filter_fatty.vert";
 static const char* const FilterFattyFrag = "filter_fatty.frag";
+static const char* const FilterFattyGradientVert = FilterVert;
+static const char* const FilterFattyGradientFrag = "filter_fatty_gradient.frag";
 static const char* const FilterSolidsDepthVert = "filter_solids_depth.vert";
 static const char* const FilterSolidsVideoVert = "filter_solids_video.vert";
 static const char* const FilterSolidsFrag = "filter_solids.frag";
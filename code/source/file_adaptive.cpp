@@ -0,0 +1,184 @@
+/*===========================================================================
+   Adaptive Compression Control
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_ADAPTIVE_CPP___
+#define ___FILE_ADAPTIVE_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "file_adaptive.h"
+#include "file_writer.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+
+   Initial : Codec level used for the first frames.
+  ---------------------------------------------------------------------------*/
+Adaptive::Adaptive(Level Initial)
+   {
+   Clear();
+
+   if (Initial < 0 || Initial >= Adaptive::LevelCount) {throw dexception("Invalid parameters.");}
+
+   Current = Initial;
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Adaptive::~Adaptive(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Adaptive::Clear(void)
+   {
+   Current = Adaptive::LevelTGARLE;
+   Interval = -1.0f;
+   for (uint I = 0; I < Adaptive::LevelCount; I++) {Cost[I] = -1.0f;}
+   Wait = 0.0f;
+   Stable = 0;
+   Started = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Adaptive::Destroy(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Folds a sample into an exponential moving average. Negative values are
+   treated as unknown, and are replaced by the sample.
+  ---------------------------------------------------------------------------*/
+void Adaptive::Average(float &Value, float Sample)
+   {
+   if (Value < 0.0f) {Value = Sample; return;}
+   Value += (Sample - Value) * ((float)Adaptive::Weight / 100.0f);
+   }
+
+/*---------------------------------------------------------------------------
+   Changes the active level. The encode time of the new level is not
+   reset, but since it is only updated from frames encoded at that level,
+   stale values are refreshed within a few frames.
+  ---------------------------------------------------------------------------*/
+void Adaptive::Switch(Level Next)
+   {
+   debug("Adaptive capture: %s -> %s, frame interval %.1f ms, encode %.1f ms, writer wait %.1f ms.\n",
+      Adaptive::Name(Current), Adaptive::Name(Next), Interval, Cost[Current], Wait);
+
+   Current = Next;
+   Wait = 0.0f;
+   Stable = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Must be called when a source frame is about to be encoded.
+
+   Frames : Number of source frames since the previous call, including
+            frames that were dropped in between. The source frame
+            interval is the elapsed time divided by this count.
+  ---------------------------------------------------------------------------*/
+void Adaptive::Arrival(uint Frames)
+   {
+   if (!Started) {Clock.start(); Started = true; return;}
+
+   int Elapsed = Clock.restart();
+   if (Frames < 1 || Elapsed < 0) {return;}
+
+   Average(Interval, (float)Elapsed / (float)Frames);
+   }
+
+/*---------------------------------------------------------------------------
+   Must be called after a frame was encoded and submitted at the current
+   level. Returns true if the level was changed, which then applies to the
+   next frame.
+
+   EncodeTime : Time taken to encode the frame, in ms.
+   WaitTime   : Time spent waiting for a free writer block, in ms.
+   Depth      : Writer queue depth after the frame was submitted.
+  ---------------------------------------------------------------------------*/
+bool Adaptive::Update(int EncodeTime, int WaitTime, usize Depth)
+   {
+   Average(Cost[Current], (float)EncodeTime);
+   Average(Wait, (float)WaitTime);
+
+   Stable++;
+
+   if (Interval < 0.0f || Stable < Adaptive::SwitchFrames) {return false;}
+
+   //Forget slow measurements from time to time, since the frame content may have changed
+   if (Stable >= Adaptive::RetryFrames)
+      {
+      for (uint I = Current + 1; I < Adaptive::LevelCount; I++) {Cost[I] = -1.0f;}
+      Stable = Adaptive::ProbeFrames;
+      }
+
+   float Limit = Interval * ((float)Adaptive::Budget / 100.0f);
+   float ProbeLimit = Interval * ((float)Adaptive::ProbeBudget / 100.0f);
+
+   //Encoder is too slow, step down
+   if (Cost[Current] > Limit)
+      {
+      if (Current == Adaptive::LevelTGA) {return false;}
+      Switch((Level)(Current - 1));
+      return true;
+      }
+
+   if (Current + 1 >= Adaptive::LevelCount) {return false;}
+
+   Level Next = (Level)(Current + 1);
+   bool Fits = Cost[Next] < 0.0f ? Cost[Current] < ProbeLimit : Cost[Next] < Limit;
+
+   //Disk is too slow, step up to produce less data
+   bool DiskBound = Wait > 0.5f || Depth > Writer::MaxQueue / 2;
+   if (DiskBound && Fits) {Switch(Next); return true;}
+
+   //Encoder has spare time, probe the next level
+   if (Stable >= Adaptive::ProbeFrames && Fits) {Switch(Next); return true;}
+
+   return false;
+   }
+
+/*---------------------------------------------------------------------------
+   Returns a readable name for a codec level.
+  ---------------------------------------------------------------------------*/
+const char* Adaptive::Name(Level Select)
+   {
+   switch (Select)
+      {
+      case Adaptive::LevelTGA : return "TGA";
+      case Adaptive::LevelTGARLE : return "TGA-RLE";
+      case Adaptive::LevelPNGFast : return "PNG fast";
+      case Adaptive::LevelPNG : return "PNG";
+      case Adaptive::LevelPNGBest : return "PNG best";
+      default : return "unknown";
+      }
+   }
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,107 @@
+/*===========================================================================
+   Adaptive Compression Control
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_ADAPTIVE_H___
+#define ___FILE_ADAPTIVE_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+  Chooses the capture codec on the fly. The controller tracks the interval
+  between source frames, the time spent encoding each frame, and the time
+  spent waiting for the write-behind queue. It settles on the strongest
+  compression that still encodes within the frame interval:
+
+  - If encoding takes too long, it steps down to a weaker level.
+  - If the disk falls behind while encoding has time to spare, it steps up
+    to a stronger level, which produces less data.
+  - After a stable period with plenty of headroom, it probes the next
+    stronger level, unless that level was already measured as too slow.
+
+  Levels are only changed after SwitchFrames frames, so that each switch is
+  based on samples taken at the current level.
+  ---------------------------------------------------------------------------*/
+class Adaptive
+   {
+   //---- Constants and definitions ----
+   public:
+
+   enum Level                                      //Codec levels, ordered from weakest to strongest
+      {
+      LevelTGA = 0,                                //Uncompressed TGA
+      LevelTGARLE = 1,                             //Run-length encoded TGA
+      LevelPNGFast = 2,                            //PNG, fastest deflate level
+      LevelPNG = 3,                                //PNG, default deflate level
+      LevelPNGBest = 4,                            //PNG, best deflate level
+      LevelCount = 5                               //Number of levels
+      };
+
+   static const uint SwitchFrames = 15;            //Minimum number of frames between switches
+   static const uint ProbeFrames = 90;             //Stable frames before probing a stronger level
+   static const uint RetryFrames = 900;            //Stable frames before slow levels are measured again
+   static const uint Budget = 85;                  //Share of the frame interval available for encoding, in percent
+   static const uint ProbeBudget = 50;             //Encode time share below which an unmeasured level is probed, in percent
+   static const uint Weight = 10;                  //Weight of new samples in the moving averages, in percent
+
+   //---- Member data ----
+   private:
+
+   Level Current;                                  //Active codec level
+   float Interval;                                 //Average source frame interval, in ms, or negative if unknown
+   float Cost[LevelCount];                         //Average encode time for each level, in ms, or negative if unknown
+   float Wait;                                     //Average time spent waiting for the writer, in ms
+   uint Stable;                                    //Number of frames since the last switch
+   QTime Clock;                                    //Measures the frame interval
+   bool Started;                                   //Clock is running
+
+   //---- Methods ----
+   public:
+
+   Adaptive(Level Initial = Adaptive::LevelTGARLE);
+   ~Adaptive(void);
+
+   private:
+
+   Adaptive(const Adaptive &obj);                  //Disable
+   Adaptive &operator = (const Adaptive &obj);     //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Level selection
+   static void Average(float &Value, float Sample);
+   void Switch(Level Next);
+
+   public:
+
+   void Arrival(uint Frames = 1);
+   bool Update(int EncodeTime, int WaitTime, usize Depth);
+
+   static const char* Name(Level Select);
+
+   inline Level GetLevel(void) const {return Current;}
+   inline float GetInterval(void) const {return Interval;}
+   };
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,311 @@
+/*===========================================================================
+   Compressed Frame Archive
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_ARCHIVE_CPP___
+#define ___FILE_ARCHIVE_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "file_archive.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+   Static data.
+  ---------------------------------------------------------------------------*/
+const char* Archive::Magic = "KFXA";
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+Archive::Archive(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Archive::~Archive(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Archive::Clear(void)
+   {
+   Count = 0;
+   RawBytes = 0;
+   Bytes = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Archive::Destroy(void)
+   {
+   Close();
+
+   Scratch.Data.Destroy();
+   Scratch.Plain.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Converts between texture types and the type codes stored in the frame
+   headers. The OpenGL format values are not stored directly, since they
+   do not fit the header field.
+  ---------------------------------------------------------------------------*/
+uint8 Archive::TypeCode(Texture::TexType Type)
+   {
+   switch (Type)
+      {
+      case Texture::TypeAlpha : return 1;
+      case Texture::TypeLum : return 2;
+      case Texture::TypeDepth : return 3;
+      case Texture::TypeRGB : return 4;
+      case Texture::TypeRGBA : return 5;
+      default : throw dexception("Unsupported texture type for archiving.");
+      }
+   }
+
+bool Archive::CodeType(uint8 Code, Texture::TexType &Type)
+   {
+   switch (Code)
+      {
+      case 1 : Type = Texture::TypeAlpha; return true;
+      case 2 : Type = Texture::TypeLum; return true;
+      case 3 : Type = Texture::TypeDepth; return true;
+      case 4 : Type = Texture::TypeRGB; return true;
+      case 5 : Type = Texture::TypeRGBA; return true;
+      default : return false;
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Encodes an image into a frame record, ready to be written with Write( ).
+   The function only uses the record's storage, so it can be called from
+   several threads at once, as long as each thread has its own record.
+
+   Record : Receives the frame header and the compressed payload.
+   Image  : Source image.
+   Level  : zlib compression level, 1 to 9.
+  ---------------------------------------------------------------------------*/
+void Archive::Encode(Frame &Record, const Texture &Image, int Level)
+   {
+   if (Image.Size() < 1) {throw dexception("Invalid parameters.");}
+
+   vector2u Res = Image.Resolution();
+   if (Res.U > 0xFFFF || Res.V > 0xFFFF) {throw dexception("Invalid frame resolution.");}
+
+   const uint8 Code = TypeCode(Image.DataType());
+   const usize Size = Image.Size();
+   const usize Pixel = Image.GetBytesPerPixel();
+   const usize Line = Image.GetBytesPerLine();
+   const usize Used = (usize)Res.U * Pixel;
+
+   if (Record.Plain.Size() < Size) {Record.Plain.Create(Size - Record.Plain.Size());}
+
+   //Left-neighbour prediction, bytes beyond the pixel data are copied as is
+   const uint8* Src = Image.Pointer();
+   uint8* Dst = Record.Plain.Pointer();
+
+   for (uiter V = 0; V < Res.V; V++, Src += Line, Dst += Line)
+      {
+      for (uiter I = 0; I < Pixel; I++) {Dst[I] = Src[I];}
+      for (uiter I = Pixel; I < Used; I++) {Dst[I] = (uint8)(Src[I] - Src[I - Pixel]);}
+      for (uiter I = Used; I < Line; I++) {Dst[I] = Src[I];}
+      }
+
+   uLongf Packed = compressBound((uLong)Size);
+   usize Capacity = Archive::FrameHeaderSize + Packed;
+   if (Record.Data.Size() < Capacity) {Record.Data.Create(Capacity - Record.Data.Size());}
+
+   uint8* Header = Record.Data.Pointer();
+
+   if (compress2(Header + Archive::FrameHeaderSize, &Packed, Record.Plain.Pointer(), (uLong)Size, Math::Clamp(Level, 1, 9)) != Z_OK)
+      {throw dexception("Failed to compress archive frame.");}
+
+   Header[0] = (uint8)Packed;
+   Header[1] = (uint8)(Packed >> 8);
+   Header[2] = (uint8)(Packed >> 16);
+   Header[3] = (uint8)(Packed >> 24);
+   Header[4] = (uint8)Res.U;
+   Header[5] = (uint8)(Res.U >> 8);
+   Header[6] = (uint8)Res.V;
+   Header[7] = (uint8)(Res.V >> 8);
+   Header[8] = Code;
+   Header[9] = Archive::FilterSub;
+   Header[10] = 0;
+   Header[11] = 0;
+
+   Record.Used = Archive::FrameHeaderSize + Packed;
+   Record.RawSize = Size;
+   }
+
+/*---------------------------------------------------------------------------
+   Creates a new archive for writing. Existing files are overwritten.
+  ---------------------------------------------------------------------------*/
+void Archive::Create(const std::string &Path)
+   {
+   Close();
+
+   Stream.Create(Path);
+
+   Count = 0;
+   RawBytes = 0;
+   Bytes = Archive::HeaderSize;
+
+   Stream.Write(Archive::Magic, 4);
+   Stream.WriteValue(Archive::Version);
+   Stream.WriteValue(Archive::HeaderSize);
+   Stream.WriteValue((uint32)0);
+   Stream.WriteValue((uint32)0);
+   }
+
+/*---------------------------------------------------------------------------
+   Opens an existing archive for reading.
+  ---------------------------------------------------------------------------*/
+void Archive::Open(const std::string &Path)
+   {
+   Close();
+
+   Stream.Open(Path);
+
+   uint8 Header[8];
+   Stream.Read(Header, sizeof(Header));
+   if (memcmp(Header, Archive::Magic, 4) != 0) {throw dexception("Not a frame archive: %s.", Path.c_str());}
+
+   uint16 FileVersion = (uint16)(Header[4] | (Header[5] << 8));
+   uint16 FileHeaderSize = (uint16)(Header[6] | (Header[7] << 8));
+   if (FileVersion != Archive::Version || FileHeaderSize < Archive::HeaderSize) {throw dexception("Unsupported archive version.");}
+
+   Stream.Seek(FileHeaderSize);
+
+   Count = 0;
+   RawBytes = 0;
+   Bytes = FileHeaderSize;
+   }
+
+/*---------------------------------------------------------------------------
+   Closes the archive.
+  ---------------------------------------------------------------------------*/
+void Archive::Close(void)
+   {
+   if (!Stream.Ready()) {return;}
+
+   bool Writing = Stream.IsWriting();
+   Stream.Close();
+
+   if (Writing && RawBytes > 0)
+      {
+      debug("Closed frame archive, %llu frames, %.1f%% of the uncompressed size.\n",
+         (unsigned long long)Count, 100.0 * (double)Bytes / (double)RawBytes);
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Appends a frame record, prepared by Encode( ).
+  ---------------------------------------------------------------------------*/
+void Archive::Write(const Frame &Record)
+   {
+   if (!Stream.IsWriting()) {throw dexception("Archive is not open for writing.");}
+   if (Record.Used < Archive::FrameHeaderSize) {throw dexception("Invalid parameters.");}
+
+   Stream.Write(Record.Data.Pointer(), Record.Used);
+
+   RawBytes += Record.RawSize;
+   Bytes += Record.Used;
+   Count++;
+   }
+
+/*---------------------------------------------------------------------------
+   Encodes and appends a frame.
+  ---------------------------------------------------------------------------*/
+void Archive::Write(const Texture &Image, int Level)
+   {
+   if (!Stream.IsWriting()) {throw dexception("Archive is not open for writing.");}
+
+   Encode(Scratch, Image, Level);
+   Write(Scratch);
+   }
+
+/*---------------------------------------------------------------------------
+   Reads the next frame into Image. The image is recreated if its size or
+   type differs from the frame. Returns false at the end of the archive.
+  ---------------------------------------------------------------------------*/
+bool Archive::Read(Texture &Image)
+   {
+   if (!Stream.IsReading()) {throw dexception("Archive is not open for reading.");}
+
+   uint8 Header[Archive::FrameHeaderSize];
+   if (!Stream.ReadHeader(Header, sizeof(Header))) {return false;}
+
+   usize Size = (usize)Header[0] | ((usize)Header[1] << 8) | ((usize)Header[2] << 16) | ((usize)Header[3] << 24);
+
+   vector2u Res;
+   Res.U = (uint)(Header[4] | (Header[5] << 8));
+   Res.V = (uint)(Header[6] | (Header[7] << 8));
+
+   Texture::TexType Type;
+   if (Size < 1 || Res.U < 1 || Res.V < 1 || !CodeType(Header[8], Type) || Header[9] > Archive::FilterSub)
+      {throw dexception("Corrupt archive frame header.");}
+
+   vector2u ImageRes = Image.Resolution();
+   if (ImageRes.U != Res.U || ImageRes.V != Res.V || Image.DataType() != Type || Image.Size() < 1)
+      {
+      Image.Create(Res, Type);
+      }
+
+   if (Scratch.Data.Size() < Size) {Scratch.Data.Create(Size - Scratch.Data.Size());}
+   Stream.Read(Scratch.Data.Pointer(), Size);
+
+   uLongf Plain = (uLongf)Image.Size();
+   if (uncompress(Image.Pointer(), &Plain, Scratch.Data.Pointer(), (uLong)Size) != Z_OK || Plain != Image.Size())
+      {throw dexception("Corrupt archive frame.");}
+
+   if (Header[9] == Archive::FilterSub)
+      {
+      const usize Pixel = Image.GetBytesPerPixel();
+      const usize Line = Image.GetBytesPerLine();
+      const usize Used = (usize)Res.U * Pixel;
+
+      uint8* Ptr = Image.Pointer();
+
+      for (uiter V = 0; V < Res.V; V++, Ptr += Line)
+         {
+         for (uiter I = Pixel; I < Used; I++) {Ptr[I] = (uint8)(Ptr[I] + Ptr[I - Pixel]);}
+         }
+      }
+
+   RawBytes += Image.Size();
+   Bytes += Archive::FrameHeaderSize + Size;
+   Count++;
+
+   return true;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
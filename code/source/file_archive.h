@@ -0,0 +1,130 @@
+/*===========================================================================
+   Compressed Frame Archive
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_ARCHIVE_H___
+#define ___FILE_ARCHIVE_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "file_binary.h"
+#include "texture.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+  Single file container for a whole capture session. Each frame is stored
+  as one deflated record, after the same left-neighbour byte prediction as
+  the PNG Sub filter, so the archive is lossless for any texture type, and
+  can be read back frame by frame.
+
+  Encode( ) only touches the Frame record passed to it, so any number of
+  frames can be compressed concurrently, and then written in order with
+  Write( ). All header values are little-endian:
+
+  Offset | Stream header       Offset | Frame header
+  ---    | ---                 ---    | ---
+  0      | char[4] "KFXA"      0      | uint32 Size, payload bytes
+  4      | uint16 Version      4      | uint16 ResU
+  6      | uint16 HeaderSize   6      | uint16 ResV
+  8      | uint32 Reserved     8      | uint8 Type, see TypeCode( )
+  12     | uint32 Reserved     9      | uint8 Filter
+                               10     | uint16 Reserved
+  ---------------------------------------------------------------------------*/
+class Archive
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const char* Magic;                       //Stream identifier
+   static const uint16 Version = 1;                //Format version
+   static const uint16 HeaderSize = 16;            //Stream header size in bytes
+   static const usize FrameHeaderSize = 12;        //Frame header size in bytes
+   static const int DefaultLevel = 6;              //Default zlib compression level
+
+   enum FilterType                                 //Byte prediction enumeration
+      {
+      FilterNone = 0,                              //Bytes are stored as they are
+      FilterSub = 1                                //Bytes are stored as the difference to the previous pixel
+      };
+
+   class Frame                                     //Encoded frame record, including its header
+      {
+      friend class Archive;
+
+      private:
+      Array<uint8, 4096> Data;                     //Frame record, grows but never shrinks
+      Array<uint8, 4096> Plain;                    //Filtered frame, before compression
+      usize Used;                                  //Number of bytes used in Data
+      usize RawSize;                               //Uncompressed frame size
+
+      public:
+      Frame(void) : Used(0), RawSize(0) {}
+      inline const uint8* Pointer(void) const {return Data.Pointer();}
+      inline usize Size(void) const {return Used;}
+      inline usize GetRawSize(void) const {return RawSize;}
+      };
+
+   //---- Member data ----
+   private:
+
+   Binary Stream;                                  //Stream file
+   Frame Scratch;                                  //Frame record for Write(const Texture&) and Read( )
+   uint64 Count;                                   //Number of frames written or read
+   uint64 RawBytes;                                //Uncompressed size of the frames
+   uint64 Bytes;                                   //Bytes written or read
+
+   //---- Methods ----
+   public:
+
+   Archive(void);
+   ~Archive(void);
+
+   private:
+
+   Archive(const Archive &obj);                    //Disable
+   Archive &operator = (const Archive &obj);       //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Frame encoding
+   static uint8 TypeCode(Texture::TexType Type);
+   static bool CodeType(uint8 Code, Texture::TexType &Type);
+
+   public:
+
+   static void Encode(Frame &Record, const Texture &Image, int Level = Archive::DefaultLevel);
+
+   void Create(const std::string &Path);
+   void Open(const std::string &Path);
+   void Close(void);
+   void Write(const Frame &Record);
+   void Write(const Texture &Image, int Level = Archive::DefaultLevel);
+   bool Read(Texture &Image);
+
+   inline bool Ready(void) const {return Stream.Ready();}
+   inline uint64 GetFrames(void) const {return Count;}
+   inline uint64 GetRawBytes(void) const {return RawBytes;}
+   inline uint64 GetBytes(void) const {return Bytes;}
+   };
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,171 @@
+/*===========================================================================
+   Binary File Stream
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_BINARY_CPP___
+#define ___FILE_BINARY_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "file_binary.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+Binary::Binary(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Binary::~Binary(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Binary::Clear(void)
+   {
+   File = nullptr;
+   Writing = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Binary::Destroy(void)
+   {
+   Close();
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Opens a file, and installs the stream buffer.
+
+   Path : Path to the file.
+   Mode : Mode passed to fopen( ).
+   Size : Size of the stream buffer, or 0 to keep the default buffering.
+  ---------------------------------------------------------------------------*/
+void Binary::Attach(const std::string &Path, const char* Mode, usize Size)
+   {
+   Close();
+
+   #if defined (WINDOWS)
+      if (fopen_s(&File, Path.c_str(), Mode) != 0)
+         {File = nullptr; throw dexception("Failed to open file: %s.", Path.c_str());}
+   #else
+      File = fopen(Path.c_str(), Mode);
+      if (File == nullptr) {throw dexception("Failed to open file: %s.", Path.c_str());}
+   #endif
+
+   if (Size < 1) {return;}
+
+   Buffer.Create(Size);
+   if (setvbuf(File, Buffer.Pointer(), _IOFBF, Buffer.Size()) != 0)
+      {Close(); throw dexception("setvbuf( ) failed.");}
+   }
+
+/*---------------------------------------------------------------------------
+   Creates a new file for writing. Existing files are overwritten.
+
+   Path : Path to the file.
+   Size : Size of the stream buffer, or 0 to keep the default buffering.
+  ---------------------------------------------------------------------------*/
+void Binary::Create(const std::string &Path, usize Size)
+   {
+   Attach(Path, "wb", Size);
+   Writing = true;
+   }
+
+/*---------------------------------------------------------------------------
+   Opens an existing file for reading.
+
+   Path : Path to the file.
+   Size : Size of the stream buffer, or 0 to keep the default buffering.
+  ---------------------------------------------------------------------------*/
+void Binary::Open(const std::string &Path, usize Size)
+   {
+   Attach(Path, "rb", Size);
+   Writing = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Flushes and closes the file, and releases the stream buffer.
+  ---------------------------------------------------------------------------*/
+void Binary::Close(void)
+   {
+   if (File == nullptr) {return;}
+
+   if (Writing) {fflush(File);}
+   fclose(File);
+
+   File = nullptr;
+   Writing = false;
+   Buffer.Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Writes or reads raw data.
+  ---------------------------------------------------------------------------*/
+void Binary::Write(const void* Ptr, usize Size)
+   {
+   if (fwrite(Ptr, 1, Size, File) != Size) {throw dexception("File I/O error.");}
+   }
+
+void Binary::Read(void* Ptr, usize Size)
+   {
+   if (fread(Ptr, 1, Size, File) != Size) {throw dexception("Unexpected end of file.");}
+   }
+
+/*---------------------------------------------------------------------------
+   Reads the start of a record. Returns false if the file ends before the
+   record, and throws if it ends within it.
+  ---------------------------------------------------------------------------*/
+bool Binary::ReadHeader(void* Ptr, usize Size)
+   {
+   usize Length = fread(Ptr, 1, Size, File);
+   if (Length == 0 && feof(File)) {return false;}
+   if (Length != Size) {throw dexception("Unexpected end of file.");}
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Moves to an offset from the start of the file.
+  ---------------------------------------------------------------------------*/
+void Binary::Seek(usize Offset)
+   {
+   if (fseek(File, (long)Offset, SEEK_SET) != 0) {throw dexception("File I/O error.");}
+   }
+
+/*---------------------------------------------------------------------------
+   Flushes the buffered data to the file.
+  ---------------------------------------------------------------------------*/
+void Binary::Flush(void)
+   {
+   if (fflush(File) != 0) {throw dexception("File I/O error.");}
+   }
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,102 @@
+/*===========================================================================
+   Binary File Stream
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_BINARY_H___
+#define ___FILE_BINARY_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+  Buffered binary file, shared by the stream formats. Values are written
+  and read in little-endian byte order, regardless of the machine. All
+  errors throw, except running out of data at the start of a record, see
+  ReadHeader( ).
+  ---------------------------------------------------------------------------*/
+class Binary
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const usize BufferSize = 4 << 20;        //Default size of the stream buffer, in bytes
+
+   //---- Member data ----
+   private:
+
+   FILE* File;                                     //File handle
+   bool Writing;                                   //File was opened for writing
+   Array<char, 256> Buffer;                        //Stream buffer
+
+   //---- Methods ----
+   public:
+
+   Binary(void);
+   ~Binary(void);
+
+   private:
+
+   Binary(const Binary &obj);                      //Disable
+   Binary &operator = (const Binary &obj);         //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   void Attach(const std::string &Path, const char* Mode, usize Size);
+
+   public:
+
+   void Create(const std::string &Path, usize Size = Binary::BufferSize);
+   void Open(const std::string &Path, usize Size = Binary::BufferSize);
+   void Close(void);
+
+   void Write(const void* Ptr, usize Size);
+   void Read(void* Ptr, usize Size);
+   bool ReadHeader(void* Ptr, usize Size);
+   void Seek(usize Offset);
+   void Flush(void);
+
+   inline bool Ready(void) const {return File != nullptr;}
+   inline bool IsWriting(void) const {return File != nullptr && Writing;}
+   inline bool IsReading(void) const {return File != nullptr && !Writing;}
+
+   /*------------------------------------------------------------------------
+      Writes or reads a single value in little-endian byte order.
+     ------------------------------------------------------------------------*/
+   template <typename TYPE> void WriteValue(TYPE Value)
+      {
+      if (!Math::MachineLittleEndian()) {Value = Math::SwapEndian(Value);}
+      Write(&Value, sizeof(TYPE));
+      }
+
+   template <typename TYPE> TYPE ReadValue(void)
+      {
+      TYPE Value;
+      Read(&Value, sizeof(TYPE));
+      if (!Math::MachineLittleEndian()) {Value = Math::SwapEndian(Value);}
+      return Value;
+      }
+   };
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,403 @@
+/*===========================================================================
+   Tile Delta Stream
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_DELTA_CPP___
+#define ___FILE_DELTA_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "file_delta.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+   Static data.
+  ---------------------------------------------------------------------------*/
+const char* Delta::Magic = "KFXD";
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+Delta::Delta(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Delta::~Delta(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Delta::Clear(void)
+   {
+   TileSize = Delta::DefaultTileSize;
+   KeyInterval = Delta::DefaultKeyInterval;
+   Tiles = 0;
+   Count = 0;
+   Keys = 0;
+   RawBytes = 0;
+   Bytes = 0;
+   FrameSize = 0;
+   Key = false;
+   Flipped = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Delta::Destroy(void)
+   {
+   Close();
+
+   Reference.Destroy();
+   Changed.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Writes a frame header, using the format of the Reference frame.
+
+   Kind  : Frame kind.
+   Size  : Payload size in bytes.
+   Count : Number of tiles in a delta frame.
+  ---------------------------------------------------------------------------*/
+void Delta::WriteHeader(FrameKind Kind, usize Size, usize Count)
+   {
+   Stream.WriteValue((uint32)Size);
+   Stream.WriteValue((uint8)Kind);
+   Stream.WriteValue((uint8)(Flipped ? Delta::FlagFlipped : 0));
+   Stream.WriteValue((uint16)0);
+   Stream.WriteValue((uint32)Reference.DataType());
+   Stream.WriteValue((uint16)Reference.Resolution().U);
+   Stream.WriteValue((uint16)Reference.Resolution().V);
+   Stream.WriteValue((uint32)Count);
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the number of pixel bytes in a tile, after clipping it to the
+   frame.
+  ---------------------------------------------------------------------------*/
+usize Delta::TileBytes(uiter Index) const
+   {
+   vector2u Res = Reference.Resolution();
+   uiter U = (Index % Tiles.U) * TileSize;
+   uiter V = (Index / Tiles.U) * TileSize;
+
+   return Math::Min((uiter)TileSize, (uiter)Res.U - U) * Math::Min((uiter)TileSize, (uiter)Res.V - V) * Reference.GetBytesPerPixel();
+   }
+
+/*---------------------------------------------------------------------------
+   Writes a tile of the Reference frame, or reads it into the Reference
+   frame, one row at a time.
+  ---------------------------------------------------------------------------*/
+void Delta::WriteTile(uiter Index)
+   {
+   vector2u Res = Reference.Resolution();
+   uiter U = (Index % Tiles.U) * TileSize;
+   uiter V = (Index / Tiles.U) * TileSize;
+   uiter End = Math::Min(V + TileSize, (uiter)Res.V);
+   usize Size = Math::Min((uiter)TileSize, (uiter)Res.U - U) * Reference.GetBytesPerPixel();
+
+   for (; V < End; V++) {Stream.Write(Reference.Address(U, V), Size);}
+   }
+
+void Delta::ReadTile(uiter Index)
+   {
+   vector2u Res = Reference.Resolution();
+   uiter U = (Index % Tiles.U) * TileSize;
+   uiter V = (Index / Tiles.U) * TileSize;
+   uiter End = Math::Min(V + TileSize, (uiter)Res.V);
+   usize Size = Math::Min((uiter)TileSize, (uiter)Res.U - U) * Reference.GetBytesPerPixel();
+
+   for (; V < End; V++) {Stream.Read(Reference.Address(U, V), Size);}
+   }
+
+/*---------------------------------------------------------------------------
+   Recreates the Reference frame and the tile grid for a new frame format.
+  ---------------------------------------------------------------------------*/
+void Delta::Resize(const vector2u &Res, Texture::TexType Type)
+   {
+   if (Res.U < 1 || Res.V < 1 || Res.U > 0xFFFF || Res.V > 0xFFFF) {throw dexception("Invalid frame resolution.");}
+
+   Reference.Create(Res, Type);
+
+   Tiles.U = (Res.U + TileSize - 1) / TileSize;
+   Tiles.V = (Res.V + TileSize - 1) / TileSize;
+
+   Changed.Destroy();
+   Changed.Create(Tiles.U * Tiles.V);
+   }
+
+/*---------------------------------------------------------------------------
+   Compares a row of tiles with the previous frame. The rows of each tile
+   are compared with memcmp( ), which is vectorised by the C library, and
+   stops at the first difference. Changed tiles are copied into the
+   reference frame, so it always matches what a reader reconstructs.
+  ---------------------------------------------------------------------------*/
+void Delta::Compare::Run(uiter Task)
+   {
+   const usize BPP = Image->GetBytesPerPixel();
+   const vector2u Res = Image->Resolution();
+   const uiter Start = Task * TileSize;
+   const uiter End = Math::Min(Start + TileSize, (uiter)Res.V);
+
+   for (uiter T = 0; T < Tiles.U; T++)
+      {
+      const uiter U = T * TileSize;
+      const usize Size = Math::Min((uiter)TileSize, (uiter)Res.U - U) * BPP;
+
+      bool Diff = false;
+      for (uiter V = Start; V < End && !Diff; V++)
+         {
+         Diff = memcmp(Image->Address(U, V), Reference->Address(U, V), Size) != 0;
+         }
+
+      Changed[Task * Tiles.U + T] = Diff ? 1 : 0;
+      if (!Diff) {continue;}
+
+      for (uiter V = Start; V < End; V++)
+         {
+         memcpy(Reference->Address(U, V), Image->Address(U, V), Size);
+         }
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Creates a new stream for writing.
+
+   Path        : Path to the stream file. Existing files are overwritten.
+   TileSize    : Tile size, in pixels.
+   KeyInterval : Number of frames between keyframes.
+  ---------------------------------------------------------------------------*/
+void Delta::Create(const std::string &Path, uint TileSize, uint KeyInterval)
+   {
+   Close();
+
+   if (TileSize < 1 || TileSize > 0xFFFF || KeyInterval < 1) {throw dexception("Invalid parameters.");}
+
+   Stream.Create(Path);
+   Delta::TileSize = TileSize;
+   Delta::KeyInterval = KeyInterval;
+   Reference.Destroy();
+
+   Count = 0;
+   Keys = 0;
+   RawBytes = 0;
+   Bytes = Delta::HeaderSize;
+   FrameSize = 0;
+
+   Stream.Write(Delta::Magic, 4);
+   Stream.WriteValue(Delta::Version);
+   Stream.WriteValue(Delta::HeaderSize);
+   Stream.WriteValue((uint16)TileSize);
+   Stream.WriteValue((uint16)0);
+   Stream.WriteValue((uint32)KeyInterval);
+   }
+
+/*---------------------------------------------------------------------------
+   Opens an existing stream for reading.
+  ---------------------------------------------------------------------------*/
+void Delta::Open(const std::string &Path)
+   {
+   Close();
+
+   Stream.Open(Path);
+   Reference.Destroy();
+
+   char ID[4];
+   Stream.Read(ID, 4);
+   if (memcmp(ID, Delta::Magic, 4) != 0) {throw dexception("Not a delta stream: %s.", Path.c_str());}
+
+   uint16 FileVersion = Stream.ReadValue<uint16>();
+   uint16 FileHeaderSize = Stream.ReadValue<uint16>();
+   if (FileVersion != Delta::Version || FileHeaderSize < Delta::HeaderSize) {throw dexception("Unsupported delta stream version.");}
+
+   TileSize = Stream.ReadValue<uint16>();
+   Stream.ReadValue<uint16>();
+   KeyInterval = Stream.ReadValue<uint32>();
+   if (TileSize < 1) {throw dexception("Corrupt delta stream header.");}
+
+   Stream.Seek(FileHeaderSize);
+
+   Count = 0;
+   Keys = 0;
+   RawBytes = 0;
+   Bytes = FileHeaderSize;
+   FrameSize = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Closes the stream.
+  ---------------------------------------------------------------------------*/
+void Delta::Close(void)
+   {
+   if (!Stream.Ready()) {return;}
+
+   bool Writing = Stream.IsWriting();
+   Stream.Close();
+
+   if (Writing && RawBytes > 0)
+      {
+      debug("Closed delta stream, %llu frames (%llu keyframes), %.1f%% of the raw size.\n",
+         (unsigned long long)Count, (unsigned long long)Keys, 100.0 * (double)Bytes / (double)RawBytes);
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Writes a frame. The first frame, and every KeyInterval-th frame after it,
+   is written in full, as are frames with a new resolution or data type.
+
+   Flipped : Marks the frame rows as stored bottom-up.
+  ---------------------------------------------------------------------------*/
+void Delta::Write(const Texture &Image, bool Flipped)
+   {
+   if (!Stream.IsWriting()) {throw dexception("Delta stream is not open for writing.");}
+   if (Image.Size() < 1) {throw dexception("Invalid parameters.");}
+
+   vector2u Res = Image.Resolution();
+   vector2u RefRes = Reference.Resolution();
+   bool Same = Reference.Size() > 0 && Res.U == RefRes.U && Res.V == RefRes.V && Image.DataType() == Reference.DataType();
+
+   Delta::Flipped = Flipped;
+   Key = !Same || Count % KeyInterval == 0;
+
+   usize Payload = 0;
+   usize Changes = 0;
+
+   if (!Key)
+      {
+      Compare Job;
+      Job.Image = &Image;
+      Job.Reference = &Reference;
+      Job.Changed = Changed.Pointer();
+      Job.Tiles = Tiles;
+      Job.TileSize = TileSize;
+
+      ThreadPool::Shared().Run(Job, Tiles.V);
+
+      for (uiter I = 0; I < Changed.Size(); I++)
+         {
+         if (Changed[I] == 0) {continue;}
+         Payload += sizeof(uint32) + TileBytes(I);
+         Changes++;
+         }
+
+      //Too many changes, a keyframe is smaller
+      if (Payload >= Image.Size()) {Key = true;}
+      }
+
+   if (Key)
+      {
+      if (!Same) {Resize(Res, Image.DataType());}
+      memcpy(Reference.Pointer(), Image.Pointer(), Image.Size());
+
+      Payload = Reference.Size();
+      WriteHeader(Delta::KindKey, Payload, 0);
+      Stream.Write(Reference.Pointer(), Payload);
+      Keys++;
+      }
+   else
+      {
+      WriteHeader(Delta::KindDelta, Payload, Changes);
+
+      for (uiter I = 0; I < Changed.Size(); I++)
+         {
+         if (Changed[I] == 0) {continue;}
+         Stream.WriteValue((uint32)I);
+         WriteTile(I);
+         }
+      }
+
+   FrameSize = Delta::FrameHeaderSize + Payload;
+   RawBytes += Delta::FrameHeaderSize + Image.Size();
+   Bytes += FrameSize;
+   Count++;
+   }
+
+/*---------------------------------------------------------------------------
+   Reads the next frame, and reconstructs it into Image. Returns false at
+   the end of the stream.
+  ---------------------------------------------------------------------------*/
+bool Delta::Read(Texture &Image)
+   {
+   if (!Stream.IsReading()) {throw dexception("Delta stream is not open for reading.");}
+
+   uint32 Size;
+   if (!Stream.ReadHeader(&Size, sizeof(Size))) {return false;}
+
+   if (!Math::MachineLittleEndian()) {Size = Math::SwapEndian(Size);}
+
+   uint8 Kind = Stream.ReadValue<uint8>();
+   uint8 Flags = Stream.ReadValue<uint8>();
+   Stream.ReadValue<uint16>();
+   Texture::TexType Type = (Texture::TexType)Stream.ReadValue<uint32>();
+   vector2u Res;
+   Res.U = Stream.ReadValue<uint16>();
+   Res.V = Stream.ReadValue<uint16>();
+   uint32 Entries = Stream.ReadValue<uint32>();
+
+   vector2u RefRes = Reference.Resolution();
+   bool Same = Reference.Size() > 0 && Res.U == RefRes.U && Res.V == RefRes.V && Type == Reference.DataType();
+
+   if (Kind == Delta::KindKey)
+      {
+      if (!Same) {Resize(Res, Type);}
+      if (Size != Reference.Size()) {throw dexception("Corrupt delta stream keyframe.");}
+      Stream.Read(Reference.Pointer(), Size);
+      Keys++;
+      }
+   else if (Kind == Delta::KindDelta)
+      {
+      if (!Same) {throw dexception("Delta frame without a matching keyframe.");}
+
+      for (uint32 I = 0; I < Entries; I++)
+         {
+         uint32 Index = Stream.ReadValue<uint32>();
+         if (Index >= Changed.Size()) {throw dexception("Corrupt delta stream tile index.");}
+         ReadTile(Index);
+         }
+      }
+   else {throw dexception("Unknown delta stream frame kind.");}
+
+   vector2u ImageRes = Image.Resolution();
+   if (ImageRes.U != Res.U || ImageRes.V != Res.V || Image.DataType() != Type) {Image.Create(Res, Type);}
+   memcpy(Image.Pointer(), Reference.Pointer(), Reference.Size());
+
+   Key = Kind == Delta::KindKey;
+   Flipped = (Flags & Delta::FlagFlipped) != 0;
+   FrameSize = Delta::FrameHeaderSize + Size;
+   RawBytes += Delta::FrameHeaderSize + Reference.Size();
+   Bytes += FrameSize;
+   Count++;
+
+   return true;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,153 @@
+/*===========================================================================
+   Tile Delta Stream
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_DELTA_H___
+#define ___FILE_DELTA_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "file_binary.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+  Tile delta stream. Each frame is split into square tiles, which are
+  compared with the previous frame, and only the changed tiles are stored.
+  A full keyframe is stored periodically, whenever the frame format
+  changes, or whenever the changed tiles would take up more space than
+  the whole frame. The stream is lossless, and suited to static cameras,
+  where most of the frame stays the same.
+
+  All header values are little-endian. The pixel data is stored exactly as
+  laid out in Texture memory, without padding:
+
+  Offset | Stream header       Offset | Frame header
+  ---    | ---                 ---    | ---
+  0      | char[4] "KFXD"      0      | uint32 Size, payload bytes
+  4      | uint16 Version      4      | uint8 Kind, see FrameKind
+  6      | uint16 HeaderSize   5      | uint8 Flags, see FrameFlags
+  8      | uint16 TileSize     6      | uint16 Reserved
+  10     | uint16 Reserved     8      | uint32 Type, see Texture::TexType
+  12     | uint32 KeyInterval  12     | uint16 ResU
+                               14     | uint16 ResV
+                               16     | uint32 Tiles
+
+  A keyframe payload holds the whole frame. A delta payload holds Tiles
+  entries, each with a uint32 tile index, in row-major tile order, followed
+  by the tile pixels. Tiles on the right and bottom edges are clipped to
+  the frame.
+  ---------------------------------------------------------------------------*/
+class Delta
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const char* Magic;                       //Stream identifier
+   static const uint16 Version = 1;                //Format version
+   static const uint16 HeaderSize = 16;            //Stream header size in bytes
+   static const usize FrameHeaderSize = 20;        //Frame header size in bytes
+   static const uint DefaultTileSize = 32;         //Default tile size, in pixels
+   static const uint DefaultKeyInterval = 150;     //Default number of frames between keyframes
+
+   enum FrameKind                                  //Frame kind enumeration
+      {
+      KindKey = 0,                                 //Whole frame
+      KindDelta = 1                                //Changed tiles only
+      };
+
+   enum FrameFlags                                 //Frame flag bits
+      {
+      FlagFlipped = 0x01                           //Rows are stored bottom-up
+      };
+
+   private:
+
+   class Compare : public ThreadPool::Job          //Tile comparison job, one task per row of tiles
+      {
+      public:
+      const Texture* Image;                        //New frame
+      Texture* Reference;                          //Previous frame, changed tiles are updated in place
+      uint8* Changed;                              //Receives the change flag for each tile
+      vector2u Tiles;                              //Number of tiles in each direction
+      uint TileSize;                               //Tile size, in pixels
+      void Run(uiter Task);
+      };
+
+   //---- Member data ----
+   private:
+
+   Binary Stream;                                  //Stream file
+   uint TileSize;                                  //Tile size, in pixels
+   uint KeyInterval;                               //Number of frames between keyframes
+   Texture Reference;                              //Last reconstructed frame
+   vector2u Tiles;                                 //Number of tiles in each direction
+   Array<uint8, 256> Changed;                      //Change flag for each tile
+   uint64 Count;                                   //Number of frames written or read
+   uint64 Keys;                                    //Number of keyframes written or read
+   uint64 RawBytes;                                //Bytes the frames would take without delta coding
+   uint64 Bytes;                                   //Bytes written or read
+   usize FrameSize;                                //Size of the last frame, including its header
+   bool Key;                                       //Last frame was a keyframe
+   bool Flipped;                                   //Last frame was stored bottom-up
+
+   //---- Methods ----
+   public:
+
+   Delta(void);
+   ~Delta(void);
+
+   private:
+
+   Delta(const Delta &obj);                        //Disable
+   Delta &operator = (const Delta &obj);           //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Frame I/O
+   void WriteHeader(FrameKind Kind, usize Size, usize Count);
+   void WriteTile(uiter Index);
+   void ReadTile(uiter Index);
+   usize TileBytes(uiter Index) const;
+   void Resize(const vector2u &Res, Texture::TexType Type);
+
+   public:
+
+   void Create(const std::string &Path, uint TileSize = Delta::DefaultTileSize, uint KeyInterval = Delta::DefaultKeyInterval);
+   void Open(const std::string &Path);
+   void Close(void);
+   void Write(const Texture &Image, bool Flipped = false);
+   bool Read(Texture &Image);
+
+   inline bool Ready(void) const {return Stream.Ready();}
+   inline uint64 GetFrames(void) const {return Count;}
+   inline uint64 GetKeyFrames(void) const {return Keys;}
+   inline uint64 GetRawBytes(void) const {return RawBytes;}
+   inline uint64 GetBytes(void) const {return Bytes;}
+   inline usize GetFrameSize(void) const {return FrameSize;}
+   inline bool IsKeyFrame(void) const {return Key;}
+   inline bool IsFlipped(void) const {return Flipped;}
+   };
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
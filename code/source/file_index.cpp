@@ -0,0 +1,136 @@
+/*===========================================================================
+   Capture Frame Index
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_INDEX_CPP___
+#define ___FILE_INDEX_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "file_index.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+   Static data.
+  ---------------------------------------------------------------------------*/
+const char* Index::Magic = "KFXI";
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+Index::Index(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Index::~Index(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Index::Clear(void)
+   {
+   Count = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Index::Destroy(void)
+   {
+   Close();
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Creates the index file and writes the header.
+
+   Path   : Path to the index file. Existing files are overwritten.
+   Header : Session information.
+  ---------------------------------------------------------------------------*/
+void Index::Open(const std::string &Path, const FileHeader &Header)
+   {
+   Close();
+
+   //Records are flushed one by one, a large buffer would not help
+   Stream.Create(Path, 0);
+
+   char Name[Index::NameSize];
+   memset(Name, 0, sizeof(Name));
+   memcpy(Name, Header.Name.c_str(), Math::Min(Header.Name.size(), Index::NameSize - 1));
+
+   Stream.Write(Index::Magic, 4);
+   Stream.WriteValue(Index::Version);
+   Stream.WriteValue(Index::HeaderSize);
+   Stream.WriteValue(Index::RecordSize);
+   Stream.WriteValue(Header.Format);
+   Stream.WriteValue(Header.Source);
+   Stream.WriteValue((uint32)0);
+   Stream.WriteValue(Header.StartTime);
+   Stream.WriteValue(Header.Colour.X);
+   Stream.WriteValue(Header.Colour.Y);
+   Stream.WriteValue(Header.Colour.Z);
+   Stream.WriteValue(Header.Colour.W);
+   Stream.Write(Name, sizeof(Name));
+
+   Stream.Flush();
+
+   Count = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Closes the index file.
+  ---------------------------------------------------------------------------*/
+void Index::Close(void)
+   {
+   Stream.Close();
+   }
+
+/*---------------------------------------------------------------------------
+   Appends a frame record, and flushes it to file.
+  ---------------------------------------------------------------------------*/
+void Index::Append(const Record &Item)
+   {
+   if (!Stream.Ready()) {throw dexception("Index file is not open.");}
+
+   Stream.WriteValue(Item.Frame);
+   Stream.WriteValue(Item.Flags);
+   Stream.WriteValue(Item.SensorTime);
+   Stream.WriteValue(Item.Dropped);
+   Stream.WriteValue(Item.WallTime);
+   Stream.WriteValue(Item.Size);
+   Stream.WriteValue(Item.ResU);
+   Stream.WriteValue(Item.ResV);
+
+   Stream.Flush();
+
+   Count++;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
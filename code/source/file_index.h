@@ -0,0 +1,135 @@
+/*===========================================================================
+   Capture Frame Index
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_INDEX_H___
+#define ___FILE_INDEX_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "file_binary.h"
+#include "vector.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+  Binary frame index for capture sessions. The file consists of a fixed size
+  header, followed by an array of fixed size records, one for each captured
+  frame. All values are little-endian and naturally aligned, so the file can
+  be memory mapped and indexed directly:
+
+  Offset | Header field           Offset | Record field
+  ---    | ---                    ---    | ---
+  0      | char[4] Magic, "KFXI"  0      | uint32 Frame
+  4      | uint16 Version         4      | uint32 Flags
+  6      | uint16 HeaderSize      8      | uint32 SensorTime
+  8      | uint16 RecordSize      12     | uint32 Dropped
+  10     | uint8 Format           16     | uint64 WallTime
+  11     | uint8 Source           24     | uint32 Size
+  12     | uint32 Reserved        28     | uint16 ResU
+  16     | uint64 StartTime       30     | uint16 ResV
+  24     | float[4] Colour
+  40     | char[24] Name
+
+  Records are appended and flushed as frames are saved, so the index of an
+  interrupted session is still valid up to the last complete record. Frame
+  files that are written in the background are only recorded once they are
+  on disk.
+
+  In adaptive capture sessions, bits 8 to 15 of the record flags hold the
+  codec level the frame was saved with, see Adaptive::Level, and the first
+  frame saved after each codec switch carries FlagSwitch.
+  ---------------------------------------------------------------------------*/
+class Index
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const char* Magic;                       //File identifier
+   static const uint16 Version = 1;                //Format version
+   static const uint16 HeaderSize = 64;            //Header size in bytes
+   static const uint16 RecordSize = 32;            //Record size in bytes
+   static const usize NameSize = 24;               //Size of the name field, including the null terminator
+
+   enum RecordFlags                                //Record flag bits
+      {
+      FlagSensorTime = 0x01,                       //SensorTime holds the Kinect time step of the frame
+      FlagCompressed = 0x02,                       //Frame file is compressed
+      FlagDropped = 0x04,                          //Frames were dropped before this one, see Dropped
+      FlagSwitch = 0x08,                           //Codec level was changed for this frame
+      FlagKeyFrame = 0x10,                         //Frame is a keyframe in a delta stream
+      FlagIndexed = 0x20                           //Frame holds 8-bit palette indices, with the palette stored in the frame file
+      };
+
+   static const uint32 ShiftLevel = 8;             //Bit position of the codec level in the record flags
+   static const uint32 MaskLevel = 0xFF;           //Codec level mask, after shifting
+
+   struct FileHeader                               //Session information
+      {
+      uint8 Format;                                //Capture file format, see CaptureThread::CapFormat
+      uint8 Source;                                //Capture source, see CaptureThread::CapSource
+      uint64 StartTime;                            //Session start, in ms since the Unix epoch
+      vector4f Colour;                             //Filter colour
+      std::string Name;                            //Filter name, truncated to NameSize - 1 characters
+      };
+
+   struct Record                                   //Frame information
+      {
+      uint32 Frame;                                //Frame number, matches the file name counter
+      uint32 Flags;                                //Combination of RecordFlags
+      uint32 SensorTime;                           //Kinect time step
+      uint32 Dropped;                              //Number of frames dropped since the previous record
+      uint64 WallTime;                             //Time the frame was saved, in ms since the Unix epoch
+      uint32 Size;                                 //Encoded frame size in bytes
+      uint16 ResU;                                 //Frame width
+      uint16 ResV;                                 //Frame height
+      };
+
+   //---- Member data ----
+   private:
+
+   Binary Stream;                                  //Index file
+   uint64 Count;                                   //Number of records written
+
+   //---- Methods ----
+   public:
+
+   Index(void);
+   ~Index(void);
+
+   private:
+
+   Index(const Index &obj);                        //Disable
+   Index &operator = (const Index &obj);           //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   public:
+
+   void Open(const std::string &Path, const FileHeader &Header);
+   void Close(void);
+   void Append(const Record &Item);
+
+   inline bool Ready(void) const {return Stream.Ready();}
+   inline uint64 GetRecords(void) const {return Count;}
+   };
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
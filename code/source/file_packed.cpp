@@ -0,0 +1,293 @@
+/*===========================================================================
+   Bit-packed Depth Stream
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_PACKED_CPP___
+#define ___FILE_PACKED_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "file_packed.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+   Static data.
+  ---------------------------------------------------------------------------*/
+const char* Packed::Magic = "KFXP";
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+Packed::Packed(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Packed::~Packed(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Packed::Clear(void)
+   {
+   Count = 0;
+   RawBytes = 0;
+   Bytes = 0;
+   FrameSize = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Packed::Destroy(void)
+   {
+   Close();
+
+   Payload.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the number of bytes needed to pack a number of samples. The size
+   is rounded up to whole groups.
+  ---------------------------------------------------------------------------*/
+usize Packed::PackedSize(usize Samples)
+   {
+   return ((Samples + Packed::GroupSamples - 1) / Packed::GroupSamples) * Packed::GroupBytes;
+   }
+
+/*---------------------------------------------------------------------------
+   Packs 11-bit samples. Each group of 8 samples is assembled in a 64-bit
+   and a 32-bit register, then stored as 11 bytes, so the kernel runs at
+   memory speed without branches or per-bit work. The upper 5 bits of each
+   sample are ignored. Dst must hold PackedSize(Samples) bytes.
+  ---------------------------------------------------------------------------*/
+void Packed::Pack(uint8* Dst, const uint16* Src, usize Samples)
+   {
+   const uint64 M = Packed::Mask;
+   usize Groups = Samples / Packed::GroupSamples;
+
+   for (usize I = 0; I < Groups; I++, Src += Packed::GroupSamples, Dst += Packed::GroupBytes)
+      {
+      uint64 A = (Src[0] & M) | ((Src[1] & M) << 11) | ((Src[2] & M) << 22) | ((Src[3] & M) << 33) | ((Src[4] & M) << 44) | ((Src[5] & M) << 55);
+      uint32 B = (uint32)(((Src[5] & M) >> 9) | ((Src[6] & M) << 2) | ((Src[7] & M) << 13));
+
+      Dst[0] = (uint8)A;
+      Dst[1] = (uint8)(A >> 8);
+      Dst[2] = (uint8)(A >> 16);
+      Dst[3] = (uint8)(A >> 24);
+      Dst[4] = (uint8)(A >> 32);
+      Dst[5] = (uint8)(A >> 40);
+      Dst[6] = (uint8)(A >> 48);
+      Dst[7] = (uint8)(A >> 56);
+      Dst[8] = (uint8)B;
+      Dst[9] = (uint8)(B >> 8);
+      Dst[10] = (uint8)(B >> 16);
+      }
+
+   //Pad the last group with zero samples
+   usize Rest = Samples - Groups * Packed::GroupSamples;
+   if (Rest < 1) {return;}
+
+   uint16 Tail[Packed::GroupSamples] = {0};
+   for (usize I = 0; I < Rest; I++) {Tail[I] = Src[I];}
+
+   Pack(Dst, Tail, Packed::GroupSamples);
+   }
+
+/*---------------------------------------------------------------------------
+   Unpacks 11-bit samples into 16-bit containers, see Pack( ). Src must
+   hold PackedSize(Samples) bytes.
+  ---------------------------------------------------------------------------*/
+void Packed::Unpack(uint16* Dst, const uint8* Src, usize Samples)
+   {
+   const uint64 M = Packed::Mask;
+   usize Groups = Samples / Packed::GroupSamples;
+
+   for (usize I = 0; I < Groups; I++, Src += Packed::GroupBytes, Dst += Packed::GroupSamples)
+      {
+      uint64 A = (uint64)Src[0] | ((uint64)Src[1] << 8) | ((uint64)Src[2] << 16) | ((uint64)Src[3] << 24) |
+                 ((uint64)Src[4] << 32) | ((uint64)Src[5] << 40) | ((uint64)Src[6] << 48) | ((uint64)Src[7] << 56);
+      uint64 B = (uint64)Src[8] | ((uint64)Src[9] << 8) | ((uint64)Src[10] << 16);
+
+      Dst[0] = (uint16)(A & M);
+      Dst[1] = (uint16)((A >> 11) & M);
+      Dst[2] = (uint16)((A >> 22) & M);
+      Dst[3] = (uint16)((A >> 33) & M);
+      Dst[4] = (uint16)((A >> 44) & M);
+      Dst[5] = (uint16)(((A >> 55) | (B << 9)) & M);
+      Dst[6] = (uint16)((B >> 2) & M);
+      Dst[7] = (uint16)((B >> 13) & M);
+      }
+
+   usize Rest = Samples - Groups * Packed::GroupSamples;
+   if (Rest < 1) {return;}
+
+   uint16 Tail[Packed::GroupSamples];
+   Unpack(Tail, Src, Packed::GroupSamples);
+
+   for (usize I = 0; I < Rest; I++) {Dst[I] = Tail[I];}
+   }
+
+/*---------------------------------------------------------------------------
+   Creates a new stream for writing. Existing files are overwritten.
+  ---------------------------------------------------------------------------*/
+void Packed::Create(const std::string &Path)
+   {
+   Close();
+
+   Stream.Create(Path);
+
+   Count = 0;
+   RawBytes = 0;
+   Bytes = Packed::HeaderSize;
+   FrameSize = 0;
+
+   Stream.Write(Packed::Magic, 4);
+   Stream.WriteValue(Packed::Version);
+   Stream.WriteValue(Packed::HeaderSize);
+   Stream.WriteValue(Packed::Bits);
+   Stream.WriteValue((uint16)0);
+   Stream.WriteValue((uint32)0);
+   }
+
+/*---------------------------------------------------------------------------
+   Opens an existing stream for reading.
+  ---------------------------------------------------------------------------*/
+void Packed::Open(const std::string &Path)
+   {
+   Close();
+
+   Stream.Open(Path);
+
+   char ID[4];
+   Stream.Read(ID, 4);
+   if (memcmp(ID, Packed::Magic, 4) != 0) {throw dexception("Not a packed depth stream: %s.", Path.c_str());}
+
+   uint16 FileVersion = Stream.ReadValue<uint16>();
+   uint16 FileHeaderSize = Stream.ReadValue<uint16>();
+   if (FileVersion != Packed::Version || FileHeaderSize < Packed::HeaderSize) {throw dexception("Unsupported packed stream version.");}
+
+   if (Stream.ReadValue<uint16>() != Packed::Bits) {throw dexception("Unsupported packed sample size.");}
+
+   Stream.Seek(FileHeaderSize);
+
+   Count = 0;
+   RawBytes = 0;
+   Bytes = FileHeaderSize;
+   FrameSize = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Closes the stream.
+  ---------------------------------------------------------------------------*/
+void Packed::Close(void)
+   {
+   if (!Stream.Ready()) {return;}
+
+   bool Writing = Stream.IsWriting();
+   Stream.Close();
+
+   if (Writing && RawBytes > 0)
+      {
+      debug("Closed packed depth stream, %llu frames, %.1f%% of the 16-bit size.\n",
+         (unsigned long long)Count, 100.0 * (double)Bytes / (double)RawBytes);
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Packs and writes a raw depth frame.
+  ---------------------------------------------------------------------------*/
+void Packed::Write(const Texture &Image)
+   {
+   if (!Stream.IsWriting()) {throw dexception("Packed stream is not open for writing.");}
+   if (Image.Size() < 1 || Image.DataType() != Texture::TypeDepth) {throw dexception("Invalid parameters.");}
+
+   vector2u Res = Image.Resolution();
+   if (Res.U > 0xFFFF || Res.V > 0xFFFF) {throw dexception("Invalid frame resolution.");}
+
+   usize Samples = (usize)Res.U * (usize)Res.V;
+   usize Size = Packed::PackedSize(Samples);
+
+   if (Payload.Size() < Size) {Payload.Create(Size - Payload.Size());}
+
+   Pack(Payload.Pointer(), reinterpret_cast<const uint16*>(Image.Pointer()), Samples);
+
+   Stream.WriteValue((uint32)Size);
+   Stream.WriteValue((uint16)Res.U);
+   Stream.WriteValue((uint16)Res.V);
+   Stream.Write(Payload.Pointer(), Size);
+
+   FrameSize = Packed::FrameHeaderSize + Size;
+   RawBytes += Packed::FrameHeaderSize + Image.Size();
+   Bytes += FrameSize;
+   Count++;
+   }
+
+/*---------------------------------------------------------------------------
+   Reads the next frame, and expands it into Image as Texture::TypeDepth.
+   Returns false at the end of the stream.
+  ---------------------------------------------------------------------------*/
+bool Packed::Read(Texture &Image)
+   {
+   if (!Stream.IsReading()) {throw dexception("Packed stream is not open for reading.");}
+
+   uint32 Size;
+   if (!Stream.ReadHeader(&Size, sizeof(Size))) {return false;}
+
+   if (!Math::MachineLittleEndian()) {Size = Math::SwapEndian(Size);}
+
+   vector2u Res;
+   Res.U = Stream.ReadValue<uint16>();
+   Res.V = Stream.ReadValue<uint16>();
+
+   usize Samples = (usize)Res.U * (usize)Res.V;
+   if (Samples < 1 || Size != Packed::PackedSize(Samples)) {throw dexception("Corrupt packed frame header.");}
+
+   if (Payload.Size() < Size) {Payload.Create(Size - Payload.Size());}
+   Stream.Read(Payload.Pointer(), Size);
+
+   vector2u ImageRes = Image.Resolution();
+   if (ImageRes.U != Res.U || ImageRes.V != Res.V || Image.DataType() != Texture::TypeDepth)
+      {
+      Image.Create(Res, Texture::TypeDepth);
+      }
+
+   Unpack(reinterpret_cast<uint16*>(Image.Pointer()), Payload.Pointer(), Samples);
+
+   FrameSize = Packed::FrameHeaderSize + Size;
+   RawBytes += Packed::FrameHeaderSize + Image.Size();
+   Bytes += FrameSize;
+   Count++;
+
+   return true;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
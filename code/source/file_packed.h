@@ -0,0 +1,111 @@
+/*===========================================================================
+   Bit-packed Depth Stream
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_PACKED_H___
+#define ___FILE_PACKED_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "file_binary.h"
+#include "texture.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+  Bit-packed stream for raw 11-bit depth frames. The sensor delivers each
+  sample in a 16-bit container, so 5 bits of every sample are wasted. This
+  stream packs groups of 8 samples into 11 bytes, which is 31% smaller than
+  the 16-bit frames, without any loss. A reader expands the frames back
+  into Texture::TypeDepth.
+
+  All header values are little-endian. Samples are packed LSB first, so
+  sample I occupies bits 11 * I to 11 * I + 10 of the payload. The last
+  group of each frame is padded with zero samples:
+
+  Offset | Stream header       Offset | Frame header
+  ---    | ---                 ---    | ---
+  0      | char[4] "KFXP"      0      | uint32 Size, payload bytes
+  4      | uint16 Version      4      | uint16 ResU
+  6      | uint16 HeaderSize   6      | uint16 ResV
+  8      | uint16 Bits
+  10     | uint16 Reserved
+  12     | uint32 Reserved
+  ---------------------------------------------------------------------------*/
+class Packed
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const char* Magic;                       //Stream identifier
+   static const uint16 Version = 1;                //Format version
+   static const uint16 HeaderSize = 16;            //Stream header size in bytes
+   static const usize FrameHeaderSize = 8;         //Frame header size in bytes
+   static const uint16 Bits = 11;                  //Bits per sample
+   static const uint16 Mask = 0x07FF;              //Sample mask
+   static const usize GroupSamples = 8;            //Number of samples in a packed group
+   static const usize GroupBytes = 11;             //Number of bytes in a packed group
+
+   //---- Member data ----
+   private:
+
+   Binary Stream;                                  //Stream file
+   Array<uint8, 4096> Payload;                     //Packed frame
+   uint64 Count;                                   //Number of frames written or read
+   uint64 RawBytes;                                //Bytes the frames would take as 16-bit samples
+   uint64 Bytes;                                   //Bytes written or read
+   usize FrameSize;                                //Size of the last frame, including its header
+
+   //---- Methods ----
+   public:
+
+   Packed(void);
+   ~Packed(void);
+
+   private:
+
+   Packed(const Packed &obj);                      //Disable
+   Packed &operator = (const Packed &obj);         //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   public:
+
+   //Packing kernels
+   static usize PackedSize(usize Samples);
+   static void Pack(uint8* Dst, const uint16* Src, usize Samples);
+   static void Unpack(uint16* Dst, const uint8* Src, usize Samples);
+
+   void Create(const std::string &Path);
+   void Open(const std::string &Path);
+   void Close(void);
+   void Write(const Texture &Image);
+   bool Read(Texture &Image);
+
+   inline bool Ready(void) const {return Stream.Ready();}
+   inline uint64 GetFrames(void) const {return Count;}
+   inline uint64 GetRawBytes(void) const {return RawBytes;}
+   inline uint64 GetBytes(void) const {return Bytes;}
+   inline usize GetFrameSize(void) const {return FrameSize;}
+   };
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
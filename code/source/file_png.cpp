@@ -14,6 +14,7 @@
 #include "common.h"
 #include "debug.h"
 #include "file_png.h"
+#include "math.h"
 
 
 //Namespaces
@@ -35,6 +36,9 @@ PNG::PNG(void)
 PNG::~PNG(void)
    {
    Destroy();
+
+   //Encoder resources are kept across Save( ) calls, and only released here
+   for (uiter I = 0; I < Bands.Size(); I++) {delete Bands[I];}
    }
 
 /*---------------------------------------------------------------------------
@@ -203,29 +207,30 @@ void PNG::Load(Texture &Image, const std::string &Path, float Gamma)
    }
 
 /*---------------------------------------------------------------------------
-   Saves a PNG file.
-
-   Image    : Image to save.
-   Path     : Path to image file, relative to the current working directory.
-   Compress : Specifies the compression level to use for encoding.
+   libpng output callbacks for encoding into a memory block. Exceptions
+   can't be thrown through libpng, so a failed write is reported with 
+   png_error( ), which returns to the setjmp( ) in Encode( ).
   ---------------------------------------------------------------------------*/
-void PNG::Save(const Texture &Image, const std::string &Path, CompLevel Compress)
+void PNG::WriteBlock(png_structp PngPtr, png_bytep Data, png_size_t Size)
    {
-   Destroy();
+   bool Failed = false;
 
-   //Important - set class to writing mode
-   Mode = PNG::ModeWrite;
+   try {static_cast<Writer::Block*>(png_get_io_ptr(PngPtr))->Write(Data, (usize)Size);}
+   catch (...) {Failed = true;}
 
-   vector2u Res = Image.Resolution();
-   if (Res.U < 1 || Res.V < 1) {return;}
+   if (Failed) {png_error(PngPtr, "Failed to write to the memory block.");}
+   }
 
-   #if defined (WINDOWS)
-      if (fopen_s(&File, Path.c_str(), "wb") != 0)
-         {throw dexception("Failed to open file: %s.", Path.c_str());}
-   #else
-      File = fopen(Path.c_str(), "wb");
-      if (File == nullptr) {throw dexception("Failed to open file: %s.", Path.c_str());}
-   #endif
+void PNG::FlushBlock(png_structp) {}
+
+/*---------------------------------------------------------------------------
+   Encodes the image, see Save( ). The output is sent to the File, or to the
+   Target block if it's specified. If a Palette is specified, the image 
+   holds 8-bit palette indices.
+  ---------------------------------------------------------------------------*/
+void PNG::Encode(const Texture &Image, const Texture* Palette, CompLevel Compress, Writer::Block* Target)
+   {
+   vector2u Res = Image.Resolution();
 
    PngPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
    if (PngPtr == nullptr) {throw dexception("png_create_write_struct( ) failed.");}
@@ -236,7 +241,8 @@ void PNG::Save(const Texture &Image, const std::string &Path, CompLevel Compress
    if (setjmp(png_jmpbuf(PngPtr)))
       {throw dexception("setjmp( ) failed.");}
 
-   png_init_io(PngPtr, File);
+   if (Target != nullptr) {png_set_write_fn(PngPtr, Target, PNG::WriteBlock, PNG::FlushBlock);}
+   else {png_init_io(PngPtr, File);}
 
    png_set_compression_level(PngPtr, (int)Compress);
 
@@ -251,12 +257,39 @@ void PNG::Save(const Texture &Image, const std::string &Path, CompLevel Compress
       default : throw dexception("Unsupported image type."); break;
       }
 
+   if (Palette != nullptr)
+      {
+      usize Entries = (usize)Palette->Resolution().U * (usize)Palette->Resolution().V;
+
+      if (Image.DataType() != Texture::TypeLum || Palette->DataType() != Texture::TypeRGB || Entries < 1 || Entries > PNG_MAX_PALETTE_LENGTH)
+         {throw dexception("Unsupported palette.");}
+
+      ColourType = PNG_COLOR_TYPE_PALETTE;
+      }
+
    png_set_IHDR(PngPtr, InfoPtr, (png_uint_32)Res.U, (png_uint_32)Res.V, BitDepth, ColourType, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
+   if (Palette != nullptr)
+      {
+      png_color Entries[PNG_MAX_PALETTE_LENGTH];
+      int Count = (int)(Palette->Resolution().U * Palette->Resolution().V);
+      const uint8* Src = Palette->Pointer();
+
+      for (int I = 0; I < Count; I++, Src += 3)
+         {
+         Entries[I].red   = Src[0];
+         Entries[I].green = Src[1];
+         Entries[I].blue  = Src[2];
+         }
+
+      png_set_PLTE(PngPtr, InfoPtr, Entries, Count);
+      }
+
    png_set_sRGB(PngPtr, InfoPtr, PNG_sRGB_INTENT_ABSOLUTE);
    png_set_sRGB_gAMA_and_cHRM(PngPtr, InfoPtr, PNG_sRGB_INTENT_ABSOLUTE);
 
    png_color_16 BackGnd;
+   BackGnd.index = 0;
    BackGnd.red   = 0;
    BackGnd.green = 0;
    BackGnd.blue  = 0;
@@ -286,9 +319,315 @@ void PNG::Save(const Texture &Image, const std::string &Path, CompLevel Compress
       Rows[I] = Image.Address(0, I);
       }
 
-   //Encode
+   //Encode large compressed images in parallel, otherwise let libpng handle it
+   if (Compress != PNG::CompNone && (usize)Res.V >= 2 * PNG::MinBandRows)
+      {
+      if (ThreadPool::Shared().Threads() > 1)
+         {
+         EncodeParallel(Image, Compress);
+         return;
+         }
+      }
+
    png_write_image(PngPtr, Rows.Pointer());
    png_write_end(PngPtr, nullptr);
+   }
+
+/*---------------------------------------------------------------------------
+   Applies a PNG filter to a single byte of a scanline.
+
+   Type : Filter type, 0 to 4 for None, Sub, Up, Average and Paeth.
+   Cur  : Current scanline.
+   Prev : Previous scanline, or nullptr for the first scanline.
+   I    : Byte index within the scanline.
+   BPP  : Bytes per pixel.
+  ---------------------------------------------------------------------------*/
+uint8 PNG::FilterByte(uint Type, const uint8* Cur, const uint8* Prev, usize I, usize BPP)
+   {
+   const int A = I >= BPP ? Cur[I - BPP] : 0;
+   const int B = Prev != nullptr ? Prev[I] : 0;
+   const int C = (Prev != nullptr && I >= BPP) ? Prev[I - BPP] : 0;
+
+   switch (Type)
+      {
+      case 1 : return (uint8)(Cur[I] - A);
+      case 2 : return (uint8)(Cur[I] - B);
+      case 3 : return (uint8)(Cur[I] - ((A + B) >> 1));
+      case 4 : 
+         {
+         const int P = A + B - C;
+         const int PA = abs(P - A);
+         const int PB = abs(P - B);
+         const int PC = abs(P - C);
+         return (uint8)(Cur[I] - ((PA <= PB && PA <= PC) ? A : (PB <= PC ? B : C)));
+         }
+      default : return Cur[I];
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Filters a range of scanlines into a band. Each scanline uses the filter
+   type with the lowest sum of absolute differences, which is the heuristic
+   recommended by the PNG specification.
+  ---------------------------------------------------------------------------*/
+void PNG::FilterRows(const Texture &Image, uiter Start, uiter End, Band &Out)
+   {
+   const usize BPP = Image.GetBytesPerPixel();
+   const usize RowBytes = Image.Resolution().U * BPP;
+   const usize Size = (End - Start) * (RowBytes + 1);
+
+   if (Out.Raw.Size() < Size) {Out.Raw.Create(Size - Out.Raw.Size());}
+
+   uint8* Dst = Out.Raw.Pointer();
+
+   for (uiter Row = Start; Row < End; Row++)
+      {
+      const uint8* Cur = Image.Address(0, Row);
+      const uint8* Prev = Row > 0 ? Image.Address(0, Row - 1) : nullptr;
+
+      uint Best = 0;
+      uint64 BestSum = 0;
+
+      for (uint Type = 0; Type < 5; Type++)
+         {
+         uint64 Sum = 0;
+
+         for (usize I = 0; I < RowBytes; I++)
+            {
+            Sum += (uint64)abs((int)(int8)FilterByte(Type, Cur, Prev, I, BPP));
+            }
+
+         if (Type == 0 || Sum < BestSum) {Best = Type; BestSum = Sum;}
+         }
+
+      *Dst++ = (uint8)Best;
+
+      for (usize I = 0; I < RowBytes; I++) {*Dst++ = FilterByte(Best, Cur, Prev, I, BPP);}
+      }
+
+   Out.RawSize = Size;
+   }
+
+/*---------------------------------------------------------------------------
+   Deflates a band into a raw deflate stream. The tail of the previous band
+   is used as a preset dictionary, so the compression ratio is close to that
+   of a single stream. All but the last band are terminated with a sync 
+   flush, so the bands can be concatenated into one zlib stream. The first 
+   band also receives the zlib header.
+  ---------------------------------------------------------------------------*/
+void PNG::DeflateBand(uiter Task, usize Count, int Level)
+   {
+   Band &Out = *Bands[Task];
+   const bool Last = Task + 1 >= Count;
+   const usize Head = Task == 0 ? 2 : 0;
+
+   z_stream Stream;
+   memset(&Stream, 0, sizeof(Stream));
+
+   if (deflateInit2(&Stream, Level, Z_DEFLATED, -15, 8, Z_FILTERED) != Z_OK)
+      {throw dexception("deflateInit2( ) failed.");}
+
+   if (Task > 0)
+      {
+      const Band &Prev = *Bands[Task - 1];
+      const usize Dict = Math::Min(Prev.RawSize, PNG::WindowSize);
+      deflateSetDictionary(&Stream, Prev.Raw.Pointer() + Prev.RawSize - Dict, (uInt)Dict);
+      }
+
+   //Leave room for the zlib header, the sync flush marker and the Adler-32 trailer
+   const usize Bound = Head + (usize)deflateBound(&Stream, (uLong)Out.RawSize) + 16;
+   if (Out.Packed.Size() < Bound) {Out.Packed.Create(Bound - Out.Packed.Size());}
+
+   Stream.next_in = Out.Raw.Pointer();
+   Stream.avail_in = (uInt)Out.RawSize;
+   Stream.next_out = Out.Packed.Pointer() + Head;
+   Stream.avail_out = (uInt)(Bound - Head - 4);
+
+   int Result = deflate(&Stream, Last ? Z_FINISH : Z_SYNC_FLUSH);
+   bool Done = Last ? Result == Z_STREAM_END : (Result == Z_OK && Stream.avail_in == 0 && Stream.avail_out > 0);
+
+   Out.PackedSize = Head + (usize)Stream.total_out;
+   deflateEnd(&Stream);
+
+   if (!Done) {throw dexception("deflate( ) failed.");}
+
+   if (Task == 0)
+      {
+      const int L = Level == Z_DEFAULT_COMPRESSION ? 6 : Level;
+      const uint Flags = (L < 2 ? 0 : (L < 6 ? 1 : (L == 6 ? 2 : 3))) << 6;
+      Out.Packed[0] = 0x78;
+      Out.Packed[1] = (uint8)(Flags + 31 - ((0x7800 + Flags) % 31));
+      }
+
+   Out.Adler = adler32(adler32(0L, Z_NULL, 0), Out.Raw.Pointer(), (uInt)Out.RawSize);
+   }
+
+/*---------------------------------------------------------------------------
+   Runs either the filter or the deflate pass on a band.
+  ---------------------------------------------------------------------------*/
+void PNG::EncodeJob::Run(uiter Task)
+   {
+   if (Deflate) {Owner->DeflateBand(Task, Bands, Level); return;}
+
+   const usize Rows = Image->Resolution().V;
+   Owner->FilterRows(*Image, (Rows * Task) / Bands, (Rows * (Task + 1)) / Bands, *Owner->Bands[Task]);
+   }
+
+/*---------------------------------------------------------------------------
+   Encodes the image data in parallel, in the manner of pigz. The image is 
+   split into bands of scanlines, which are filtered, deflated and 
+   checksummed concurrently. Each band becomes one IDAT chunk, and the 
+   chunks together form a single standard zlib stream. The header chunks 
+   must be written by png_write_info( ) beforehand, and all chunks go 
+   through png_write_chunk( ), so libpng's output stays in order.
+  ---------------------------------------------------------------------------*/
+void PNG::EncodeParallel(const Texture &Image, CompLevel Compress)
+   {
+   ThreadPool &Pool = ThreadPool::Shared();
+
+   EncodeJob Job;
+   Job.Owner = this;
+   Job.Image = &Image;
+   Job.Bands = Math::Min(Pool.Threads(), (usize)Image.Resolution().V / PNG::MinBandRows);
+   Job.Level = (int)Compress;
+   Job.Deflate = false;
+
+   while (Bands.Size() < Job.Bands) {Bands += new Band;}
+
+   //The deflate pass needs the filtered tail of the previous band
+   Pool.Run(Job, Job.Bands);
+   Job.Deflate = true;
+   Pool.Run(Job, Job.Bands);
+
+   //Combine the checksums and append the Adler-32 trailer to the last band
+   uLong Adler = adler32(0L, Z_NULL, 0);
+   for (uiter I = 0; I < Job.Bands; I++) 
+      {
+      Adler = adler32_combine(Adler, Bands[I]->Adler, (z_off_t)Bands[I]->RawSize);
+      }
+
+   Band &Last = *Bands[Job.Bands - 1];
+   uint8* Trailer = Last.Packed.Pointer() + Last.PackedSize;
+   Trailer[0] = (uint8)(Adler >> 24);
+   Trailer[1] = (uint8)(Adler >> 16);
+   Trailer[2] = (uint8)(Adler >> 8);
+   Trailer[3] = (uint8)Adler;
+   Last.PackedSize += 4;
+
+   png_byte NameIDAT[5] = "IDAT";
+   png_byte NameIEND[5] = "IEND";
+
+   for (uiter I = 0; I < Job.Bands; I++)
+      {
+      png_write_chunk(PngPtr, NameIDAT, Bands[I]->Packed.Pointer(), (png_size_t)Bands[I]->PackedSize);
+      }
+
+   //png_write_end( ) expects libpng to have written the IDAT chunks itself
+   png_write_chunk(PngPtr, NameIEND, nullptr, 0);
+   }
+
+/*---------------------------------------------------------------------------
+   Saves a PNG file.
+
+   Image    : Image to save.
+   Path     : Path to image file, relative to the current working directory.
+   Compress : Specifies the compression level to use for encoding.
+  ---------------------------------------------------------------------------*/
+void PNG::Save(const Texture &Image, const std::string &Path, CompLevel Compress)
+   {
+   Destroy();
+
+   //Important - set class to writing mode
+   Mode = PNG::ModeWrite;
+
+   vector2u Res = Image.Resolution();
+   if (Res.U < 1 || Res.V < 1) {return;}
+
+   #if defined (WINDOWS)
+      if (fopen_s(&File, Path.c_str(), "wb") != 0)
+         {throw dexception("Failed to open file: %s.", Path.c_str());}
+   #else
+      File = fopen(Path.c_str(), "wb");
+      if (File == nullptr) {throw dexception("Failed to open file: %s.", Path.c_str());}
+   #endif
+
+   Encode(Image, nullptr, Compress, nullptr);
+
+   //Clean up
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Encodes a PNG file into a memory block, which can be handed over to a
+   File::Writer. The parameters are the same as for the other Save( ).
+  ---------------------------------------------------------------------------*/
+void PNG::Save(const Texture &Image, Writer::Block &Target, CompLevel Compress)
+   {
+   Destroy();
+
+   //Important - set class to writing mode
+   Mode = PNG::ModeWrite;
+
+   vector2u Res = Image.Resolution();
+   if (Res.U < 1 || Res.V < 1) {return;}
+
+   Encode(Image, nullptr, Compress, &Target);
+
+   //Clean up
+   Destroy();
+   }
+
+
+/*---------------------------------------------------------------------------
+   Saves a palette PNG file. If the Palette is empty, the Image is saved as 
+   is, see the other Save( ).
+
+   Image   : Image of 8-bit palette indices.
+   Palette : Palette of up to 256 RGB entries.
+  ---------------------------------------------------------------------------*/
+void PNG::Save(const Texture &Image, const Texture &Palette, const std::string &Path, CompLevel Compress)
+   {
+   if (Palette.Size() < 1) {Save(Image, Path, Compress); return;}
+
+   Destroy();
+
+   //Important - set class to writing mode
+   Mode = PNG::ModeWrite;
+
+   vector2u Res = Image.Resolution();
+   if (Res.U < 1 || Res.V < 1) {return;}
+
+   #if defined (WINDOWS)
+      if (fopen_s(&File, Path.c_str(), "wb") != 0)
+         {throw dexception("Failed to open file: %s.", Path.c_str());}
+   #else
+      File = fopen(Path.c_str(), "wb");
+      if (File == nullptr) {throw dexception("Failed to open file: %s.", Path.c_str());}
+   #endif
+
+   Encode(Image, &Palette, Compress, nullptr);
+
+   //Clean up
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Encodes a palette PNG file into a memory block. The parameters are the 
+   same as for the other Save( ).
+  ---------------------------------------------------------------------------*/
+void PNG::Save(const Texture &Image, const Texture &Palette, Writer::Block &Target, CompLevel Compress)
+   {
+   if (Palette.Size() < 1) {Save(Image, Target, Compress); return;}
+
+   Destroy();
+
+   //Important - set class to writing mode
+   Mode = PNG::ModeWrite;
+
+   vector2u Res = Image.Resolution();
+   if (Res.U < 1 || Res.V < 1) {return;}
+
+   Encode(Image, &Palette, Compress, &Target);
 
    //Clean up
    Destroy();
@@ -13,7 +13,9 @@
   ---------------------------------------------------------------------------*/
 #include "array.h"
 #include "common.h"
+#include "file_writer.h"
 #include "texture.h"
+#include "thread_pool.h"
 
 
 //Namespaces
@@ -55,6 +57,31 @@ class PNG
       };
 
    static const usize HeaderSize = 8;              //Header size to test for PNG format
+   static const usize MinBandRows = 32;            //Minimum number of scanlines in a parallel deflate band
+   static const usize WindowSize = 32768;          //Deflate window size, and the preset dictionary size for each band
+
+   private:
+
+   class Band                                      //Scanline band for parallel encoding
+      {
+      public:
+      Array<uint8, 4096> Raw;                      //Filtered scanlines
+      Array<uint8, 4096> Packed;                   //Deflated data, one IDAT chunk
+      usize RawSize;                               //Number of bytes used in Raw
+      usize PackedSize;                            //Number of bytes used in Packed
+      uLong Adler;                                 //Adler-32 checksum of the filtered scanlines
+      };
+
+   class EncodeJob : public ThreadPool::Job        //Filters or deflates a band of scanlines
+      {
+      public:
+      PNG* Owner;                                  //Encoder, which holds the bands
+      const Texture* Image;                        //Source image
+      usize Bands;                                 //Number of bands the image is split into
+      int Level;                                   //Compression level
+      bool Deflate;                                //Selects the deflate pass, otherwise the filter pass
+      void Run(uiter Task);
+      };
 
    //---- Member data ----
    private:
@@ -64,6 +91,7 @@ class PNG
    png_structp PngPtr;                             //PNG read structure
    png_infop InfoPtr;                              //PNG information structure
    Array<png_bytep, 16> Rows;                      //Row pointer array for decompressing the image
+   Array<Band*, 8> Bands;                          //Encoded bands, retained between frames
 
    //---- Methods ----
    public:
@@ -80,10 +108,24 @@ class PNG
    void Clear(void);
    void Destroy(void);
 
+   //Encoding
+   static void WriteBlock(png_structp PngPtr, png_bytep Data, png_size_t Size);
+   static void FlushBlock(png_structp PngPtr);
+   void Encode(const Texture &Image, const Texture* Palette, CompLevel Compress, Writer::Block* Target);
+
+   //Parallel encoding
+   static uint8 FilterByte(uint Type, const uint8* Cur, const uint8* Prev, usize I, usize BPP);
+   void FilterRows(const Texture &Image, uiter Start, uiter End, Band &Out);
+   void DeflateBand(uiter Task, usize Count, int Level);
+   void EncodeParallel(const Texture &Image, CompLevel Compress);
+
    public:
 
    void Load(Texture &Image, const std::string &Path, float Gamma = 2.2f);
    void Save(const Texture &Image, const std::string &Path, CompLevel Compress = PNG::CompDefault);
+   void Save(const Texture &Image, Writer::Block &Target, CompLevel Compress = PNG::CompDefault);
+   void Save(const Texture &Image, const Texture &Palette, const std::string &Path, CompLevel Compress = PNG::CompDefault);
+   void Save(const Texture &Image, const Texture &Palette, Writer::Block &Target, CompLevel Compress = PNG::CompDefault);
    };
 
 
@@ -0,0 +1,312 @@
+/*===========================================================================
+   Image Sequence Reader
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_SEQUENCE_CPP___
+#define ___FILE_SEQUENCE_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "file_sequence.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+Sequence::Sequence(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Sequence::~Sequence(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Sequence::Clear(void)
+   {
+   Cursor = 0;
+   Next = 0;
+   Exit = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Sequence::Destroy(void)
+   {
+   Close();
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Opens a capture directory. The frames are the files with a purely
+   numeric name and a TGA or PNG extension, as written by CaptureThread,
+   sorted by name.
+
+   Path    : Directory to read.
+   Depth   : Number of frames decoded ahead.
+   Threads : Number of decoder threads, or 0 to match the processor count.
+  ---------------------------------------------------------------------------*/
+void Sequence::Open(const std::string &Path, usize Depth, usize Threads)
+   {
+   Close();
+
+   QDir Dir(QString::fromLocal8Bit(Path.c_str()));
+   if (!Dir.exists()) {throw dexception("Directory does not exist: %s.", Path.c_str());}
+
+   QStringList Filters;
+   Filters << "*.tga" << "*.png" << "*.TGA" << "*.PNG";
+   QStringList Names = Dir.entryList(Filters, QDir::Files, QDir::Name);
+
+   for (int I = 0; I < Names.size(); I++)
+      {
+      QString Base = QFileInfo(Names[I]).baseName();
+
+      bool Numeric = false;
+      Base.toULongLong(&Numeric);
+      if (!Numeric) {continue;}
+
+      Files += std::string(Dir.absoluteFilePath(Names[I]).toLocal8Bit().constData());
+      }
+
+   if (Files.Size() < 1) {throw dexception("No image sequence found in: %s.", Path.c_str());}
+
+   Start(Depth, Threads);
+   }
+
+/*---------------------------------------------------------------------------
+   Allocates the look-ahead window, and starts the decoder threads.
+  ---------------------------------------------------------------------------*/
+void Sequence::Start(usize Depth, usize Threads)
+   {
+   if (Depth < 1) {throw dexception("Invalid parameters.");}
+
+   if (Threads < 1) {Threads = (usize)Math::Max(QThread::idealThreadCount(), 1);}
+   Threads = Math::Min(Math::Min(Threads, Sequence::MaxThreads), Depth);
+
+   Slots.Create(Depth);
+   for (uiter I = 0; I < Depth; I++) {Slots[I] = new Slot;}
+
+   Cursor = 0;
+   Next = 0;
+   Exit = false;
+
+   for (uiter I = 0; I < Threads; I++)
+      {
+      Worker* Thread = new Worker(this);
+      Workers += Thread;
+      Thread->start();
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Stops the decoder threads, and releases all frames.
+  ---------------------------------------------------------------------------*/
+void Sequence::Close(void)
+   {
+   if (Workers.Size() > 0)
+      {
+      Mutex.lock();
+      Exit = true;
+      WorkWait.wakeAll();
+      Mutex.unlock();
+
+      for (uiter I = 0; I < Workers.Size(); I++)
+         {
+         Workers[I]->wait();
+         delete Workers[I];
+         }
+      }
+
+   Workers.Destroy();
+
+   for (uiter I = 0; I < Slots.Size(); I++) {delete Slots[I];}
+   Slots.Destroy();
+
+   Files.Destroy();
+
+   Cursor = 0;
+   Next = 0;
+   Exit = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Claims a slot for the next frame that needs decoding, or returns nullptr
+   if the window is full. Frames that are already decoded, or are being
+   decoded, are skipped. Must be called with the Mutex locked.
+  ---------------------------------------------------------------------------*/
+Sequence::Slot* Sequence::Pick(void)
+   {
+   const usize Depth = Slots.Size();
+
+   while (Next < Cursor + Depth && Next < Files.Size())
+      {
+      Slot* Item = Slots[(uiter)(Next % Depth)];
+
+      if (Item->Frame == Next && !Item->Stale && Item->State != Sequence::SlotEmpty) {Next++; continue;}
+
+      //Wait for a discarded frame to finish before reusing its slot
+      if (Item->State == Sequence::SlotBusy) {return nullptr;}
+
+      Item->Frame = Next;
+      Item->State = Sequence::SlotBusy;
+      Item->Error.clear();
+      Next++;
+
+      return Item;
+      }
+
+   return nullptr;
+   }
+
+/*---------------------------------------------------------------------------
+   Decoder thread loop. Frames are decoded outside the lock, since Read( )
+   never touches busy slots.
+  ---------------------------------------------------------------------------*/
+void Sequence::Work(Worker &Thread)
+   {
+   Mutex.lock();
+
+   while (!Exit)
+      {
+      Slot* Item = Pick();
+      if (Item == nullptr) {WorkWait.wait(&Mutex); continue;}
+
+      std::string Path = Files[(uiter)Item->Frame];
+      std::string Error;
+
+      Mutex.unlock();
+
+      try {
+         usize Length = Path.size();
+         bool PNG = Length > 4 && (Path.compare(Length - 4, 4, ".png") == 0 || Path.compare(Length - 4, 4, ".PNG") == 0);
+
+         if (PNG) {Thread.PNG.Load(Item->Image, Path);}
+         else {Thread.TGA.Load(Item->Image, Path);}
+         }
+
+      catch (std::exception &e)
+         {Error = e.what();}
+
+      catch (...)
+         {Error = "Trapped an unhandled exception.";}
+
+      Mutex.lock();
+
+      if (Item->Stale)
+         {
+         Item->State = Sequence::SlotEmpty;
+         Item->Stale = false;
+         WorkWait.wakeAll();
+         continue;
+         }
+
+      Item->State = Error.size() > 0 ? Sequence::SlotFailed : Sequence::SlotReady;
+      Item->Error = Error;
+      ReadyWait.wakeAll();
+      }
+
+   Mutex.unlock();
+   }
+
+/*---------------------------------------------------------------------------
+   Copies the next frame into Image, waiting for it to be decoded if
+   necessary. Returns false past the last frame. Throws an exception if the
+   frame could not be decoded, the following frames can still be read.
+  ---------------------------------------------------------------------------*/
+bool Sequence::Read(Texture &Image)
+   {
+   if (Workers.Size() < 1) {throw dexception("Image sequence is not open.");}
+
+   QMutexLocker Locker(&Mutex);
+
+   if (Cursor >= Files.Size()) {return false;}
+
+   Slot* Item = Slots[(uiter)(Cursor % Slots.Size())];
+
+   while (Item->Frame != Cursor || Item->Stale || (Item->State != Sequence::SlotReady && Item->State != Sequence::SlotFailed))
+      {
+      ReadyWait.wait(&Mutex);
+      }
+
+   uint64 Frame = Cursor;
+   Cursor++;
+
+   if (Item->State == Sequence::SlotFailed)
+      {
+      std::string Error = Item->Error;
+      Item->State = Sequence::SlotEmpty;
+      WorkWait.wakeAll();
+      throw dexception("Failed to decode frame %llu: %s", (unsigned long long)Frame, Error.c_str());
+      }
+
+   vector2u Res = Image.Resolution();
+   vector2u ItemRes = Item->Image.Resolution();
+   if (Res.U != ItemRes.U || Res.V != ItemRes.V || Image.DataType() != Item->Image.DataType())
+      {
+      Image.Create(ItemRes, Item->Image.DataType());
+      }
+
+   memcpy(Image.Pointer(), Item->Image.Pointer(), Item->Image.Size());
+
+   Item->State = Sequence::SlotEmpty;
+   WorkWait.wakeAll();
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Moves the read position to a frame, so that the next Read( ) returns
+   exactly that frame. Seeking to the frame count positions at the end.
+  ---------------------------------------------------------------------------*/
+void Sequence::Seek(uint64 Frame)
+   {
+   if (Workers.Size() < 1) {throw dexception("Image sequence is not open.");}
+   if (Frame > Files.Size()) {throw dexception("Frame number is out of range.");}
+
+   QMutexLocker Locker(&Mutex);
+
+   Cursor = Frame;
+   Next = Frame;
+
+   const usize Depth = Slots.Size();
+
+   for (uiter I = 0; I < Depth; I++)
+      {
+      Slot* Item = Slots[I];
+      if (Item->Frame >= Frame && Item->Frame < Frame + Depth) {continue;}
+
+      if (Item->State == Sequence::SlotBusy) {Item->Stale = true;}
+      else {Item->State = Sequence::SlotEmpty;}
+      }
+
+   WorkWait.wakeAll();
+   }
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,130 @@
+/*===========================================================================
+   Image Sequence Reader
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_SEQUENCE_H___
+#define ___FILE_SEQUENCE_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "file_png.h"
+#include "file_tga.h"
+#include "texture.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+  Reads the numbered TGA and PNG files of a capture directory in order. A
+  few worker threads decode the upcoming frames into a bounded look-ahead
+  window, so the frames are delivered at decode throughput, rather than at
+  the latency of loading one file after another.
+
+  The window is a ring of slots, and frame N always lands in slot N modulo
+  the window size. Seek( ) moves the window to any frame. Frames that are
+  already decoded and still inside the new window are kept, and the
+  workers discard the ones that are being decoded outside of it.
+  ---------------------------------------------------------------------------*/
+class Sequence
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const usize DefaultDepth = 16;           //Default number of frames decoded ahead
+   static const usize MaxThreads = 8;              //Upper limit on decoder threads
+
+   private:
+
+   enum SlotState                                  //Slot state enumeration
+      {
+      SlotEmpty = 0,                               //Slot is free
+      SlotBusy = 1,                                //Frame is being decoded
+      SlotReady = 2,                               //Frame is decoded
+      SlotFailed = 3                               //Frame could not be decoded, see Error
+      };
+
+   class Slot                                      //Decoded frame storage
+      {
+      public:
+      Texture Image;                               //Decoded frame
+      uint64 Frame;                                //Frame number held by the slot
+      SlotState State;                             //Slot state
+      bool Stale;                                  //Frame moved out of the window while it was being decoded
+      std::string Error;                           //Error message of a failed frame
+      Slot(void) : Frame(0), State(SlotEmpty), Stale(false) {}
+      };
+
+   class Worker : public QThread                   //Decoder thread, no signals or slots
+      {
+      private:
+      Sequence* Owner;
+      public:
+      File::TGA TGA;                               //Decoders are not thread safe, so each thread has its own
+      File::PNG PNG;
+      Worker(Sequence* Owner) : Owner(Owner) {}
+      void run(void) {Owner->Work(*this);}
+      };
+
+   //---- Member data ----
+   private:
+
+   Array<std::string, 256> Files;                  //Frame file paths, in frame order
+   Array<Slot*, 16> Slots;                         //Look-ahead window
+   Array<Worker*, 8> Workers;                      //Decoder threads
+   uint64 Cursor;                                  //Next frame returned by Read( )
+   uint64 Next;                                    //Next frame to be decoded
+   QMutex Mutex;                                   //Guards the window state
+   QWaitCondition WorkWait;                        //Signals workers when a slot can be filled
+   QWaitCondition ReadyWait;                       //Signals Read( ) when a frame is decoded
+   bool Exit;                                      //Signals the workers to exit
+
+   //---- Methods ----
+   public:
+
+   Sequence(void);
+   ~Sequence(void);
+
+   private:
+
+   Sequence(const Sequence &obj);                  //Disable
+   Sequence &operator = (const Sequence &obj);     //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Decoding
+   void Start(usize Depth, usize Threads);
+   Slot* Pick(void);
+   void Work(Worker &Thread);
+
+   public:
+
+   void Open(const std::string &Path, usize Depth = Sequence::DefaultDepth, usize Threads = 0);
+   void Close(void);
+   bool Read(Texture &Image);
+   void Seek(uint64 Frame);
+
+   inline bool Ready(void) const {return Workers.Size() > 0;}
+   inline uint64 GetFrames(void) const {return Files.Size();}
+   inline uint64 GetPosition(void) const {return Cursor;}
+   inline std::string GetPath(uint64 Frame) const {return Files[(uiter)Frame];}
+   };
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -55,7 +55,8 @@ void Text::Destroy(void)
    }
 
 /*---------------------------------------------------------------------------
-   Load a string buffer from a file.
+   Load a string buffer from a file. The contents are appended to the
+   string, which always ends with a newline character afterwards.
   ---------------------------------------------------------------------------*/
 void Text::Load(std::string &String, const std::string &Path)
    {
@@ -68,19 +69,21 @@ void Text::Load(std::string &String, const std::string &Path)
 
    File.seekg(0, std::fstream::end);
    
-   if ((usize)File.tellg() > Text::MaxSize) 
+   usize Size = (usize)File.tellg();
+
+   if (Size > Text::MaxSize) 
       {throw dexception("File size exceeds limit (%d) for \"%s\".", Text::MaxSize, Path.c_str());}
    
    File.seekg(0);
 
-   std::string Line;
+   //Read in one go, text mode translation may yield fewer characters than the file size
+   usize Start = String.size();
+   String.resize(Start + Size);
+   if (Size > 0) {File.read(&String[Start], (std::streamsize)Size);}
+   String.resize(Start + (usize)File.gcount());
 
-   while (File.good())
-      {
-      std::getline(File, Line);
-      String += Line;
-      String += "\n";   //Preserve newline character in source
-      }
+   if (String.size() < 1 || String[String.size() - 1] != '\n') 
+      {String += "\n";}   //Preserve newline character in source
 
    Destroy();
    }
@@ -35,6 +35,9 @@ TGA::TGA(void)
 TGA::~TGA(void)
    {
    Destroy();
+
+   //Encoder resources are kept across Save( ) calls, and only released here
+   for (uiter I = 0; I < Bands.Size(); I++) {delete Bands[I];}
    }
 
 /*---------------------------------------------------------------------------
@@ -54,6 +57,8 @@ void TGA::Clear(void)
    Header.ResV = 0;
    Header.BitsPerPixel = 0;
    Header.ImageDesc = 0;
+
+   Target = nullptr;
    }
 
 /*---------------------------------------------------------------------------
@@ -387,11 +392,13 @@ void TGA::Load(Texture &Image, const std::string &Path)
       case TGA::TypeGrey :
       case TGA::TypeGreyRLE :
          {
-         if (Header.BitsPerPixel != 8) 
-            {throw dexception("Currently only 8-bit grey scale images are supported.");}
-      
-         Type = Texture::TypeLum;
-         ImageColour = &Colour8; 
+         switch (Header.BitsPerPixel)
+            {
+            case 8  : Type = Texture::TypeLum; ImageColour = &Colour8; break;
+            case 16 : Type = Texture::TypeDepth; ImageColour = &Grey16; break;
+            default : throw dexception("Currently only 8-bit and 16-bit grey scale images are supported.");
+            }
+
          Decompress = Header.ImageType == TGA::TypeGreyRLE;
          break;
          }
@@ -425,6 +432,22 @@ void TGA::Load(Texture &Image, const std::string &Path)
    Destroy();
    }
 
+/*---------------------------------------------------------------------------
+   Writes encoded data either to the file, or to the Target block when 
+   encoding into memory.
+  ---------------------------------------------------------------------------*/
+void TGA::Write(const void* Ptr, usize Size)
+   {
+   if (Target != nullptr) 
+      {
+      Target->Write(Ptr, Size);
+      return;
+      }
+
+   File.write(reinterpret_cast<const char*>(Ptr), Size);
+   if (File.bad()) {throw dexception("File I/O error.");}
+   }
+
 /*---------------------------------------------------------------------------
    Saves the file header. Note, the Header is passed as a copy, because some 
    requires modification before saving.
@@ -441,19 +464,18 @@ void TGA::SaveHeader(FileHeader Header)
       Header.ResV = Math::SwapEndian(Header.ResV);
       }
 
-   File.write(reinterpret_cast<char*>(&Header.ID_FieldSize), 1);
-   File.write(reinterpret_cast<char*>(&Header.ColMapType), 1);
-   File.write(reinterpret_cast<char*>(&Header.ImageType), 1);
-   File.write(reinterpret_cast<char*>(&Header.ColMapEntOffset), 2);
-   File.write(reinterpret_cast<char*>(&Header.ColMapEntCount), 2);
-   File.write(reinterpret_cast<char*>(&Header.ColMapEntSize), 1);
-   File.write(reinterpret_cast<char*>(&Header.OriginU), 2);
-   File.write(reinterpret_cast<char*>(&Header.OriginV), 2);
-   File.write(reinterpret_cast<char*>(&Header.ResU), 2);
-   File.write(reinterpret_cast<char*>(&Header.ResV), 2);
-   File.write(reinterpret_cast<char*>(&Header.BitsPerPixel), 1);
-   File.write(reinterpret_cast<char*>(&Header.ImageDesc), 1);
-   if (File.bad()) {throw dexception("File I/O error.");}
+   Write(&Header.ID_FieldSize, 1);
+   Write(&Header.ColMapType, 1);
+   Write(&Header.ImageType, 1);
+   Write(&Header.ColMapEntOffset, 2);
+   Write(&Header.ColMapEntCount, 2);
+   Write(&Header.ColMapEntSize, 1);
+   Write(&Header.OriginU, 2);
+   Write(&Header.OriginV, 2);
+   Write(&Header.ResU, 2);
+   Write(&Header.ResV, 2);
+   Write(&Header.BitsPerPixel, 1);
+   Write(&Header.ImageDesc, 1);
    }
 
 /*---------------------------------------------------------------------------
@@ -479,8 +501,7 @@ void TGA::SaveImage(const Texture &Image, const TGA::Iterator &Iter, const TGA::
          Dst += BytesPerBixel;
          }
 
-      File.write(reinterpret_cast<char*>(Buffer.Pointer()), Buffer.Size());
-      if (File.bad()) {throw dexception("File I/O error.");}
+      Write(Buffer.Pointer(), Buffer.Size());
       }
    }
 
@@ -544,9 +565,14 @@ bool TGA::EncodeCount(const Texture &Image, const TGA::Iterator &Iter, vector2<i
    }
 
 /*---------------------------------------------------------------------------
-   Saves a compressed image data to file.
+   Run-length encodes a range of scanlines into a memory block. Packets 
+   never cross scanlines, so each range can be encoded independently.
+
+   Start : First scanline, counted in the iterator direction.
+   End   : Last scanline, not inclusive.
+   Out   : Block to receive the packets.
   ---------------------------------------------------------------------------*/
-void TGA::SaveImageEncode(const Texture &Image, const TGA::Iterator &Iter, const TGA::Colour &Colour)
+void TGA::EncodeRows(const Texture &Image, const TGA::Iterator &Iter, const TGA::Colour &Colour, uiter Start, uiter End, Writer::Block &Out)
    {
    const usize BytesPerBixel = Math::ByteSize((usize)Header.BitsPerPixel);
    uint8* Dst, *Src, Code;
@@ -555,8 +581,10 @@ void TGA::SaveImageEncode(const Texture &Image, const TGA::Iterator &Iter, const
    Array<uint8, 16> Buffer;
    Buffer.Create(BytesPerBixel * Image.Resolution().U);
 
-   for (P.V = Iter.S.V; P.V != Iter.E.V; P.V += Iter.I.V)
+   for (uiter Row = Start; Row < End; Row++)
       {
+      P.V = Iter.S.V + (iter)Row * Iter.I.V;
+
       for (P.U = Iter.S.U; P.U != Iter.E.U;)
          {
          usize Count;
@@ -565,15 +593,13 @@ void TGA::SaveImageEncode(const Texture &Image, const TGA::Iterator &Iter, const
             {
             Code = (uint8)(0x80 | Count);
 
-            File.write(reinterpret_cast<char*>(&Code), 1);
-            if (File.bad()) {throw dexception("File I/O error.");}
+            Out.Write(&Code, 1);
 
             Dst = Buffer.Pointer();
             Src = Image.Address((uint)P.U, (uint)P.V);
             Colour.Encode(Dst, Src);
 
-            File.write(reinterpret_cast<char*>(Buffer.Pointer()), BytesPerBixel);
-            if (File.bad()) {throw dexception("File I/O error.");}
+            Out.Write(Buffer.Pointer(), BytesPerBixel);
 
             P.U += (Count + 1) * Iter.I.U;
             }
@@ -581,8 +607,7 @@ void TGA::SaveImageEncode(const Texture &Image, const TGA::Iterator &Iter, const
             {
             Code = (uint8)Count;
 
-            File.write(reinterpret_cast<char*>(&Code), 1);
-            if (File.bad()) {throw dexception("File I/O error.");}
+            Out.Write(&Code, 1);
 
             Dst = Buffer.Pointer();
 
@@ -593,35 +618,65 @@ void TGA::SaveImageEncode(const Texture &Image, const TGA::Iterator &Iter, const
                Dst += BytesPerBixel;
                }
 
-            File.write(reinterpret_cast<char*>(Buffer.Pointer()), (Count + 1) * BytesPerBixel);
-            if (File.bad()) {throw dexception("File I/O error.");}
+            Out.Write(Buffer.Pointer(), (Count + 1) * BytesPerBixel);
             }
          }
       }
    }
 
 /*---------------------------------------------------------------------------
-   Saves a TGA file.
+   Encodes a single band of scanlines.
+  ---------------------------------------------------------------------------*/
+void TGA::EncodeJob::Run(uiter Task)
+   {
+   const uiter Start = (Rows * Task) / Bands;
+   const uiter End = (Rows * (Task + 1)) / Bands;
 
-   Image    : Image to save.
-   Path     : Path to image file, relative to the current working directory.
-   Flip     : Flip the image horizontally, vertically, or both.
-   Compress : Apply run-lenght encoding on the image.
+   Owner->EncodeRows(*Image, *Iter, *Colour, Start, End, *Owner->Bands[Task]);
+   }
+
+/*---------------------------------------------------------------------------
+   Saves a compressed image data to file. The image is split into bands of 
+   scanlines, which are encoded concurrently, then written out in order.
   ---------------------------------------------------------------------------*/
-void TGA::Save(const Texture &Image, const std::string &Path, const vector2b &Flip, bool Compress)
+void TGA::SaveImageEncode(const Texture &Image, const TGA::Iterator &Iter, const TGA::Colour &Colour)
    {
-   Destroy();
+   ThreadPool &Pool = ThreadPool::Shared();
+
+   const usize Rows = Image.Resolution().V;
+
+   EncodeJob Job;
+   Job.Owner = this;
+   Job.Image = &Image;
+   Job.Iter = &Iter;
+   Job.Colour = &Colour;
+   Job.Rows = Rows;
+   Job.Bands = Math::Max(Math::Min(Pool.Threads() * TGA::BandsPerThread, Rows / TGA::MinBandRows), (usize)1);
 
+   while (Bands.Size() < Job.Bands) {Bands += new Writer::Block;}
+
+   for (uiter I = 0; I < Job.Bands; I++) {Bands[I]->Reset();}
+
+   Pool.Run(Job, Job.Bands);
+
+   for (uiter I = 0; I < Job.Bands; I++) 
+      {
+      Write(Bands[I]->Pointer(), Bands[I]->Size());
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Encodes the header and image data, see Save( ). The output is sent 
+   through Write( ), so the File or Target must be set up beforehand. If a
+   Palette is specified, the image holds 8-bit colour map indices.
+  ---------------------------------------------------------------------------*/
+void TGA::Encode(const Texture &Image, const Texture* Palette, const vector2b &Flip, bool Compress)
+   {
    vector2<iter> Res = cast_vector2(iter, Image.Resolution());
 
    if (Res.U < 1 || Res.V < 1 || (uiter)Res.U > TGA::MaxRes || (uiter)Res.V > TGA::MaxRes)
       {throw dexception("Image resolution is out of range.");}
 
-   File.open(Path.c_str(), std::fstream::out | std::fstream::binary);
-   
-   if (File.bad() || !File.is_open()) 
-      {throw dexception("Failed to open \"%s\".", Path.c_str());}
-
    std::string ID;
    ID  = "Created by ";
    ID += AppName;
@@ -673,13 +728,42 @@ void TGA::Save(const Texture &Image, const std::string &Path, const vector2b &Fl
       }
 
    Header.BitsPerPixel = (uint8)Image.GetBitsPerPixel();
+
+   if (Palette != nullptr)
+      {
+      usize Entries = (usize)Palette->Resolution().U * (usize)Palette->Resolution().V;
+
+      if (Image.DataType() != Texture::TypeLum || Palette->DataType() != Texture::TypeRGB || Entries < 1 || Entries > 256)
+         {throw dexception("Unkown or unsupported colour map.");}
+
+      Header.ColMapType = 1;
+      Header.ColMapEntCount = (uint16)Entries;
+      Header.ColMapEntSize = 24;
+      Header.ImageType = Compress ? (uint8)TGA::TypeCMapRLE : (uint8)TGA::TypeCMap;
+      }
    
    SaveHeader(Header);
 
    if (Header.ID_FieldSize > 0)
       {
-      File.write(ID.c_str(), Header.ID_FieldSize);
-      if (File.bad()) {throw dexception("File I/O error.");}
+      Write(ID.c_str(), Header.ID_FieldSize);
+      }
+
+   //Colour map follows the ID field
+   if (Palette != nullptr)
+      {
+      Array<uint8, 16> Buffer;
+      Buffer.Create(Palette->Size());
+
+      uint8* Dst = Buffer.Pointer();
+      const uint8* Src = Palette->Pointer();
+
+      for (uiter I = 0; I < Header.ColMapEntCount; I++, Dst += 3, Src += 3)
+         {
+         Colour24.Encode(Dst, Src);
+         }
+
+      Write(Buffer.Pointer(), Buffer.Size());
       }
 
    //Setup iterators
@@ -693,6 +777,96 @@ void TGA::Save(const Texture &Image, const std::string &Path, const vector2b &Fl
 
    if (Compress) {SaveImageEncode(Image, Iter, *ImageColour);} 
    else {SaveImage(Image, Iter, *ImageColour);}
+   }
+
+/*---------------------------------------------------------------------------
+   Saves a TGA file.
+
+   Image    : Image to save.
+   Path     : Path to image file, relative to the current working directory.
+   Flip     : Flip the image horizontally, vertically, or both.
+   Compress : Apply run-lenght encoding on the image.
+  ---------------------------------------------------------------------------*/
+void TGA::Save(const Texture &Image, const std::string &Path, const vector2b &Flip, bool Compress)
+   {
+   Destroy();
+
+   File.open(Path.c_str(), std::fstream::out | std::fstream::binary);
+   
+   if (File.bad() || !File.is_open()) 
+      {throw dexception("Failed to open \"%s\".", Path.c_str());}
+
+   Encode(Image, nullptr, Flip, Compress);
+
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Encodes a TGA file into a memory block, which can be handed over to a 
+   File::Writer. The parameters are the same as for the other Save( ).
+  ---------------------------------------------------------------------------*/
+void TGA::Save(const Texture &Image, Writer::Block &Target, const vector2b &Flip, bool Compress)
+   {
+   Destroy();
+
+   try {
+      TGA::Target = &Target;
+      Encode(Image, nullptr, Flip, Compress);
+      }
+
+   catch (...)
+      {
+      Destroy();
+      throw;
+      }
+
+   Destroy();
+   }
+
+
+/*---------------------------------------------------------------------------
+   Saves a colour mapped TGA file. If the Palette is empty, the Image is
+   saved as is, see the other Save( ).
+
+   Image   : Image of 8-bit colour map indices.
+   Palette : Colour map of up to 256 RGB entries.
+  ---------------------------------------------------------------------------*/
+void TGA::Save(const Texture &Image, const Texture &Palette, const std::string &Path, const vector2b &Flip, bool Compress)
+   {
+   if (Palette.Size() < 1) {Save(Image, Path, Flip, Compress); return;}
+
+   Destroy();
+
+   File.open(Path.c_str(), std::fstream::out | std::fstream::binary);
+   
+   if (File.bad() || !File.is_open()) 
+      {throw dexception("Failed to open \"%s\".", Path.c_str());}
+
+   Encode(Image, &Palette, Flip, Compress);
+
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Encodes a colour mapped TGA file into a memory block. The parameters are 
+   the same as for the other Save( ).
+  ---------------------------------------------------------------------------*/
+void TGA::Save(const Texture &Image, const Texture &Palette, Writer::Block &Target, const vector2b &Flip, bool Compress)
+   {
+   if (Palette.Size() < 1) {Save(Image, Target, Flip, Compress); return;}
+
+   Destroy();
+
+   try {
+      TGA::Target = &Target;
+      Encode(Image, &Palette, Flip, Compress);
+      }
+
+   catch (...)
+      {
+      Destroy();
+      throw;
+      }
 
    Destroy();
    }
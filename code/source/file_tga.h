@@ -12,7 +12,9 @@
    Header files
   ---------------------------------------------------------------------------*/
 #include "common.h"
+#include "file_writer.h"
 #include "texture.h"
+#include "thread_pool.h"
 
 
 //Namespaces
@@ -116,12 +118,31 @@ class TGA
       vector2<iter> I;                             //Increment size
       };
 
+   static const usize BandsPerThread = 4;          //Number of RLE bands per worker thread
+   static const usize MinBandRows = 16;            //Minimum number of scanlines in an RLE band
+
+   private:
+
+   class EncodeJob : public ThreadPool::Job        //Encodes a band of scanlines with RLE
+      {
+      public:
+      TGA* Owner;                                  //Encoder, which holds the band buffers
+      const Texture* Image;                        //Source image
+      const TGA::Iterator* Iter;                   //Image iterator
+      const TGA::Colour* Colour;                   //Colour conversion
+      usize Rows;                                  //Number of scanlines in the image
+      usize Bands;                                 //Number of bands the image is split into
+      void Run(uiter Task);
+      };
+
    //---- Member data ----
    private:
 
    std::fstream File;
    FileHeader Header;
    Array<uint8, 32> ColourMap;
+   Writer::Block* Target;                          //Memory target for encoding, see Save( )
+   Array<Writer::Block*, 16> Bands;                //Encoded RLE bands, retained between frames
 
    //---- Methods ----
    public:
@@ -145,16 +166,22 @@ class TGA
    void ReadImage(Texture &Image, const TGA::Iterator &Iter, const TGA::Colour &Colour);
    void ReadImageDecode(Texture &Image, const TGA::Iterator &Iter, const TGA::Colour &Colour);
 
+   void Write(const void* Ptr, usize Size);
    void SaveHeader(FileHeader Header);
    void SaveImage(const Texture &Image, const TGA::Iterator &Iter, const TGA::Colour &Colour);
    bool ComparePixel(const uint8* Dst, const uint8* Src, const usize BytesPerBixel);
    bool EncodeCount(const Texture &Image, const TGA::Iterator &Iter, vector2<iter> P, usize &Count);
+   void EncodeRows(const Texture &Image, const TGA::Iterator &Iter, const TGA::Colour &Colour, uiter Start, uiter End, Writer::Block &Out);
    void SaveImageEncode(const Texture &Image, const TGA::Iterator &Iter, const TGA::Colour &Colour);
+   void Encode(const Texture &Image, const Texture* Palette, const vector2b &Flip, bool Compress);
 
    public:
 
    void Load(Texture &Image, const std::string &Path);
    void Save(const Texture &Image, const std::string &Path, const vector2b &Flip = false, bool Compress = true);
+   void Save(const Texture &Image, Writer::Block &Target, const vector2b &Flip = false, bool Compress = true);
+   void Save(const Texture &Image, const Texture &Palette, const std::string &Path, const vector2b &Flip = false, bool Compress = true);
+   void Save(const Texture &Image, const Texture &Palette, Writer::Block &Target, const vector2b &Flip = false, bool Compress = true);
    };
 
 
@@ -0,0 +1,343 @@
+/*===========================================================================
+   Capture Session Transcoder
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_TRANSCODER_CPP___
+#define ___FILE_TRANSCODER_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "file_transcoder.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+Transcoder::Transcoder(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Transcoder::~Transcoder(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Transcoder::Clear(void)
+   {
+   Pool = nullptr;
+   Thread = nullptr;
+   BatchSize = 0;
+   Pending = nullptr;
+   PendingCount = 0;
+   Written = 0;
+   Exit = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Transcoder::Destroy(void)
+   {
+   Stop();
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Opens the source and target, and starts the encoder and write threads.
+   The decoder threads take a quarter of the processors, since deflating a
+   frame costs several times more than loading it.
+  ---------------------------------------------------------------------------*/
+void Transcoder::Start(const std::string &Source, const std::string &Target, usize Threads)
+   {
+   Stop();
+
+   if (Threads < 1) {Threads = (usize)Math::Max(QThread::idealThreadCount(), 1);}
+
+   usize Decoders = Math::Max(Threads / 4, (usize)1);
+   usize Encoders = Math::Max(Threads - Math::Min(Decoders, Threads), (usize)1);
+
+   Pool = new ThreadPool(Encoders);
+   BatchSize = Pool->Threads() * Transcoder::BatchPerThread;
+
+   Items.Create(BatchSize * 2);
+   for (uiter I = 0; I < Items.Size(); I++) {Items[I] = new Item;}
+
+   Input.Open(Source, BatchSize * 2, Decoders);
+   Output.Create(Target);
+
+   Pending = nullptr;
+   PendingCount = 0;
+   Written = Output.GetBytes();
+   Error.clear();
+   Exit = false;
+
+   Thread = new Worker(this);
+   Thread->start();
+
+   debug("Transcoding %llu frames with %u decoder and %u encoder threads.\n",
+      (unsigned long long)Input.GetFrames(), (uint)Decoders, (uint)Pool->Threads());
+   }
+
+/*---------------------------------------------------------------------------
+   Stops all threads, closes the files and releases the batches. Frames
+   that are still pending are not written.
+  ---------------------------------------------------------------------------*/
+void Transcoder::Stop(void)
+   {
+   if (Thread != nullptr)
+      {
+      Mutex.lock();
+      Exit = true;
+      WorkWait.wakeAll();
+      Mutex.unlock();
+
+      Thread->wait();
+      delete Thread;
+      Thread = nullptr;
+      }
+
+   if (Pool != nullptr) {delete Pool; Pool = nullptr;}
+
+   Input.Close();
+   Output.Close();
+
+   for (uiter I = 0; I < Items.Size(); I++) {delete Items[I];}
+   Items.Destroy();
+
+   BatchSize = 0;
+   Pending = nullptr;
+   PendingCount = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Hands an encoded batch to the write thread, after the previous batch is
+   written. Rethrows the error of a failed write.
+  ---------------------------------------------------------------------------*/
+void Transcoder::Submit(Item** Batch, usize Count)
+   {
+   QMutexLocker Locker(&Mutex);
+
+   while (Pending != nullptr && Error.size() < 1) {DoneWait.wait(&Mutex);}
+   if (Error.size() > 0) {throw dexception("%s", Error.c_str());}
+
+   Pending = Batch;
+   PendingCount = Count;
+   WorkWait.wakeAll();
+   }
+
+/*---------------------------------------------------------------------------
+   Waits until the last batch is written.
+  ---------------------------------------------------------------------------*/
+void Transcoder::Flush(void)
+   {
+   QMutexLocker Locker(&Mutex);
+
+   while (Pending != nullptr && Error.size() < 1) {DoneWait.wait(&Mutex);}
+   if (Error.size() > 0) {throw dexception("%s", Error.c_str());}
+   }
+
+/*---------------------------------------------------------------------------
+   Write thread loop. Records are appended outside the lock, the batch is
+   not touched by the caller until Pending is cleared.
+  ---------------------------------------------------------------------------*/
+void Transcoder::Work(void)
+   {
+   Mutex.lock();
+
+   while (!Exit)
+      {
+      if (Pending == nullptr || Error.size() > 0) {WorkWait.wait(&Mutex); continue;}
+
+      Item** Batch = Pending;
+      usize Count = PendingCount;
+      uint64 Bytes = Written;
+      std::string Failure;
+
+      Mutex.unlock();
+
+      try {
+         for (uiter I = 0; I < Count; I++) {Output.Write(Batch[I]->Record); Bytes += Batch[I]->Record.Size();}
+         }
+
+      catch (std::exception &e)
+         {Failure = e.what();}
+
+      catch (...)
+         {Failure = "Trapped an unhandled exception.";}
+
+      Mutex.lock();
+
+      Written = Bytes;
+      Error = Failure;
+      Pending = nullptr;
+      PendingCount = 0;
+      DoneWait.wakeAll();
+      }
+
+   Mutex.unlock();
+   }
+
+/*---------------------------------------------------------------------------
+   Encodes a single frame of the batch.
+  ---------------------------------------------------------------------------*/
+void Transcoder::EncodeJob::Run(uiter Task)
+   {
+   Item* Frame = Batch[Task];
+   Archive::Encode(Frame->Record, Frame->Image, Level);
+   }
+
+/*---------------------------------------------------------------------------
+   Prints a progress line, or the final summary.
+  ---------------------------------------------------------------------------*/
+void Transcoder::Print(FILE* Report, const Metrics &Stats, bool Final)
+   {
+   if (Report == nullptr) {return;}
+
+   const double MB = 1024.0 * 1024.0;
+   double Seconds = Math::Max(Stats.Seconds, 0.001);
+
+   fprintf(Report, "%s%llu frames, %.1f s, read %.1f MB/s, raw %.1f MB/s, written %.1f MB/s",
+      Final ? "" : "\r", (unsigned long long)Stats.Frames, Stats.Seconds,
+      (double)Stats.BytesRead / MB / Seconds, (double)Stats.BytesRaw / MB / Seconds,
+      (double)Stats.BytesWritten / MB / Seconds);
+
+   if (Final)
+      {
+      double Ratio = Stats.BytesRaw > 0 ? 100.0 * (double)Stats.BytesWritten / (double)Stats.BytesRaw : 0.0;
+      fprintf(Report, ", %.1f%% of raw, %llu frames skipped\n", Ratio, (unsigned long long)Stats.Failed);
+      }
+
+   fflush(Report);
+   }
+
+/*---------------------------------------------------------------------------
+   Transcodes a capture directory into a frame archive.
+
+   Source  : Directory of numbered TGA or PNG frames, see Sequence::Open( ).
+   Target  : Archive file path, existing files are overwritten.
+   Level   : zlib compression level, 1 to 9.
+   Threads : Total number of decoder and encoder threads, or 0 to match the
+             processor count.
+   Report  : Stream for progress reports, or nullptr.
+
+   Returns the statistics of the whole run.
+  ---------------------------------------------------------------------------*/
+Transcoder::Metrics Transcoder::Run(const std::string &Source, const std::string &Target, int Level, usize Threads, FILE* Report)
+   {
+   Metrics Stats;
+   memset(&Stats, 0, sizeof(Stats));
+
+   QTime Clock;
+   Clock.start();
+   int LastReport = 0;
+
+   try {
+      Start(Source, Target, Threads);
+
+      EncodeJob Job;
+      Job.Level = Level;
+
+      uiter Fill = 0;
+      bool End = false;
+
+      while (!End)
+         {
+         Item** Batch = Items.Pointer() + Fill * BatchSize;
+         usize Count = 0;
+
+         //Collect a batch while the write thread works on the previous one
+         while (Count < BatchSize)
+            {
+            uint64 Frame = Input.GetPosition();
+
+            try {
+               if (!Input.Read(Batch[Count]->Image)) {End = true; break;}
+               }
+
+            catch (std::exception &e)
+               {
+               Stats.Failed++;
+               debug("Skipped frame: %s\n", e.what());
+               if (Report != nullptr) {fprintf(Report, "\nSkipped frame %llu: %s\n", (unsigned long long)Frame, e.what());}
+               continue;
+               }
+
+            Stats.BytesRead += (uint64)QFileInfo(QString::fromLocal8Bit(Input.GetPath(Frame).c_str())).size();
+            Count++;
+            }
+
+         if (Count < 1) {break;}
+
+         Job.Batch = Batch;
+         Pool->Run(Job, Count);
+
+         for (uiter I = 0; I < Count; I++) {Stats.BytesRaw += Batch[I]->Record.GetRawSize();}
+
+         Submit(Batch, Count);
+
+         Stats.Frames += Count;
+         Fill ^= 1;
+
+         int Elapsed = Clock.elapsed();
+         if (Elapsed - LastReport >= Transcoder::ReportInterval)
+            {
+            LastReport = Elapsed;
+            Stats.Seconds = (double)Elapsed / 1000.0;
+            Mutex.lock();
+            Stats.BytesWritten = Written;
+            Mutex.unlock();
+
+            Print(Report, Stats, false);
+            }
+         }
+
+      Flush();
+
+      Stats.BytesWritten = Output.GetBytes();
+      Stop();
+      }
+
+   catch (...)
+      {
+      Stop();
+      throw;
+      }
+
+   Stats.Seconds = (double)Clock.elapsed() / 1000.0;
+
+   debug("Transcoded %llu frames in %.1f s, %llu skipped.\n",
+      (unsigned long long)Stats.Frames, Stats.Seconds, (unsigned long long)Stats.Failed);
+
+   if (Report != nullptr && LastReport > 0) {fprintf(Report, "\n");}
+   Print(Report, Stats, true);
+
+   return Stats;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
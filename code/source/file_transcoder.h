@@ -0,0 +1,138 @@
+/*===========================================================================
+   Capture Session Transcoder
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_TRANSCODER_H___
+#define ___FILE_TRANSCODER_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "file_archive.h"
+#include "file_sequence.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+  Converts a directory of numbered TGA or PNG frames into a single frame
+  archive. The work is split into three stages, each with its own threads,
+  so they overlap:
+
+  - Decoding : The Sequence reader loads the upcoming frames.
+  - Encoding : A ThreadPool compresses a batch of frames concurrently.
+  - Writing  : A background thread appends the previous batch to the
+               archive, in frame order.
+
+  Batches are double buffered, so one batch is written while the next one
+  is being collected and encoded. Frames that fail to decode are skipped
+  and counted, the rest of the session is still archived.
+  ---------------------------------------------------------------------------*/
+class Transcoder
+   {
+   //---- Constants and definitions ----
+   public:
+
+   struct Metrics                                  //Transcoding statistics
+      {
+      uint64 Frames;                               //Number of frames archived
+      uint64 Failed;                               //Number of frames that could not be decoded
+      uint64 BytesRead;                            //Size of the source files
+      uint64 BytesRaw;                             //Uncompressed size of the frames
+      uint64 BytesWritten;                         //Size of the archive
+      double Seconds;                              //Elapsed time
+      };
+
+   static const usize BatchPerThread = 2;          //Frames per encoder thread in a batch
+   static const int ReportInterval = 1000;         //Progress report interval, in ms
+
+   private:
+
+   class Item                                      //Frame storage in a batch
+      {
+      public:
+      Texture Image;                               //Decoded frame
+      Archive::Frame Record;                       //Encoded frame
+      };
+
+   class EncodeJob : public ThreadPool::Job        //Encodes the frames of a batch
+      {
+      public:
+      Item** Batch;                                //First frame of the batch
+      int Level;                                   //Compression level
+      void Run(uiter Task);
+      };
+
+   class Worker : public QThread                   //Archive write thread, no signals or slots
+      {
+      private:
+      Transcoder* Owner;
+      public:
+      Worker(Transcoder* Owner) : Owner(Owner) {}
+      void run(void) {Owner->Work();}
+      };
+
+   //---- Member data ----
+   private:
+
+   Sequence Input;                                 //Source frames
+   Archive Output;                                 //Target archive
+   ThreadPool* Pool;                               //Encoder threads
+   Worker* Thread;                                 //Archive write thread
+   Array<Item*, 16> Items;                         //Two batches of frames
+   usize BatchSize;                                //Number of frames in a batch
+   Item** Pending;                                 //Batch waiting to be written, or nullptr
+   usize PendingCount;                             //Number of frames in the pending batch
+   QMutex Mutex;                                   //Guards the pending batch, Written and Error
+   QWaitCondition WorkWait;                        //Signals the write thread when a batch is pending
+   QWaitCondition DoneWait;                        //Signals the caller when a batch is written
+   uint64 Written;                                 //Bytes appended by the write thread
+   std::string Error;                              //Error message of a failed write
+   bool Exit;                                      //Signals the write thread to exit
+
+   //---- Methods ----
+   public:
+
+   Transcoder(void);
+   ~Transcoder(void);
+
+   private:
+
+   Transcoder(const Transcoder &obj);              //Disable
+   Transcoder &operator = (const Transcoder &obj); //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Pipeline
+   void Start(const std::string &Source, const std::string &Target, usize Threads);
+   void Stop(void);
+   void Submit(Item** Batch, usize Count);
+   void Flush(void);
+   void Work(void);
+   static void Print(FILE* Report, const Metrics &Stats, bool Final);
+
+   public:
+
+   Metrics Run(const std::string &Source, const std::string &Target, int Level = Archive::DefaultLevel, usize Threads = 0, FILE* Report = nullptr);
+   };
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,609 @@
+/*===========================================================================
+   Asynchronous File Writer
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_WRITER_CPP___
+#define ___FILE_WRITER_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "file_writer.h"
+#include "math.h"
+
+#if defined (URING)
+   #include <cerrno>
+   #include <fcntl.h>
+   #include <linux/io_uring.h>
+   #include <sys/mman.h>
+   #include <sys/syscall.h>
+   #include <unistd.h>
+#endif
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+   io_uring submission and completion queues, mapped from the kernel. The
+   liburing helper library is not used, the ring is driven through the raw
+   system calls instead.
+  ---------------------------------------------------------------------------*/
+#if defined (URING)
+struct Writer::Ring
+   {
+   int Handle;                                     //Ring file descriptor
+   void* SQ;                                       //Submission queue mapping
+   usize SQSize;                                   //Submission queue mapping size
+   void* CQ;                                       //Completion queue mapping
+   usize CQSize;                                   //Completion queue mapping size
+   io_uring_sqe* SQEs;                             //Submission queue entries
+   usize SQEsSize;                                 //Submission queue entries mapping size
+   unsigned* SQHead;
+   unsigned* SQTail;
+   unsigned* SQMask;
+   unsigned* SQArray;
+   unsigned* CQHead;
+   unsigned* CQTail;
+   unsigned* CQMask;
+   io_uring_cqe* CQEs;
+   };
+#else
+struct Writer::Ring {};
+#endif
+
+
+/*---------------------------------------------------------------------------
+   Appends data to the end of the block. The storage is grown
+   geometrically, so repeated small writes remain cheap.
+  ---------------------------------------------------------------------------*/
+void Writer::Block::Write(const void* Ptr, usize Size)
+   {
+   if (Size < 1) {return;}
+
+   if (Used + Size > Data.Size())
+      {
+      Data.Create(Math::Max(Used + Size, Data.Size() * 2) - Data.Size());
+      }
+
+   memcpy(Data.Pointer() + Used, Ptr, Size);
+   Used += Size;
+   }
+
+/*---------------------------------------------------------------------------
+   Constructor. Starts the background thread.
+
+   PreferURing : Use the io_uring backend, if it was compiled in and the
+                 kernel supports it. Otherwise the thread backend is used.
+  ---------------------------------------------------------------------------*/
+Writer::Writer(bool PreferURing)
+   {
+   Clear();
+
+   if (PreferURing && SetupURing()) {Backend = Writer::BackendURing;}
+
+   debug("File writer is using the %s backend.\n", Backend == Writer::BackendURing ? "io_uring" : "thread");
+
+   Thread = new Worker(this);
+   Thread->start();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Writer::~Writer(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Writer::Clear(void)
+   {
+   Backend = Writer::BackendThread;
+   Thread = nullptr;
+   URing = nullptr;
+   memset(&Stats, 0, sizeof(Stats));
+   Error.clear();
+   Exit = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure. Waits for all pending writes to complete.
+  ---------------------------------------------------------------------------*/
+void Writer::Destroy(void)
+   {
+   if (Thread != nullptr)
+      {
+      Mutex.lock();
+
+      while (!Exit && Stats.Depth > 0) {DoneWait.wait(&Mutex);}
+
+      Exit = true;
+      QueueWait.wakeAll();
+
+      //Wake up the completion thread with an empty request
+      if (URing != nullptr)
+         {
+         try {SubmitURing(nullptr);}
+         catch (...) {Thread->terminate();}
+         }
+
+      Mutex.unlock();
+
+      Thread->wait();
+      delete Thread;
+      }
+
+   DestroyURing();
+
+   for (uiter I = 0; I < Blocks.Size(); I++) {delete Blocks[I];}
+
+   Blocks.Destroy();
+   Free.Destroy();
+   Queue.Destroy();
+   Ahead.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Sets up the io_uring instance. Returns false if the backend was not
+   compiled in, or if the kernel does not support asynchronous writes.
+  ---------------------------------------------------------------------------*/
+bool Writer::SetupURing(void)
+   {
+   #if defined (URING)
+      io_uring_params Params;
+      memset(&Params, 0, sizeof(Params));
+
+      int Handle = (int)syscall(__NR_io_uring_setup, (unsigned)Writer::MaxQueue, &Params);
+      if (Handle < 0) {debug("io_uring_setup( ) failed, errno %d.\n", errno); return false;}
+
+      URing = new Ring;
+      memset(URing, 0, sizeof(Ring));
+      URing->Handle = Handle;
+
+      //IORING_OP_WRITE is only available on kernel 5.6 and newer
+      Array<uint8, 1> Probe;
+      Probe.Create(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+      memset(Probe.Pointer(), 0, Probe.Size());
+      io_uring_probe* Ops = reinterpret_cast<io_uring_probe*>(Probe.Pointer());
+
+      if (syscall(__NR_io_uring_register, Handle, IORING_REGISTER_PROBE, Ops, 256) < 0 ||
+          Ops->last_op < IORING_OP_WRITE || !(Ops->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED))
+         {
+         debug("io_uring does not support IORING_OP_WRITE.\n");
+         DestroyURing();
+         return false;
+         }
+
+      URing->SQSize = Params.sq_off.array + Params.sq_entries * sizeof(unsigned);
+      URing->CQSize = Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe);
+      URing->SQEsSize = Params.sq_entries * sizeof(io_uring_sqe);
+
+      URing->SQ = mmap(nullptr, URing->SQSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Handle, IORING_OFF_SQ_RING);
+      URing->CQ = mmap(nullptr, URing->CQSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Handle, IORING_OFF_CQ_RING);
+      void* SQEs = mmap(nullptr, URing->SQEsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Handle, IORING_OFF_SQES);
+
+      if (URing->SQ == MAP_FAILED) {URing->SQ = nullptr;}
+      if (URing->CQ == MAP_FAILED) {URing->CQ = nullptr;}
+      URing->SQEs = SQEs == MAP_FAILED ? nullptr : static_cast<io_uring_sqe*>(SQEs);
+
+      if (URing->SQ == nullptr || URing->CQ == nullptr || URing->SQEs == nullptr)
+         {
+         debug("Failed to map the io_uring queues.\n");
+         DestroyURing();
+         return false;
+         }
+
+      uint8* SQ = static_cast<uint8*>(URing->SQ);
+      URing->SQHead = reinterpret_cast<unsigned*>(SQ + Params.sq_off.head);
+      URing->SQTail = reinterpret_cast<unsigned*>(SQ + Params.sq_off.tail);
+      URing->SQMask = reinterpret_cast<unsigned*>(SQ + Params.sq_off.ring_mask);
+      URing->SQArray = reinterpret_cast<unsigned*>(SQ + Params.sq_off.array);
+
+      uint8* CQ = static_cast<uint8*>(URing->CQ);
+      URing->CQHead = reinterpret_cast<unsigned*>(CQ + Params.cq_off.head);
+      URing->CQTail = reinterpret_cast<unsigned*>(CQ + Params.cq_off.tail);
+      URing->CQMask = reinterpret_cast<unsigned*>(CQ + Params.cq_off.ring_mask);
+      URing->CQEs = reinterpret_cast<io_uring_cqe*>(CQ + Params.cq_off.cqes);
+
+      return true;
+   #else
+      return false;
+   #endif
+   }
+
+/*---------------------------------------------------------------------------
+   Unmaps the io_uring queues and closes the ring.
+  ---------------------------------------------------------------------------*/
+void Writer::DestroyURing(void)
+   {
+   if (URing == nullptr) {return;}
+
+   #if defined (URING)
+      if (URing->SQEs != nullptr) {munmap(URing->SQEs, URing->SQEsSize);}
+      if (URing->CQ != nullptr) {munmap(URing->CQ, URing->CQSize);}
+      if (URing->SQ != nullptr) {munmap(URing->SQ, URing->SQSize);}
+      close(URing->Handle);
+   #endif
+
+   delete URing;
+   URing = nullptr;
+   }
+
+/*---------------------------------------------------------------------------
+   Queues a write request for the remaining data in the block, and submits
+   it to the kernel. A nullptr block submits an empty request, which is used
+   for waking up the completion thread. Must be called with the Mutex
+   locked. The queue depth is limited to MaxQueue, so the submission queue
+   can never overflow.
+  ---------------------------------------------------------------------------*/
+void Writer::SubmitURing(Block* Item)
+   {
+   #if defined (URING)
+      unsigned Tail = *URing->SQTail;
+      unsigned Index = Tail & *URing->SQMask;
+
+      io_uring_sqe* SQE = &URing->SQEs[Index];
+      memset(SQE, 0, sizeof(io_uring_sqe));
+
+      if (Item != nullptr)
+         {
+         SQE->opcode = IORING_OP_WRITE;
+         SQE->fd = Item->Handle;
+         SQE->addr = (uint64)(size_t)(Item->Data.Pointer() + Item->Done);
+         SQE->len = (uint32)(Item->Used - Item->Done);
+         SQE->off = (uint64)Item->Done;
+         }
+      else
+         {
+         SQE->opcode = IORING_OP_NOP;
+         }
+
+      SQE->user_data = (uint64)(size_t)Item;
+      URing->SQArray[Index] = Index;
+
+      //Publish the entry before the tail is advanced
+      __sync_synchronize();
+      *URing->SQTail = Tail + 1;
+      __sync_synchronize();
+
+      int Result;
+      do {Result = (int)syscall(__NR_io_uring_enter, URing->Handle, 1, 0, 0, nullptr, 0);}
+      while (Result < 0 && errno == EINTR);
+
+      if (Result < 0) {throw dexception("io_uring_enter( ) failed, errno %d.", errno);}
+   #else
+      (void)Item;
+      throw dexception("io_uring backend is not available.");
+   #endif
+   }
+
+/*---------------------------------------------------------------------------
+   Writes a block to file with blocking I/O.
+  ---------------------------------------------------------------------------*/
+void Writer::WriteFile(Block* Item)
+   {
+   FILE* File;
+
+   #if defined (WINDOWS)
+      if (fopen_s(&File, Item->Path.c_str(), "wb") != 0)
+         {throw dexception("Failed to open file: %s.", Item->Path.c_str());}
+   #else
+      File = fopen(Item->Path.c_str(), "wb");
+      if (File == nullptr) {throw dexception("Failed to open file: %s.", Item->Path.c_str());}
+   #endif
+
+   usize Size = fwrite(Item->Data.Pointer(), 1, Item->Used, File);
+
+   if (fclose(File) != 0 || Size != Item->Used)
+      {throw dexception("Failed to write file: %s.", Item->Path.c_str());}
+
+   Item->Done = Size;
+   }
+
+/*---------------------------------------------------------------------------
+   Retires a block, updates the statistics and returns the block to the
+   free list. Successful writes advance Stats.Retired once every block
+   submitted before them has also been written. Must be called with the 
+   Mutex locked.
+
+   Message : Error message, or empty if the write succeeded. Only the first
+             error is retained.
+  ---------------------------------------------------------------------------*/
+void Writer::Complete(Block* Item, const std::string &Message)
+   {
+   if (!Message.empty() && Error.empty()) {Error = Message;}
+
+   Stats.Completed++;
+   Stats.Depth--;
+   Stats.BytesInFlight -= Item->Used;
+   Stats.BytesWritten += Item->Done;
+
+   if (Message.empty())
+      {
+      if (Item->Sequence != Stats.Retired) {Ahead += Item->Sequence;}
+      else
+         {
+         Stats.Retired++;
+
+         //Blocks that were written ahead are retired as the gap closes
+         bool Found = true;
+         while (Found)
+            {
+            Found = false;
+            for (uiter I = 0; I < Ahead.Size() && !Found; I++)
+               {
+               if (Ahead[I] == Stats.Retired) {Ahead.Remove(I); Stats.Retired++; Found = true;}
+               }
+            }
+         }
+      }
+
+   Item->Reset();
+   Item->Path.clear();
+   Item->Handle = -1;
+   Free += Item;
+
+   DoneWait.wakeAll();
+   }
+
+/*---------------------------------------------------------------------------
+   Background thread entry point.
+  ---------------------------------------------------------------------------*/
+void Writer::Work(void)
+   {
+   if (URing != nullptr) {WorkURing();}
+   else {WorkThread();}
+   }
+
+/*---------------------------------------------------------------------------
+   Thread backend. Writes the queued blocks in submission order, until the
+   writer is destroyed and the queue is empty.
+  ---------------------------------------------------------------------------*/
+void Writer::WorkThread(void)
+   {
+   Mutex.lock();
+
+   while (true)
+      {
+      while (!Exit && Queue.Size() < 1) {QueueWait.wait(&Mutex);}
+
+      if (Queue.Size() < 1) {break;}
+
+      Block* Item = Queue[0];
+      Queue.Remove(0);
+
+      Mutex.unlock();
+
+      std::string Message;
+      try {WriteFile(Item);}
+      catch (std::exception &e) {Message = e.what();}
+
+      Mutex.lock();
+
+      Complete(Item, Message);
+      }
+
+   Mutex.unlock();
+   }
+
+/*---------------------------------------------------------------------------
+   io_uring backend. Waits for completions, resubmits short writes, and
+   retires finished blocks. Exits when the empty request from Destroy( )
+   is completed.
+  ---------------------------------------------------------------------------*/
+void Writer::WorkURing(void)
+   {
+   #if defined (URING)
+      bool Quit = false;
+
+      while (!Quit)
+         {
+         int Result = (int)syscall(__NR_io_uring_enter, URing->Handle, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+         if (Result < 0 && errno != EINTR)
+            {
+            QMutexLocker Locker(&Mutex);
+            if (Error.empty()) {Error = dexception("io_uring_enter( ) failed, errno %d.", errno).what();}
+            Exit = true;
+            DoneWait.wakeAll();
+            break;
+            }
+
+         QMutexLocker Locker(&Mutex);
+
+         unsigned Head = *URing->CQHead;
+
+         while (true)
+            {
+            unsigned Tail = *URing->CQTail;
+            __sync_synchronize();
+
+            if (Head == Tail) {break;}
+
+            io_uring_cqe* CQE = &URing->CQEs[Head & *URing->CQMask];
+            Block* Item = reinterpret_cast<Block*>((size_t)CQE->user_data);
+            int Res = CQE->res;
+            Head++;
+
+            if (Item == nullptr) {Quit = true; continue;}
+
+            std::string Message;
+
+            if (Res > 0) {Item->Done += (usize)Res;}
+
+            if (Res > 0 && Item->Done < Item->Used)
+               {
+               try {SubmitURing(Item); continue;}
+               catch (std::exception &e) {Message = e.what();}
+               }
+            else if (Res < 0 || Item->Done < Item->Used)
+               {
+               Message = dexception("Failed to write file: %s.", Item->Path.c_str()).what();
+               }
+
+            close(Item->Handle);
+            Complete(Item, Message);
+            }
+
+         __sync_synchronize();
+         *URing->CQHead = Head;
+         }
+   #endif
+   }
+
+/*---------------------------------------------------------------------------
+   Returns an empty block for the encoder to fill. Blocks while the number
+   of blocks or bytes in flight exceeds the limits, which throttles the
+   encoder when the disk can't keep up. Throws the first write error, if
+   any occurred.
+  ---------------------------------------------------------------------------*/
+Writer::Block* Writer::Acquire(void)
+   {
+   QMutexLocker Locker(&Mutex);
+
+   if (!Exit && (Stats.Depth >= Writer::MaxQueue || Stats.BytesInFlight >= Writer::MaxBytes)) {Stats.Throttled++;}
+
+   while (!Exit && (Stats.Depth >= Writer::MaxQueue || Stats.BytesInFlight >= Writer::MaxBytes))
+      {
+      DoneWait.wait(&Mutex);
+      }
+
+   if (!Error.empty()) {throw dexception("%s", Error.c_str());}
+   if (Exit) {throw dexception("File writer is not running.");}
+
+   if (Free.Size() > 0)
+      {
+      Block* Item = Free[Free.Size() - 1];
+      Free.Remove(Free.Size() - 1);
+      return Item;
+      }
+
+   Block* Item = new Block;
+   Blocks += Item;
+   return Item;
+   }
+
+/*---------------------------------------------------------------------------
+   Returns a block obtained from Acquire( ) to the free list, without
+   writing it. Used when encoding fails before the block is submitted.
+  ---------------------------------------------------------------------------*/
+void Writer::Release(Block* Item)
+   {
+   if (Item == nullptr) {return;}
+
+   QMutexLocker Locker(&Mutex);
+
+   Item->Reset();
+   Free += Item;
+   }
+
+/*---------------------------------------------------------------------------
+   Submits a block for writing, and returns without waiting for the write to
+   complete. The block must have been obtained from Acquire( ), and may not
+   be accessed after this call.
+
+   Item : Block to write.
+   Path : Target file path. Existing files are overwritten.
+
+   Returns the sequence number of the block. The block is on disk once
+   Metrics::Retired is greater than this number.
+  ---------------------------------------------------------------------------*/
+uint64 Writer::Submit(Block* Item, const std::string &Path)
+   {
+   if (Item == nullptr) {throw dexception("Invalid parameters.");}
+
+   Item->Path = Path;
+   Item->Done = 0;
+
+   //Opening the file may block, so it's done before the queue is locked
+   #if defined (URING)
+      if (URing != nullptr) {Item->Handle = open(Path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);}
+   #endif
+
+   QMutexLocker Locker(&Mutex);
+
+   uint64 Sequence = Stats.Submitted;
+   Item->Sequence = Sequence;
+
+   Stats.Submitted++;
+   Stats.Depth++;
+   Stats.BytesInFlight += Item->Used;
+   Stats.MaxDepth = Math::Max(Stats.MaxDepth, Stats.Depth);
+   Stats.MaxBytesInFlight = Math::Max(Stats.MaxBytesInFlight, Stats.BytesInFlight);
+
+   #if defined (URING)
+      if (URing != nullptr)
+         {
+         if (Item->Handle < 0)
+            {
+            Complete(Item, dexception("Failed to open file: %s.", Path.c_str()).what());
+            return Sequence;
+            }
+
+         //Empty files are completed right away
+         if (Item->Used < 1)
+            {
+            close(Item->Handle);
+            Complete(Item, "");
+            return Sequence;
+            }
+
+         try {SubmitURing(Item);}
+         catch (std::exception &e)
+            {
+            close(Item->Handle);
+            Complete(Item, e.what());
+            }
+
+         return Sequence;
+         }
+   #endif
+
+   Queue += Item;
+   QueueWait.wakeAll();
+
+   return Sequence;
+   }
+
+/*---------------------------------------------------------------------------
+   Blocks until all submitted writes are completed. Throws the first write
+   error, if any occurred.
+  ---------------------------------------------------------------------------*/
+void Writer::Flush(void)
+   {
+   QMutexLocker Locker(&Mutex);
+
+   while (!Exit && Stats.Depth > 0) {DoneWait.wait(&Mutex);}
+
+   if (!Error.empty()) {throw dexception("%s", Error.c_str());}
+   }
+
+/*---------------------------------------------------------------------------
+   Returns a snapshot of the write statistics.
+  ---------------------------------------------------------------------------*/
+Writer::Metrics Writer::GetMetrics(void)
+   {
+   QMutexLocker Locker(&Mutex);
+   return Stats;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
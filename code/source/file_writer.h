@@ -0,0 +1,157 @@
+/*===========================================================================
+   Asynchronous File Writer
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_WRITER_H___
+#define ___FILE_WRITER_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+  Write-behind file output. Encoders fill a Block in memory, then submit it
+  together with the target path, and carry on with the next frame while the
+  file is written in the background. On Linux builds with URING defined,
+  the writes are issued through io_uring, otherwise a background thread
+  performs ordinary blocking writes.
+
+  Submit( ) numbers the blocks in submission order. Writes may complete out
+  of order, so Metrics::Retired tracks how many of the leading blocks have
+  all been written successfully, which lets the caller commit its own 
+  records in order once the data is on disk.
+  ---------------------------------------------------------------------------*/
+class Writer
+   {
+   //---- Constants and definitions ----
+   public:
+
+   enum BackendType                                //Write backend enumeration
+      {
+      BackendThread = 0,                           //Blocking writes on a background thread
+      BackendURing = 1                             //Asynchronous writes through io_uring
+      };
+
+   class Block                                     //In-memory file contents
+      {
+      friend class Writer;
+
+      private:
+      Array<uint8, 4096> Data;                     //Data storage, grows but never shrinks
+      usize Used;                                  //Number of bytes used in Data
+      usize Done;                                  //Number of bytes written to file
+      std::string Path;                            //Target file path
+      int Handle;                                  //File descriptor, io_uring backend only
+      uint64 Sequence;                             //Submission sequence number
+
+      public:
+      Block(void) : Used(0), Done(0), Handle(-1), Sequence(0) {}
+      void Write(const void* Ptr, usize Size);
+      inline void Reset(void) {Used = 0; Done = 0;}
+      inline const uint8* Pointer(void) const {return Data.Pointer();}
+      inline usize Size(void) const {return Used;}
+      };
+
+   struct Metrics                                  //Write statistics
+      {
+      uint64 Submitted;                            //Number of blocks submitted
+      uint64 Completed;                            //Number of blocks written, or failed
+      uint64 Throttled;                            //Number of times Acquire( ) had to wait for a free slot
+      uint64 BytesWritten;                         //Total bytes written
+      uint64 Retired;                              //Number of leading blocks that were all written successfully
+      usize Depth;                                 //Current queue depth
+      usize MaxDepth;                              //Highest queue depth reached
+      usize BytesInFlight;                         //Bytes submitted, but not yet written
+      usize MaxBytesInFlight;                      //Highest number of bytes in flight
+      };
+
+   static const usize MaxQueue = 16;               //Maximum number of blocks in flight
+   static const usize MaxBytes = 256 << 20;        //Maximum number of bytes in flight
+
+   private:
+
+   class Worker : public QThread                   //Write or completion thread, no signals or slots
+      {
+      private:
+      Writer* Owner;
+      public:
+      Worker(Writer* Owner) : Owner(Owner) {}
+      void run(void) {Owner->Work();}
+      };
+
+   struct Ring;                                    //io_uring state, see file_writer.cpp
+
+   //---- Member data ----
+   private:
+
+   BackendType Backend;                            //Active backend
+   Worker* Thread;                                 //Background thread
+   Ring* URing;                                    //io_uring state, or nullptr for the thread backend
+   QMutex Mutex;                                   //Guards the queue and metrics
+   QWaitCondition QueueWait;                       //Signals the write thread when blocks are queued
+   QWaitCondition DoneWait;                        //Signals submitters when blocks are completed
+   Array<Block*, 16> Blocks;                       //All allocated blocks
+   Array<Block*, 16> Free;                         //Blocks available for Acquire( )
+   Array<Block*, 16> Queue;                        //Blocks waiting for the write thread
+   Array<uint64, 16> Ahead;                        //Sequence numbers of blocks written ahead of Stats.Retired
+   Metrics Stats;                                  //Write statistics
+   std::string Error;                              //Error message of the first failed write
+   bool Exit;                                      //Signals the background thread to exit
+
+   //---- Methods ----
+   public:
+
+   Writer(bool PreferURing = true);
+   ~Writer(void);
+
+   private:
+
+   Writer(const Writer &obj);                      //Disable
+   Writer &operator = (const Writer &obj);         //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Background processing
+   void Work(void);
+   void WorkThread(void);
+   void WorkURing(void);
+   void WriteFile(Block* Item);
+   void Complete(Block* Item, const std::string &Message);
+
+   //io_uring backend
+   bool SetupURing(void);
+   void DestroyURing(void);
+   void SubmitURing(Block* Item);
+
+   public:
+
+   Block* Acquire(void);
+   void Release(Block* Item);
+   uint64 Submit(Block* Item, const std::string &Path);
+   void Flush(void);
+
+   Metrics GetMetrics(void);
+   inline BackendType GetBackend(void) const {return Backend;}
+   };
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
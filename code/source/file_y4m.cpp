@@ -0,0 +1,286 @@
+/*===========================================================================
+   YUV4MPEG2 Stream Output
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_Y4M_CPP___
+#define ___FILE_Y4M_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "file_y4m.h"
+#include "math.h"
+
+#include <sys/stat.h>
+
+#if defined (WINDOWS)
+   #include <fcntl.h>
+   #include <io.h>
+#endif
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+   Static data.
+  ---------------------------------------------------------------------------*/
+const char* Y4M::PathStdOut = "-";
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+Y4M::Y4M(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Y4M::~Y4M(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Y4M::Clear(void)
+   {
+   File = nullptr;
+   StdOut = false;
+   Res = 0;
+   Count = 0;
+   Stalls = 0;
+   StallTime = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Y4M::Destroy(void)
+   {
+   Close();
+
+   Frame.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Returns true if the path refers to a named pipe.
+  ---------------------------------------------------------------------------*/
+bool Y4M::IsPipe(const std::string &Path)
+   {
+   #if defined (WINDOWS)
+      return Path.compare(0, 9, "\\\\.\\pipe\\") == 0;
+   #else
+      struct stat Info;
+      if (stat(Path.c_str(), &Info) != 0) {return false;}
+      return S_ISFIFO(Info.st_mode);
+   #endif
+   }
+
+/*---------------------------------------------------------------------------
+   Opens a stream and writes the stream header. Note that opening a named
+   pipe will block until the reader opens the other end.
+
+   Path : Path to a file or named pipe. Use PathStdOut for the standard
+          output.
+   Res  : Frame resolution in pixels.
+   Rate : Frame rate in frames per second.
+  ---------------------------------------------------------------------------*/
+void Y4M::Open(const std::string &Path, const vector2u &Res, uint Rate)
+   {
+   Close();
+
+   if (Res.U < 1 || Res.V < 1 || Rate < 1) {throw dexception("Invalid parameters.");}
+
+   StdOut = Path == Y4M::PathStdOut;
+
+   if (StdOut)
+      {
+      #if defined (WINDOWS)
+         _setmode(_fileno(stdout), _O_BINARY);
+      #endif
+
+      File = stdout;
+      }
+   else
+      {
+      #if defined (WINDOWS)
+         if (fopen_s(&File, Path.c_str(), "wb") != 0)
+            {File = nullptr; throw dexception("Failed to open file: %s.", Path.c_str());}
+      #else
+         File = fopen(Path.c_str(), "wb");
+         if (File == nullptr) {throw dexception("Failed to open file: %s.", Path.c_str());}
+      #endif
+      }
+
+   Y4M::Res = Res;
+
+   vector2u ResUV((Res.U + 1) >> 1, (Res.V + 1) >> 1);
+   //The frame header is kept in front of the planes, so each frame is a single write
+   Frame.Destroy();
+   Frame.Create(Y4M::HeaderSize + Res.U * Res.V + 2 * ResUV.U * ResUV.V);
+   memcpy(Frame.Pointer(), "FRAME\n", Y4M::HeaderSize);
+
+   Count = 0;
+   Stalls = 0;
+   StallTime = 0;
+
+   if (fprintf(File, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", (uint)Res.U, (uint)Res.V, Rate) < 0)
+      {throw dexception("Failed to write stream header.");}
+   }
+
+/*---------------------------------------------------------------------------
+   Flushes and closes the stream, and releases the frame buffer.
+  ---------------------------------------------------------------------------*/
+void Y4M::Close(void)
+   {
+   if (File == nullptr) {return;}
+
+   fflush(File);
+
+   if (!StdOut) {fclose(File);}
+
+   File = nullptr;
+   StdOut = false;
+   Frame.Destroy();
+
+   debug("Closed Y4M stream, %llu frames written, %llu stalls (%llu ms).\n", (unsigned long long)Count, (unsigned long long)Stalls, (unsigned long long)StallTime);
+   }
+
+/*---------------------------------------------------------------------------
+   Converts a band of scanlines to I420, using BT.601 coefficients in 8-bit
+   fixed point. Each band consists of an equal number of chroma rows, and
+   the inner loops are kept free of branches so they can be vectorised.
+  ---------------------------------------------------------------------------*/
+void Y4M::Convert::Run(uiter Task)
+   {
+   const usize BPP = Image->GetBytesPerPixel();
+   const usize OffG = BPP > 1 ? 1 : 0;
+   const usize OffB = BPP > 1 ? 2 : 0;
+
+   const uiter Start = (ResUV.V * Task) / Bands;
+   const uiter End = (ResUV.V * (Task + 1)) / Bands;
+
+   for (uiter V = Start; V < End; V++)
+      {
+      const uiter Y0 = V << 1;
+      const uiter Y1 = Math::Min(Y0 + 1, (uiter)Res.V - 1);
+
+      const uint8* Src0 = Image->Address(0, Flip ? Res.V - 1 - Y0 : Y0);
+      const uint8* Src1 = Image->Address(0, Flip ? Res.V - 1 - Y1 : Y1);
+
+      uint8* DstY0 = Planes[0] + Y0 * Res.U;
+      uint8* DstY1 = Planes[0] + Y1 * Res.U;
+      uint8* DstU = Planes[1] + V * ResUV.U;
+      uint8* DstV = Planes[2] + V * ResUV.U;
+
+      //Luma
+      for (uiter U = 0; U < Res.U; U++)
+         {
+         const uint8* P = Src0 + U * BPP;
+         DstY0[U] = (uint8)(((66 * P[0] + 129 * P[OffG] + 25 * P[OffB] + 128) >> 8) + 16);
+         }
+
+      if (Y1 != Y0)
+         {
+         for (uiter U = 0; U < Res.U; U++)
+            {
+            const uint8* P = Src1 + U * BPP;
+            DstY1[U] = (uint8)(((66 * P[0] + 129 * P[OffG] + 25 * P[OffB] + 128) >> 8) + 16);
+            }
+         }
+
+      //Chroma, averaged over 2x2 pixels
+      for (uiter U = 0; U < ResUV.U; U++)
+         {
+         const uiter X0 = (U << 1) * BPP;
+         const uiter X1 = Math::Min((U << 1) + 1, (uiter)Res.U - 1) * BPP;
+
+         const int R = (Src0[X0] + Src0[X1] + Src1[X0] + Src1[X1] + 2) >> 2;
+         const int G = (Src0[X0 + OffG] + Src0[X1 + OffG] + Src1[X0 + OffG] + Src1[X1 + OffG] + 2) >> 2;
+         const int B = (Src0[X0 + OffB] + Src0[X1 + OffB] + Src1[X0 + OffB] + Src1[X1 + OffB] + 2) >> 2;
+
+         DstU[U] = (uint8)(((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128);
+         DstV[U] = (uint8)(((112 * R - 94 * G - 18 * B + 128) >> 8) + 128);
+         }
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Converts and writes a frame to the stream. Writes that block for longer
+   than TimeStall are reported as pipe stalls.
+
+   Image : Frame to write, must be RGB, RGBA or luminance, and match the
+           stream resolution.
+   Flip  : Flip the image vertically. Frames read back from OpenGL have the
+           origin at the bottom left, so this is set by default.
+  ---------------------------------------------------------------------------*/
+void Y4M::Write(const Texture &Image, bool Flip)
+   {
+   if (File == nullptr) {throw dexception("Stream is not open.");}
+
+   switch (Image.DataType())
+      {
+      case Texture::TypeLum :
+      case Texture::TypeRGB :
+      case Texture::TypeRGBA : break;
+      default : throw dexception("Unsupported image type.");
+      }
+
+   vector2u ImageRes = Image.Resolution();
+   if (ImageRes.U != Res.U || ImageRes.V != Res.V) {throw dexception("Frame resolution does not match the stream.");}
+
+   //Colour conversion
+   ThreadPool &Pool = ThreadPool::Shared();
+
+   Convert Conversion;
+   Conversion.Image = &Image;
+   Conversion.Res = Res;
+   Conversion.ResUV.Set((Res.U + 1) >> 1, (Res.V + 1) >> 1);
+   Conversion.Planes[0] = Frame.Pointer() + Y4M::HeaderSize;
+   Conversion.Planes[1] = Conversion.Planes[0] + Res.U * Res.V;
+   Conversion.Planes[2] = Conversion.Planes[1] + Conversion.ResUV.U * Conversion.ResUV.V;
+   Conversion.Bands = Math::Min(Pool.Threads() * Y4M::BandsPerThread, (usize)Conversion.ResUV.V);
+   Conversion.Flip = Flip;
+
+   Pool.Run(Conversion, Conversion.Bands);
+
+   //Stream out
+   QTime Timer;
+   Timer.start();
+
+   if (fwrite(Frame.Pointer(), 1, Frame.Size(), File) != Frame.Size())
+      {throw dexception("Failed to write to the Y4M stream, the reader may have closed the pipe.");}
+
+   int Elapsed = Timer.elapsed();
+   if (Elapsed >= (int)Y4M::TimeStall)
+      {
+      Stalls++;
+      StallTime += (uint64)Elapsed;
+      debug("Y4M stream stalled for %d ms on frame %llu.\n", Elapsed, (unsigned long long)Count);
+      }
+
+   Count++;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
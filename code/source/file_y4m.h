@@ -0,0 +1,103 @@
+/*===========================================================================
+   YUV4MPEG2 Stream Output
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILE_Y4M_H___
+#define ___FILE_Y4M_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+NAMESPACE_BEGIN(File)
+
+
+/*---------------------------------------------------------------------------
+  YUV4MPEG2 stream writer. Frames are converted to I420 (8-bit planar
+  Y'CbCr, with 2x2 subsampled chroma) and written as a continuous stream,
+  which is suitable for piping into an external encoder.
+  ---------------------------------------------------------------------------*/
+class Y4M
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const char* PathStdOut;                  //Stream path that selects the standard output
+   static const usize HeaderSize = 6;              //Size of the frame header, in bytes
+   static const uint TimeStall = 20;               //Write duration that is reported as a stall, in ms
+   static const uint BandsPerThread = 4;           //Number of conversion bands per worker thread
+
+   private:
+
+   class Convert : public ThreadPool::Job          //RGB to I420 conversion job
+      {
+      public:
+      const Texture* Image;                        //Source image
+      uint8* Planes[3];                            //Destination Y, U and V planes
+      vector2u Res;                                //Luma resolution
+      vector2u ResUV;                              //Chroma resolution
+      usize Bands;                                 //Number of bands the image is split into
+      bool Flip;                                   //Flip image vertically
+      void Run(uiter Task);
+      };
+
+   //---- Member data ----
+   private:
+
+   FILE* File;                                     //Stream handle
+   bool StdOut;                                    //Stream is the standard output
+   vector2u Res;                                   //Frame resolution
+   Array<uint8, 256> Frame;                        //Frame header and I420 frame data
+   uint64 Count;                                   //Number of frames written
+   uint64 Stalls;                                  //Number of writes that exceeded TimeStall
+   uint64 StallTime;                               //Total time spent in stalled writes, in ms
+
+   //---- Methods ----
+   public:
+
+   Y4M(void);
+   ~Y4M(void);
+
+   private:
+
+   Y4M(const Y4M &obj);                            //Disable
+   Y4M &operator = (const Y4M &obj);               //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   public:
+
+   void Open(const std::string &Path, const vector2u &Res, uint Rate = 30);
+   void Close(void);
+   void Write(const Texture &Image, bool Flip = true);
+
+   static bool IsPipe(const std::string &Path);
+
+   inline bool Ready(void) const {return File != nullptr;}
+   inline vector2u Resolution(void) const {return Res;}
+   inline usize GetFrameSize(void) const {return Frame.Size();}
+   inline uint64 GetFrames(void) const {return Count;}
+   inline uint64 GetStalls(void) const {return Stalls;}
+   inline uint64 GetStallTime(void) const {return StallTime;}
+   };
+
+
+//Close namespaces
+NAMESPACE_END(File)
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -26,6 +26,9 @@ NAMESPACE_BEGIN(NAMESPACE_PROJECT)
   ---------------------------------------------------------------------------*/
 Filter::Filter(void)
    {
+   Pool = nullptr;
+   PoolSlot = 0;
+
    Clear();
    }
 
@@ -65,6 +68,10 @@ void Filter::Clear(void)
    EnableDepth = false;
    EnableCal = false;
    EnableColour = false;
+   EnableGL = true;
+   Indexed = false;
+
+   UploadTime = 0;
    }
 
 /*---------------------------------------------------------------------------
@@ -76,11 +83,12 @@ void Filter::Destroy(void)
    Model.Destroy();
    Video.Destroy();
    Depth.Destroy();
+   VideoStream.Destroy();
+   DepthStream.Destroy();
    Program.Destroy();
 
-   if (CBOID > 0) {glDeleteTextures(1, &CBOID);}
-   if (DBOID > 0) {glDeleteRenderbuffers(1, &DBOID);}
-   if (FBOID > 0) {glDeleteFramebuffers(1, &FBOID);}
+   if (Pool != nullptr) {Pool->Release(CBOID);}
+   else {FilterPool::Delete(FBOID, DBOID, CBOID);}
 
    Clear();
    }
@@ -116,29 +124,12 @@ void Filter::Setup(Buffers &Buffer)
 
    if (Res.X < 1 || Res.Y < 1) {return;}
    
-   //Create a new frame buffer object
-   glGenFramebuffers(1, &FBOID);
-   glBindFramebuffer(GL_FRAMEBUFFER, FBOID);
+   //Create a new frame buffer object with depth and colour buffers, 
+   // or take one from the pool
+   if (Pool != nullptr) {Pool->Acquire(Res, PoolSlot, FBOID, DBOID, CBOID);}
+   else {FilterPool::Create(Res, FBOID, DBOID, CBOID);}
 
-   //Create a new depth buffer object, then associate a 
-   // storage space for it, and attach it to the FBO
-   glGenRenderbuffers(1, &DBOID);
-   glBindRenderbuffer(GL_RENDERBUFFER, DBOID);
-   glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, Res.X, Res.Y);
-   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DBOID);
-
-   //Create a colour buffer in form of a texture and attach it to the FBO
-   glGenTextures(1, &CBOID);
-   glBindTexture(GL_TEXTURE_2D, CBOID);
-   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, Res.X, Res.Y, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, CBOID, 0);
-
-   //FBO texture scaling
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-   glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+   glBindFramebuffer(GL_FRAMEBUFFER, FBOID);
 
    //Setup view port size
    ViewPort.Set4(0, 0, Res.X, Res.Y);
@@ -179,15 +170,15 @@ void Filter::Assets(Buffers &Buffer)
 
    Video.Create(Buffer.GetVideoResolution(), Buffer.GetVideoDataType());
    Video.ClearData();
+   Video.SetMipLevels(0); //Drawn at its own size
    Video.Buffer(false);
 
    Model.Plane(1, Mesh::ModeSolid);
    Model.Buffer(false);
 
-   File::Text Text;
    std::string CodeVert, CodeFrag;
-   Text.Load(CodeVert, File::Path::Shader(File::FilterVert));
-   Text.Load(CodeFrag, File::Path::Shader(File::FilterFrag));
+   AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterVert));
+   AssetCache::LoadText(CodeFrag, File::Path::Shader(File::FilterFrag));
    Program.Attach(CodeVert, Shader::ShaderVert);
    Program.Attach(CodeFrag, Shader::ShaderFrag);
    Program.Buffer(false);
@@ -210,16 +201,16 @@ void Filter::Change(Buffers &Buffer)
       {
       case Filter::SelectVideo : 
          Res[0] = Buffer.GetVideoResolution();
-         Res[1] = Video.Resolution();
+         Res[1] = Video.IsShared() ? Resolution() : Video.Resolution();
          Type[0] = Buffer.GetVideoDataType();
-         Type[1] = Video.DataType();
+         Type[1] = Video.IsShared() ? Type[0] : Video.DataType();
          break;
 
       case Filter::SelectDepth : 
          Res[0] = Buffer.GetDepthResolution();
-         Res[1] = Depth.Resolution();
+         Res[1] = Depth.IsShared() ? Resolution() : Depth.Resolution();
          Type[0] = Buffer.GetDepthDataType();
-         Type[1] = Depth.DataType();
+         Type[1] = Depth.IsShared() ? Type[0] : Depth.DataType();
          break;
 
       default : throw dexception("Invalid Select enumeration.");
@@ -234,6 +225,71 @@ void Filter::Change(Buffers &Buffer)
       }
    }
 
+/*---------------------------------------------------------------------------
+   Prepares the filter for being handed over to another OpenGL context that
+   shares objects with the current one. Frame buffer objects are never 
+   shared between contexts, so they are deleted here, while the depth and
+   colour buffers attached to them are kept. The filter is not ready until 
+   Attach( ) is called in the other context. Filters rendering into a pool
+   target only forget their frame buffer object, since it is shared, the 
+   owner of the pool deletes it with FilterPool::Detach( ). NOTE: This must
+   be called within the OpenGL context that set up the filter.
+  ---------------------------------------------------------------------------*/
+void Filter::Detach(void)
+   {
+   if (Pool == nullptr && FBOID > 0) {glDeleteFramebuffers(1, &FBOID);}
+   FBOID = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Completes the hand-over started by Detach( ). Makes a new frame buffer 
+   object in the current OpenGL context, and attaches the depth and colour 
+   buffers of the filter to it. Leaves the frame buffer object bound.
+  ---------------------------------------------------------------------------*/
+void Filter::Attach(void)
+   {
+   if (FBOID > 0 || DBOID < 1 || CBOID < 1) {return;}
+
+   if (Pool != nullptr) {Pool->Attach(CBOID, FBOID); return;}
+
+   glGenFramebuffers(1, &FBOID);
+   glBindFramebuffer(GL_FRAMEBUFFER, FBOID);
+   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DBOID);
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, CBOID, 0);
+
+   GLenum Error = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+   if (Error != GL_FRAMEBUFFER_COMPLETE) {throw dexception("Failed to setup frame buffer object: %s.", Debug::StatusFBO(Error));}
+   }
+
+/*---------------------------------------------------------------------------
+   Makes the filter render into a render target shared through a pool,
+   instead of its own. Takes effect on the next Setup( ).
+
+   Pool : Render target pool, or nullptr for a target owned by the filter.
+   Slot : Slot number in the pool.
+  ---------------------------------------------------------------------------*/
+void Filter::SetPool(FilterPool* Pool, uint Slot)
+   {
+   Filter::Pool = Pool;
+   PoolSlot = Slot;
+   }
+
+/*---------------------------------------------------------------------------
+   Replaces the selected input texture with the colour buffer of another 
+   filter, so the output of Source is sampled directly, without a copy. The
+   other input, if used, is still updated from the Kinect buffers. Has no
+   effect if the input is already connected to Source. Call it after 
+   Assets( ), and again whenever either filter is set up again.
+  ---------------------------------------------------------------------------*/
+void Filter::Input(const Filter &Source)
+   {
+   Texture &Target = (Select == Filter::SelectDepth) ? Depth : Video;
+
+   if (Target.IsShared() && Target.GetID() == Source.ID()) {return;}
+
+   Target.Share(Source.ID(), Source.Resolution(), Texture::TypeRGB);
+   }
+
 /*---------------------------------------------------------------------------
    Updates the scaling component of the texture calbiration. One unit 
    repesents a single pixel in each direction.
@@ -327,11 +383,34 @@ void Filter::Unbind(void)
 
    glPopAttrib();
    
-   //Update texture mipmaps post rendering
+   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+   }
+
+/*---------------------------------------------------------------------------
+   Builds mipmaps for the colour buffer texture, on demand of whoever 
+   samples it next, such as the display or the next filter in a chain. The
+   colour buffer has no mipmaps until this is called. Call it after 
+   Unbind( ).
+
+   Levels : Number of levels below the base level to build, 0 if the 
+            colour buffer is not minified.
+  ---------------------------------------------------------------------------*/
+void Filter::Mipmap(uint Levels)
+   {
+   if (!Ready()) {return;}
+
    glBindTexture(GL_TEXTURE_2D, CBOID);
-   glGenerateMipmap(GL_TEXTURE_2D);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)Levels);
+   if (Levels > 0) {glGenerateMipmap(GL_TEXTURE_2D);}
+   glBindTexture(GL_TEXTURE_2D, 0);
+   }
 
-   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+/*---------------------------------------------------------------------------
+   Returns the number of mipmap levels the selected input is sampled with.
+  ---------------------------------------------------------------------------*/
+uint Filter::InputLevels(void) const
+   {
+   return (Select == Filter::SelectDepth) ? Depth.GetMipLevels() : Video.GetMipLevels();
    }
 
 /*---------------------------------------------------------------------------
@@ -378,41 +457,83 @@ bool Filter::Update(Buffers &Buffer)
    Change(Buffer);
    
    bool Updated = false;
+   UploadTime = 0;
+
+   if (Buffer.VideoUpdated(VideoUpdateID) && EnableVideo) {Updated |= Upload(Video, VideoStream, Buffer.GetVideo());}
+   if (Buffer.DepthUpdated(DepthUpdateID) && EnableDepth) {Updated |= Upload(Depth, DepthStream, Buffer.GetDepth());}
 
-   if (Buffer.VideoUpdated(VideoUpdateID) && EnableVideo)
+   #if defined (DEBUG)
+      GLenum Error = glGetError();
+      if (Error != GL_NO_ERROR) {throw dexception("OpenGL generated an error: %s", Debug::ErrorGL(Error));}
+   #endif
+
+   return Updated;
+   }
+
+/*---------------------------------------------------------------------------
+   Uploads a front buffer texture into one of the filter's textures. The
+   front buffer is only locked while its data is copied into the stream, so
+   the capture thread is free to swap buffers during the transfer. Without
+   stream support, the texture is updated directly under the lock. The time
+   spent is added to UploadTime. Returns false if the front buffer was busy,
+   if the staged data could not be transferred, or if the target is a chain
+   input, which samples the previous stage and is never uploaded.
+
+   Target : Filter texture to update.
+   Stream : Stream used for the target.
+   Front  : Front buffer texture.
+  ---------------------------------------------------------------------------*/
+bool Filter::Upload(Texture &Target, TextureStream &Stream, Texture &Front)
+   {
+   if (Target.IsShared()) {return false;}
+
+   QElapsedTimer Timer;
+   Timer.start();
+
+   MutexControl Mutex(Front.GetMutexHandle());
+   if (!Mutex.LockRequest()) {return false;}
+
+   bool Updated = true;
+
+   if (Stream.Stage(Front))
       {
-      Texture &VideoFront = Buffer.GetVideo();
-      MutexControl Mutex(VideoFront.GetMutexHandle());
-      if (Mutex.LockRequest())
-         {
-         Video.Bind(0);
-         Video.Update(VideoFront);
-         Video.Unbind(0);
-         Mutex.Unlock();
-         Updated |= true;
-         }
+      Mutex.Unlock();
+      Updated = Stream.Commit(Target);
       }
+   else
+      {
+      Target.Bind(0);
+      Target.Update(Front);
+      Target.Unbind(0);
+      Mutex.Unlock();
+      }
+
+   UploadTime += Timer.nsecsElapsed();
 
-   if (Buffer.DepthUpdated(DepthUpdateID) && EnableDepth)
+   return Updated;
+   }
+
+/*---------------------------------------------------------------------------
+   Reads the contents of the frame buffer object into an RGB texture. The
+   caller must lock the Image texture.
+  ---------------------------------------------------------------------------*/
+void Filter::Read(Texture &Image)
+   {
+   vector2u Res = Image.Resolution();
+   if (Res.U != ViewPort.C2 || Res.V != ViewPort.C3 || Image.DataType() != Texture::TypeRGB) 
       {
-      Texture &DepthFront = Buffer.GetDepth();
-      MutexControl Mutex(DepthFront.GetMutexHandle());
-      if (Mutex.LockRequest())
-         {
-         Depth.Bind(0);
-         Depth.Update(DepthFront);
-         Depth.Unbind(0);
-         Mutex.Unlock();
-         Updated |= true;
-         }
+      Res.Set(ViewPort.C2, ViewPort.C3);
+      Image.Create(Res, Texture::TypeRGB);
       }
 
+   glBindFramebuffer(GL_READ_FRAMEBUFFER, FBOID);
+   glReadPixels(0, 0, Res.U, Res.V, Image.DataFormat(), Image.DataCompType(), Image.Pointer());
+   glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
    #if defined (DEBUG)
       GLenum Error = glGetError();
       if (Error != GL_NO_ERROR) {throw dexception("OpenGL generated an error: %s", Debug::ErrorGL(Error));}
    #endif
-
-   return Updated;
    }
 
 /*---------------------------------------------------------------------------
@@ -428,25 +549,53 @@ bool Filter::Capture(Texture &Frame, bool Wait)
    if (!Wait && !Mutex.LockRequest()) {return false;}
    else {Mutex.Lock();}
    
-   vector2u Res = Frame.Resolution();
-   if (Res.U != ViewPort.C2 || Res.V != ViewPort.C3 || Frame.DataType() != Texture::TypeRGB) 
-      {
-      Res.Set(ViewPort.C2, ViewPort.C3);
-      Frame.Create(Res, Texture::TypeRGB);
-      }
+   Read(Frame);
+   
+   return true;
+   }
 
-   glBindFramebuffer(GL_READ_FRAMEBUFFER, FBOID);
-   glReadPixels(0, 0, Res.U, Res.V, Frame.DataFormat(), Frame.DataCompType(), Frame.Pointer());
-   glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+/*---------------------------------------------------------------------------
+   Same as above, but allows filters with a limited set of output colours to
+   capture 8-bit palette indices instead. The colour map is then stored in 
+   Palette, otherwise Palette is emptied, and the frame is captured as RGB.
+   Palette is guarded by the Frame mutex.
+  ---------------------------------------------------------------------------*/
+bool Filter::Capture(Texture &Frame, Texture &Palette, bool Wait)
+   {
+   if (!Ready()) {return false;}
 
-   #if defined (DEBUG)
-      GLenum Error = glGetError();
-      if (Error != GL_NO_ERROR) {throw dexception("OpenGL generated an error: %s", Debug::ErrorGL(Error));}
-   #endif
+   MutexControl Mutex(Frame.GetMutexHandle());
+   if (!Wait && !Mutex.LockRequest()) {return false;}
+   else {Mutex.Lock();}
+   
+   Read(Frame);
+   if (Palette.Size() > 0) {Palette.Destroy();}
    
    return true;
    }
 
+/*---------------------------------------------------------------------------
+   Tells the filter whether the following frames are captured as palette
+   indices. Filters with a limited set of output colours may then snap the
+   rendered colours to their colour map, which they don't need to do for
+   display. Must be set before Render( ).
+  ---------------------------------------------------------------------------*/
+void Filter::SetIndexed(bool State)
+   {
+   Indexed = State;
+   }
+
+/*---------------------------------------------------------------------------
+   Renders the last input frame again with a plain reference implementation
+   of the effect, to check an optimised renderer against. The frame is laid
+   out the same way as a captured frame. Returns false if the filter has no
+   reference renderer. Derived classes receive the reference frame as RGB in
+   Frame.
+  ---------------------------------------------------------------------------*/
+bool Filter::Reference(Texture &)
+   {
+   return false;
+   }
 
 //Close namespaces
 NAMESPACE_END(NAMESPACE_PROJECT)
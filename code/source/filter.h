@@ -11,14 +11,17 @@
 /*---------------------------------------------------------------------------
    Header files
   ---------------------------------------------------------------------------*/
+#include "asset_cache.h"
 #include "buffers.h"
 #include "common.h"
 #include "file.h"
+#include "filter_pool.h"
 #include "material.h"
 #include "matrix.h"
 #include "mesh.h"
 #include "shader.h"
 #include "texture.h"
+#include "texture_stream.h"
 #include "vector.h"
 
 
@@ -57,10 +60,14 @@ class Filter
    GLuint FBOID;                                   //Frame buffer object ID
    GLuint DBOID;                                   //Depth buffer object ID
    GLuint CBOID;                                   //Colour buffer object ID
+   FilterPool* Pool;                               //Shared render targets, or nullptr if the filter owns its target
+   uint PoolSlot;                                  //Slot of the shared render target
 
    Mesh Model;                                     //Plane for texturing the video (may be used for something else, depending on filter)
    Texture Video;                                  //Video texture
    Texture Depth;                                  //Depth texture
+   TextureStream VideoStream;                      //Uploads the video texture
+   TextureStream DepthStream;                      //Uploads the depth texture
    Shader Program;                                 //Shader program
    Material Mat;                                   //Material property
 
@@ -71,12 +78,15 @@ class Filter
    bool EnableDepth;                               //If set, depth texture will be updated
    bool EnableCal;                                 //If set, texture aligment calibration will be enabled
    bool EnableColour;                              //If set, colour editing is enabled
+   bool EnableGL;                                  //If set, the filter renders with OpenGL, otherwise on the CPU
+   bool Indexed;                                   //If set, the frames are captured as palette indices, see SetIndexed( )
+   qint64 UploadTime;                              //Nanoseconds spent uploading textures in the last Update( )
 
    //---- Methods ----
    public:
 
    Filter(void);
-   ~Filter(void);
+   virtual ~Filter(void);
 
    private:
 
@@ -89,28 +99,49 @@ class Filter
    void virtual Clear(void);
    void virtual Destroy(void);
 
+   //Frame capture
+   void Read(Texture &Image);
+
+   //Texture uploads
+   bool Upload(Texture &Target, TextureStream &Stream, Texture &Front);
+
    public:
 
    //Data allocation
-   bool Ready(void) const;
-   void Setup(Buffers &Buffer);
+   bool virtual Ready(void) const;
+   void virtual Setup(Buffers &Buffer);
    void virtual Assets(Buffers &Buffer);
    void Change(Buffers &Buffer);
 
+   //Context hand-over
+   void virtual Detach(void);
+   void virtual Attach(void);
+
    //Rendering
-   void Bind(void);
-   void Unbind(void);
+   void virtual Bind(void);
+   void virtual Unbind(void);
+   void virtual Mipmap(uint Levels);
    void virtual Render(void);
-   bool Update(Buffers &Buffer);
-   bool Capture(Texture &Frame, bool Wait);
+   bool virtual Update(Buffers &Buffer);
+   bool virtual Capture(Texture &Frame, bool Wait);
+   bool virtual Capture(Texture &Frame, Texture &Palette, bool Wait);
+   void virtual SetIndexed(bool State);
+   bool virtual Reference(Texture &Frame);
+
+   //Filter chaining
+   void SetPool(FilterPool* Pool, uint Slot);
+   void Input(const Filter &Source);
+   uint InputLevels(void) const;
 
    //Data access
-   inline vector2u Resolution(void) const {return vector2u(ViewPort.C2, ViewPort.C3);}
-   inline GLuint ID(void) const {return CBOID;}
+   inline vector2u virtual Resolution(void) const {return vector2u(ViewPort.C2, ViewPort.C3);}
+   inline GLuint virtual ID(void) const {return CBOID;}
+   inline qint64 virtual GetUploadTime(void) const {return UploadTime;}
    inline bool UsesVideo(void) const {return EnableVideo;}
    inline bool UsesDepth(void) const {return EnableDepth;}
    inline bool UsesCal(void) const {return EnableCal;}
    inline bool UsesColour(void) const {return EnableColour;}
+   inline bool UsesGL(void) const {return EnableGL;}
 
    void AddScale(float X, float Y);
    void AddTrans(float X, float Y);
@@ -0,0 +1,255 @@
+/*===========================================================================
+   Filter Chain
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_CHAIN_CPP___
+#define ___FILTER_CHAIN_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "filter_chain.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+FilterChain::FilterChain(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor. NOTE: Make sure it is called within a valid OpenGL context.
+  ---------------------------------------------------------------------------*/
+FilterChain::~FilterChain(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void FilterChain::Clear(void)
+   {
+   Filter::Clear();
+
+   EnableVideo = false;
+   EnableDepth = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the stages, and then the render targets they shared. NOTE: Make
+   sure it is called within a valid OpenGL context.
+  ---------------------------------------------------------------------------*/
+void FilterChain::Destroy(void)
+   {
+   for (uiter I = 0; I < Stages.Size(); I++) {delete Stages[I];}
+
+   Stages.Destroy();
+   Pool.Destroy();
+
+   Filter::Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Adds a filter at the end of the chain. The chain takes ownership of the
+   filter. Must be called before the chain is set up.
+  ---------------------------------------------------------------------------*/
+void FilterChain::Append(Filter* FX)
+   {
+   if (FX == nullptr) {throw dexception("Invalid parameters.");}
+
+   FX->SetPool(&Pool, (uint)(Stages.Size() % FilterChain::PoolSlots));
+   Stages += FX;
+
+   EnableVideo |= FX->UsesVideo();
+   EnableDepth |= FX->UsesDepth();
+   }
+
+/*---------------------------------------------------------------------------
+   Connects each stage to the output of the previous stage. Stages that were
+   set up again since the last call are connected again.
+  ---------------------------------------------------------------------------*/
+void FilterChain::Link(void)
+   {
+   for (uiter I = 1; I < Stages.Size(); I++) {Stages[I]->Input(*Stages[I - 1]);}
+   }
+
+/*---------------------------------------------------------------------------
+   Indicates whether every stage was set up.
+  ---------------------------------------------------------------------------*/
+bool FilterChain::Ready(void) const
+   {
+   if (Stages.Size() < 1) {return false;}
+
+   for (uiter I = 0; I < Stages.Size(); I++)
+      {
+      if (!Stages[I]->Ready()) {return false;}
+      }
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Sets up each stage. NOTE: This must be called within a valid OpenGL
+   context.
+  ---------------------------------------------------------------------------*/
+void FilterChain::Setup(Buffers &Buffer)
+   {
+   for (uiter I = 0; I < Stages.Size(); I++) {Stages[I]->Setup(Buffer);}
+   }
+
+/*---------------------------------------------------------------------------
+   Sets up the assets of each stage, then connects the stages.
+  ---------------------------------------------------------------------------*/
+void FilterChain::Assets(Buffers &Buffer)
+   {
+   if (!Ready()) {return;}
+
+   for (uiter I = 0; I < Stages.Size(); I++) {Stages[I]->Assets(Buffer);}
+
+   Link();
+   }
+
+/*---------------------------------------------------------------------------
+   Prepares each stage for being handed over to another OpenGL context,
+   then deletes the frame buffer objects of the shared render targets, see
+   Filter::Detach( ). NOTE: This must be called within the OpenGL context
+   that set up the chain.
+  ---------------------------------------------------------------------------*/
+void FilterChain::Detach(void)
+   {
+   for (uiter I = 0; I < Stages.Size(); I++) {Stages[I]->Detach();}
+
+   Pool.Detach();
+   }
+
+/*---------------------------------------------------------------------------
+   Completes the hand-over started by Detach( ) in the current OpenGL 
+   context. Stages sharing a render target also share the new frame buffer
+   object. The colour buffers are kept, so the stages stay connected.
+  ---------------------------------------------------------------------------*/
+void FilterChain::Attach(void)
+   {
+   for (uiter I = 0; I < Stages.Size(); I++) {Stages[I]->Attach();}
+   }
+
+/*---------------------------------------------------------------------------
+   The stages bind their own frame buffer objects in Render( ).
+  ---------------------------------------------------------------------------*/
+void FilterChain::Bind(void) {}
+void FilterChain::Unbind(void) {}
+
+/*---------------------------------------------------------------------------
+   Renders each stage into its frame buffer object, in order. Each output
+   gets as many mipmap levels as the next stage samples.
+  ---------------------------------------------------------------------------*/
+void FilterChain::Render(void)
+   {
+   if (!Ready()) {return;}
+
+   for (uiter I = 0; I < Stages.Size(); I++)
+      {
+      Filter* FX = Stages[I];
+      FX->Bind();
+      FX->Render();
+      FX->Unbind();
+
+      if (I + 1 < Stages.Size()) {FX->Mipmap(Stages[I + 1]->InputLevels());}
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Builds mipmaps for the output of the last stage.
+  ---------------------------------------------------------------------------*/
+void FilterChain::Mipmap(uint Levels)
+   {
+   if (!Ready()) {return;}
+   Stages[Stages.Size() - 1]->Mipmap(Levels);
+   }
+
+/*---------------------------------------------------------------------------
+   Updates the input textures of every stage, so that each one consumes the
+   buffer updates, then reconnects stages that were set up again. Returns
+   true if any of the stages were updated.
+  ---------------------------------------------------------------------------*/
+bool FilterChain::Update(Buffers &Buffer)
+   {
+   if (!Ready()) {return false;}
+
+   bool Updated = false;
+
+   for (uiter I = 0; I < Stages.Size(); I++) {Updated |= Stages[I]->Update(Buffer);}
+
+   Link();
+
+   return Updated;
+   }
+
+/*---------------------------------------------------------------------------
+   Captures the output of the last stage.
+  ---------------------------------------------------------------------------*/
+bool FilterChain::Capture(Texture &Frame, bool Wait)
+   {
+   if (!Ready()) {return false;}
+   return Stages[Stages.Size() - 1]->Capture(Frame, Wait);
+   }
+
+bool FilterChain::Capture(Texture &Frame, Texture &Palette, bool Wait)
+   {
+   if (!Ready()) {return false;}
+   return Stages[Stages.Size() - 1]->Capture(Frame, Palette, Wait);
+   }
+
+/*---------------------------------------------------------------------------
+   Only the last stage is captured, so only it is told about indexed 
+   capture.
+  ---------------------------------------------------------------------------*/
+void FilterChain::SetIndexed(bool State)
+   {
+   Filter::SetIndexed(State);
+   if (Stages.Size() > 0) {Stages[Stages.Size() - 1]->SetIndexed(State);}
+   }
+
+/*---------------------------------------------------------------------------
+   Output resolution and colour buffer of the last stage.
+  ---------------------------------------------------------------------------*/
+vector2u FilterChain::Resolution(void) const
+   {
+   if (Stages.Size() < 1) {return vector2u(0, 0);}
+   return Stages[Stages.Size() - 1]->Resolution();
+   }
+
+GLuint FilterChain::ID(void) const
+   {
+   if (Stages.Size() < 1) {return 0;}
+   return Stages[Stages.Size() - 1]->ID();
+   }
+
+/*---------------------------------------------------------------------------
+   Time spent uploading textures in the last Update( ), over all stages.
+  ---------------------------------------------------------------------------*/
+qint64 FilterChain::GetUploadTime(void) const
+   {
+   qint64 Time = 0;
+   for (uiter I = 0; I < Stages.Size(); I++) {Time += Stages[I]->GetUploadTime();}
+   return Time;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
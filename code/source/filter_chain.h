@@ -0,0 +1,101 @@
+/*===========================================================================
+   Filter Chain
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_CHAIN_H___
+#define ___FILTER_CHAIN_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "filter.h"
+#include "filter_pool.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Runs several filters one after another, each stage sampling the colour
+  buffer of the previous stage in place of its selected input, see
+  Filter::Input( ). Everything stays on the GPU, the stages only render
+  into frame buffer objects. The stages share their render targets through
+  a pool, alternating between two targets per resolution.
+
+  The chain is a filter itself, so it can be attached to a GLWidget, built
+  by a FilterThread, or used in batch mode. Its output, capture and resolution are those of the last
+  stage.
+  ---------------------------------------------------------------------------*/
+class FilterChain : public Filter
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const uint PoolSlots = 2;                //Number of pool slots the stages alternate between
+
+   //---- Member data ----
+   private:
+
+   Array<Filter*> Stages;                          //Filters in rendering order, owned by the chain
+   FilterPool Pool;                                //Render targets of the stages
+
+   //---- Methods ----
+   public:
+
+   FilterChain(void);
+   ~FilterChain(void);
+
+   private:
+
+   FilterChain(const FilterChain &obj);            //Disable
+   FilterChain &operator = (const FilterChain &obj); //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   void Link(void);
+
+   public:
+
+   //Chain setup
+   void Append(Filter* FX);
+   inline usize Size(void) const {return Stages.Size();}
+
+   //Data allocation
+   bool Ready(void) const;
+   void Setup(Buffers &Buffer);
+   void Assets(Buffers &Buffer);
+
+   //Context hand-over
+   void Detach(void);
+   void Attach(void);
+
+   //Rendering
+   void Bind(void);
+   void Unbind(void);
+   void Mipmap(uint Levels);
+   void Render(void);
+   bool Update(Buffers &Buffer);
+   bool Capture(Texture &Frame, bool Wait);
+   bool Capture(Texture &Frame, Texture &Palette, bool Wait);
+   void SetIndexed(bool State);
+
+   //Data access
+   vector2u Resolution(void) const;
+   GLuint ID(void) const;
+   qint64 GetUploadTime(void) const;
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
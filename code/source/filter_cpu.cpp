@@ -0,0 +1,270 @@
+/*===========================================================================
+   Software Filter Base Class
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_CPU_CPP___
+#define ___FILTER_CPU_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "filter_cpu.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+FilterCPU::FilterCPU(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+FilterCPU::~FilterCPU(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void FilterCPU::Clear(void)
+   {
+   Filter::Clear();
+
+   EnableGL = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure. No OpenGL context is needed.
+  ---------------------------------------------------------------------------*/
+void FilterCPU::Destroy(void)
+   {
+   Filter::Destroy();
+
+   Output.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Indicates whether the Setup( ) was called.
+  ---------------------------------------------------------------------------*/
+bool FilterCPU::Ready(void) const
+   {
+   return Output.Size() > 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Creates the output texture, with the resolution of the selected input.
+  ---------------------------------------------------------------------------*/
+void FilterCPU::Setup(Buffers &Buffer)
+   {
+   Destroy();
+
+   vector2u Res;
+
+   switch (Select)
+      {
+      case Filter::SelectVideo : Res = Buffer.GetVideoResolution(); break;
+      case Filter::SelectDepth : Res = Buffer.GetDepthResolution(); break;
+      default : throw dexception("Invalid Select enumeration.");
+      }
+
+   if (Res.X < 1 || Res.Y < 1) {return;}
+
+   Output.Create(Res, Texture::TypeRGB);
+   ViewPort.Set4(0, 0, Res.X, Res.Y);
+   }
+
+/*---------------------------------------------------------------------------
+   There is no frame buffer object to bind, or mipmaps to build.
+  ---------------------------------------------------------------------------*/
+void FilterCPU::Bind(void) {}
+void FilterCPU::Unbind(void) {}
+void FilterCPU::Mipmap(uint) {}
+
+/*---------------------------------------------------------------------------
+   Renders a band of scanlines. Bands start on even scanlines, so a 2x2
+   pixel block is never split between two bands.
+  ---------------------------------------------------------------------------*/
+void FilterCPU::RenderJob::Run(uiter Task)
+   {
+   const usize Lines = FX->Output.Resolution().V;
+   const usize Pairs = (Lines + 1) >> 1;
+
+   const uiter Start = ((Pairs * Task) / Bands) << 1;
+   const uiter End = Math::Min(((Pairs * (Task + 1)) / Bands) << 1, Lines);
+
+   if (Start < End) {FX->Shade(Start, End);}
+   }
+
+/*---------------------------------------------------------------------------
+   Renders the filter effect into the output texture, using the threads of
+   the shared pool.
+  ---------------------------------------------------------------------------*/
+void FilterCPU::Render(void)
+   {
+   if (!Ready()) {return;}
+
+   ThreadPool &Workers = ThreadPool::Shared();
+
+   const usize Pairs = (Output.Resolution().V + 1) >> 1;
+
+   RenderJob Job;
+   Job.FX = this;
+   Job.Bands = Math::Min(Workers.Threads() * FilterCPU::BandsPerThread, Pairs);
+
+   Workers.Run(Job, Job.Bands);
+   }
+
+/*---------------------------------------------------------------------------
+   Copies a front buffer texture into one of the input textures. The time
+   spent is added to UploadTime. Returns false if the front buffer was busy,
+   or does not match the input texture.
+
+   Target : Input texture.
+   Front  : Front buffer texture.
+  ---------------------------------------------------------------------------*/
+bool FilterCPU::Copy(Texture &Target, Texture &Front)
+   {
+   QElapsedTimer Timer;
+   Timer.start();
+
+   MutexControl Mutex(Front.GetMutexHandle());
+   if (!Mutex.LockRequest()) {return false;}
+
+   if (Target.Size() != Front.Size() || Target.DataType() != Front.DataType()) {return false;}
+
+   memcpy(Target.Pointer(), Front.Pointer(), Front.Size());
+
+   Mutex.Unlock();
+
+   UploadTime += Timer.nsecsElapsed();
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Builds the first mipmap level of the depth texture with a 2x2 box filter,
+   like glGenerateMipmap( ). Returns the resolution of the level.
+
+   Level : Receives the normalised depth values.
+  ---------------------------------------------------------------------------*/
+vector2u FilterCPU::Reduce(Array<float, 256> &Level) const
+   {
+   const vector2u Res = Depth.Resolution();
+   const vector2u LevelRes = Res.Max(2) / 2;
+   const float Norm = 1.0f / (4.0f * 65535.0f);
+
+   if (Level.Size() != LevelRes.U * LevelRes.V)
+      {
+      Level.Destroy();
+      Level.Create(LevelRes.U * LevelRes.V);
+      }
+
+   float* Dst = Level.Pointer();
+
+   for (uiter V = 0; V < LevelRes.V; V++)
+      {
+      const uint16* Src0 = Depth.Address16(0, Math::Min(V * 2, (uiter)Res.V - 1));
+      const uint16* Src1 = Depth.Address16(0, Math::Min(V * 2 + 1, (uiter)Res.V - 1));
+
+      for (uiter U = 0; U < LevelRes.U; U++)
+         {
+         const uiter U0 = Math::Min(U * 2, (uiter)Res.U - 1);
+         const uiter U1 = Math::Min(U * 2 + 1, (uiter)Res.U - 1);
+         *Dst++ = (float)((uint)Src0[U0] + (uint)Src0[U1] + (uint)Src1[U0] + (uint)Src1[U1]) * Norm;
+         }
+      }
+
+   return LevelRes;
+   }
+
+/*---------------------------------------------------------------------------
+   Copies the front buffers into the input textures. It may also reconfigure
+   the filter if the selected input has a different resolution. Returns true
+   if either of the textures were updated.
+  ---------------------------------------------------------------------------*/
+bool FilterCPU::Update(Buffers &Buffer)
+   {
+   if (!Ready()) {return false;}
+
+   //Test for resolution change, if applicable
+   Change(Buffer);
+
+   bool Updated = false;
+   UploadTime = 0;
+
+   if (Buffer.VideoUpdated(VideoUpdateID) && EnableVideo) {Updated |= Copy(Video, Buffer.GetVideo());}
+   if (Buffer.DepthUpdated(DepthUpdateID) && EnableDepth) {Updated |= Copy(Depth, Buffer.GetDepth());}
+
+   return Updated;
+   }
+
+/*---------------------------------------------------------------------------
+   Copies the output texture into an RGB texture. The caller must lock the
+   Frame texture.
+  ---------------------------------------------------------------------------*/
+void FilterCPU::Read(Texture &Frame)
+   {
+   vector2u Res = Frame.Resolution();
+   vector2u OutputRes = Output.Resolution();
+   if (Res.U != OutputRes.U || Res.V != OutputRes.V || Frame.DataType() != Texture::TypeRGB)
+      {
+      Frame.Create(OutputRes, Texture::TypeRGB);
+      }
+
+   memcpy(Frame.Pointer(), Output.Pointer(), Output.Size());
+   }
+
+/*---------------------------------------------------------------------------
+   Captures the output texture, see Filter::Capture( ). The output is always
+   captured as RGB, so Palette is emptied.
+  ---------------------------------------------------------------------------*/
+bool FilterCPU::Capture(Texture &Frame, bool Wait)
+   {
+   if (!Ready()) {return false;}
+
+   MutexControl Mutex(Frame.GetMutexHandle());
+   if (!Wait && !Mutex.LockRequest()) {return false;}
+   else {Mutex.Lock();}
+
+   Read(Frame);
+
+   return true;
+   }
+
+bool FilterCPU::Capture(Texture &Frame, Texture &Palette, bool Wait)
+   {
+   if (!Ready()) {return false;}
+
+   MutexControl Mutex(Frame.GetMutexHandle());
+   if (!Wait && !Mutex.LockRequest()) {return false;}
+   else {Mutex.Lock();}
+
+   Read(Frame);
+   if (Palette.Size() > 0) {Palette.Destroy();}
+
+   return true;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
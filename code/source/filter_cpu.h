@@ -0,0 +1,104 @@
+/*===========================================================================
+   Software Filter Base Class
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_CPU_H___
+#define ___FILTER_CPU_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "filter.h"
+#include "thread_pool.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Base class for filters that render on the CPU, for systems without an
+  OpenGL context that supports frame buffer objects, such as headless
+  servers. The input textures are plain copies of the front buffers, and
+  the output is an RGB texture laid out the same way as a frame buffer
+  object read back with glReadPixels( ), with the origin at the bottom left.
+  Rendering is split into bands of scanlines, processed by a pool of worker
+  threads.
+
+  The filters can be used wherever a Filter is, except that they have
+  nothing to display, ID( ) is always 0, and they cannot be chained.
+  Derived classes load their assets in Assets( ), and implement Shade( ).
+  ---------------------------------------------------------------------------*/
+class FilterCPU : public Filter
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const uint BandsPerThread = 4;           //Number of render bands per worker thread
+
+   private:
+
+   class RenderJob : public ThreadPool::Job        //Renders a band of scanlines
+      {
+      public:
+      FilterCPU* FX;                               //Filter to render
+      usize Bands;                                 //Number of bands the frame is split into
+      void Run(uiter Task);
+      };
+
+   //---- Member data ----
+   protected:
+
+   Texture Output;                                 //Rendered frame
+
+   //---- Methods ----
+   public:
+
+   FilterCPU(void);
+   ~FilterCPU(void);
+
+   private:
+
+   FilterCPU(const FilterCPU &obj);                //Disable
+   FilterCPU &operator = (const FilterCPU &obj);   //Disable
+
+   protected:
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Rendering
+   bool Copy(Texture &Target, Texture &Front);
+   vector2u Reduce(Array<float, 256> &Level) const;
+   void Read(Texture &Frame);
+   void virtual Shade(uiter Start, uiter End) = 0;
+
+   public:
+
+   //Data allocation
+   bool Ready(void) const;
+   void Setup(Buffers &Buffer);
+
+   //Rendering
+   void Bind(void);
+   void Unbind(void);
+   void Mipmap(uint Levels);
+   void Render(void);
+   bool Update(Buffers &Buffer);
+   bool Capture(Texture &Frame, bool Wait);
+   bool Capture(Texture &Frame, Texture &Palette, bool Wait);
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -52,6 +52,8 @@ void FilterFatty::Clear(void)
    Mat.SetDiffuse(vector4f(0.9f, 0.9f, 0.9f, 1.0f));
    Mat.SetSpecular(vector4f(0.2f, 0.2f, 0.2f, 0.0f));
    Mat.SetShininess(100.0f);
+
+   GradientFBOID = 0;
    }
 
 /*---------------------------------------------------------------------------
@@ -62,6 +64,12 @@ void FilterFatty::Destroy(void)
    {
    Filter::Destroy();
 
+   Screen.Destroy();
+   Gradient.Destroy();
+   GradientProgram.Destroy();
+
+   if (GradientFBOID > 0) {glDeleteFramebuffers(1, &GradientFBOID);}
+
    Clear();
    }
 
@@ -80,28 +88,50 @@ void FilterFatty::Assets(Buffers &Buffer)
    if (Count < 1) {throw dexception("Current OpenGL context does not support vertex texture image units.");}
 
    Light.SetPosition(vector4f(0.0f, 2.0f, 2.0f, 0.0f));
-   Light.Buffer(0);
 
    vector2u Res = Buffer.GetVideoResolution();
    Video.Create(Res, Buffer.GetVideoDataType());
    Video.ClearData();
+   Video.SetMipLevels(0); //Mapped onto the surface at about its own size
    Video.Buffer(false);
 
    Depth.Create(Buffer.GetDepthResolution(), Buffer.GetDepthDataType());
    Depth.ClearData();
+   Depth.SetMipLevels(0); //Sampled at LOD 0
    Depth.Buffer(false);
 
-   Model.Plane(Res >> 1, Mesh::ModeSolid);
+   //One gradient texel for each vertex of the plane
+   vector2u Grid = (Res >> 1).Clamp((uint)Mesh::DivMin, (uint)Mesh::DivMax);
+   Gradient.Create(Grid + 1, Texture::TypeNormal);
+   Gradient.ClearData();
+   Gradient.SetMipLevels(0); //Fetched at texel centres
+   Gradient.SetMinFilter(Texture::MinNearest);
+   Gradient.SetMagFilter(Texture::MagNearest);
+   Gradient.Buffer(false);
+
+   //Light and gradient frame buffer object belong to the current context
+   Attach();
+
+   Screen.Plane(1, Mesh::ModeSolid);
+   Screen.Buffer(false);
+
+   Model.Plane(Grid, Mesh::ModeSolid);
    Model.Buffer(false);
 
-   File::Text Text;
    std::string CodeVert, CodeFrag;
-   Text.Load(CodeVert, File::Path::Shader(File::FilterFattyVert));
-   Text.Load(CodeFrag, File::Path::Shader(File::FilterFattyFrag));
+   AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterFattyVert));
+   AssetCache::LoadText(CodeFrag, File::Path::Shader(File::FilterFattyFrag));
    Program.Attach(CodeVert, Shader::ShaderVert);
    Program.Attach(CodeFrag, Shader::ShaderFrag);
    Program.Buffer(false);
 
+   std::string GradientVert, GradientFrag;
+   AssetCache::LoadText(GradientVert, File::Path::Shader(File::FilterFattyGradientVert));
+   AssetCache::LoadText(GradientFrag, File::Path::Shader(File::FilterFattyGradientFrag));
+   GradientProgram.Attach(GradientVert, Shader::ShaderVert);
+   GradientProgram.Attach(GradientFrag, Shader::ShaderFrag);
+   GradientProgram.Buffer(false);
+
    vector2f d[2];
    d[0].U = 1.0f / (float)Res.U;
    d[0].V = 1.0f / (float)Res.V;
@@ -128,26 +158,91 @@ void FilterFatty::Assets(Buffers &Buffer)
       };
 
    Program.Bind();
-   glUniform1i(glGetUniformLocation(Program.ID(), "Depth"), 0);   //Texture unit 0
-   glUniform1i(glGetUniformLocation(Program.ID(), "Video"), 1);   //Texture unit 1
-   glUniform2f(glGetUniformLocation(Program.ID(), "d[0]"), d[0].U, d[0].V);
-   glUniform2f(glGetUniformLocation(Program.ID(), "d[1]"), d[1].U, d[1].V);
-   glUniform3f(glGetUniformLocation(Program.ID(), "K[0]"), K[0].X, K[0].Y, K[0].Z);
-   glUniform3f(glGetUniformLocation(Program.ID(), "K[1]"), K[1].X, K[1].Y, K[1].Z);
-   glUniform3f(glGetUniformLocation(Program.ID(), "K[2]"), K[2].X, K[2].Y, K[2].Z);
-   glUniform3f(glGetUniformLocation(Program.ID(), "K[3]"), K[3].X, K[3].Y, K[3].Z);
-   glUniform3f(glGetUniformLocation(Program.ID(), "K[4]"), K[4].X, K[4].Y, K[4].Z);
-   glUniform3f(glGetUniformLocation(Program.ID(), "K[5]"), K[5].X, K[5].Y, K[5].Z);
-   glUniform3f(glGetUniformLocation(Program.ID(), "K[6]"), K[6].X, K[6].Y, K[6].Z);
-   glUniform3f(glGetUniformLocation(Program.ID(), "K[7]"), K[7].X, K[7].Y, K[7].Z);
-   glUniform3f(glGetUniformLocation(Program.ID(), "K[8]"), K[8].X, K[8].Y, K[8].Z);
-   glUniform3f(glGetUniformLocation(Program.ID(), "K[9]"), K[9].X, K[9].Y, K[9].Z);
+   glUniform1i(glGetUniformLocation(Program.ID(), "Gradient"), 0);   //Texture unit 0
+   glUniform1i(glGetUniformLocation(Program.ID(), "Video"), 1);      //Texture unit 1
+   glUniform2f(glGetUniformLocation(Program.ID(), "d"), d[0].U, d[0].V);
+   glUniform2f(glGetUniformLocation(Program.ID(), "Grid"), (float)Grid.U, (float)Grid.V);
    Program.Unbind();
 
+   GradientProgram.Bind();
+   glUniform1i(glGetUniformLocation(GradientProgram.ID(), "Depth"), 0);   //Texture unit 0
+   glUniform2f(glGetUniformLocation(GradientProgram.ID(), "d[0]"), d[0].U, d[0].V);
+   glUniform2f(glGetUniformLocation(GradientProgram.ID(), "d[1]"), d[1].U, d[1].V);
+   glUniform2f(glGetUniformLocation(GradientProgram.ID(), "Grid"), (float)Grid.U, (float)Grid.V);
+   glUniform3f(glGetUniformLocation(GradientProgram.ID(), "K[0]"), K[0].X, K[0].Y, K[0].Z);
+   glUniform3f(glGetUniformLocation(GradientProgram.ID(), "K[1]"), K[1].X, K[1].Y, K[1].Z);
+   glUniform3f(glGetUniformLocation(GradientProgram.ID(), "K[2]"), K[2].X, K[2].Y, K[2].Z);
+   glUniform3f(glGetUniformLocation(GradientProgram.ID(), "K[3]"), K[3].X, K[3].Y, K[3].Z);
+   glUniform3f(glGetUniformLocation(GradientProgram.ID(), "K[4]"), K[4].X, K[4].Y, K[4].Z);
+   glUniform3f(glGetUniformLocation(GradientProgram.ID(), "K[5]"), K[5].X, K[5].Y, K[5].Z);
+   glUniform3f(glGetUniformLocation(GradientProgram.ID(), "K[6]"), K[6].X, K[6].Y, K[6].Z);
+   glUniform3f(glGetUniformLocation(GradientProgram.ID(), "K[7]"), K[7].X, K[7].Y, K[7].Z);
+   glUniform3f(glGetUniformLocation(GradientProgram.ID(), "K[8]"), K[8].X, K[8].Y, K[8].Z);
+   glUniform3f(glGetUniformLocation(GradientProgram.ID(), "K[9]"), K[9].X, K[9].Y, K[9].Z);
+   GradientProgram.Unbind();
+
    GLenum Error = glGetError();
    if (Error != GL_NO_ERROR) {throw dexception("OpenGL generated an error: %s", Debug::ErrorGL(Error));}
    }
 
+/*---------------------------------------------------------------------------
+   Renders the gradient pass into the gradient texture, then binds the frame
+   buffer object of the filter again. Uses the matrices set by Bind( ).
+  ---------------------------------------------------------------------------*/
+void FilterFatty::RenderGradient(void)
+   {
+   const vector2u Res = Gradient.Resolution();
+
+   glBindFramebuffer(GL_FRAMEBUFFER, GradientFBOID);
+   glViewport(0, 0, Res.U, Res.V);
+
+   GradientProgram.Bind();
+   Screen.Bind(1);
+   Depth.Bind(0);
+   Screen.Render();
+   Depth.Unbind(0);
+   Screen.Unbind(1);
+   GradientProgram.Unbind();
+
+   glViewport(ViewPort.C0, ViewPort.C1, ViewPort.C2, ViewPort.C3);
+   glBindFramebuffer(GL_FRAMEBUFFER, FBOID);
+   }
+
+/*---------------------------------------------------------------------------
+   Deletes the frame buffer objects before the filter is handed over to
+   another OpenGL context, see Filter::Detach( ).
+  ---------------------------------------------------------------------------*/
+void FilterFatty::Detach(void)
+   {
+   Filter::Detach();
+
+   if (GradientFBOID > 0) {glDeleteFramebuffers(1, &GradientFBOID);}
+   GradientFBOID = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Makes the frame buffer objects and buffers the light in the current
+   OpenGL context, see Filter::Attach( ).
+  ---------------------------------------------------------------------------*/
+void FilterFatty::Attach(void)
+   {
+   Filter::Attach();
+
+   Light.Buffer(0);
+
+   if (GradientFBOID > 0 || Gradient.GetID() < 1) {return;}
+
+   //Frame buffer object of the gradient pass, with the gradient texture
+   // as its colour buffer. It needs no depth buffer.
+   glGenFramebuffers(1, &GradientFBOID);
+   glBindFramebuffer(GL_FRAMEBUFFER, GradientFBOID);
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Gradient.GetID(), 0);
+
+   GLenum Status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+   glBindFramebuffer(GL_FRAMEBUFFER, FBOID);
+   if (Status != GL_FRAMEBUFFER_COMPLETE) {throw dexception("Failed to setup frame buffer object: %s.", Debug::StatusFBO(Status));}
+   }
+
 /*---------------------------------------------------------------------------
    Renders the filter effect. Assumes the Bind( ) method was called prior.
   ---------------------------------------------------------------------------*/
@@ -156,6 +251,8 @@ void FilterFatty::Render(void)
    if (!Ready()) {return;}
 
    glEnable(GL_TEXTURE_2D);
+
+   RenderGradient();
    glEnable(GL_LIGHTING);
 
    //Video texture uses its own matrix
@@ -172,13 +269,13 @@ void FilterFatty::Render(void)
 
    Program.Bind();
    Model.Bind(2);
-   Depth.Bind(0);
+   Gradient.Bind(0);
    Video.Bind(1);       
 
    Model.Render();
 
    Video.Unbind(1);
-   Depth.Unbind(0);
+   Gradient.Unbind(0);
    Model.Unbind(2);
    Program.Unbind();
 
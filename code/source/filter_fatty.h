@@ -20,7 +20,12 @@ NAMESPACE_BEGIN(NAMESPACE_PROJECT)
 
 
 /*---------------------------------------------------------------------------
-   Classes
+   Renders in two passes. The first pass evaluates the 5x5 edge operator
+   into a float texture with one texel per vertex of the displaced plane,
+   holding the gradient and the depth. The vertex shader of the second pass
+   then needs a single fetch from that texture, instead of 41 fetches from
+   the depth texture. Vertex texture fetches are far slower than fragment
+   texture fetches on most hardware.
   ---------------------------------------------------------------------------*/
 class FilterFatty : public Filter
    {
@@ -31,6 +36,10 @@ class FilterFatty : public Filter
    private:
 
    Lighting Light;                                 //Light colour
+   Mesh Screen;                                    //Plane covering the gradient texture
+   Texture Gradient;                               //Gradient and depth of each vertex of the plane
+   Shader GradientProgram;                         //Shader program of the gradient pass
+   GLuint GradientFBOID;                           //Frame buffer object of the gradient pass
 
    //---- Methods ----
    public:
@@ -48,8 +57,15 @@ class FilterFatty : public Filter
    void Destroy(void);
    void Assets(Buffers &Buffer);
 
+   //Rendering
+   void RenderGradient(void);
+
    public:
 
+   //Context hand-over
+   void Detach(void);
+   void Attach(void);
+
    //Rendering
    void Render(void);
    };
@@ -60,4 +76,4 @@ NAMESPACE_END(NAMESPACE_PROJECT)
 
 
 //==== End of file ===========================================================
-#endif
+#endif
@@ -56,6 +56,7 @@ void FilterLines::Destroy(void)
    {
    Filter::Destroy();
 
+   AssetCache::Release(Lines);
    Lines.Destroy();
 
    Clear();
@@ -75,20 +76,19 @@ void FilterLines::Assets(Buffers &Buffer)
    vector2u Res = Buffer.GetDepthResolution();
    Depth.Create(Res, Buffer.GetDepthDataType());
    Depth.ClearData();
+   Depth.SetMipLevels(1); //Sampled with a LOD bias of 1
    Depth.Buffer(false);
 
    Model.Plane(1, Mesh::ModeSolid);
    Model.Buffer(false);
 
-   File::PNG PNG;
-   PNG.Load(Lines, File::Path::Texture(File::TextureLines));
+   AssetCache::LoadPNG(Lines, File::Path::Texture(File::TextureLines));
    Lines.SetWrap(true);
-   Lines.Buffer(false);
+   AssetCache::Acquire(Lines, File::Path::Texture(File::TextureLines));
 
-   File::Text Text;
    std::string CodeVert, CodeFrag;
-   Text.Load(CodeVert, File::Path::Shader(File::FilterLinesVert));
-   Text.Load(CodeFrag, File::Path::Shader(File::FilterLinesFrag));
+   AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterLinesVert));
+   AssetCache::LoadText(CodeFrag, File::Path::Shader(File::FilterLinesFrag));
    Program.Attach(CodeVert, Shader::ShaderVert);
    Program.Attach(CodeFrag, Shader::ShaderFrag);
    Program.Buffer(false);
@@ -0,0 +1,362 @@
+/*===========================================================================
+   Line Effects Filter Class, Software Renderer
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_LINES_CPU_CPP___
+#define ___FILTER_LINES_CPU_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "filter_lines_cpu.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Bilinear sample of an RGB texture with repeat wrapping, as normalised
+   colour components.
+  ---------------------------------------------------------------------------*/
+static inline void FilterLinesBilinear(const Texture &Level, float S, float T, float* RGB)
+   {
+   const vector2u Res = Level.Resolution();
+
+   float X = S * (float)Res.U - 0.5f;
+   float Y = T * (float)Res.V - 0.5f;
+   float X0 = floorf(X);
+   float Y0 = floorf(Y);
+   float FX = X - X0;
+   float FY = Y - Y0;
+
+   int U0 = (int)X0 % (int)Res.U;
+   int V0 = (int)Y0 % (int)Res.V;
+   if (U0 < 0) {U0 += (int)Res.U;}
+   if (V0 < 0) {V0 += (int)Res.V;}
+   int U1 = (U0 + 1) % (int)Res.U;
+   int V1 = (V0 + 1) % (int)Res.V;
+
+   const uint8* P00 = Level.Address((uiter)U0, (uiter)V0);
+   const uint8* P10 = Level.Address((uiter)U1, (uiter)V0);
+   const uint8* P01 = Level.Address((uiter)U0, (uiter)V1);
+   const uint8* P11 = Level.Address((uiter)U1, (uiter)V1);
+
+   const float W00 = (1.0f - FX) * (1.0f - FY) * (1.0f / 255.0f);
+   const float W10 = FX * (1.0f - FY) * (1.0f / 255.0f);
+   const float W01 = (1.0f - FX) * FY * (1.0f / 255.0f);
+   const float W11 = FX * FY * (1.0f / 255.0f);
+
+   for (uint C = 0; C < 3; C++)
+      {
+      RGB[C] = W00 * (float)P00[C] + W10 * (float)P10[C] + W01 * (float)P01[C] + W11 * (float)P11[C];
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+FilterLinesCPU::FilterLinesCPU(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+FilterLinesCPU::~FilterLinesCPU(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void FilterLinesCPU::Clear(void)
+   {
+   FilterCPU::Clear();
+
+   Select = Filter::SelectDepth;
+   EnableVideo = false;
+   EnableDepth = true;
+
+   BlurRes = 0;
+   Scale = 1.0f;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void FilterLinesCPU::Destroy(void)
+   {
+   FilterCPU::Destroy();
+
+   Lines.Destroy();
+   Blur.Destroy();
+   Depths.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Class specific setup function for the effects assets. The mipmap levels
+   of the line texture are built with a 2x2 box filter, like
+   glGenerateMipmap( ).
+  ---------------------------------------------------------------------------*/
+void FilterLinesCPU::Assets(Buffers &Buffer)
+   {
+   if (!Ready()) {return;}
+
+   vector2u Res = Buffer.GetDepthResolution();
+   Depth.Create(Res, Buffer.GetDepthDataType());
+   Depth.ClearData();
+
+   Scale = (float)Res.V / 12.0f;
+
+   //Each pair of lines owns two rows, so the bands never share a row
+   Depths.Create(Res.U * (Res.V + 1));
+
+   Texture Image;
+   AssetCache::LoadPNG(Image, File::Path::Texture(File::TextureLines));
+
+   const usize BytesPerPixel = Image.GetBytesPerPixel();
+   if (BytesPerPixel < 3 || Image.Size() < 1) {throw dexception("Line texture has no RGB data.");}
+
+   Texture Level;
+   vector2u LevelRes = Image.Resolution();
+   Level.Create(LevelRes, Texture::TypeRGB);
+
+   for (uiter V = 0; V < LevelRes.V; V++)
+      {
+      for (uiter U = 0; U < LevelRes.U; U++)
+         {
+         const uint8* Src = Image.Address(U, V);
+         uint8* Dst = Level.Address(U, V);
+         Dst[0] = Src[0];
+         Dst[1] = Src[1];
+         Dst[2] = Src[2];
+         }
+      }
+
+   Lines += Level;
+
+   while (LevelRes.U > 1 || LevelRes.V > 1)
+      {
+      const Texture &Prev = Lines[Lines.Size() - 1];
+      const vector2u PrevRes = LevelRes;
+
+      LevelRes = LevelRes.Max(2) / 2;
+      Level.Create(LevelRes, Texture::TypeRGB);
+
+      for (uiter V = 0; V < LevelRes.V; V++)
+         {
+         const uiter V0 = Math::Min(V * 2, (uiter)PrevRes.V - 1);
+         const uiter V1 = Math::Min(V * 2 + 1, (uiter)PrevRes.V - 1);
+
+         for (uiter U = 0; U < LevelRes.U; U++)
+            {
+            const uiter U0 = Math::Min(U * 2, (uiter)PrevRes.U - 1);
+            const uiter U1 = Math::Min(U * 2 + 1, (uiter)PrevRes.U - 1);
+
+            const uint8* P00 = Prev.Address(U0, V0);
+            const uint8* P10 = Prev.Address(U1, V0);
+            const uint8* P01 = Prev.Address(U0, V1);
+            const uint8* P11 = Prev.Address(U1, V1);
+            uint8* Dst = Level.Address(U, V);
+
+            for (uint C = 0; C < 3; C++) {Dst[C] = (uint8)((P00[C] + P10[C] + P01[C] + P11[C] + 2) >> 2);}
+            }
+         }
+
+      Lines += Level;
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Bilinear sample of the first depth mipmap level, clamped to the edges.
+   Returns the normalised depth.
+  ---------------------------------------------------------------------------*/
+float FilterLinesCPU::Sample(float S, float T) const
+   {
+   const float* Data = Blur.Pointer();
+
+   float X = Math::Clamp(S * (float)BlurRes.U - 0.5f, 0.0f, (float)(BlurRes.U - 1));
+   float Y = Math::Clamp(T * (float)BlurRes.V - 0.5f, 0.0f, (float)(BlurRes.V - 1));
+
+   uiter U0 = (uiter)X;
+   uiter V0 = (uiter)Y;
+   uiter U1 = Math::Min(U0 + 1, (uiter)BlurRes.U - 1);
+   uiter V1 = Math::Min(V0 + 1, (uiter)BlurRes.V - 1);
+   float FX = X - (float)U0;
+   float FY = Y - (float)V0;
+
+   const float* R0 = Data + V0 * BlurRes.U;
+   const float* R1 = Data + V1 * BlurRes.U;
+
+   float A = R0[U0] + (R0[U1] - R0[U0]) * FX;
+   float B = R1[U0] + (R1[U1] - R1[U0]) * FX;
+
+   return A + (B - A) * FY;
+   }
+
+/*---------------------------------------------------------------------------
+   Trilinear sample of the line texture.
+
+   S, T   : Texture coordinates, repeated outside of 0..1.
+   Lambda : Level of detail. Magnified samples come from the base level.
+   RGB    : Receives the normalised colour.
+  ---------------------------------------------------------------------------*/
+void FilterLinesCPU::Sample(float S, float T, float Lambda, float* RGB) const
+   {
+   const Texture* Levels = Lines.Pointer();
+   const usize Count = Lines.Size();
+
+   Lambda = Math::Clamp(Lambda, 0.0f, (float)(Count - 1));
+
+   uiter L0 = (uiter)Lambda;
+   uiter L1 = Math::Min(L0 + 1, Count - 1);
+   float F = Lambda - (float)L0;
+
+   FilterLinesBilinear(Levels[L0], S, T, RGB);
+   if (F <= 0.0f || L1 == L0) {return;}
+
+   float Next[3];
+   FilterLinesBilinear(Levels[L1], S, T, Next);
+
+   for (uint C = 0; C < 3; C++) {RGB[C] += (Next[C] - RGB[C]) * F;}
+   }
+
+/*---------------------------------------------------------------------------
+   Builds the first mipmap level of the depth, then renders the frame.
+  ---------------------------------------------------------------------------*/
+void FilterLinesCPU::Render(void)
+   {
+   if (!Ready() || Lines.Size() < 1) {return;}
+
+   BlurRes = Reduce(Blur);
+
+   FilterCPU::Render();
+   }
+
+/*---------------------------------------------------------------------------
+   Renders a band of scanlines, following filter_lines.frag. The band is
+   processed in pairs of lines, and the level of detail of the line texture
+   is derived from the differences of the scaled coordinates across each
+   2x2 pixel block.
+  ---------------------------------------------------------------------------*/
+void FilterLinesCPU::Shade(uiter Start, uiter End)
+   {
+   const vector2u Res = Output.Resolution();
+   const vector2u LinesRes = Lines[0].Resolution();
+
+   const float LumR = 0.2990f;
+   const float LumG = 0.5870f;
+   const float LumB = 0.1140f;
+   const float ZMax = 1.0f - 1.0f / 65535.0f;
+   const float InvLn2 = 1.0f / logf(2.0f);
+   const float DS = 1.0f / (float)Res.U;
+   const float DT = 1.0f / (float)Res.V;
+
+   for (uiter V0 = Start; V0 < End; V0 += 2)
+      {
+      const uiter Rows[2] = {V0, Math::Min(V0 + 1, (uiter)Res.V - 1)};
+      float* Pair = Depths.Pointer() + V0 * Res.U;
+
+      //Depth of both lines of the 2x2 blocks
+      for (uiter R = 0; R < 2; R++)
+         {
+         float* Z = Pair + R * Res.U;
+         const float T = ((float)Rows[R] + 0.5f) * DT;
+
+         for (uiter U = 0; U < Res.U; U++) {Z[U] = Sample(((float)U + 0.5f) * DS, T) * (LumR + LumG + LumB);}
+         }
+
+      const float* Z0 = Pair;
+      const float* Z1 = Pair + Res.U;
+      const float TA = ((float)Rows[0] + 0.5f) * DT;
+      const float TB = ((float)Rows[1] + 0.5f) * DT;
+
+      for (uiter R = 0; R < 2 && V0 + R < End; R++)
+         {
+         const float* ZRow = Pair + R * Res.U;
+         const float T = ((float)(V0 + R) + 0.5f) * DT;
+         uint8* Dst = Output.Address(0, V0 + R);
+
+         for (uiter U = 0; U < Res.U; U++, Dst += 3)
+            {
+            const float Z = ZRow[U];
+            if (Z > ZMax) {Dst[0] = 255; Dst[1] = 255; Dst[2] = 255; continue;}
+
+            //Scale the line texture sampler
+            const float S = ((float)U + 0.5f) * DS;
+            const float K = Scale * Z + Scale;
+
+            //Level of detail, from the texel footprint of the 2x2 block
+            const uiter UA = U & ~(uiter)1;
+            const uiter UB = Math::Min(UA + 1, (uiter)Res.U - 1);
+            const float SA = ((float)UA + 0.5f) * DS;
+            const float SB = ((float)UB + 0.5f) * DS;
+            const float KA = Scale * Z0[UA] + Scale;
+            const float KB = Scale * Z0[UB] + Scale;
+            const float KC = Scale * Z1[UA] + Scale;
+
+            const float DXS = (SB * KB - SA * KA) * (float)LinesRes.U;
+            const float DXT = (TA * KB - TA * KA) * (float)LinesRes.V;
+            const float DYS = (SA * KC - SA * KA) * (float)LinesRes.U;
+            const float DYT = (TB * KC - TA * KA) * (float)LinesRes.V;
+            const float Rho = Math::Max(DXS * DXS + DXT * DXT, DYS * DYS + DYT * DYT);
+            const float Lambda = (Rho > 0.0f) ? 0.5f * logf(Rho) * InvLn2 : 0.0f;
+
+            //Over sample line texture
+            const float CS[3] = {(S - DS) * K, S * K, (S + DS) * K};
+            const float CT[3] = {(T - DT) * K, T * K, (T + DT) * K};
+            float Texel[3] = {0.0f, 0.0f, 0.0f};
+            float RGB[3];
+
+            for (uint J = 0; J < 3; J++)
+               {
+               for (uint I = 0; I < 3; I++)
+                  {
+                  Sample(CS[I], CT[J], Lambda, RGB);
+                  Texel[0] += RGB[0];
+                  Texel[1] += RGB[1];
+                  Texel[2] += RGB[2];
+                  }
+               }
+
+            Texel[0] *= 1.0f / 9.0f;
+            Texel[1] *= 1.0f / 9.0f;
+            Texel[2] *= 1.0f / 9.0f;
+
+            //Sharpen if luminance is above threshold
+            if (Texel[0] * LumR + Texel[1] * LumG + Texel[2] * LumB > 0.25f)
+               {
+               Sample(CS[1], CT[1], Lambda + 1.0f, RGB);
+               Texel[0] += RGB[0];
+               Texel[1] += RGB[1];
+               Texel[2] += RGB[2];
+               }
+
+            //Dodge filter
+            const float Dodge = 1.0f / (1.0f - Z);
+            Dst[0] = (uint8)(Math::Clamp(Texel[0] * Dodge, 0.0f, 1.0f) * 255.0f + 0.5f);
+            Dst[1] = (uint8)(Math::Clamp(Texel[1] * Dodge, 0.0f, 1.0f) * 255.0f + 0.5f);
+            Dst[2] = (uint8)(Math::Clamp(Texel[2] * Dodge, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+         }
+      }
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
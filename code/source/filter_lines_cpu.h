@@ -0,0 +1,73 @@
+/*===========================================================================
+   Line Effects Filter Class, Software Renderer
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_LINES_CPU_H___
+#define ___FILTER_LINES_CPU_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "filter_cpu.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Renders the same output as FilterLines on the CPU. The texture sampling of
+  the line shader is reproduced: the depth is read from its first mipmap
+  level, and the line texture is sampled with trilinear filtering from a
+  mipmap chain, with the level of detail taken from the differences across
+  2x2 pixel blocks, the way a GPU does.
+  ---------------------------------------------------------------------------*/
+class FilterLinesCPU : public FilterCPU
+   {
+   //---- Member data ----
+   private:
+
+   Array<Texture> Lines;                           //Mipmap levels of the line texture
+   Array<float, 256> Blur;                         //First mipmap level of the depth texture, normalised
+   vector2u BlurRes;                               //Resolution of the first mipmap level
+   Array<float, 256> Depths;                       //Depth of each scanline, with a spare line for odd heights
+   float Scale;                                    //Scale factor for the line texture sampler
+
+   //---- Methods ----
+   public:
+
+   FilterLinesCPU(void);
+   ~FilterLinesCPU(void);
+
+   private:
+
+   FilterLinesCPU(const FilterLinesCPU &obj);      //Disable
+   FilterLinesCPU &operator = (const FilterLinesCPU &obj); //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+   void Assets(Buffers &Buffer);
+
+   //Rendering
+   float Sample(float S, float T) const;
+   void Sample(float S, float T, float Lambda, float* RGB) const;
+   void Shade(uiter Start, uiter End);
+
+   public:
+
+   //Rendering
+   void Render(void);
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
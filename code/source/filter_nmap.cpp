@@ -68,15 +68,15 @@ void FilterNMap::Assets(Buffers &Buffer)
 
    Depth.Create(Buffer.GetDepthResolution(), Buffer.GetDepthDataType());
    Depth.ClearData();
+   Depth.SetMipLevels(1); //Sampled with a LOD bias of 0.5
    Depth.Buffer(false);
 
    Model.Plane(1, Mesh::ModeSolid);
    Model.Buffer(false);
 
-   File::Text Text;
    std::string CodeVert, CodeFrag;
-   Text.Load(CodeVert, File::Path::Shader(File::FilterNMapVert));
-   Text.Load(CodeFrag, File::Path::Shader(File::FilterNMapFrag));
+   AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterNMapVert));
+   AssetCache::LoadText(CodeFrag, File::Path::Shader(File::FilterNMapFrag));
    Program.Attach(CodeVert, Shader::ShaderVert);
    Program.Attach(CodeFrag, Shader::ShaderFrag);
    Program.Buffer(false);
@@ -0,0 +1,356 @@
+/*===========================================================================
+   Normal Map Filter Class, Software Renderer
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_NMAP_CPU_CPP___
+#define ___FILTER_NMAP_CPU_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "filter_nmap_cpu.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+FilterNMapCPU::FilterNMapCPU(void)
+   {
+   Clear();
+   EnableNormals = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+FilterNMapCPU::~FilterNMapCPU(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void FilterNMapCPU::Clear(void)
+   {
+   FilterCPU::Clear();
+
+   Select = Filter::SelectDepth;
+   EnableVideo = false;
+   EnableDepth = true;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void FilterNMapCPU::Destroy(void)
+   {
+   FilterCPU::Destroy();
+
+   Level.Destroy();
+   Resampled.Destroy();
+   Blur.Destroy();
+   Columns.Destroy();
+   Rows.Destroy();
+   Normals.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Class specific setup function for the effects assets.
+  ---------------------------------------------------------------------------*/
+void FilterNMapCPU::Assets(Buffers &Buffer)
+   {
+   if (!Ready()) {return;}
+
+   vector2u Res = Buffer.GetDepthResolution();
+   Depth.Create(Res, Buffer.GetDepthDataType());
+   Depth.ClearData();
+
+   Blur.Create((Res.U + 2) * (Res.V + 2));
+   if (EnableNormals) {Normals.Create(Res.U * Res.V * 3);}
+   }
+
+/*---------------------------------------------------------------------------
+   Keeps a copy of the unit normals in addition to the RGB output. Takes
+   effect on the next call to Setup( ).
+  ---------------------------------------------------------------------------*/
+void FilterNMapCPU::SetNormals(bool Enable)
+   {
+   EnableNormals = Enable;
+   }
+
+/*---------------------------------------------------------------------------
+   Copies the unit normals of the last rendered frame. Returns false if the
+   normals are not kept, see SetNormals( ).
+
+   Target : Receives the normals, 3 floats per pixel. The rows are ordered
+            the same way as the output frame.
+  ---------------------------------------------------------------------------*/
+bool FilterNMapCPU::GetNormals(Array<float, 256> &Target) const
+   {
+   if (Normals.Size() < 1) {return false;}
+
+   Target = Normals;
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Computes the taps that resample a mipmap level linearly to the full
+   resolution, at the texel centres of the base level, clamped to the edges.
+
+   Target    : Receives the taps.
+   Size      : Number of texels at the base level.
+   LevelSize : Number of texels at the mipmap level.
+  ---------------------------------------------------------------------------*/
+void FilterNMapCPU::Taps(Array<Tap> &Target, usize Size, usize LevelSize)
+   {
+   Target.Destroy();
+   Target.Create(Size);
+
+   const float Ratio = (float)LevelSize / (float)Size;
+
+   for (uiter I = 0; I < Size; I++)
+      {
+      float X = ((float)I + 0.5f) * Ratio - 0.5f;
+      float X0 = floorf(X);
+      int I0 = (int)X0;
+
+      Tap &T = Target[I];
+      T.I0 = (uiter)Math::Clamp(I0, 0, (int)LevelSize - 1);
+      T.I1 = (uiter)Math::Clamp(I0 + 1, 0, (int)LevelSize - 1);
+      T.F = X - X0;
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Blends the base level of the depth with the first mipmap level, and
+   stores the result with a border replicating the edge texels.
+  ---------------------------------------------------------------------------*/
+void FilterNMapCPU::Resample(const vector2u &LevelRes)
+   {
+   const vector2u Res = Depth.Resolution();
+   const usize Pitch = Res.U + 2;
+   const float Norm = 0.5f / 65535.0f;
+
+   if (Columns.Size() != Res.U || Rows.Size() != Res.V)
+      {
+      Taps(Columns, Res.U, LevelRes.U);
+      Taps(Rows, Res.V, LevelRes.V);
+      Resampled.Destroy();
+      Resampled.Create(Res.U * LevelRes.V);
+      }
+
+   const Tap* C = Columns.Pointer();
+   const Tap* R = Rows.Pointer();
+
+   //Mipmap level, horizontally
+   for (uiter V = 0; V < LevelRes.V; V++)
+      {
+      const float* Src = Level.Pointer() + V * LevelRes.U;
+      float* Dst = Resampled.Pointer() + V * Res.U;
+
+      for (uiter U = 0; U < Res.U; U++) {Dst[U] = Src[C[U].I0] + (Src[C[U].I1] - Src[C[U].I0]) * C[U].F;}
+      }
+
+   //Mipmap level vertically, blended with the base level
+   for (uiter V = 0; V < Res.V; V++)
+      {
+      const float* Src0 = Resampled.Pointer() + R[V].I0 * Res.U;
+      const float* Src1 = Resampled.Pointer() + R[V].I1 * Res.U;
+      const uint16* Base = Depth.Address16(0, V);
+      const float F = R[V].F;
+      float* Dst = Blur.Pointer() + (V + 1) * Pitch + 1;
+
+      for (uiter U = 0; U < Res.U; U++) {Dst[U] = (float)Base[U] * Norm + 0.5f * (Src0[U] + (Src1[U] - Src0[U]) * F);}
+
+      Dst[-1] = Dst[0];
+      Dst[Res.U] = Dst[Res.U - 1];
+      }
+
+   memcpy(Blur.Pointer(), Blur.Pointer() + Pitch, Pitch * sizeof(float));
+   memcpy(Blur.Pointer() + (Res.V + 1) * Pitch, Blur.Pointer() + Res.V * Pitch, Pitch * sizeof(float));
+   }
+
+/*---------------------------------------------------------------------------
+   Builds the blended depth, then renders the frame.
+  ---------------------------------------------------------------------------*/
+void FilterNMapCPU::Render(void)
+   {
+   if (!Ready() || Blur.Size() < 1) {return;}
+
+   Resample(Reduce(Level));
+
+   FilterCPU::Render();
+   }
+
+/*---------------------------------------------------------------------------
+   Renders a band of scanlines, following filter_nmap.frag. The depth
+   texture is luminance, so the luminance weights of the shader sum to 1,
+   and the kernel reduces to the plain Scharr weights of 3 and 10. The
+   inner loop has no branches or edge tests, so the compiler can vectorise
+   it.
+  ---------------------------------------------------------------------------*/
+void FilterNMapCPU::Shade(uiter Start, uiter End)
+   {
+   const vector2u Res = Output.Resolution();
+   const usize Pitch = Res.U + 2;
+   const float DepthLum = 0.355556f;
+
+   for (uiter V = Start; V < End; V++)
+      {
+      //Rows V - 1, V, and V + 1 of the depth, starting at the left border
+      const float* A = Blur.Pointer() + V * Pitch;
+      const float* B = A + Pitch;
+      const float* C = B + Pitch;
+
+      uint8* Dst = Output.Address(0, V);
+      float* Normal = (Normals.Size() > 0) ? Normals.Pointer() + V * Res.U * 3 : nullptr;
+
+      for (uiter U = 0; U < Res.U; U++)
+         {
+         const float NX = 3.0f * (A[U + 2] - A[U]) + 10.0f * (B[U + 2] - B[U]) + 3.0f * (C[U + 2] - C[U]);
+         const float NY = 3.0f * (A[U] - C[U]) + 10.0f * (A[U + 1] - C[U + 1]) + 3.0f * (A[U + 2] - C[U + 2]);
+         const float NZ = B[U + 1] * DepthLum;
+
+         //A flat surface at zero depth has no normal, and is left grey
+         const float Length = NX * NX + NY * NY + NZ * NZ;
+         const float Inv = (Length > 0.0f) ? 1.0f / sqrtf(Length) : 0.0f;
+
+         const float X = NX * Inv;
+         const float Y = NY * Inv;
+         const float Z = NZ * Inv;
+
+         Dst[U * 3 + 0] = (uint8)((0.5f + X * 0.5f) * 255.0f + 0.5f);
+         Dst[U * 3 + 1] = (uint8)((0.5f + Y * 0.5f) * 255.0f + 0.5f);
+         Dst[U * 3 + 2] = (uint8)((0.5f + Z * 0.5f) * 255.0f + 0.5f);
+
+         if (Normal != nullptr)
+            {
+            Normal[U * 3 + 0] = X;
+            Normal[U * 3 + 1] = Y;
+            Normal[U * 3 + 2] = Z;
+            }
+         }
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Returns a texel of the first mipmap level of the depth, normalised, built
+   with a 2x2 box filter. The coordinates are clamped to the level.
+  ---------------------------------------------------------------------------*/
+float FilterNMapCPU::Texel(int U, int V) const
+   {
+   const vector2u Res = Depth.Resolution();
+   const vector2u LevelRes = Res.Max(2) / 2;
+
+   U = Math::Clamp(U, 0, (int)LevelRes.U - 1);
+   V = Math::Clamp(V, 0, (int)LevelRes.V - 1);
+
+   const uiter U0 = Math::Min((uiter)U * 2, (uiter)Res.U - 1);
+   const uiter U1 = Math::Min((uiter)U * 2 + 1, (uiter)Res.U - 1);
+   const uiter V0 = Math::Min((uiter)V * 2, (uiter)Res.V - 1);
+   const uiter V1 = Math::Min((uiter)V * 2 + 1, (uiter)Res.V - 1);
+
+   uint Sum = (uint)*Depth.Address16(U0, V0) + (uint)*Depth.Address16(U1, V0) + (uint)*Depth.Address16(U0, V1) + (uint)*Depth.Address16(U1, V1);
+
+   return (float)Sum / (4.0f * 65535.0f);
+   }
+
+/*---------------------------------------------------------------------------
+   Samples the depth the way the shader does with a LOD bias of 0.5, at the
+   centre of a base level texel. The coordinates are clamped to the edges.
+  ---------------------------------------------------------------------------*/
+float FilterNMapCPU::Sample(int U, int V) const
+   {
+   const vector2u Res = Depth.Resolution();
+   const vector2u LevelRes = Res.Max(2) / 2;
+
+   U = Math::Clamp(U, 0, (int)Res.U - 1);
+   V = Math::Clamp(V, 0, (int)Res.V - 1);
+
+   //Linear sample of the first mipmap level
+   float X = ((float)U + 0.5f) * ((float)LevelRes.U / (float)Res.U) - 0.5f;
+   float Y = ((float)V + 0.5f) * ((float)LevelRes.V / (float)Res.V) - 0.5f;
+   int X0 = (int)floorf(X);
+   int Y0 = (int)floorf(Y);
+   float FU = X - (float)X0;
+   float FV = Y - (float)Y0;
+
+   float T0 = Texel(X0, Y0) + (Texel(X0 + 1, Y0) - Texel(X0, Y0)) * FU;
+   float T1 = Texel(X0, Y0 + 1) + (Texel(X0 + 1, Y0 + 1) - Texel(X0, Y0 + 1)) * FU;
+   float Mip = T0 + (T1 - T0) * FV;
+
+   //Blended evenly with the base level
+   float Base = (float)*Depth.Address16((uiter)U, (uiter)V) / 65535.0f;
+
+   return 0.5f * Base + 0.5f * Mip;
+   }
+
+/*---------------------------------------------------------------------------
+   Renders the last depth frame with a scalar loop, following
+   filter_nmap.frag tap by tap, see Filter::Reference( ). It is slow, and
+   only meant for checking Render( ). Returns false if the filter has no
+   output yet.
+
+   Frame : Receives the reference frame as RGB.
+  ---------------------------------------------------------------------------*/
+bool FilterNMapCPU::Reference(Texture &Frame)
+   {
+   if (!Ready()) {return false;}
+
+   const vector2u Res = Output.Resolution();
+   const vector2u FrameRes = Frame.Resolution();
+
+   if (FrameRes.U != Res.U || FrameRes.V != Res.V || Frame.DataType() != Texture::TypeRGB)
+      {
+      Frame.Create(Res, Texture::TypeRGB);
+      }
+
+   for (int V = 0; V < (int)Res.V; V++)
+      {
+      uint8* Dst = Frame.Address(0, (uiter)V);
+
+      for (int U = 0; U < (int)Res.U; U++, Dst += 3)
+         {
+         float NX = 3.0f * (Sample(U + 1, V - 1) - Sample(U - 1, V - 1));
+         NX += 10.0f * (Sample(U + 1, V) - Sample(U - 1, V));
+         NX += 3.0f * (Sample(U + 1, V + 1) - Sample(U - 1, V + 1));
+
+         float NY = 3.0f * (Sample(U - 1, V - 1) - Sample(U - 1, V + 1));
+         NY += 10.0f * (Sample(U, V - 1) - Sample(U, V + 1));
+         NY += 3.0f * (Sample(U + 1, V - 1) - Sample(U + 1, V + 1));
+
+         float NZ = Sample(U, V) * 0.355556f;
+
+         float Length = sqrtf(NX * NX + NY * NY + NZ * NZ);
+         if (Length > 0.0f) {NX /= Length; NY /= Length; NZ /= Length;}
+
+         Dst[0] = (uint8)((0.5f + NX * 0.5f) * 255.0f + 0.5f);
+         Dst[1] = (uint8)((0.5f + NY * 0.5f) * 255.0f + 0.5f);
+         Dst[2] = (uint8)((0.5f + NZ * 0.5f) * 255.0f + 0.5f);
+         }
+      }
+
+   return true;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
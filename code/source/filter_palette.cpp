@@ -47,6 +47,9 @@ void FilterPalette::Clear(void)
    Select = Filter::SelectDepth;
    EnableVideo = false;
    EnableDepth = true;
+
+   Mapped = 0;
+   Quantised = false;
    }
 
 /*---------------------------------------------------------------------------
@@ -57,7 +60,12 @@ void FilterPalette::Destroy(void)
    {
    Filter::Destroy();
 
+   AssetCache::Release(Palette);
    Palette.Destroy();
+   Colours.Destroy();
+   Scratch.Destroy();
+   Keys.Destroy();
+   Values.Destroy();
 
    Clear();
    }
@@ -71,21 +79,35 @@ void FilterPalette::Assets(Buffers &Buffer)
 
    Depth.Create(Buffer.GetDepthResolution(), Buffer.GetDepthDataType());
    Depth.ClearData();
+   Depth.SetMipLevels(0); //Drawn at its own size
    Depth.Buffer(false);
 
    Model.Plane(1, Mesh::ModeSolid);
    Model.Buffer(false);
 
-   File::PNG PNG;
-   PNG.Load(Palette, File::Path::Shader(File::TexturePalette));
+   AssetCache::LoadPNG(Palette, File::Path::Shader(File::TexturePalette));
    Palette.SetMinFilter(Texture::MinNearest); //Disable filtering for palette texture in order to prevent bleeding into adjacent tables
    Palette.SetMagFilter(Texture::MagNearest);
-   Palette.Buffer(false);
 
-   File::Text Text;
+   //Keep a copy of the palette steps sampled by the shader, for indexed capture
+   if (Steps(Colours, Palette, Type))
+      {
+      Keys.Create(FilterPalette::MapSize);
+      Values.Create(FilterPalette::MapSize);
+      memset(Keys.Pointer(), 0, Keys.Size() * sizeof(uint32));
+
+      for (uint I = 0; I < FilterPalette::Entries; I++)
+         {
+         const uint8* Src = Colours.Address(I, 0);
+         Insert(((uint32)Src[0] << 16) | ((uint32)Src[1] << 8) | (uint32)Src[2], (uint8)I);
+         }
+      }
+
+   AssetCache::Acquire(Palette, File::Path::Shader(File::TexturePalette));
+
    std::string CodeVert, CodeFrag;
-   Text.Load(CodeVert, File::Path::Shader(File::FilterPaletteVert));
-   Text.Load(CodeFrag, File::Path::Shader(File::FilterPaletteFrag));
+   AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterPaletteVert));
+   AssetCache::LoadText(CodeFrag, File::Path::Shader(File::FilterPaletteFrag));
    Program.Attach(CodeVert, Shader::ShaderVert);
    Program.Attach(CodeFrag, Shader::ShaderFrag);
    Program.Buffer(false);
@@ -96,14 +118,48 @@ void FilterPalette::Assets(Buffers &Buffer)
 
    Program.Bind();
    glUniform1f(glGetUniformLocation(Program.ID(), "Select"), Select); 
+   glUniform1f(glGetUniformLocation(Program.ID(), "Steps"), 0.0f); 
    glUniform1i(glGetUniformLocation(Program.ID(), "Texture"), 0);   //Texture unit 0
    glUniform1i(glGetUniformLocation(Program.ID(), "Palette"), 1);   //Texture unit 1
    Program.Unbind();
 
+   Quantised = false;
+
    GLenum Error = glGetError();
    if (Error != GL_NO_ERROR) {throw dexception("OpenGL generated an error: %s", Debug::ErrorGL(Error));}
    }
 
+/*---------------------------------------------------------------------------
+   Picks the palette steps from one of the tables in the palette texture, the
+   same way the shader samples them. Returns false if the palette texture
+   holds no RGB data, in which case Colours is left unchanged.
+
+   Colours : Receives the palette steps, an RGB texture of Entries x 1.
+   Palette : Palette texture, one table per row.
+   Type    : Selects the table.
+  ---------------------------------------------------------------------------*/
+bool FilterPalette::Steps(Texture &Colours, const Texture &Palette, PaletteType Type)
+   {
+   vector2u Res = Palette.Resolution();
+   if (Res.U < 1 || Res.V < 1 || Palette.GetBytesPerPixel() < 3 || Palette.Size() < 1) {return false;}
+
+   Colours.Create(vector2u(FilterPalette::Entries, 1), Texture::TypeRGB);
+
+   uint Row = Math::Min((uint)Type, Res.V - 1);
+
+   for (uint I = 0; I < FilterPalette::Entries; I++)
+      {
+      uint Column = Math::Min((uint)(((float)I + 0.5f) * (float)Res.U / (float)FilterPalette::Entries), Res.U - 1);
+      const uint8* Src = Palette.Address(Column, Row);
+      uint8* Dst = Colours.Address(I, 0);
+      Dst[0] = Src[0];
+      Dst[1] = Src[1];
+      Dst[2] = Src[2];
+      }
+
+   return true;
+   }
+
 /*---------------------------------------------------------------------------
    Renders the filter effect. Assumes the Bind( ) method was called prior.
   ---------------------------------------------------------------------------*/
@@ -117,6 +173,14 @@ void FilterPalette::Render(void)
    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
    Program.Bind();
+
+   //The lookup is only quantised while frames are captured as palette indices
+   if (Quantised != Indexed)
+      {
+      glUniform1f(glGetUniformLocation(Program.ID(), "Steps"), Indexed ? (float)FilterPalette::Entries : 0.0f);
+      Quantised = Indexed;
+      }
+
    Model.Bind(2);
    Depth.Bind(0);
    Palette.Bind(1);
@@ -135,6 +199,117 @@ void FilterPalette::Render(void)
    }
 
 
+/*---------------------------------------------------------------------------
+   Adds a colour to the colour to index hash table, unless it is already
+   present, or the table is half full.
+  ---------------------------------------------------------------------------*/
+void FilterPalette::Insert(uint32 Colour, uint8 Value)
+   {
+   if (Mapped >= FilterPalette::MapSize / 2) {return;}
+
+   uint32 Key = Colour + 1;
+   uiter I = (uiter)((Colour * 2654435761u) >> 16) & (FilterPalette::MapSize - 1);
+
+   while (Keys[I] != 0)
+      {
+      if (Keys[I] == Key) {return;}
+      I = (I + 1) & (FilterPalette::MapSize - 1);
+      }
+
+   Keys[I] = Key;
+   Values[I] = Value;
+   Mapped++;
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the palette index of a packed RGB colour. Colours that are not in
+   the palette, such as the clear colour, are mapped to the nearest entry,
+   and added to the table to speed up subsequent lookups.
+  ---------------------------------------------------------------------------*/
+uint8 FilterPalette::Index(uint32 Colour)
+   {
+   uint32 Key = Colour + 1;
+   uiter I = (uiter)((Colour * 2654435761u) >> 16) & (FilterPalette::MapSize - 1);
+
+   while (Keys[I] != 0)
+      {
+      if (Keys[I] == Key) {return Values[I];}
+      I = (I + 1) & (FilterPalette::MapSize - 1);
+      }
+
+   int R = (int)((Colour >> 16) & 0xFF);
+   int G = (int)((Colour >> 8) & 0xFF);
+   int B = (int)(Colour & 0xFF);
+
+   uint8 Best = 0;
+   int BestDist = 0x7FFFFFFF;
+
+   for (uint J = 0; J < FilterPalette::Entries; J++)
+      {
+      const uint8* Ptr = Colours.Address(J, 0);
+      int DR = R - (int)Ptr[0];
+      int DG = G - (int)Ptr[1];
+      int DB = B - (int)Ptr[2];
+      int Dist = DR * DR + DG * DG + DB * DB;
+      if (Dist < BestDist) {BestDist = Dist; Best = (uint8)J;}
+      }
+
+   Insert(Colour, Best);
+
+   return Best;
+   }
+
+/*---------------------------------------------------------------------------
+   Captures the frame as 8-bit palette indices, and stores the palette steps
+   in ColourMap, see Filter::Capture( ). While SetIndexed( ) is on, the 
+   shader quantises the lookup to the palette steps, so the indexed frame 
+   is lossless, and takes a third of the space of an RGB frame.
+  ---------------------------------------------------------------------------*/
+bool FilterPalette::Capture(Texture &Frame, Texture &ColourMap, bool Wait)
+   {
+   if (Colours.Size() < 1) {return Filter::Capture(Frame, ColourMap, Wait);}
+   if (!Ready()) {return false;}
+
+   MutexControl Mutex(Frame.GetMutexHandle());
+   if (!Wait && !Mutex.LockRequest()) {return false;}
+   else {Mutex.Lock();}
+
+   Read(Scratch);
+
+   vector2u Res = Frame.Resolution();
+   vector2u ScratchRes = Scratch.Resolution();
+   if (Res.U != ScratchRes.U || Res.V != ScratchRes.V || Frame.DataType() != Texture::TypeLum)
+      {
+      Frame.Create(ScratchRes, Texture::TypeLum);
+      }
+
+   const uint8* Src = Scratch.Pointer();
+   const uint8* End = Src + Scratch.Size();
+   uint8* Dst = Frame.Pointer();
+
+   //Neighbouring pixels are often the same colour, so remember the last lookup
+   uint32 Last = 0xFFFFFFFF;
+   uint8 Value = 0;
+
+   while (Src < End)
+      {
+      uint32 Colour = ((uint32)Src[0] << 16) | ((uint32)Src[1] << 8) | (uint32)Src[2];
+      if (Colour != Last) {Value = Index(Colour); Last = Colour;}
+      *Dst++ = Value;
+      Src += 3;
+      }
+
+   if (ColourMap.Size() != Colours.Size() || ColourMap.DataType() != Texture::TypeRGB)
+      {
+      ColourMap.Create(Colours.Resolution(), Texture::TypeRGB);
+      }
+
+   memcpy(ColourMap.Pointer(), Colours.Pointer(), Colours.Size());
+
+   return true;
+   }
+
+
 //Close namespaces
 NAMESPACE_END(NAMESPACE_PROJECT)
 
@@ -34,11 +34,20 @@ class FilterPalette : public Filter
       Saturate = 3                                 //Red-yellow-green gradient with sautration markers
       };
 
+   static const uint Entries = 256;                //Number of palette steps, so each output colour has a capture index
+   static const usize MapSize = 1024;              //Size of the colour to index hash table, must be a power of two
+
    //---- Member data ----
    private:
 
    PaletteType Type;                               //Controls the palette type
    Texture Palette;                                //Actual texture palette
+   Texture Colours;                                //Palette steps used by the shader, stored with indexed captures
+   Texture Scratch;                                //RGB frame read back for indexed capture
+   Array<uint32, 256> Keys;                        //Colour to index hash table, 0 marks an empty slot
+   Array<uint8, 256> Values;                       //Palette index for each hash table slot
+   usize Mapped;                                   //Number of used hash table slots
+   bool Quantised;                                 //The shader snaps the lookup to the palette steps
 
    //---- Methods ----
    public:
@@ -56,10 +65,18 @@ class FilterPalette : public Filter
    void Destroy(void);
    void Assets(Buffers &Buffer);
 
+   //Indexed capture
+   void Insert(uint32 Colour, uint8 Value);
+   uint8 Index(uint32 Colour);
+
    public:
 
    //Rendering
    void Render(void);
+   bool Capture(Texture &Frame, Texture &ColourMap, bool Wait);
+
+   //Palette data
+   static bool Steps(Texture &Colours, const Texture &Palette, PaletteType Type);
    };
 
 
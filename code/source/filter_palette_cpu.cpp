@@ -0,0 +1,169 @@
+/*===========================================================================
+   Depth Filter Class With Palette, Software Renderer
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_PALETTE_CPU_CPP___
+#define ___FILTER_PALETTE_CPU_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "filter_palette_cpu.h"
+#include "math.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+FilterPaletteCPU::FilterPaletteCPU(FilterPalette::PaletteType Type)
+   {
+   Clear();
+   FilterPaletteCPU::Type = Type;
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+FilterPaletteCPU::~FilterPaletteCPU(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void FilterPaletteCPU::Clear(void)
+   {
+   FilterCPU::Clear();
+
+   Select = Filter::SelectDepth;
+   EnableVideo = false;
+   EnableDepth = true;
+
+   TableID = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void FilterPaletteCPU::Destroy(void)
+   {
+   FilterCPU::Destroy();
+
+   Colours.Destroy();
+   DepthTable.Destroy();
+   Table.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Class specific setup function for the effects assets.
+  ---------------------------------------------------------------------------*/
+void FilterPaletteCPU::Assets(Buffers &Buffer)
+   {
+   if (!Ready()) {return;}
+
+   Depth.Create(Buffer.GetDepthResolution(), Buffer.GetDepthDataType());
+   Depth.ClearData();
+
+   Texture Palette;
+   AssetCache::LoadPNG(Palette, File::Path::Shader(File::TexturePalette));
+   if (!FilterPalette::Steps(Colours, Palette, Type)) {throw dexception("Palette texture has no RGB data.");}
+
+   //Until the device publishes its table, assume the default non-linear depth
+   if (!Buffer.DepthTableUpdated(TableID, DepthTable))
+      {
+      DepthTable.Create(FilterPaletteCPU::TableSize);
+      for (uiter I = 0; I < DepthTable.Size(); I++) {DepthTable[I] = (uint16)((I * 65535) / 2047);}
+      }
+
+   Build();
+   }
+
+/*---------------------------------------------------------------------------
+   Fuses the depth table with the palette lookup. The palette step of each
+   depth value is quantised the same way as in the palette shader.
+  ---------------------------------------------------------------------------*/
+void FilterPaletteCPU::Build(void)
+   {
+   if (DepthTable.Size() < 1 || Colours.Size() < 1) {return;}
+
+   Table.Destroy();
+   Table.Create(FilterPaletteCPU::TableSize * 4);
+
+   const float Steps = (float)(FilterPalette::Entries - 1);
+
+   for (uiter I = 0; I < FilterPaletteCPU::TableSize; I++)
+      {
+      float Z = (float)DepthTable[Math::Min(I, DepthTable.Size() - 1)] / 65535.0f;
+      float Lookup = Math::Clamp(1.0f - Z, 0.0f, 1.0f);
+      uint Step = Math::Min((uint)floorf(Lookup * Steps + 0.5f), FilterPalette::Entries - 1);
+
+      const uint8* Src = Colours.Address(Step, 0);
+      uint8* Dst = Table.Pointer() + (I << 2);
+      Dst[0] = Src[0];
+      Dst[1] = Src[1];
+      Dst[2] = Src[2];
+      Dst[3] = 0;
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Copies the raw depth buffer, and rebuilds the colour table if the device
+   published a new depth table. Returns true if the depth was updated.
+  ---------------------------------------------------------------------------*/
+bool FilterPaletteCPU::Update(Buffers &Buffer)
+   {
+   if (!Ready()) {return false;}
+
+   //Test for resolution change, if applicable
+   Change(Buffer);
+
+   if (Buffer.DepthTableUpdated(TableID, DepthTable)) {Build();}
+
+   UploadTime = 0;
+
+   if (!Buffer.DepthUpdated(DepthUpdateID)) {return false;}
+
+   return Copy(Depth, Buffer.GetDepthRaw());
+   }
+
+/*---------------------------------------------------------------------------
+   Renders a band of scanlines. Each pixel is a single table lookup. Whole
+   4 byte entries are stored, so the copies need no branches or byte
+   shuffling, and the pad byte is overwritten by the next pixel. Only the
+   last pixel of a line is stored with 3 bytes.
+  ---------------------------------------------------------------------------*/
+void FilterPaletteCPU::Shade(uiter Start, uiter End)
+   {
+   const uiter Last = Output.Resolution().U - 1;
+   const uint8* Lookup = Table.Pointer();
+
+   for (uiter V = Start; V < End; V++)
+      {
+      const uint16* Src = Depth.Address16(0, V);
+      uint8* Dst = Output.Address(0, V);
+
+      for (uiter U = 0; U < Last; U++, Dst += 3) {memcpy(Dst, Lookup + ((Src[U] & 0x07FF) << 2), 4);}
+
+      memcpy(Dst, Lookup + ((Src[Last] & 0x07FF) << 2), 3);
+      }
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,78 @@
+/*===========================================================================
+   Depth Filter Class With Palette, Software Renderer
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_PALETTE_CPU_H___
+#define ___FILTER_PALETTE_CPU_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "filter_cpu.h"
+#include "filter_palette.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Renders the same output as FilterPalette on the CPU. Rather than looking
+  up the converted depth buffer, the filter works from the raw 11-bit depth
+  texture. The depth table published by the device and the palette lookup
+  are fused into a single table, which maps each raw value directly to the
+  output colour.
+  ---------------------------------------------------------------------------*/
+class FilterPaletteCPU : public FilterCPU
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const usize TableSize = 2048;            //Number of raw depth values
+
+   //---- Member data ----
+   private:
+
+   FilterPalette::PaletteType Type;                //Controls the palette type
+   Texture Colours;                                //Palette steps
+   Array<uint16, 8> DepthTable;                    //Depth look-up table of the device
+   Array<uint8, 32> Table;                         //Raw depth to colour look-up table, 4 bytes per entry, RGB and a pad byte
+   uiter TableID;                                  //Update ID for the depth look-up table
+
+   //---- Methods ----
+   public:
+
+   FilterPaletteCPU(FilterPalette::PaletteType Type = FilterPalette::Grey);
+   ~FilterPaletteCPU(void);
+
+   private:
+
+   FilterPaletteCPU(const FilterPaletteCPU &obj);  //Disable
+   FilterPaletteCPU &operator = (const FilterPaletteCPU &obj); //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+   void Assets(Buffers &Buffer);
+
+   //Rendering
+   void Build(void);
+   void Shade(uiter Start, uiter End);
+
+   public:
+
+   //Rendering
+   bool Update(Buffers &Buffer);
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
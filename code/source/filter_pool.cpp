@@ -0,0 +1,240 @@
+/*===========================================================================
+   Render Target Pool for Filters
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_POOL_CPP___
+#define ___FILTER_POOL_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "filter_pool.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+FilterPool::FilterPool(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor. NOTE: Make sure it is called within a valid OpenGL context.
+  ---------------------------------------------------------------------------*/
+FilterPool::~FilterPool(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void FilterPool::Clear(void)
+   {
+   Targets.Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Deletes all targets. Filters still holding a target must not render
+   after this. NOTE: Make sure it is called within a valid OpenGL context.
+  ---------------------------------------------------------------------------*/
+void FilterPool::Destroy(void)
+   {
+   for (uiter I = 0; I < Targets.Size(); I++)
+      {
+      Target &T = Targets[I];
+      Delete(T.FBOID, T.DBOID, T.CBOID);
+      }
+
+   Targets.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Hands out a target of the given resolution and slot, creating one if
+   there is none yet.
+
+   Res   : Resolution of the target.
+   Slot  : Slot number.
+   FBOID : Receives the frame buffer object ID.
+   DBOID : Receives the depth buffer object ID.
+   CBOID : Receives the colour buffer object ID.
+  ---------------------------------------------------------------------------*/
+void FilterPool::Acquire(const vector2u &Res, uint Slot, GLuint &FBOID, GLuint &DBOID, GLuint &CBOID)
+   {
+   uiter Index = Targets.Size();
+
+   for (uiter I = 0; I < Targets.Size(); I++)
+      {
+      const Target &T = Targets[I];
+      if (T.Res.U == Res.U && T.Res.V == Res.V && T.Slot == Slot) {Index = I; break;}
+      }
+
+   if (Index == Targets.Size())
+      {
+      Target T;
+      T.Res = Res;
+      T.Slot = Slot;
+      T.Users = 0;
+      Create(Res, T.FBOID, T.DBOID, T.CBOID);
+      Targets += T;
+
+      debug("Filter pool created a %ux%u target in slot %u.\n", Res.U, Res.V, Slot);
+      }
+
+   Target &T = Targets[Index];
+   T.Users++;
+
+   FBOID = T.FBOID;
+   DBOID = T.DBOID;
+   CBOID = T.CBOID;
+   }
+
+/*---------------------------------------------------------------------------
+   Returns a target to the pool. The target is deleted once no filter holds
+   it anymore. NOTE: Make sure it is called within a valid OpenGL context.
+
+   CBOID : Colour buffer object ID of the target.
+  ---------------------------------------------------------------------------*/
+void FilterPool::Release(GLuint CBOID)
+   {
+   if (CBOID < 1) {return;}
+
+   for (uiter I = 0; I < Targets.Size(); I++)
+      {
+      Target &T = Targets[I];
+      if (T.CBOID != CBOID || T.Users < 1) {continue;}
+
+      T.Users--;
+      if (T.Users > 0) {return;}
+
+      debug("Filter pool deleted a %ux%u target in slot %u.\n", T.Res.U, T.Res.V, T.Slot);
+
+      Delete(T.FBOID, T.DBOID, T.CBOID);
+      Targets.Remove(I);
+      return;
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Deletes the frame buffer objects of all targets, while keeping their depth
+   and colour buffers, before the filters holding them are handed over to
+   another OpenGL context, see Filter::Detach( ). NOTE: This must be called
+   within the OpenGL context that created the targets.
+  ---------------------------------------------------------------------------*/
+void FilterPool::Detach(void)
+   {
+   for (uiter I = 0; I < Targets.Size(); I++)
+      {
+      Target &T = Targets[I];
+      if (T.FBOID > 0) {glDeleteFramebuffers(1, &T.FBOID);}
+      T.FBOID = 0;
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Makes a frame buffer object for a target in the current OpenGL context,
+   unless another filter holding the target already did, see 
+   Filter::Attach( ). Leaves the frame buffer object bound.
+
+   CBOID : Colour buffer object ID of the target.
+   FBOID : Receives the frame buffer object ID.
+  ---------------------------------------------------------------------------*/
+void FilterPool::Attach(GLuint CBOID, GLuint &FBOID)
+   {
+   for (uiter I = 0; I < Targets.Size(); I++)
+      {
+      Target &T = Targets[I];
+      if (T.CBOID != CBOID) {continue;}
+
+      if (T.FBOID > 0) 
+         {
+         glBindFramebuffer(GL_FRAMEBUFFER, T.FBOID);
+         FBOID = T.FBOID;
+         return;
+         }
+
+      glGenFramebuffers(1, &T.FBOID);
+      glBindFramebuffer(GL_FRAMEBUFFER, T.FBOID);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, T.DBOID);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, T.CBOID, 0);
+
+      GLenum Error = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+      if (Error != GL_FRAMEBUFFER_COMPLETE) {throw dexception("Failed to setup frame buffer object: %s.", Debug::StatusFBO(Error));}
+
+      FBOID = T.FBOID;
+      return;
+      }
+
+   throw dexception("Render target is not in the pool.");
+   }
+
+/*---------------------------------------------------------------------------
+   Creates a frame buffer object with a depth buffer, and a colour buffer in
+   form of a texture. The texture has no mipmaps until Filter::Mipmap( ) is
+   called. Leaves the frame buffer object bound.
+
+   Res   : Resolution of the buffers.
+   FBOID : Receives the frame buffer object ID.
+   DBOID : Receives the depth buffer object ID.
+   CBOID : Receives the colour buffer object ID.
+  ---------------------------------------------------------------------------*/
+void FilterPool::Create(const vector2u &Res, GLuint &FBOID, GLuint &DBOID, GLuint &CBOID)
+   {
+   //Create a new frame buffer object
+   glGenFramebuffers(1, &FBOID);
+   glBindFramebuffer(GL_FRAMEBUFFER, FBOID);
+
+   //Create a new depth buffer object, then associate a
+   // storage space for it, and attach it to the FBO
+   glGenRenderbuffers(1, &DBOID);
+   glBindRenderbuffer(GL_RENDERBUFFER, DBOID);
+   glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, Res.X, Res.Y);
+   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DBOID);
+
+   //Create a colour buffer in form of a texture and attach it to the FBO
+   glGenTextures(1, &CBOID);
+   glBindTexture(GL_TEXTURE_2D, CBOID);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, Res.X, Res.Y, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, CBOID, 0);
+
+   //FBO texture scaling
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+   }
+
+/*---------------------------------------------------------------------------
+   Deletes the buffers made by Create( ), and zeroes the IDs.
+  ---------------------------------------------------------------------------*/
+void FilterPool::Delete(GLuint &FBOID, GLuint &DBOID, GLuint &CBOID)
+   {
+   if (CBOID > 0) {glDeleteTextures(1, &CBOID);}
+   if (DBOID > 0) {glDeleteRenderbuffers(1, &DBOID);}
+   if (FBOID > 0) {glDeleteFramebuffers(1, &FBOID);}
+
+   FBOID = 0;
+   DBOID = 0;
+   CBOID = 0;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
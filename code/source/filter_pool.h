@@ -0,0 +1,90 @@
+/*===========================================================================
+   Render Target Pool for Filters
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___FILTER_POOL_H___
+#define ___FILTER_POOL_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "vector.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Hands out frame buffer objects to filters, so that filters rendering one
+  after another can share render targets. Targets are matched by resolution
+  and slot number. Filters in a chain alternate between two slots, so each
+  stage renders into a different target than the one it samples, and a
+  chain of any length needs only two targets per resolution.
+
+  A target is deleted as soon as its last filter releases it, so targets
+  left behind by a resolution change or a shorter chain are not kept.
+  Targets are identified by their colour buffers, which stay the same when
+  the filters are handed over to another context, see Detach( ). All
+  methods must be called within a valid OpenGL context.
+  ---------------------------------------------------------------------------*/
+class FilterPool
+   {
+   //---- Constants and definitions ----
+   public:
+
+   struct Target                                   //Render target
+      {
+      vector2u Res;                                //Resolution
+      uint Slot;                                   //Slot number, targets in different slots are never shared
+      uint Users;                                  //Number of filters holding the target
+      GLuint FBOID;                                //Frame buffer object ID
+      GLuint DBOID;                                //Depth buffer object ID
+      GLuint CBOID;                                //Colour buffer object ID
+      };
+
+   //---- Member data ----
+   private:
+
+   Array<Target> Targets;                          //Targets created so far
+
+   //---- Methods ----
+   public:
+
+   FilterPool(void);
+   ~FilterPool(void);
+
+   private:
+
+   FilterPool(const FilterPool &obj);              //Disable
+   FilterPool &operator = (const FilterPool &obj); //Disable
+
+   //Data allocation
+   void Clear(void);
+
+   public:
+
+   void Destroy(void);
+
+   //Target management
+   void Acquire(const vector2u &Res, uint Slot, GLuint &FBOID, GLuint &DBOID, GLuint &CBOID);
+   void Release(GLuint CBOID);
+   void Detach(void);
+   void Attach(GLuint CBOID, GLuint &FBOID);
+
+   static void Create(const vector2u &Res, GLuint &FBOID, GLuint &DBOID, GLuint &CBOID);
+   static void Delete(GLuint &FBOID, GLuint &DBOID, GLuint &CBOID);
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -74,7 +74,9 @@ void FilterSolids::Clear(void)
    Grid = 1;
    GridNorm = 1.0f;
    Offset = 0.0f;
-   UID = 0;
+   InstanceID = 0;
+   AID = -1;
+   Instanced = false;
 
    Near = -1.0f;
    Far = -7.0f;
@@ -91,6 +93,9 @@ void FilterSolids::Clear(void)
   ---------------------------------------------------------------------------*/
 void FilterSolids::Destroy(void)
    {
+   if (InstanceID > 0) {glDeleteBuffers(1, &InstanceID);}
+   Instances.Destroy();
+
    Filter::Destroy();
 
    Clear();
@@ -106,6 +111,7 @@ void FilterSolids::Assets(Buffers &Buffer)
    vector2u Res = Buffer.GetDepthResolution();
    Depth.Create(Res, Buffer.GetDepthDataType());
    Depth.ClearData();
+   Depth.SetMipLevels(2); //Sampled at LOD 2
    Depth.Buffer(false);
 
    glMatrixMode(GL_MODELVIEW);
@@ -128,14 +134,13 @@ void FilterSolids::Assets(Buffers &Buffer)
    uint PolyDiv = (Math::Min(Res.U, Res.V) / GridSmallest) / PolyDivPixels;
    PolyDiv = Math::Clamp(PolyDiv, PolyDivMin, PolyDivMax);
 
-   File::Text Text;
    std::string CodeVert, CodeFrag;
 
    switch (Type)
       {
       case FilterSolids::Cubes :
          Model.Cube(1, Mesh::ModeSolid);
-         Text.Load(CodeVert, File::Path::Shader(File::FilterSolidsDepthVert));
+         AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterSolidsDepthVert));
          EnableVideo = false;
          EnableDepth = true;
          EnableCal = false;
@@ -144,7 +149,7 @@ void FilterSolids::Assets(Buffers &Buffer)
 
       case FilterSolids::Spheres :
          Model.Sphere(PolyDiv, Mesh::ModeSolid);
-         Text.Load(CodeVert, File::Path::Shader(File::FilterSolidsDepthVert));
+         AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterSolidsDepthVert));
          EnableVideo = false;
          EnableDepth = true;
          EnableCal = false;
@@ -152,9 +157,10 @@ void FilterSolids::Assets(Buffers &Buffer)
 
       case FilterSolids::CubesTinted :
          Model.Cube(1, Mesh::ModeSolid);
-         Text.Load(CodeVert, File::Path::Shader(File::FilterSolidsVideoVert));
+         AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterSolidsVideoVert));
          Video.Create(Buffer.GetVideoResolution(), Buffer.GetVideoDataType());
          Video.ClearData();
+         Video.SetMipLevels(2);
          Video.Buffer(false);
          EnableVideo = true;
          EnableDepth = true;
@@ -164,9 +170,10 @@ void FilterSolids::Assets(Buffers &Buffer)
 
       case FilterSolids::SpheresTinted :
          Model.Sphere(PolyDiv, Mesh::ModeSolid);
-         Text.Load(CodeVert, File::Path::Shader(File::FilterSolidsVideoVert));
+         AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterSolidsVideoVert));
          Video.Create(Buffer.GetVideoResolution(), Buffer.GetVideoDataType());
          Video.ClearData();
+         Video.SetMipLevels(2);
          Video.Buffer(false);
          EnableVideo = true;
          EnableDepth = true;
@@ -175,7 +182,7 @@ void FilterSolids::Assets(Buffers &Buffer)
 
       case FilterSolids::CubesFar :
          Model.Cube(1, Mesh::ModeSolid);
-         Text.Load(CodeVert, File::Path::Shader(File::FilterSolidsDepthVert));
+         AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterSolidsDepthVert));
          EnableVideo = false;
          EnableDepth = true;
          EnableCal = false;
@@ -185,7 +192,7 @@ void FilterSolids::Assets(Buffers &Buffer)
 
       case FilterSolids::SpheresFar :
          Model.Sphere(PolyDiv, Mesh::ModeSolid);
-         Text.Load(CodeVert, File::Path::Shader(File::FilterSolidsDepthVert));
+         AssetCache::LoadText(CodeVert, File::Path::Shader(File::FilterSolidsDepthVert));
          EnableVideo = false;
          EnableDepth = true;
          EnableCal = false;
@@ -199,7 +206,7 @@ void FilterSolids::Assets(Buffers &Buffer)
 
    Model.Buffer(false);
 
-   Text.Load(CodeFrag, File::Path::Shader(File::FilterSolidsFrag));
+   AssetCache::LoadText(CodeFrag, File::Path::Shader(File::FilterSolidsFrag));
    Program.Attach(CodeVert, Shader::ShaderVert);
    Program.Attach(CodeFrag, Shader::ShaderFrag);
    Program.Buffer(false);
@@ -208,10 +215,13 @@ void FilterSolids::Assets(Buffers &Buffer)
    glUniform1f(glGetUniformLocation(Program.ID(), "Range"), Math::Abs(Range));
    glUniform1i(glGetUniformLocation(Program.ID(), "Depth"), 0);   //Texture unit 0
    glUniform1i(glGetUniformLocation(Program.ID(), "Video"), 1);   //Texture unit 1
-   UID = glGetUniformLocation(Program.ID(), "TexCoord");
-   glUniform2f(UID, 0.0f, 0.0f);
+   AID = glGetAttribLocation(Program.ID(), "Instance");
    Program.Unbind();
 
+   if (AID < 0) {throw dexception("Solids shader is missing the Instance attribute.");}
+
+   Grids();
+
    //Projection matrix
    MP = MP.Identity();
    MP = MP.Frustum(-Ratio.X, Ratio.X, -Ratio.Y, Ratio.Y, Math::Abs(Near), Math::Abs(Far));
@@ -226,6 +236,53 @@ void FilterSolids::Assets(Buffers &Buffer)
    if (Error != GL_NO_ERROR) {throw dexception("OpenGL generated an error: %s", Debug::ErrorGL(Error));}
    }
 
+/*---------------------------------------------------------------------------
+   Builds the per instance attributes of the grid, and buffers them for
+   instanced rendering, if supported. Each instance holds the offset of its 
+   grid cell in XY, and the texture coordinates of the cell in ZW.
+  ---------------------------------------------------------------------------*/
+void FilterSolids::Grids(void)
+   {
+   if (InstanceID > 0) {glDeleteBuffers(1, &InstanceID);}
+   InstanceID = 0;
+
+   Instances.Destroy();
+   Instances.Create(Grid.X * Grid.Y);
+
+   for (uint Y = 0, I = 0; Y < Grid.Y; Y++)
+      {
+      for (uint X = 0; X < Grid.X; X++, I++)
+         {
+         vector2f Coord((float)X, (float)Y);
+         Coord = (Coord - Offset) * 2.0f;
+
+         vector2f TexCoord((float)X, (float)Y);
+         TexCoord *= GridNorm;
+
+         Instances[I].Set4(Coord.X, Coord.Y, TexCoord.X, TexCoord.Y);
+         }
+      }
+
+   Instanced = GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced;
+   if (!Instanced) {return;}
+
+   glGenBuffers(1, &InstanceID);
+   glBindBuffer(GL_ARRAY_BUFFER, InstanceID);
+   glBufferData(GL_ARRAY_BUFFER, sizeof(vector4f) * Instances.Size(), Instances.Pointer(), GL_STATIC_DRAW);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+   }
+
+/*---------------------------------------------------------------------------
+   Makes the frame buffer object and buffers the light in the current 
+   OpenGL context, see Filter::Attach( ).
+  ---------------------------------------------------------------------------*/
+void FilterSolids::Attach(void)
+   {
+   Filter::Attach();
+
+   Light.Buffer(0);
+   }
+
 /*---------------------------------------------------------------------------
    Renders the filter effect. Assumes the Bind( ) method was called prior.
   ---------------------------------------------------------------------------*/
@@ -256,21 +313,28 @@ void FilterSolids::Render(void)
 
    glMatrixMode(GL_MODELVIEW);
 
-   for (uint Y = 0; Y < Grid.Y; Y++)
+   if (Instanced)
       {
-      for (uint X = 0; X < Grid.X; X++)
-         {
-         vector2f Coord((float)X, (float)Y);
-         Coord = (Coord - Offset) * 2.0f;
+      //The whole grid in one draw call, one attribute per instance
+      glBindBuffer(GL_ARRAY_BUFFER, InstanceID);
+      glEnableVertexAttribArray(AID);
+      glVertexAttribPointer(AID, 4, GL_FLOAT, GL_FALSE, sizeof(vector4f), nullptr);
+      glVertexAttribDivisorARB(AID, 1);
 
-         vector2f TexCoord((float)X, (float)Y);
-         TexCoord *= GridNorm;
-         glUniform2f(UID, TexCoord.X, TexCoord.Y);
+      Model.Render(Instances.Size());
 
-         glPushMatrix();
-         glTranslatef(Coord.X, Coord.Y, 0.0f);
+      glVertexAttribDivisorARB(AID, 0);
+      glDisableVertexAttribArray(AID);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      }
+   else
+      {
+      //Same attributes as constant values, one draw call per instance
+      for (uiter I = 0; I < Instances.Size(); I++)
+         {
+         const vector4f Attrib = Instances[I];
+         glVertexAttrib4f(AID, Attrib.X, Attrib.Y, Attrib.Z, Attrib.W);
          Model.Render();
-         glPopMatrix();
          }
       }
 
@@ -42,7 +42,7 @@ class FilterSolids : public Filter
    static const uint PolyDivMax = 8;               //Maximum geometry division
    static const uint GridDiv = 10;                 //Grid divident size
    static const uint GridMin = 9;                  //Least divisions per dimension
-   static const uint GridMax = 127;                //Most divisions per dimension
+   static const uint GridMax = 255;                //Most divisions per dimension
 
    //---- Member data ----
    private:
@@ -52,7 +52,10 @@ class FilterSolids : public Filter
    vector2u Grid;                                  //Cube grid divisions in each dimension
    vector2f GridNorm;                              //Reciprocal of grids
    vector2f Offset;                                //Half grid offset
-   GLint UID;                                      //Uniform ID for updating texture coordinates
+   Array<vector4f> Instances;                      //Per instance grid offset (XY) and texture coordinates (ZW)
+   GLuint InstanceID;                              //Vertex buffer object ID of the instance attributes
+   GLint AID;                                      //Attribute location of the instance attributes
+   bool Instanced;                                 //Draw all instances with one call, requires ARB_instanced_arrays
 
    //---- Methods ----
    public:
@@ -69,9 +72,13 @@ class FilterSolids : public Filter
    void Clear(void);
    void Destroy(void);
    void Assets(Buffers &Buffer);
+   void Grids(void);
 
    public:
 
+   //Context hand-over
+   void Attach(void);
+
    //Rendering
    void Render(void);
    };
@@ -30,18 +30,27 @@
 const char* FormWindow::FilePrefixVideo = "video";
 const char* FormWindow::FilePrefixDepth = "depth";
 const char* FormWindow::FilePrefixMesh = "mesh";
+const char* FormWindow::FilePrefixVideoRaw = "video raw";
+const char* FormWindow::FilePrefixDepthRaw = "depth raw";
 
 
 /*---------------------------------------------------------------------------
    Constructor.
+
+   Parent : Parent window.
+   Synth  : Generated frame source to use instead of the sensor, or nullptr.
   ---------------------------------------------------------------------------*/
-FormWindow::FormWindow(QMainWindow* Parent) : QMainWindow(Parent)
+FormWindow::FormWindow(QMainWindow* Parent, const NAMESPACE_PROJECT::Synthetic::Settings* Synth) : QMainWindow(Parent)
    {
    //Reset member data
    WidgetVideo = nullptr;
    WidgetDepth = nullptr;
    StatusDevice = nullptr;
+   StatusCaptureVideo = nullptr;
+   StatusCaptureDepth = nullptr;
    Device = nullptr;
+   PreRollVideo = nullptr;
+   PreRollDepth = nullptr;
    FileFormat = CaptureThread::FormatTGA;
    FileCompress = false;
 
@@ -54,9 +63,9 @@ FormWindow::FormWindow(QMainWindow* Parent) : QMainWindow(Parent)
    //Window title
    setWindowTitle(NAMESPACE_PROJECT::AppName);
 
-   //Create OpenGL widgets
+   //Create OpenGL widgets, sharing objects so both can use the same assets
    WidgetVideo = new GLWidget(this, UI.FrameVideo, Buffer);
-   WidgetDepth = new GLWidget(this, UI.FrameDepth, Buffer);
+   WidgetDepth = new GLWidget(this, UI.FrameDepth, Buffer, WidgetVideo);
 
    //Attach default filters
    WidgetVideo->AttachFilter(new NAMESPACE_PROJECT::Filter());
@@ -67,6 +76,7 @@ FormWindow::FormWindow(QMainWindow* Parent) : QMainWindow(Parent)
 
    //Create a new thread for the device
    Device = new KinectThread(this, WidgetVideo, WidgetDepth, Buffer);
+   Device->SetSynthetic(Synth);
    Device->start();
 
    //Update GUI controls related to depth
@@ -89,6 +99,16 @@ FormWindow::FormWindow(QMainWindow* Parent) : QMainWindow(Parent)
       StatusDevice->setMargin(2);
       StatusDevice->setFrameShape(QFrame::NoFrame);
       StatusDevice->setText("Device: Not detected");
+
+      StatusCaptureVideo = new QLabel;
+      StatusBar->addPermanentWidget(StatusCaptureVideo);
+      StatusCaptureVideo->setMargin(2);
+      StatusCaptureVideo->setFrameShape(QFrame::NoFrame);
+
+      StatusCaptureDepth = new QLabel;
+      StatusBar->addPermanentWidget(StatusCaptureDepth);
+      StatusCaptureDepth->setMargin(2);
+      StatusCaptureDepth->setFrameShape(QFrame::NoFrame);
       }
    }
 
@@ -97,6 +117,13 @@ FormWindow::FormWindow(QMainWindow* Parent) : QMainWindow(Parent)
   ---------------------------------------------------------------------------*/
 FormWindow::~FormWindow(void)
    {
+   //Capture threads may be draining the pre-roll rings
+   WidgetVideo->CaptureClose();
+   WidgetDepth->CaptureClose();
+
+   delete PreRollVideo;
+   delete PreRollDepth;
+
    if (Device->isRunning())
       {
       Device->stop();
@@ -110,6 +137,8 @@ FormWindow::~FormWindow(void)
    
    delete Device;
    delete StatusDevice;
+   delete StatusCaptureVideo;
+   delete StatusCaptureDepth;
    }
 
 /*---------------------------------------------------------------------------
@@ -224,7 +253,8 @@ void FormWindow::DeviceConnected(bool State)
    {
    if (StatusDevice != nullptr)
       {
-      if (State) {StatusDevice->setText("Device: Connected");}
+      if (State && Device->IsSynthetic()) {StatusDevice->setText("Device: Synthetic");}
+      else if (State) {StatusDevice->setText("Device: Connected");}
       else {StatusDevice->setText("Device: Not detected");}
       }
 
@@ -266,6 +296,16 @@ void FormWindow::RenderError(QString Message)
    debug("%s\n", String.constData()); 
    }
 
+/*---------------------------------------------------------------------------
+   Traps the signal of a GL widget that has swapped in a new filter, which 
+   may need different streams and controls than the previous one.
+  ---------------------------------------------------------------------------*/
+void FormWindow::FilterReady(void)
+   {
+   DeviceEnableStreams();
+   EnableVideoFilterWidgets();
+   }
+
 /*---------------------------------------------------------------------------
    Traps a capture error signal.
   ---------------------------------------------------------------------------*/
@@ -284,6 +324,17 @@ void FormWindow::CaptureError(QString Message)
    catch (...) {debug("Trapped an unhandled exception.\n");}
    }
 
+/*---------------------------------------------------------------------------
+   Shows periodic reports from the capture threads, such as the bandwidth
+   saved by delta capture. The video and depth streams report into labels
+   of their own, so they don't overwrite each other.
+  ---------------------------------------------------------------------------*/
+void FormWindow::CaptureStatus(QString Message)
+   {
+   QLabel* Status = sender() == WidgetDepth->GetCapture() ? StatusCaptureDepth : StatusCaptureVideo;
+   if (Status != nullptr) {Status->setText(Message);}
+   }
+
 /*---------------------------------------------------------------------------
    Enables or disables window widgets, depending on State. 
   ---------------------------------------------------------------------------*/
@@ -317,6 +368,8 @@ void FormWindow::EnableStreaming(bool State)
    UI.CheckBoxStreamVideo->setEnabled(State);
    UI.CheckBoxStreamDepth->setEnabled(State);
    UI.CheckBoxStreamMesh->setEnabled(State);
+   UI.CheckBoxStreamRaw->setEnabled(State);
+   UI.CheckBoxStreamPreRoll->setEnabled(State);
 
    UI.CheckBoxSyncFrames->setEnabled(State);
    }
@@ -329,6 +382,10 @@ void FormWindow::EnableFileFormat(bool State)
    UI.RadioButtonTGA->setEnabled(State);
    UI.RadioButtonTGARLE->setEnabled(State);
    UI.RadioButtonPNG->setEnabled(State);
+   UI.RadioButtonY4M->setEnabled(State);
+   UI.RadioButtonAdaptive->setEnabled(State);
+   UI.RadioButtonDelta->setEnabled(State);
+   UI.RadioButtonPacked->setEnabled(State);
    }
 
 /*---------------------------------------------------------------------------
@@ -344,9 +401,14 @@ void FormWindow::EnableButtonRecord(void)
    UI.CheckBoxStreamVideo->setEnabled(true);
    UI.CheckBoxStreamDepth->setEnabled(true);
    UI.CheckBoxStreamMesh->setEnabled(true);
+   UI.CheckBoxStreamRaw->setEnabled(true);
+   UI.CheckBoxStreamPreRoll->setEnabled(true);
 
    EnableFileFormat(true);
 
+   if (StatusCaptureVideo != nullptr) {StatusCaptureVideo->clear();}
+   if (StatusCaptureDepth != nullptr) {StatusCaptureDepth->clear();}
+
    Device->SetLED(NAMESPACE_PROJECT::Kinect::LedGreen);
    }
 
@@ -363,6 +425,8 @@ void FormWindow::EnableButtonStop(void)
    UI.CheckBoxStreamVideo->setEnabled(false);
    UI.CheckBoxStreamDepth->setEnabled(false);
    UI.CheckBoxStreamMesh->setEnabled(false);
+   UI.CheckBoxStreamRaw->setEnabled(false);
+   UI.CheckBoxStreamPreRoll->setEnabled(false);
 
    EnableFileFormat(false);
 
@@ -664,9 +728,31 @@ void FormWindow::ButtonActionRecord(void)
 
       bool StartVideo = UI.CheckBoxStreamVideo->checkState() == Qt::Checked;
       bool StartDepth = UI.CheckBoxStreamDepth->checkState() == Qt::Checked;
+      bool Raw = UI.CheckBoxStreamRaw->checkState() == Qt::Checked;
+      bool PreRolled = PreRollVideo != nullptr && PreRollDepth != nullptr;
+
+      //Bit-packing only applies to the raw depth samples
+      if (FileFormat == CaptureThread::FormatPacked)
+         {
+         if (!StartDepth) {throw dexception("Bit-packed capture requires the depth stream to be enabled.");}
+         StartVideo = false;
+         Raw = true;
+         }
 
-      if (StartVideo) {WidgetVideo->CaptureOpen(Path, FormWindow::FilePrefixVideo, FileFormat, FileCompress);}
-      if (StartDepth) {WidgetDepth->CaptureOpen(Path, FormWindow::FilePrefixDepth, FileFormat, FileCompress);}
+      //YUV4MPEG2 only carries colour frames, the raw 11-bit depth samples don't fit
+      if (FileFormat == CaptureThread::FormatY4M && StartDepth && (Raw || PreRolled))
+         {throw dexception("YUV4MPEG2 capture does not support the raw depth stream.");}
+
+      if (Raw || PreRolled)
+         {
+         if (StartVideo) {WidgetVideo->CaptureOpen(Path, FormWindow::FilePrefixVideoRaw, FileFormat, FileCompress, CaptureThread::SourceVideo, PreRollVideo);}
+         if (StartDepth) {WidgetDepth->CaptureOpen(Path, FormWindow::FilePrefixDepthRaw, FileFormat, FileCompress, CaptureThread::SourceDepth, PreRollDepth);}
+         }
+      else
+         {
+         if (StartVideo) {WidgetVideo->CaptureOpen(Path, FormWindow::FilePrefixVideo, FileFormat, FileCompress);}
+         if (StartDepth) {WidgetDepth->CaptureOpen(Path, FormWindow::FilePrefixDepth, FileFormat, FileCompress);}
+         }
 
       EnableButtonStop();
       }
@@ -718,6 +804,28 @@ void FormWindow::CheckBoxActionStreamMesh(void)
    EnableButtonRecordStreamOptions();
    }
 
+//Keep raw sensor frames in memory, ready to be saved when recording starts
+void FormWindow::CheckBoxActionStreamPreRoll(void)
+   {
+   try {
+      delete PreRollVideo;
+      delete PreRollDepth;
+      PreRollVideo = nullptr;
+      PreRollDepth = nullptr;
+
+      if (UI.CheckBoxStreamPreRoll->checkState() != Qt::Checked) {return;}
+
+      PreRollVideo = new NAMESPACE_PROJECT::PreRoll(Buffer, false);
+      PreRollDepth = new NAMESPACE_PROJECT::PreRoll(Buffer, true);
+      }
+
+   catch (std::exception &e) 
+      {QMessageBox::information(nullptr, NAMESPACE_PROJECT::AppName, e.what());}
+
+   catch (...) 
+      {QMessageBox::information(nullptr, NAMESPACE_PROJECT::AppName, "Trapped an unhandled exception.");}
+   }
+
 /*---------------------------------------------------------------------------
    Frame sync checkbox.
   ---------------------------------------------------------------------------*/
@@ -752,6 +860,34 @@ void FormWindow::RadioButtonActionPNG(void)
    FileCompress = true;
    }
 
+//Stream as YUV4MPEG2
+void FormWindow::RadioButtonActionY4M(void)
+   {
+   FileFormat = CaptureThread::FormatY4M;
+   FileCompress = false;
+   }
+
+//Let the capture thread pick the codec
+void FormWindow::RadioButtonActionAdaptive(void)
+   {
+   FileFormat = CaptureThread::FormatAdaptive;
+   FileCompress = true;
+   }
+
+//Stream changed tiles only
+void FormWindow::RadioButtonActionDelta(void)
+   {
+   FileFormat = CaptureThread::FormatDelta;
+   FileCompress = false;
+   }
+
+//Stream bit-packed raw depth
+void FormWindow::RadioButtonActionPacked(void)
+   {
+   FileFormat = CaptureThread::FormatPacked;
+   FileCompress = false;
+   }
+
 /*---------------------------------------------------------------------------
    Radio buttons for changing the device video capture mode.
   ---------------------------------------------------------------------------*/
@@ -39,6 +39,8 @@ class FormWindow : public QMainWindow
    static const char* FilePrefixVideo;             //File name prefix for depth buffer streaming
    static const char* FilePrefixDepth;             //File name prefix for video buffer streaming
    static const char* FilePrefixMesh;              //File name prefix for mesh streaming
+   static const char* FilePrefixVideoRaw;          //File name prefix for raw video sensor streaming
+   static const char* FilePrefixDepthRaw;          //File name prefix for raw depth sensor streaming
 
    //---- Member data ----
    private:
@@ -47,9 +49,13 @@ class FormWindow : public QMainWindow
    GLWidget* WidgetVideo;                          //Video OpenGL widget
    GLWidget* WidgetDepth;                          //Depth buffer OpenGL widget
    QLabel* StatusDevice;                           //Status bar for device
+   QLabel* StatusCaptureVideo;                     //Status bar for video capture reports
+   QLabel* StatusCaptureDepth;                     //Status bar for depth capture reports
 
    NAMESPACE_PROJECT::Buffers Buffer;              //The actual video and depth frames
    KinectThread* Device;                           //Thread for handling the kinect device
+   NAMESPACE_PROJECT::PreRoll* PreRollVideo;       //Pre-roll ring for the video sensor stream
+   NAMESPACE_PROJECT::PreRoll* PreRollDepth;       //Pre-roll ring for the depth sensor stream
 
    CaptureThread::CapFormat FileFormat;            //Sream capture file format
    bool FileCompress;                              //Apply data compression on file
@@ -58,7 +64,7 @@ class FormWindow : public QMainWindow
    //---- Methods ----
    public:
 
-   FormWindow(QMainWindow* Parent = nullptr);
+   FormWindow(QMainWindow* Parent = nullptr, const NAMESPACE_PROJECT::Synthetic::Settings* Synth = nullptr);
    ~FormWindow(void);
 
    private:
@@ -107,12 +113,17 @@ class FormWindow : public QMainWindow
    void CheckBoxActionStreamVideo(void);
    void CheckBoxActionStreamDepth(void);
    void CheckBoxActionStreamMesh(void);
+   void CheckBoxActionStreamPreRoll(void);
 
    void CheckBoxActionSyncFrames(void);
 
    void RadioButtonActionTGA(void);
    void RadioButtonActionTGARLE(void);
    void RadioButtonActionPNG(void);
+   void RadioButtonActionY4M(void);
+   void RadioButtonActionAdaptive(void);
+   void RadioButtonActionDelta(void);
+   void RadioButtonActionPacked(void);
 
    void RadioButtonActionCaptureRGB(void);
    void RadioButtonActionCaptureBayer(void);
@@ -152,7 +163,9 @@ class FormWindow : public QMainWindow
    void DeviceConnected(bool State);
    void DeviceError(QString Message);
    void RenderError(QString Message);
+   void FilterReady(void);
    void CaptureError(QString Message);
+   void CaptureStatus(QString Message);
    };
 
 
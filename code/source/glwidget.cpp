@@ -23,8 +23,10 @@
 
    Parent : Pointer to the parent widget, must not be nullptr.
    Main   : Pointer to the main window, must not be nullptr.
+   Share  : Widget to share OpenGL objects with, such as the textures of the
+            asset cache, or nullptr.
   ---------------------------------------------------------------------------*/
-GLWidget::GLWidget(QMainWindow* Main, QWidget* Parent, NAMESPACE_PROJECT::Buffers &Buffer) : QGLWidget(QGLFormat(QGL::SampleBuffers), Parent), /*QThread(Parent),*/ Buffer(Buffer)
+GLWidget::GLWidget(QMainWindow* Main, QWidget* Parent, NAMESPACE_PROJECT::Buffers &Buffer, const QGLWidget* Share) : QGLWidget(QGLFormat(QGL::SampleBuffers), Parent, Share), /*QThread(Parent),*/ Buffer(Buffer)
    {
    Clear();
 
@@ -34,6 +36,7 @@ GLWidget::GLWidget(QMainWindow* Main, QWidget* Parent, NAMESPACE_PROJECT::Buffer
    GLWidget::Main = Main;
 
    QObject::connect(this, SIGNAL(SignalError(QString)), Main, SLOT(RenderError(QString)));
+   QObject::connect(this, SIGNAL(SignalFilterReady()), Main, SLOT(FilterReady()));
 
    makeCurrent();
 
@@ -48,6 +51,19 @@ GLWidget::GLWidget(QMainWindow* Main, QWidget* Parent, NAMESPACE_PROJECT::Buffer
 
    Model.Plane(1, NAMESPACE_PROJECT::Mesh::ModeSolid);
    Model.Buffer(false);
+
+   //Filters are set up in a context of their own, if objects can be shared
+   Loader = new FilterThread(this, this, &Buffer);
+   makeCurrent();
+
+   if (!Loader->Shared())
+      {
+      debug("OpenGL contexts do not share objects, filters are set up while rendering.\n");
+      delete Loader;
+      Loader = nullptr;
+      makeCurrent();
+      }
+   else {QObject::connect(Loader, SIGNAL(finished()), this, SLOT(updateGL()));}
    }
 
 /*---------------------------------------------------------------------------
@@ -66,6 +82,7 @@ void GLWidget::Clear(void)
    {
    FX = nullptr;
    Capture = nullptr;
+   Loader = nullptr;
    Count = 0;
    BufferCount = 1;
    Sync = true;
@@ -81,8 +98,11 @@ void GLWidget::Destroy(void)
 
    Model.Destroy();
    
+   //The filters must go before the worker context
+   if (Loader != nullptr) {Loader->prepare(nullptr);}
    delete FX;
    delete Capture;
+   delete Loader;
    
    Clear();
    }
@@ -90,6 +110,12 @@ void GLWidget::Destroy(void)
 /*---------------------------------------------------------------------------
    Attaches a filter object to the widget. Note: Must set the OpenGL context 
    to current current in this function.
+
+   The new filter is set up on the filter thread, while the current filter
+   keeps rendering. It replaces the current filter on the first render 
+   event after it is ready, and SignalFilterReady( ) is emitted. Until 
+   then, GetFilter( ) returns the current filter. A filter that is still 
+   being set up is dropped when another one is attached.
   
    FX : Pointer to the new filter object. This class will take ownership of
         the filter object and it will handle its destruction. If this 
@@ -98,20 +124,32 @@ void GLWidget::Destroy(void)
 void GLWidget::AttachFilter(NAMESPACE_PROJECT::Filter* FX)
    {
    makeCurrent();
+
+   if (Loader != nullptr && FX != nullptr) 
+      {
+      Loader->prepare(FX);
+      return;
+      }
+
+   if (Loader != nullptr) {Loader->prepare(nullptr);}
+
    delete GLWidget::FX;
    GLWidget::FX = FX;
    }
 
 /*---------------------------------------------------------------------------
-   Starts a capture stream for the attached effects filter.
+   Starts a capture stream for the attached effects filter. If Source 
+   selects one of the sensor streams, the frames are taken directly from the
+   Kinect buffers instead of the filter output, or from the pre-roll Ring,
+   if one is given.
   ---------------------------------------------------------------------------*/
-void GLWidget::CaptureOpen(const QString &Path, const QString &Prefix, CaptureThread::CapFormat Format, bool Compress)
+void GLWidget::CaptureOpen(const QString &Path, const QString &Prefix, CaptureThread::CapFormat Format, bool Compress, CaptureThread::CapSource Source, NAMESPACE_PROJECT::PreRoll* Ring)
    {
    if (Error || FX == nullptr) {return;}
 
    CaptureClose();
    
-   Capture = new CaptureThread(Main, Path, Prefix, Format, Compress);
+   Capture = new CaptureThread(Main, Path, Prefix, Format, Compress, Source, &Buffer, FX->GetColour(), Ring);
    }
 
 /*---------------------------------------------------------------------------
@@ -275,15 +313,63 @@ void GLWidget::resizeGL(int X, int Y)
       }
    }
 
+/*---------------------------------------------------------------------------
+   Returns the number of mipmap levels needed for displaying the filter 
+   output, from the minification of the frame buffer object in the widget.
+  ---------------------------------------------------------------------------*/
+NAMESPACE_PROJECT::uint GLWidget::Levels(void)
+   {
+   NAMESPACE_PROJECT::vector2u Res = FX->Resolution();
+   if (width() < 1 || height() < 1) {return 0;}
+
+   //Aspect ratio is preserved, so the larger ratio applies
+   float Scale = NAMESPACE_PROJECT::Math::Max((float)Res.X / (float)width(), (float)Res.Y / (float)height());
+   if (Scale <= 1.0f) {return 0;}
+
+   return (NAMESPACE_PROJECT::uint)ceilf(logf(Scale) / logf(2.0f));
+   }
+
+/*---------------------------------------------------------------------------
+   Replaces the current filter with the one set up by the filter thread.
+   Assumes the OpenGL context is current.
+  ---------------------------------------------------------------------------*/
+void GLWidget::Swap(void)
+   {
+   QString Message;
+   NAMESPACE_PROJECT::Filter* Ready = Loader->Take(Message);
+
+   if (Ready == nullptr) 
+      {
+      QByteArray Text = Message.toAscii();
+      throw dexception("%s", Text.constData());
+      }
+
+   try {Ready->Attach();}
+   catch (...) {delete Ready; throw;}
+
+   delete FX;
+   FX = Ready;
+
+   Count = 0;
+   UpdateView();
+
+   SignalFilterReady();
+   }
+
 /*---------------------------------------------------------------------------
    Render event. QT makes the OpenGL context current prior calling this 
    function.
   ---------------------------------------------------------------------------*/
 void GLWidget::paintGL(void)
    {
-   if (Error || FX == nullptr) {return;}
+   if (Error) {return;}
 
    try {
+      //Swap in a new filter once the filter thread is done with it
+      if (Loader != nullptr && Loader->Ready()) {Swap();}
+
+      if (FX == nullptr) {return;}
+
       //Force clear buffer on first couple of calls
       if (Count < BufferCount)
          {
@@ -303,17 +389,27 @@ void GLWidget::paintGL(void)
       //Update filter with new content (returns false if no relevant buffers were updated)
       if (!FX->Update(Buffer)) {return;}
 
-      //Render effects
+      //Render effects, snapped to the colour map while capturing palette indices
+      FX->SetIndexed(Capture != nullptr && Capture->UsesColourMap());
       FX->Bind();
       FX->Render();
       FX->Unbind();
 
+      //Mipmaps are only needed when the widget is smaller than the frame buffer object
+      FX->Mipmap(Levels());
+
       //Capture if appropriate
       bool Dropped = false;
       if (Capture != nullptr)
          {
-         Dropped = !FX->Capture(Capture->Texture(), Sync);
-         if (!Dropped) {Capture->update();}
+         if (Capture->GetSource() == CaptureThread::SourceFilter)
+            {
+            if (Capture->UsesColourMap()) {Dropped = !FX->Capture(Capture->Texture(), Capture->ColourMap(), Sync);}
+            else {Dropped = !FX->Capture(Capture->Texture(), Sync);}
+            if (!Dropped) {Capture->update();}
+            else {Capture->skip();}
+            }
+         else {Capture->update();}
          }
 
       //Display the frame buffer object in the GLWidget
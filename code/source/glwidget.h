@@ -13,6 +13,7 @@
   ---------------------------------------------------------------------------*/
 #include "buffers.h"
 #include "thread_capture.h"
+#include "thread_filter.h"
 #include "common.h"
 #include "filter.h"
 #include "mesh.h"
@@ -42,13 +43,14 @@ class GLWidget : public QGLWidget
    NAMESPACE_PROJECT::uiter Count;                 //Frame counter
    NAMESPACE_PROJECT::uiter BufferCount;           //Number of buffers
    CaptureThread* Capture;                         //Stream the FBO to file
+   FilterThread* Loader;                           //Sets up new filters in the background, or nullptr if contexts cannot share objects
    bool Sync;                                      //Capture in synchronous mode
    bool Error;                                     //Indicates than an error has occured
 
    //---- Methods ----
    public:
 
-   GLWidget(QMainWindow* Main, QWidget* Parent, NAMESPACE_PROJECT::Buffers &Buffer);
+   GLWidget(QMainWindow* Main, QWidget* Parent, NAMESPACE_PROJECT::Buffers &Buffer, const QGLWidget* Share = nullptr);
    ~GLWidget(void);
 
    private:
@@ -61,6 +63,8 @@ class GLWidget : public QGLWidget
    void initializeGL(void);
    void resizeGL(int X, int Y);
    void paintGL(void);
+   void Swap(void);
+   NAMESPACE_PROJECT::uint Levels(void);
 
    public:
 
@@ -69,9 +73,10 @@ class GLWidget : public QGLWidget
    NAMESPACE_PROJECT::Filter* GetFilter(void) {return FX;}
 
    //Capture interface
-   void CaptureOpen(const QString &Path, const QString &Prefix, CaptureThread::CapFormat Format, bool Compress);
+   void CaptureOpen(const QString &Path, const QString &Prefix, CaptureThread::CapFormat Format, bool Compress, CaptureThread::CapSource Source = CaptureThread::SourceFilter, NAMESPACE_PROJECT::PreRoll* Ring = nullptr);
    void CaptureClose(void);
    void CaptureSync(bool Sync) {GLWidget::Sync = Sync;}
+   const CaptureThread* GetCapture(void) const {return Capture;}
    
    //Widget updates
    void UpdateGeometry(const QRect &Rect);
@@ -80,6 +85,7 @@ class GLWidget : public QGLWidget
    signals:
 
    void SignalError(QString Message);
+   void SignalFilterReady(void);
    };
 
 
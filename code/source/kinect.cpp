@@ -72,6 +72,10 @@ void Kinect::Clear(void)
 
    ClipMode = Kinect::EraseBack;
    Linear = true;
+
+   Generator = nullptr;
+   GeneratorVideo.fetchAndStoreOrdered(0);
+   GeneratorDepth.fetchAndStoreOrdered(0);
    }
 
 /*---------------------------------------------------------------------------
@@ -83,6 +87,8 @@ void Kinect::Destroy(void)
 
    if (Context != nullptr) {freenect_shutdown(Context);}
 
+   delete Generator;
+
    DepthTable.Destroy();
 
    Clear();
@@ -163,16 +169,21 @@ void Kinect::DepthTableSetup(void)
 
       default : throw dexception("Unknown clipping mode enumeration.");
       }
+
+   Buffer.SetDepthTable(DepthTable);
    }
 
 /*---------------------------------------------------------------------------
    This function converts the raw 11-bit depth values (in 16-bit alignment)
-   to linear values as specified by DepthTable. This should be called
-   externally by a separate thread.
+   to linear values as specified by DepthTable. The conversion is applied to 
+   the back buffer, just before it's swapped to the front. The unprocessed 
+   values are preserved in the back raw depth texture, which is swapped 
+   to the front together with the back buffer.
   ---------------------------------------------------------------------------*/
 void Kinect::DepthPostProcess(void)
    {
-   Texture &Depth = Buffer.GetDepth(Buffers::Front);
+   Texture &Depth = Buffer.GetDepth(Buffers::Back);
+   Texture &DepthRaw = Buffer.GetDepthRaw(Buffers::Back);
 
    MutexControl Mutex(Depth.GetMutexHandle());
    if (!Mutex.LockRequest()) {return;}
@@ -182,14 +193,141 @@ void Kinect::DepthPostProcess(void)
 
    const usize Size = Depth.Size() / sizeof(uint16);
 
-   for (uiter I = 0; I < Size; I++)
+   //Readers only lock the front raw texture
+   MutexControl MutexRaw(DepthRaw.GetMutexHandle());
+   MutexRaw.Lock();
+
+   if (DepthRaw.Size() == Depth.Size())
+      {
+      uint16* Raw = reinterpret_cast<uint16*>(DepthRaw.Pointer());
+
+      for (uiter I = 0; I < Size; I++)
+         {
+         Raw[I] = Ptr[I] & 0x07FF;
+         Ptr[I] = Table[Raw[I]];
+         }
+
+      MutexRaw.Unlock();
+      }
+   else
       {
-      Ptr[I] = Table[Ptr[I] & 0x07FF];
+      for (uiter I = 0; I < Size; I++)
+         {
+         Ptr[I] = Table[Ptr[I] & 0x07FF];
+         }
       }
 
    Mutex.Unlock();
    }
 
+/*---------------------------------------------------------------------------
+   Reallocates a set of buffers for fed frames, if their resolution or type
+   differs from Res and Type. If Raw is set, the raw depth textures are 
+   reallocated as well.
+  ---------------------------------------------------------------------------*/
+void Kinect::FeedSetup(Texture &Front, Texture &Back, bool Raw, const vector2u &Res, Texture::TexType Type)
+   {
+   vector2u Current = Back.Resolution();
+   if (Current.U == Res.U && Current.V == Res.V && Back.DataType() == Type && Back.Size() > 0) {return;}
+
+   MutexControl MutexFront(Front.GetMutexHandle());
+   MutexControl MutexBack(Back.GetMutexHandle());
+   MutexFront.Lock();
+   MutexBack.Lock();
+
+   Front.Create(Res, Type);
+   Back.Create(Res, Type);
+   Front.ClearData();
+   Back.ClearData();
+
+   if (!Raw) {return;}
+
+   Texture &RawFront = Buffer.GetDepthRaw(Buffers::Front);
+   Texture &RawBack = Buffer.GetDepthRaw(Buffers::Back);
+   MutexControl MutexRawFront(RawFront.GetMutexHandle());
+   MutexControl MutexRawBack(RawBack.GetMutexHandle());
+   MutexRawFront.Lock();
+   MutexRawBack.Lock();
+
+   RawFront.Create(Res, Type);
+   RawBack.Create(Res, Type);
+   RawFront.ClearData();
+   RawBack.ClearData();
+   }
+
+/*---------------------------------------------------------------------------
+   Publishes a frame that did not come from the sensor, such as a recorded
+   or generated frame, through the same path as the sensor callbacks. Video
+   frames are copied as they are. Depth frames must hold raw 11-bit values
+   in Texture::TypeDepth, they are converted with the depth table. The
+   buffers are reallocated when the frame size changes. Returns false if
+   the buffers were locked, and the frame was dropped.
+
+   Frame : Source frame.
+   Time  : Time step reported for the frame.
+  ---------------------------------------------------------------------------*/
+bool Kinect::FeedVideo(const Texture &Frame, uint32 Time)
+   {
+   Texture &VideoFront = Buffer.GetVideo(Buffers::Front);
+   Texture &VideoBack = Buffer.GetVideo(Buffers::Back);
+
+   FeedSetup(VideoFront, VideoBack, false, Frame.Resolution(), Frame.DataType());
+
+   MutexControl MutexBack(VideoBack.GetMutexHandle());
+   if (!MutexBack.LockRequest()) {return false;}
+
+   memcpy(VideoBack.Pointer(), Frame.Pointer(), Math::Min(VideoBack.Size(), Frame.Size()));
+
+   MutexBack.Unlock();
+
+   if (!Buffer.VideoSwap(Time)) {return false;}
+
+   VideoTime = Time;
+   return true;
+   }
+
+bool Kinect::FeedDepth(const Texture &Frame, uint32 Time)
+   {
+   if (Frame.DataType() != Texture::TypeDepth) {throw dexception("Depth frames must be 16-bit.");}
+
+   Texture &DepthFront = Buffer.GetDepth(Buffers::Front);
+   Texture &DepthBack = Buffer.GetDepth(Buffers::Back);
+
+   FeedSetup(DepthFront, DepthBack, true, Frame.Resolution(), Texture::TypeDepth);
+
+   MutexControl MutexBack(DepthBack.GetMutexHandle());
+   if (!MutexBack.LockRequest()) {return false;}
+
+   memcpy(DepthBack.Pointer(), Frame.Pointer(), Math::Min(DepthBack.Size(), Frame.Size()));
+
+   MutexBack.Unlock();
+
+   DepthPostProcess();
+
+   if (!Buffer.DepthSwap(Time)) {return false;}
+
+   DepthTime = Time;
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Replaces the sensor with a generated frame source, for load testing. The
+   generated frames are published from Update( ), through FeedVideo( ) and
+   FeedDepth( ), while the streams are started. Must be called before the
+   device thread starts.
+
+   Config : Generator configuration, or nullptr to use the sensor again.
+  ---------------------------------------------------------------------------*/
+void Kinect::SetSynthetic(const Synthetic::Settings* Config)
+   {
+   delete Generator;
+   Generator = nullptr;
+   GeneratorVideo.fetchAndStoreOrdered(0);
+   GeneratorDepth.fetchAndStoreOrdered(0);
+
+   if (Config != nullptr) {Generator = new Synthetic(*Config);}
+   }
+
 /*---------------------------------------------------------------------------
    Depth range helper functions.
   ---------------------------------------------------------------------------*/
@@ -247,6 +385,7 @@ void Kinect::SetLinear(bool State)
   ---------------------------------------------------------------------------*/
 bool Kinect::Open(void)
    {
+   if (Generator != nullptr) {return true;}
    if (Context == nullptr) {return false;}
    if (Device != nullptr) {return true;}
 
@@ -414,16 +553,26 @@ void Kinect::SetupDepth(void)
 
    Texture &DepthFront = Buffer.GetDepth(Buffers::Front);
    Texture &DepthBack = Buffer.GetDepth(Buffers::Back);
+   Texture &RawFront = Buffer.GetDepthRaw(Buffers::Front);
+   Texture &RawBack = Buffer.GetDepthRaw(Buffers::Back);
 
    MutexControl MutexFront(DepthFront.GetMutexHandle());
    MutexControl MutexBack(DepthBack.GetMutexHandle());
+   MutexControl MutexRawFront(RawFront.GetMutexHandle());
+   MutexControl MutexRawBack(RawBack.GetMutexHandle());
    MutexFront.Lock();
    MutexBack.Lock();
+   MutexRawFront.Lock();
+   MutexRawBack.Lock();
 
    DepthFront.Create(vector2u(FREENECT_FRAME_W, FREENECT_FRAME_H), Texture::TypeDepth);
    DepthBack.Create(vector2u(FREENECT_FRAME_W, FREENECT_FRAME_H), Texture::TypeDepth);
+   RawFront.Create(vector2u(FREENECT_FRAME_W, FREENECT_FRAME_H), Texture::TypeDepth);
+   RawBack.Create(vector2u(FREENECT_FRAME_W, FREENECT_FRAME_H), Texture::TypeDepth);
    DepthFront.ClearData();
    DepthBack.ClearData();
+   RawFront.ClearData();
+   RawBack.ClearData();
 
    if (DepthFront.Size() != FREENECT_DEPTH_11BIT_SIZE) {throw dexception("Incorrect depth texture size.");}
    if (DepthBack.Size() != FREENECT_DEPTH_11BIT_SIZE) {throw dexception("Incorrect depth texture size.");}
@@ -445,6 +594,7 @@ void Kinect::SetupDepth(void)
   ---------------------------------------------------------------------------*/
 void Kinect::StartVideo(void)
    {
+   if (Generator != nullptr) {GeneratorVideo.fetchAndStoreOrdered(1); return;}
    if (Device == nullptr) {return;}
 
    Texture &VideoFront = Buffer.GetVideo(Buffers::Front);
@@ -455,6 +605,7 @@ void Kinect::StartVideo(void)
 
 void Kinect::StartDepth(void)
    {
+   if (Generator != nullptr) {GeneratorDepth.fetchAndStoreOrdered(1); return;}
    if (Device == nullptr) {return;}
 
    Texture &DepthFront = Buffer.GetDepth(Buffers::Front);
@@ -468,12 +619,14 @@ void Kinect::StartDepth(void)
   ---------------------------------------------------------------------------*/
 void Kinect::StopVideo(void)
    {
+   GeneratorVideo.fetchAndStoreOrdered(0);
    if (Device == nullptr) {return;}
    freenect_stop_video(Device);
    }
 
 void Kinect::StopDepth(void)
    {
+   GeneratorDepth.fetchAndStoreOrdered(0);
    if (Device == nullptr) {return;}
    freenect_stop_depth(Device);
    }
@@ -484,16 +637,36 @@ void Kinect::StopDepth(void)
   ---------------------------------------------------------------------------*/
 bool Kinect::Connected(void)
    {
+   if (Generator != nullptr) {return true;}
    return Context != nullptr && Device != nullptr;
    }
 
 /*---------------------------------------------------------------------------
    Update function for the USB event processor. Returns true if the device is
    conntected, returns false otherwise. This method should be called
-   periodically from a separate thread.
+   periodically from a separate thread. With a generated source, waits for
+   the next frame to be due instead, and publishes it to the started
+   streams. Frames are skipped rather than drawn while both streams are
+   stopped.
   ---------------------------------------------------------------------------*/
 bool Kinect::Update(void)
    {
+   if (Generator != nullptr)
+      {
+      Generator->Wait();
+
+      bool Video = GeneratorVideo.fetchAndAddOrdered(0) != 0;
+      bool Depth = GeneratorDepth.fetchAndAddOrdered(0) != 0;
+      if (!Video && !Depth) {Generator->Skip(); return true;}
+
+      Generator->Render();
+
+      if (Video) {FeedVideo(Generator->GetVideo(), Generator->GetTime());}
+      if (Depth) {FeedDepth(Generator->GetDepth(), Generator->GetTime());}
+
+      return true;
+      }
+
    if (Context == nullptr) {return false;}
 
    if (freenect_process_events(Context) != 0)
@@ -547,7 +720,7 @@ void Kinect::HandlerVideoRGB(freenect_device* Device, KINECT_VIDEO_TYPE* Buffer,
 
    #endif
 
-   if (!obj->Buffer.VideoSwap()) {return;}
+   if (!obj->Buffer.VideoSwap((uint32)Time)) {return;}
 
    #if !defined (KINECT_UNOFFICIAL)
 
@@ -590,7 +763,7 @@ void Kinect::HandlerVideoBayer(freenect_device* Device, KINECT_VIDEO_TYPE* Buffe
 
    #endif
 
-   if (!obj->Buffer.VideoSwap()) {return;}
+   if (!obj->Buffer.VideoSwap((uint32)Time)) {return;}
 
    #if !defined (KINECT_UNOFFICIAL)
 
@@ -633,7 +806,7 @@ void Kinect::HandlerVideoIR(freenect_device* Device, KINECT_VIDEO_TYPE* Buffer,
 
    #endif
 
-   if (!obj->Buffer.VideoSwap()) {return;}
+   if (!obj->Buffer.VideoSwap((uint32)Time)) {return;}
 
    #if !defined (KINECT_UNOFFICIAL)
 
@@ -676,7 +849,9 @@ void Kinect::HandlerDepth(freenect_device* Device, KINECT_DEPTH_TYPE* Buffer, ui
 
    #endif
 
-   if (!obj->Buffer.DepthSwap()) {return;}
+   obj->DepthPostProcess();
+
+   if (!obj->Buffer.DepthSwap((uint32)Time)) {return;}
 
    #if !defined (KINECT_UNOFFICIAL)
 
@@ -691,8 +866,6 @@ void Kinect::HandlerDepth(freenect_device* Device, KINECT_DEPTH_TYPE* Buffer, ui
 
    #endif
 
-   obj->DepthPostProcess();
-
    obj->DepthTime = (uint32)Time;
    }
 
@@ -13,6 +13,7 @@
   ---------------------------------------------------------------------------*/
 #include "buffers.h"
 #include "common.h"
+#include "synthetic.h"
 #include "texture.h"
 #include "vector.h"
 
@@ -113,6 +114,10 @@ class Kinect
    DepthRange RangeRaw;                            //Raw depth scale 
    bool Linear;                                    //Depth range is transformed to linear range
 
+   Synthetic* Generator;                           //Generated frame source, replaces the sensor when set
+   QAtomicInt GeneratorVideo;                      //Generated streams are started, set from the GUI thread and read by the device thread
+   QAtomicInt GeneratorDepth;
+
    //---- Methods ----
    public:
 
@@ -132,6 +137,7 @@ class Kinect
 
    void DepthTableSetup(void);
    void DepthPostProcess(void);
+   void FeedSetup(Texture &Front, Texture &Back, bool Raw, const vector2u &Res, Texture::TexType Type);
 
    public:
 
@@ -163,6 +169,16 @@ class Kinect
    inline float GetMax(void) {return Linear ? RangeMet.Max : RangeRaw.Max;}
    inline float GetNear(void) {return Linear ? RangeMet.Near : RangeRaw.Near;}
    inline float GetFar(void) {return Linear ? RangeMet.Far : RangeRaw.Far;}
+
+   //Frames from other sources, such as recordings
+   bool FeedVideo(const Texture &Frame, uint32 Time = 0);
+   bool FeedDepth(const Texture &Frame, uint32 Time = 0);
+   void SetSynthetic(const Synthetic::Settings* Config);
+   inline bool IsSynthetic(void) const {return Generator != nullptr;}
+
+   //Sensor timing
+   inline uint32 GetVideoTime(void) const {return VideoTime;}
+   inline uint32 GetDepthTime(void) const {return DepthTime;}
    
    private:
 
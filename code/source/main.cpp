@@ -11,10 +11,15 @@
 /*---------------------------------------------------------------------------
    Header files
   ---------------------------------------------------------------------------*/
+#include "batch.h"
 #include "common.h"
 #include "debug.h"
 #include "form_window.h"
 #include "main.h"
+#include "shader_cache.h"
+#include "thread_pool.h"
+
+#include <csignal>
 
 
 /*---------------------------------------------------------------------------
@@ -74,6 +79,264 @@ void MainSetAssetDir(void)
       }
    }
 
+/*---------------------------------------------------------------------------
+   Sets the directory where compiled shader programs are cached.
+  ---------------------------------------------------------------------------*/
+void MainSetCacheDir(void)
+   {
+   QDir Dir = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+
+   QString DirPath = QDir::cleanPath(Dir.absoluteFilePath("shaders"));
+   QByteArray Path = DirPath.toAscii();
+
+   if (!Dir.exists(DirPath) && !Dir.mkpath(DirPath))
+      {
+      debug("Failed to create shader cache directory: %s\n", Path.constData());
+      return;
+      }
+
+   debug("Shader cache path: %s\n", Path.constData());
+   NAMESPACE_PROJECT::ShaderCache::SetPath(Path.constData());
+   }
+
+/*---------------------------------------------------------------------------
+   Parses one option of the synthetic frame source, at argv[I]. The options
+   are the resolution as <width>x<height>, -fps <rate> and -noise <amount>.
+   Returns true if the option was recognised, and advances I past its
+   value.
+  ---------------------------------------------------------------------------*/
+bool MainParseSynthetic(int &I, int argc, char** argv, NAMESPACE_PROJECT::Synthetic::Settings &Config)
+   {
+   unsigned int U = 0;
+   unsigned int V = 0;
+
+   if (strcmp(argv[I], "-fps") == 0 && I + 1 < argc) {Config.Rate = (float)atof(argv[++I]); return true;}
+   if (strcmp(argv[I], "-noise") == 0 && I + 1 < argc) {Config.Noise = (float)atof(argv[++I]); return true;}
+   if (sscanf(argv[I], "%ux%u", &U, &V) == 2) {Config.Res = NAMESPACE_PROJECT::vector2u(U, V); return true;}
+
+   return false;
+   }
+
+/*---------------------------------------------------------------------------
+   Command line transcoder, converts a capture directory of numbered TGA or
+   PNG frames into a frame archive, without starting the user interface:
+
+   kfx --transcode <directory> <archive> [-level 1..9] [-threads N]
+  ---------------------------------------------------------------------------*/
+int MainTranscode(int argc, char** argv)
+   {
+   QCoreApplication Application(argc, argv);
+
+   int Level = NAMESPACE_PROJECT::File::Archive::DefaultLevel;
+   int Threads = 0;
+   const char* Source = nullptr;
+   const char* Target = nullptr;
+
+   for (int I = 2; I < argc; I++)
+      {
+      if (strcmp(argv[I], "-level") == 0 && I + 1 < argc) {Level = atoi(argv[++I]);}
+      else if (strcmp(argv[I], "-threads") == 0 && I + 1 < argc) {Threads = atoi(argv[++I]);}
+      else if (Source == nullptr) {Source = argv[I];}
+      else if (Target == nullptr) {Target = argv[I];}
+      else {Source = nullptr; break;}
+      }
+
+   if (Source == nullptr || Target == nullptr || Level < 1 || Level > 9 || Threads < 0)
+      {
+      fprintf(stderr, "Usage: %s %s <directory> <archive> [-level 1..9] [-threads N]\n", argv[0], MAIN_ARG_TRANSCODE);
+      return MAIN_EXIT_ERROR;
+      }
+
+   try {
+      NAMESPACE_PROJECT::File::Transcoder Transcoder;
+      Transcoder.Run(Source, Target, Level, (NAMESPACE_PROJECT::usize)Threads, stdout);
+      }
+
+   catch (std::exception &e)
+      {
+      fprintf(stderr, "\n%s\n", e.what());
+      return MAIN_EXIT_ERROR;
+      }
+
+   catch (...)
+      {
+      fprintf(stderr, "\nTrapped an unhandled exception.\n");
+      return MAIN_EXIT_ERROR;
+      }
+
+   return 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Command line batch renderer, renders a recorded session through a filter
+   into numbered image files, without starting the user interface:
+
+   kfx --render <filter> <directory> [-depth <path>] [-video <path>] [-png] [-cpu] [-check]
+
+   With -check, every frame is compared with the reference renderer of the
+   filter, and the exit code is an error if any pixel differs, see also
+   MainCheck( ).
+  ---------------------------------------------------------------------------*/
+int MainRender(int argc, char** argv)
+   {
+   //An EGL context does not need a window system connection
+   #if defined (EGL)
+      QCoreApplication Application(argc, argv);
+   #else
+      QApplication Application(argc, argv);
+   #endif
+
+   Application.setApplicationName(NAMESPACE_PROJECT::AppName);
+   Application.setOrganizationName(NAMESPACE_PROJECT::AppOrg);
+   Application.setOrganizationDomain(NAMESPACE_PROJECT::AppAuthorWeb);
+
+   NAMESPACE_PROJECT::Batch::OutputFormat Format = NAMESPACE_PROJECT::Batch::FormatTGA;
+   const char* Name = nullptr;
+   const char* Target = nullptr;
+   const char* DepthPath = "";
+   const char* VideoPath = "";
+   NAMESPACE_PROJECT::Synthetic::Settings Synth;
+   long SynthFrames = 300;
+   bool Synthetic = false;
+   bool Software = false;
+   bool Check = false;
+   bool Valid = true;
+
+   Synth.Rate = 0.0f;
+
+   for (int I = 2; I < argc; I++)
+      {
+      if (strcmp(argv[I], "-depth") == 0 && I + 1 < argc) {DepthPath = argv[++I];}
+      else if (strcmp(argv[I], "-synthetic") == 0 && I + 1 < argc) {I++; Synthetic = true; Valid &= MainParseSynthetic(I, argc, argv, Synth);}
+      else if (strcmp(argv[I], "-frames") == 0 && I + 1 < argc) {SynthFrames = atol(argv[++I]); Valid &= SynthFrames > 0;}
+      else if (strcmp(argv[I], "-fps") == 0 || strcmp(argv[I], "-noise") == 0) {Valid &= MainParseSynthetic(I, argc, argv, Synth);}
+      else if (strcmp(argv[I], "-video") == 0 && I + 1 < argc) {VideoPath = argv[++I];}
+      else if (strcmp(argv[I], "-png") == 0) {Format = NAMESPACE_PROJECT::Batch::FormatPNG;}
+      else if (strcmp(argv[I], "-cpu") == 0) {Software = true;}
+      else if (strcmp(argv[I], "-check") == 0) {Check = true;}
+      else if (Name == nullptr) {Name = argv[I];}
+      else if (Target == nullptr) {Target = argv[I];}
+      else {Valid = false;}
+      }
+
+   if (!Valid || Name == nullptr || Target == nullptr)
+      {
+      fprintf(stderr, "Usage: %s %s <filter> <directory> [-depth <path>] [-video <path>] [-png] [-cpu] [-check]\n", argv[0], MAIN_ARG_RENDER);
+      fprintf(stderr, "       %s %s <filter> <directory> -synthetic <W>x<H> [-frames N] [-fps F] [-noise N] [-png] [-cpu] [-check]\n", argv[0], MAIN_ARG_RENDER);
+      fprintf(stderr, "Filters: %s\n", NAMESPACE_PROJECT::Batch::FilterNames());
+      fprintf(stderr, "Filters with -cpu: %s\n", NAMESPACE_PROJECT::Batch::SoftwareNames());
+      return MAIN_EXIT_ERROR;
+      }
+
+   int Error = 0;
+
+   try {
+      MainCreateLogFile();
+      MainSetAssetDir();
+      MainSetCacheDir();
+
+      NAMESPACE_PROJECT::Batch Renderer;
+      if (Synthetic) {Renderer.SetSynthetic(Synth, (NAMESPACE_PROJECT::uint64)SynthFrames);}
+      Renderer.SetSoftware(Software);
+      Renderer.SetCheck(Check);
+
+      NAMESPACE_PROJECT::Batch::Metrics Stats = Renderer.Run(Name, DepthPath, VideoPath, Target, Format, stdout);
+      if (Stats.Mismatches > 0) {Error = MAIN_EXIT_ERROR;}
+      }
+
+   catch (std::exception &e)
+      {
+      fprintf(stderr, "\n%s\n", e.what());
+      Error = MAIN_EXIT_ERROR;
+      }
+
+   catch (...)
+      {
+      fprintf(stderr, "\nTrapped an unhandled exception.\n");
+      Error = MAIN_EXIT_ERROR;
+      }
+
+   NAMESPACE_PROJECT::ThreadPool::DestroyShared();
+   NAMESPACE_PROJECT::Debug::Close();
+
+   return Error;
+   }
+
+/*---------------------------------------------------------------------------
+   Command line self-test, renders a fixed sequence of generated 640x480
+   frames with the software renderer of a filter, and compares each frame
+   with its reference renderer, without writing any files:
+
+   kfx --check [<filter>] [-frames N]
+
+   The filter defaults to nmap. The input is the same on every run, so the
+   reported rendering rate can be compared between builds and machines.
+   Prints PASSED and exits with 0 if every pixel is within a rounding step
+   of the reference, otherwise prints FAILED and exits with an error.
+  ---------------------------------------------------------------------------*/
+int MainCheck(int argc, char** argv)
+   {
+   QCoreApplication Application(argc, argv);
+
+   const char* Name = nullptr;
+   long Frames = 100;
+   bool Valid = true;
+
+   for (int I = 2; I < argc; I++)
+      {
+      if (strcmp(argv[I], "-frames") == 0 && I + 1 < argc) {Frames = atol(argv[++I]); Valid &= Frames > 0;}
+      else if (Name == nullptr) {Name = argv[I];}
+      else {Valid = false;}
+      }
+
+   if (!Valid)
+      {
+      fprintf(stderr, "Usage: %s %s [<filter>] [-frames N]\n", argv[0], MAIN_ARG_CHECK);
+      return MAIN_EXIT_ERROR;
+      }
+
+   if (Name == nullptr) {Name = "nmap";}
+
+   //Fixed input, generated as fast as possible
+   NAMESPACE_PROJECT::Synthetic::Settings Synth;
+   Synth.Res = NAMESPACE_PROJECT::vector2u(640, 480);
+   Synth.Rate = 0.0f;
+   Synth.Noise = 2.0f;
+
+   int Error = 0;
+
+   try {
+      MainSetAssetDir();
+
+      NAMESPACE_PROJECT::Batch Checker;
+      Checker.SetSynthetic(Synth, (NAMESPACE_PROJECT::uint64)Frames);
+      Checker.SetSoftware(true);
+      Checker.SetCheck(true);
+
+      NAMESPACE_PROJECT::Batch::Metrics Stats = Checker.Run(Name, "", "", "", NAMESPACE_PROJECT::Batch::FormatTGA, stdout);
+
+      bool Passed = Stats.Checked > 0 && Stats.Mismatches < 1;
+      printf("%s\n", Passed ? "PASSED" : "FAILED");
+      if (!Passed) {Error = MAIN_EXIT_ERROR;}
+      }
+
+   catch (std::exception &e)
+      {
+      fprintf(stderr, "\n%s\n", e.what());
+      Error = MAIN_EXIT_ERROR;
+      }
+
+   catch (...)
+      {
+      fprintf(stderr, "\nTrapped an unhandled exception.\n");
+      Error = MAIN_EXIT_ERROR;
+      }
+
+   NAMESPACE_PROJECT::ThreadPool::DestroyShared();
+
+   return Error;
+   }
+
 /*---------------------------------------------------------------------------
    Program entry point.
   ---------------------------------------------------------------------------*/
@@ -81,7 +344,34 @@ int cdeclare main(int argc, char** argv)
    {
    int Error = 0;
 
+   if (argc > 1 && strcmp(argv[1], MAIN_ARG_TRANSCODE) == 0) {return MainTranscode(argc, argv);}
+   if (argc > 1 && strcmp(argv[1], MAIN_ARG_RENDER) == 0) {return MainRender(argc, argv);}
+   if (argc > 1 && strcmp(argv[1], MAIN_ARG_CHECK) == 0) {return MainCheck(argc, argv);}
+
+   //Generated frames instead of the sensor, for load testing
+   NAMESPACE_PROJECT::Synthetic::Settings Synth;
+   bool Synthetic = argc > 1 && strcmp(argv[1], MAIN_ARG_SYNTHETIC) == 0;
+
+   for (int I = 2; Synthetic && I < argc; I++)
+      {
+      if (!MainParseSynthetic(I, argc, argv, Synth))
+         {
+         fprintf(stderr, "Usage: %s %s [<W>x<H>] [-fps F] [-noise N]\n", argv[0], MAIN_ARG_SYNTHETIC);
+         return MAIN_EXIT_ERROR;
+         }
+      }
+
    Q_INIT_RESOURCE(kfx_resource);
+
+   //A reader closing a Y4M capture pipe should produce an error, rather than terminate the process
+   #if !defined (WINDOWS)
+      signal(SIGPIPE, SIG_IGN);
+   #endif
+
+   //Filters are set up on a worker thread with an OpenGL context of its own
+   #if defined (LINUX)
+      QCoreApplication::setAttribute(Qt::AA_X11InitThreads);
+   #endif
    
    QApplication Application(argc, argv);
 
@@ -93,6 +383,7 @@ int cdeclare main(int argc, char** argv)
 
       MainCreateLogFile();
       MainSetAssetDir();
+      MainSetCacheDir();
 
       if (!QGLFormat::hasOpenGL())
          {throw dexception("This system does not support OpenGL.");}
@@ -100,7 +391,7 @@ int cdeclare main(int argc, char** argv)
       if (!QGLFramebufferObject::hasOpenGLFramebufferObjects())
          {throw dexception("This system does not support OpenGL framebuffer objects.");}
 
-      FormWindow Window;
+      FormWindow Window(nullptr, Synthetic ? &Synth : nullptr);
       Window.show();
 
       Error = Application.exec();
@@ -118,6 +409,7 @@ int cdeclare main(int argc, char** argv)
       Error = MAIN_EXIT_ERROR;
       }
 
+   NAMESPACE_PROJECT::ThreadPool::DestroyShared();
    NAMESPACE_PROJECT::Debug::Close();
 
    return Error;
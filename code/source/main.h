@@ -12,12 +12,17 @@
    Header files
   ---------------------------------------------------------------------------*/
 #include "common.h"
+#include "synthetic.h"
 
 
 /*---------------------------------------------------------------------------
    Definitions
   ---------------------------------------------------------------------------*/
 #define MAIN_EXIT_ERROR -1
+#define MAIN_ARG_TRANSCODE "--transcode"
+#define MAIN_ARG_RENDER "--render"
+#define MAIN_ARG_SYNTHETIC "--synthetic"
+#define MAIN_ARG_CHECK "--check"
 
 
 /*---------------------------------------------------------------------------
@@ -25,6 +30,10 @@
   ---------------------------------------------------------------------------*/
 void MainSetAssetDir(void);
 void MainCreateLogFile(void);
+bool MainParseSynthetic(int &I, int argc, char** argv, NAMESPACE_PROJECT::Synthetic::Settings &Config);
+int MainTranscode(int argc, char** argv);
+int MainRender(int argc, char** argv);
+int MainCheck(int argc, char** argv);
 int cdeclare main(int argc, char** argv);
 
 
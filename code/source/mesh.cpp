@@ -307,6 +307,19 @@ void Mesh::Render(void) const
    if (VBOID < 1 || ICount < 1) {return;}
    glDrawElements((GLenum)Mode, ICount, GL_UNSIGNED_INT, nullptr);
    }
+
+/*---------------------------------------------------------------------------
+   Renders several instances of the model with a single draw call. Assumes
+   Bind( ) was called prior, and that the per instance vertex attributes 
+   were set up by the caller. Requires ARB_draw_instanced.
+
+   Instances : Number of instances to render.
+  ---------------------------------------------------------------------------*/
+void Mesh::Render(usize Instances) const
+   {
+   if (VBOID < 1 || ICount < 1 || Instances < 1) {return;}
+   glDrawElementsInstancedARB((GLenum)Mode, ICount, GL_UNSIGNED_INT, nullptr, (GLsizei)Instances);
+   }
    
 
 //Close namespaces
@@ -93,6 +93,7 @@ class Mesh : public MutexHandle
    void Bind(usize Count) const;
    void Unbind(usize Count) const;
    void Render(void) const;
+   void Render(usize Instances) const;
    
    //Data access
    /*TO DO*/
@@ -0,0 +1,188 @@
+/*===========================================================================
+   Offscreen OpenGL Context
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___OFFSCREEN_CPP___
+#define ___OFFSCREEN_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "offscreen.h"
+
+#if defined (EGL)
+   #include <EGL/egl.h>
+#endif
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+Offscreen::Offscreen(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Offscreen::~Offscreen(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Offscreen::Clear(void)
+   {
+   #if defined (EGL)
+      Display = nullptr;
+      Surface = nullptr;
+      Context = nullptr;
+   #else
+      Buffer = nullptr;
+   #endif
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Offscreen::Destroy(void)
+   {
+   Close();
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Creates the context and makes it current on the calling thread.
+
+   Res : Surface size in pixels.
+  ---------------------------------------------------------------------------*/
+void Offscreen::Create(const vector2u &Res)
+   {
+   Close();
+
+   #if defined (EGL)
+
+      EGLDisplay EGLD = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+      if (EGLD == EGL_NO_DISPLAY) {throw dexception("eglGetDisplay( ) failed.");}
+
+      EGLint Major = 0;
+      EGLint Minor = 0;
+      if (!eglInitialize(EGLD, &Major, &Minor)) {throw dexception("eglInitialize( ) failed.");}
+      Display = EGLD;
+
+      const EGLint ConfigAttr[] =
+         {
+         EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+         EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+         EGL_RED_SIZE, 8,
+         EGL_GREEN_SIZE, 8,
+         EGL_BLUE_SIZE, 8,
+         EGL_DEPTH_SIZE, 24,
+         EGL_NONE
+         };
+
+      EGLConfig Config;
+      EGLint Count = 0;
+      if (!eglChooseConfig(EGLD, ConfigAttr, &Config, 1, &Count) || Count < 1)
+         {Close(); throw dexception("No suitable EGL configuration for desktop OpenGL.");}
+
+      const EGLint SurfaceAttr[] = {EGL_WIDTH, (EGLint)Res.U, EGL_HEIGHT, (EGLint)Res.V, EGL_NONE};
+
+      Surface = eglCreatePbufferSurface(EGLD, Config, SurfaceAttr);
+      if (Surface == EGL_NO_SURFACE) {Surface = nullptr; Close(); throw dexception("eglCreatePbufferSurface( ) failed.");}
+
+      if (!eglBindAPI(EGL_OPENGL_API)) {Close(); throw dexception("eglBindAPI( ) failed.");}
+
+      Context = eglCreateContext(EGLD, Config, EGL_NO_CONTEXT, nullptr);
+      if (Context == EGL_NO_CONTEXT) {Context = nullptr; Close(); throw dexception("eglCreateContext( ) failed.");}
+
+      debug("Created EGL %d.%d offscreen context.\n", (int)Major, (int)Minor);
+
+   #else
+
+      if (!QGLPixelBuffer::hasOpenGLPbuffers()) {throw dexception("This system does not support OpenGL pixel buffers.");}
+
+      Buffer = new QGLPixelBuffer(QSize((int)Res.U, (int)Res.V), QGLFormat::defaultFormat());
+      if (!Buffer->isValid()) {Close(); throw dexception("Failed to create an OpenGL pixel buffer.");}
+
+      debug("Created pixel buffer offscreen context.\n");
+
+   #endif
+
+   MakeCurrent();
+   }
+
+/*---------------------------------------------------------------------------
+   Releases the context.
+  ---------------------------------------------------------------------------*/
+void Offscreen::Close(void)
+   {
+   #if defined (EGL)
+
+      if (Display == nullptr) {return;}
+
+      eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+      if (Context != nullptr) {eglDestroyContext(Display, Context);}
+      if (Surface != nullptr) {eglDestroySurface(Display, Surface);}
+      eglTerminate(Display);
+
+      Display = nullptr;
+      Surface = nullptr;
+      Context = nullptr;
+
+   #else
+
+      if (Buffer == nullptr) {return;}
+
+      Buffer->doneCurrent();
+      delete Buffer;
+      Buffer = nullptr;
+
+   #endif
+   }
+
+/*---------------------------------------------------------------------------
+   Makes the context current on the calling thread.
+  ---------------------------------------------------------------------------*/
+void Offscreen::MakeCurrent(void)
+   {
+   if (!Ready()) {throw dexception("Offscreen context is not created.");}
+
+   #if defined (EGL)
+      if (!eglMakeCurrent(Display, Surface, Surface, Context)) {throw dexception("eglMakeCurrent( ) failed.");}
+   #else
+      if (!Buffer->makeCurrent()) {throw dexception("Failed to make the pixel buffer context current.");}
+   #endif
+   }
+
+/*---------------------------------------------------------------------------
+   Returns true if the context was created.
+  ---------------------------------------------------------------------------*/
+bool Offscreen::Ready(void) const
+   {
+   #if defined (EGL)
+      return Context != nullptr;
+   #else
+      return Buffer != nullptr;
+   #endif
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
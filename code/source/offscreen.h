@@ -0,0 +1,79 @@
+/*===========================================================================
+   Offscreen OpenGL Context
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___OFFSCREEN_H___
+#define ___OFFSCREEN_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "vector.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  OpenGL context without a window, for rendering filters in batch mode. The
+  filters draw into their own frame buffer objects, so the surface of the
+  context is never displayed, and may be small.
+
+  On Linux builds with EGL defined, the context is created through EGL with
+  a pbuffer surface. This works without an X server, and with Mesa it runs
+  on the llvmpipe software rasteriser, when EGL_PLATFORM=surfaceless is set
+  in the environment. Other builds use a Qt pixel buffer.
+  ---------------------------------------------------------------------------*/
+class Offscreen
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const uint DefaultSize = 16;             //Default surface size in pixels
+
+   //---- Member data ----
+   private:
+
+   #if defined (EGL)
+      void* Display;                               //EGLDisplay
+      void* Surface;                               //EGLSurface
+      void* Context;                               //EGLContext
+   #else
+      QGLPixelBuffer* Buffer;                      //Qt pixel buffer and its context
+   #endif
+
+   //---- Methods ----
+   public:
+
+   Offscreen(void);
+   ~Offscreen(void);
+
+   private:
+
+   Offscreen(const Offscreen &obj);                //Disable
+   Offscreen &operator = (const Offscreen &obj);   //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   public:
+
+   void Create(const vector2u &Res = Offscreen::DefaultSize);
+   void Close(void);
+   void MakeCurrent(void);
+   bool Ready(void) const;
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,373 @@
+/*===========================================================================
+   Pre-roll Frame Ring
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___PREROLL_CPP___
+#define ___PREROLL_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "math.h"
+#include "mutex.h"
+#include "preroll.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Constructor. Starts pulling frames from the sensor buffers straight away.
+
+   Buffer   : Sensor buffers.
+   Depth    : Pull frames from the raw depth buffer, instead of video.
+   Seconds  : Pre-roll duration, sets the number of slots in the ring.
+   Budget   : Memory budget for all slots, in bytes.
+   Compress : Deflate frames with the fastest zlib level.
+  ---------------------------------------------------------------------------*/
+PreRoll::PreRoll(Buffers &Buffer, bool Depth, uint Seconds, usize Budget, bool Compress)
+   {
+   Clear();
+
+   if (Seconds < 1 || Budget < 1) {throw dexception("Invalid parameters.");}
+
+   PreRoll::Buffer = &Buffer;
+   PreRoll::Depth = Depth;
+   PreRoll::Budget = Budget;
+   PreRoll::Compress = Compress;
+
+   usize Capacity = (usize)Seconds * PreRoll::FrameRate;
+   Slots.Create(Capacity);
+   for (uiter I = 0; I < Capacity; I++) {Slots[I] = new Slot;}
+
+   Spare = new Slot;
+   Taken = new Slot;
+
+   //Skip the sensor frame that is currently in the front buffer
+   UpdateID = Depth ? Buffer.GetDepthCounter() : Buffer.GetVideoCounter();
+
+   Thread = new Worker(this);
+   Thread->start();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+PreRoll::~PreRoll(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void PreRoll::Clear(void)
+   {
+   Buffer = nullptr;
+   Depth = false;
+   Compress = false;
+   Budget = 0;
+
+   Head = 0;
+   Count = 0;
+   Used = 0;
+   Spare = nullptr;
+   Taken = nullptr;
+
+   UpdateID = 0;
+   Dropped = 0;
+   Overwritten = 0;
+   Draining = false;
+
+   Thread = nullptr;
+   Exit = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void PreRoll::Destroy(void)
+   {
+   if (Thread != nullptr)
+      {
+      Mutex.lock();
+      Exit = true;
+      PollWait.wakeAll();
+      Mutex.unlock();
+
+      Thread->wait();
+      delete Thread;
+      }
+
+   if (Overwritten > 0) {debug("Pre-roll overwrote %llu frames.\n", (unsigned long long)Overwritten);}
+
+   for (uiter I = 0; I < Slots.Size(); I++) {delete Slots[I];}
+   Slots.Destroy();
+
+   delete Spare;
+   delete Taken;
+
+   Scratch.Destroy();
+   Packed.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Acquisition thread loop.
+  ---------------------------------------------------------------------------*/
+void PreRoll::Work(void)
+   {
+   try {
+      while (!Exit)
+         {
+         if (Acquire()) {Push(); continue;}
+
+         QMutexLocker Locker(&Mutex);
+         if (!Exit) {PollWait.wait(&Mutex, PreRoll::TimePoll);}
+         }
+      }
+
+   catch (std::exception &e)
+      {debug("Pre-roll acquisition stopped: %s\n", e.what());}
+
+   catch (...)
+      {debug("Pre-roll acquisition stopped: Trapped an unhandled exception.\n");}
+   }
+
+/*---------------------------------------------------------------------------
+   Copies the most recent sensor frame into Scratch, and deflates it into
+   Packed if required. The frame properties are stored in the Spare slot.
+   Returns false if there was no new frame, or if the buffer was locked.
+   The sensor buffer is only locked while the frame is copied.
+  ---------------------------------------------------------------------------*/
+bool PreRoll::Acquire(void)
+   {
+   uiter PrevID = UpdateID;
+
+   if (!(Depth ? Buffer->DepthUpdated(UpdateID) : Buffer->VideoUpdated(UpdateID))) {return false;}
+
+   if (UpdateID - PrevID > 1) {Dropped += (uint32)(UpdateID - PrevID - 1);}
+
+   Texture &Sensor = Depth ? Buffer->GetDepthRaw() : Buffer->GetVideo();
+   MutexControl MutexSensor(Sensor.GetMutexHandle());
+   if (!MutexSensor.LockRequest()) {Dropped++; return false;}
+
+   if (Sensor.Size() < 1) {return false;}
+
+   vector2u Res = Scratch.Resolution();
+   vector2u SensorRes = Sensor.Resolution();
+   if (Res.U != SensorRes.U || Res.V != SensorRes.V || Scratch.DataType() != Sensor.DataType())
+      {
+      Scratch.Create(SensorRes, Sensor.DataType());
+      }
+
+   memcpy(Scratch.Pointer(), Sensor.Pointer(), Sensor.Size());
+
+   Spare->Res = SensorRes;
+   Spare->Type = Sensor.DataType();
+   Spare->Time = Depth ? Buffer->GetDepthTime() : Buffer->GetVideoTime();
+   Spare->WallTime = (uint64)QDateTime::currentDateTime().toMSecsSinceEpoch();
+
+   MutexSensor.Unlock();
+
+   if (!Compress)
+      {
+      Spare->Size = Scratch.Size();
+      Spare->Packed = false;
+      return true;
+      }
+
+   uLongf Size = compressBound((uLong)Scratch.Size());
+   if (Packed.Size() < Size) {Packed.Create(Size - Packed.Size());}
+
+   if (compress2(Packed.Pointer(), &Size, Scratch.Pointer(), (uLong)Scratch.Size(), Z_BEST_SPEED) != Z_OK)
+      {throw dexception("Failed to compress pre-roll frame.");}
+
+   Spare->Size = Size;
+   Spare->Packed = true;
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Reallocates the slot data, if it is too small or more than twice the
+   required Size. Must be called with the Mutex locked.
+  ---------------------------------------------------------------------------*/
+void PreRoll::Resize(Slot* Item, usize Size)
+   {
+   usize Capacity = Item->Data.Size();
+   if (Capacity >= Size && Capacity <= Size * 2) {return;}
+
+   Used -= Capacity;
+   Item->Data.Destroy();
+   Item->Data.Create(Size);
+   Used += Item->Data.Size();
+   }
+
+/*---------------------------------------------------------------------------
+   Makes room in the ring for a frame of Size bytes. Memory is released from
+   unused slots first, then the oldest frames are evicted. While draining,
+   no frames are evicted, and false is returned if there is no room. Must be
+   called with the Mutex locked.
+  ---------------------------------------------------------------------------*/
+bool PreRoll::Reclaim(usize Size)
+   {
+   if (Size > Budget) {return false;}
+
+   usize Total = Slots.Size();
+   usize Spared = Spare->Data.Size();
+
+   if (Count == Total)
+      {
+      if (Draining) {return false;}
+
+      Slot* Old = Slots[Head];
+      Head = (Head + 1) % Total;
+      Count--;
+      Overwritten++;
+
+      //The slot is reused for the new frame, so only release memory if over budget
+      if (Used - Spared + Size > Budget) {Used -= Old->Data.Size(); Old->Data.Destroy();}
+      }
+
+   if (Used - Spared + Size <= Budget) {return true;}
+
+   for (uiter I = Count; I < Total; I++)
+      {
+      Slot* Item = Slots[(Head + I) % Total];
+      Used -= Item->Data.Size();
+      Item->Data.Destroy();
+      }
+
+   while (Used - Spared + Size > Budget && Count > 0)
+      {
+      if (Draining) {return false;}
+
+      Slot* Old = Slots[Head];
+      Used -= Old->Data.Size();
+      Old->Data.Destroy();
+      Head = (Head + 1) % Total;
+      Count--;
+      Overwritten++;
+      }
+
+   return Used - Spared + Size <= Budget;
+   }
+
+/*---------------------------------------------------------------------------
+   Moves the acquired frame into the ring. If there is no room while
+   draining, the frame is dropped.
+  ---------------------------------------------------------------------------*/
+void PreRoll::Push(void)
+   {
+   QMutexLocker Locker(&Mutex);
+
+   if (!Reclaim(Spare->Size)) {Dropped++; return;}
+
+   Resize(Spare, Spare->Size);
+   memcpy(Spare->Data.Pointer(), Spare->Packed ? Packed.Pointer() : Scratch.Pointer(), Spare->Size);
+   Spare->Dropped = Dropped;
+   Dropped = 0;
+
+   uiter Tail = (Head + Count) % Slots.Size();
+   Slot* Free = Slots[Tail];
+   Slots[Tail] = Spare;
+   Spare = Free;
+   Count++;
+
+   FrameWait.wakeAll();
+   }
+
+/*---------------------------------------------------------------------------
+   Turns the ring into a queue, which is drained by Pop( ). The frames that
+   are already in the ring form the pre-roll.
+  ---------------------------------------------------------------------------*/
+void PreRoll::Trigger(void)
+   {
+   QMutexLocker Locker(&Mutex);
+   Draining = true;
+   }
+
+/*---------------------------------------------------------------------------
+   Returns to pre-roll mode. Frames that were not drained are kept, and
+   become part of the next pre-roll.
+  ---------------------------------------------------------------------------*/
+void PreRoll::Release(void)
+   {
+   QMutexLocker Locker(&Mutex);
+   Draining = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Removes the oldest frame from the ring, and unpacks it into Frame.
+   Returns false if the ring is still empty after TimeOut ms. Only one
+   thread may call this at a time, and the caller must lock Frame.
+
+   Time     : Receives the sensor time step of the frame.
+   WallTime : Receives the acquisition time, in ms since the Unix epoch.
+   Dropped  : Incremented by the number of frames dropped before this one.
+  ---------------------------------------------------------------------------*/
+bool PreRoll::Pop(Texture &Frame, uint32 &Time, uint64 &WallTime, uint32 &Dropped, uint TimeOut)
+   {
+   Mutex.lock();
+
+   if (Count < 1 && TimeOut > 0) {FrameWait.wait(&Mutex, TimeOut);}
+   if (Count < 1) {Mutex.unlock(); return false;}
+
+   Slot* Item = Slots[Head];
+   Slots[Head] = Taken;
+   Taken = Item;
+   Head = (Head + 1) % Slots.Size();
+   Count--;
+
+   Mutex.unlock();
+
+   //Unpack outside the lock, the acquisition thread never touches Taken
+   vector2u Res = Frame.Resolution();
+   if (Res.U != Item->Res.U || Res.V != Item->Res.V || Frame.DataType() != Item->Type)
+      {
+      Frame.Create(Item->Res, Item->Type);
+      }
+
+   if (Item->Packed)
+      {
+      uLongf Size = (uLongf)Frame.Size();
+      if (uncompress(Frame.Pointer(), &Size, Item->Data.Pointer(), (uLong)Item->Size) != Z_OK || Size != Frame.Size())
+         {throw dexception("Failed to unpack pre-roll frame.");}
+      }
+   else
+      {
+      if (Item->Size != Frame.Size()) {throw dexception("Pre-roll frame size mismatch.");}
+      memcpy(Frame.Pointer(), Item->Data.Pointer(), Item->Size);
+      }
+
+   Time = Item->Time;
+   WallTime = Item->WallTime;
+   Dropped += Item->Dropped;
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the number of frames in the ring.
+  ---------------------------------------------------------------------------*/
+usize PreRoll::Frames(void)
+   {
+   QMutexLocker Locker(&Mutex);
+   return Count;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
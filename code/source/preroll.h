@@ -0,0 +1,143 @@
+/*===========================================================================
+   Pre-roll Frame Ring
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___PREROLL_H___
+#define ___PREROLL_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "buffers.h"
+#include "common.h"
+#include "texture.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Keeps the most recent sensor frames in memory, so that a recording can
+  start a few seconds before the operator pressed Record. A background
+  thread pulls frames from the Buffers front textures into a fixed ring of
+  pooled slots, optionally deflated with the fastest zlib level to extend
+  the window. The ring is bounded both by the number of slots, and by a
+  memory budget.
+
+  While idle, the oldest frames are overwritten. Once Trigger( ) is called,
+  the ring turns into a queue: the capture thread drains it with Pop( ),
+  starting with the pre-roll, while live frames keep arriving at the other
+  end. Acquisition never waits for the disk. If the queue fills up, the
+  newest frames are dropped and counted instead.
+
+  The budget covers all memory held by the slots, including slots that are
+  not in use. Slot memory is sized to the frames it holds, and is released
+  from unused slots first, then by evicting the oldest frames.
+  ---------------------------------------------------------------------------*/
+class PreRoll
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const uint FrameRate = 30;               //Nominal sensor frame rate, used for sizing the ring
+   static const uint DefaultSeconds = 10;          //Default pre-roll duration, in seconds
+   static const usize DefaultBudget = 256 << 20;   //Default memory budget for each ring, in bytes
+   static const uint TimePoll = 5;                 //Poll interval for new sensor frames, in ms
+
+   private:
+
+   class Slot                                      //Pooled frame storage
+      {
+      public:
+      Array<uint8, 4096> Data;                     //Frame data, sized to the frame
+      usize Size;                                  //Number of bytes used in Data
+      bool Packed;                                 //Data is deflated
+      vector2u Res;                                //Frame resolution
+      Texture::TexType Type;                       //Frame data type
+      uint32 Time;                                 //Sensor time step
+      uint64 WallTime;                             //Acquisition time, in ms since the Unix epoch
+      uint32 Dropped;                              //Number of frames dropped before this one
+      Slot(void) : Size(0), Packed(false), Res(0), Type(Texture::TypeRGB), Time(0), WallTime(0), Dropped(0) {}
+      };
+
+   class Worker : public QThread                   //Acquisition thread, no signals or slots
+      {
+      private:
+      PreRoll* Owner;
+      public:
+      Worker(PreRoll* Owner) : Owner(Owner) {}
+      void run(void) {Owner->Work();}
+      };
+
+   //---- Member data ----
+   private:
+
+   Buffers* Buffer;                                //Sensor buffers
+   bool Depth;                                     //Pull frames from the raw depth buffer, instead of video
+   bool Compress;                                  //Deflate frames in the ring
+   usize Budget;                                   //Memory budget for all slots, in bytes
+
+   Array<Slot*, 16> Slots;                         //Ring of slots, indexed from Head
+   uiter Head;                                     //Index of the oldest frame
+   usize Count;                                    //Number of frames in the ring
+   usize Used;                                     //Number of bytes allocated by all slots
+   Slot* Spare;                                    //Slot describing the frame being acquired
+   Slot* Taken;                                    //Slot being unpacked by Pop( )
+   Texture Scratch;                                //Copy of the sensor frame, deflated outside the buffer lock
+   Array<uint8, 4096> Packed;                      //Deflated copy of Scratch
+
+   uiter UpdateID;                                 //Last sensor buffer update ID
+   uint32 Dropped;                                 //Frames dropped since the last frame entered the ring
+   uint64 Overwritten;                             //Pre-roll frames overwritten while idle
+   bool Draining;                                  //Ring is drained by a capture thread
+
+   Worker* Thread;                                 //Acquisition thread
+   QMutex Mutex;                                   //Guards the ring state
+   QWaitCondition FrameWait;                       //Signals Pop( ) when frames are added
+   QWaitCondition PollWait;                        //Paces the acquisition thread, and wakes it on exit
+   bool Exit;                                      //Signals the acquisition thread to exit
+
+   //---- Methods ----
+   public:
+
+   PreRoll(Buffers &Buffer, bool Depth, uint Seconds = PreRoll::DefaultSeconds, usize Budget = PreRoll::DefaultBudget, bool Compress = true);
+   ~PreRoll(void);
+
+   private:
+
+   PreRoll(const PreRoll &obj);                    //Disable
+   PreRoll &operator = (const PreRoll &obj);       //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Acquisition
+   void Work(void);
+   bool Acquire(void);
+   void Push(void);
+   void Resize(Slot* Item, usize Size);
+   bool Reclaim(usize Size);
+
+   public:
+
+   void Trigger(void);
+   void Release(void);
+   bool Pop(Texture &Frame, uint32 &Time, uint64 &WallTime, uint32 &Dropped, uint TimeOut = 0);
+
+   usize Frames(void);
+   inline bool IsDepth(void) const {return Depth;}
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -14,6 +14,7 @@
 #include "common.h"
 #include "debug.h"
 #include "shader.h"
+#include "shader_cache.h"
 
 
 //Namespaces
@@ -157,7 +158,59 @@ void Shader::Delete(void)
    }
 
 /*---------------------------------------------------------------------------
-   Compiles all the shader sources then links them to a program ID.
+   Creates the program from a cached binary. Returns false if there is no
+   binary for the key, or the driver rejected it.
+  ---------------------------------------------------------------------------*/
+bool Shader::Restore(uint64 Key)
+   {
+   GLenum Format = 0;
+   Array<uint8, 256> Binary;
+   if (!ShaderCache::Find(Key, Format, Binary)) {return false;}
+
+   PID = glCreateProgram();
+   glProgramBinary(PID, Format, Binary.Pointer(), (GLsizei)Binary.Size());
+
+   GLint Status = GL_FALSE;
+   glGetProgramiv(PID, GL_LINK_STATUS, &Status);
+
+   //An unsupported format raises an error, which must not reach the caller
+   GLenum Error = glGetError();
+
+   if (Status == GL_FALSE || Error != GL_NO_ERROR)
+      {
+      debug("Cached binary of program %d was rejected by the driver.\n", PID);
+      glDeleteProgram(PID);
+      PID = 0;
+      return false;
+      }
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Adds the binary of the linked program to the cache.
+  ---------------------------------------------------------------------------*/
+void Shader::Save(uint64 Key)
+   {
+   GLint Length = 0;
+   glGetProgramiv(PID, GL_PROGRAM_BINARY_LENGTH, &Length);
+   if (Length < 1) {return;}
+
+   GLenum Format = 0;
+   Array<uint8, 256> Binary;
+   Binary.Create((usize)Length);
+   glGetProgramBinary(PID, Length, &Length, &Format, Binary.Pointer());
+
+   if (glGetError() != GL_NO_ERROR || Length < 1) {return;}
+
+   ShaderCache::Store(Key, Format, Binary);
+   }
+
+/*---------------------------------------------------------------------------
+   Compiles all the shader sources then links them to a program ID. When the
+   context supports program binaries, the program is restored from the
+   ShaderCache if possible, and added to the cache otherwise. The time spent
+   compiling and linking is logged.
 
    Keep : If set true the original sources will be kept in memory.
   ---------------------------------------------------------------------------*/
@@ -167,6 +220,20 @@ void Shader::Buffer(bool Keep)
 
    if (Source.Size() < 1) {return;}
 
+   QElapsedTimer Timer;
+   Timer.start();
+
+   bool Cached = ShaderCache::Supported();
+   uint64 Key = Cached ? ShaderCache::Key(Source) : 0;
+
+   if (Cached && Restore(Key))
+      {
+      if (!Keep) {Source.Destroy();}
+
+      debug("Restored program ID: %d from the cache in %.2f ms.\n", PID, (double)Timer.nsecsElapsed() * 1.0E-6);
+      return;
+      }
+
    GLint Status;
    Array<char> InfoLog;
 
@@ -205,6 +272,11 @@ void Shader::Buffer(bool Keep)
       //Attach shader to program
       glAttachShader(PID, SID[I]);
       }
+
+   qint64 CompileTime = Timer.nsecsElapsed();
+
+   //The binary is only retrievable if requested before linking
+   if (Cached) {glProgramParameteri(PID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);}
   
    //Link compiled shaders in program
    glLinkProgram(PID);
@@ -229,12 +301,16 @@ void Shader::Buffer(bool Keep)
    GLenum Error = glGetError();
    if (Error != GL_NO_ERROR) {throw dexception("OpenGL generated an error: %s", Debug::ErrorGL(Error));}
 
+   qint64 LinkTime = Timer.nsecsElapsed() - CompileTime;
+
+   if (Cached) {Save(Key);}
+
    if (!Keep)
       {
       Source.Destroy();
       }
 
-   debug("Committed program ID: %d.\n", PID);
+   debug("Committed program ID: %d, compiled in %.2f ms, linked in %.2f ms.\n", PID, (double)CompileTime * 1.0E-6, (double)LinkTime * 1.0E-6);
    }
 
 /*---------------------------------------------------------------------------
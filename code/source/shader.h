@@ -68,6 +68,14 @@ class Shader : public MutexHandle
    void Attach(const char* Code, ShaderType Type);
    void Attach(const std::string &Code, ShaderType Type);
 
+   private:
+
+   //Program binaries
+   bool Restore(uint64 Key);
+   void Save(uint64 Key);
+
+   public:
+
    //Rendering related
    void Delete(void);
    void Buffer(bool Keep);
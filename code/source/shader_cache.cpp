@@ -0,0 +1,335 @@
+/*===========================================================================
+   OpenGL Shader Program Binary Cache
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___SHADER_CACHE_CPP___
+#define ___SHADER_CACHE_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "shader_cache.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Static data.
+  ---------------------------------------------------------------------------*/
+const char ShaderCache::Magic[4] = {'K', 'F', 'X', 'S'};
+
+std::string ShaderCache::Path;
+Array<ShaderCache::Entry> ShaderCache::Entries;
+QMutex ShaderCache::Mutex;
+uint32 ShaderCache::Writes = 0;
+
+
+/*---------------------------------------------------------------------------
+   Adds a block of data to a 64-bit FNV-1a hash.
+  ---------------------------------------------------------------------------*/
+static inline uint64 ShaderCacheHash(uint64 Hash, const void* Data, usize Size)
+   {
+   const uint8* Bytes = static_cast<const uint8*>(Data);
+
+   for (uiter I = 0; I < Size; I++)
+      {
+      Hash ^= Bytes[I];
+      Hash *= 0x00000100000001B3ULL;
+      }
+
+   return Hash;
+   }
+
+/*---------------------------------------------------------------------------
+   Sets the directory for the cache files. The directory must exist. An
+   empty path keeps the binaries only in memory. Note, the path must not
+   have a trailing slash.
+  ---------------------------------------------------------------------------*/
+void ShaderCache::SetPath(const std::string &NewPath)
+   {
+   QMutexLocker Lock(&Mutex);
+   Path = NewPath;
+   }
+
+/*---------------------------------------------------------------------------
+   Indicates whether the current OpenGL context can retrieve and restore
+   program binaries. Must be called within a valid OpenGL context.
+  ---------------------------------------------------------------------------*/
+bool ShaderCache::Supported(void)
+   {
+   if (!GLEW_ARB_get_program_binary) {return false;}
+
+   GLint Formats = 0;
+   glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &Formats);
+
+   return Formats > 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Computes the cache key of a program. Must be called within a valid
+   OpenGL context.
+
+   Source : Shader sources of the program.
+  ---------------------------------------------------------------------------*/
+uint64 ShaderCache::Key(const Array<Shader::ShaderSource, 4> &Source)
+   {
+   uint64 Hash = 0xCBF29CE484222325ULL;
+
+   const GLenum Names[3] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+
+   for (uiter I = 0; I < 3; I++)
+      {
+      const char* Driver = reinterpret_cast<const char*>(glGetString(Names[I]));
+      if (Driver != nullptr) {Hash = ShaderCacheHash(Hash, Driver, strlen(Driver) + 1);}
+      }
+
+   for (uiter I = 0; I < Source.Size(); I++)
+      {
+      const Shader::ShaderSource* S = Source.Pointer() + I;
+      uint32 Type = (uint32)S->Type;
+      Hash = ShaderCacheHash(Hash, &Type, sizeof(Type));
+      Hash = ShaderCacheHash(Hash, S->Code.c_str(), S->Code.size() + 1);
+      }
+
+   return Hash;
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the binary in memory for a key, or nullptr if there is none. The
+   caller must hold the mutex.
+  ---------------------------------------------------------------------------*/
+ShaderCache::Entry* ShaderCache::Lookup(uint64 Key)
+   {
+   for (uiter I = 0; I < Entries.Size(); I++)
+      {
+      if (Entries.Pointer()[I].Key == Key) {return Entries.Pointer() + I;}
+      }
+
+   return nullptr;
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the path of the cache file for a key.
+
+   Dir : Cache directory.
+   Key : Cache key, see Key( ).
+  ---------------------------------------------------------------------------*/
+std::string ShaderCache::FileName(const std::string &Dir, uint64 Key)
+   {
+   char Name[32];
+
+   #if defined (WINDOWS)
+      sprintf_s(Name, sizeof(Name), "%08x%08x.bin", (uint32)(Key >> 32), (uint32)Key);
+   #else
+      snprintf(Name, sizeof(Name), "%08x%08x.bin", (uint32)(Key >> 32), (uint32)Key);
+   #endif
+
+   return Dir + "/" + Name;
+   }
+
+/*---------------------------------------------------------------------------
+   Reads a binary from the cache directory. Returns false if there is no
+   file for the key, or the file is damaged. It does not touch the shared
+   state, so it is called without holding the mutex.
+
+   Dir  : Cache directory.
+   Key  : Cache key, see Key( ).
+   Item : Receives the binary.
+  ---------------------------------------------------------------------------*/
+bool ShaderCache::Read(const std::string &Dir, uint64 Key, Entry &Item)
+   {
+   std::string Name = FileName(Dir, Key);
+   FILE* File = nullptr;
+
+   #if defined (WINDOWS)
+      if (fopen_s(&File, Name.c_str(), "rb") != 0) {return false;}
+   #else
+      File = fopen(Name.c_str(), "rb");
+      if (File == nullptr) {return false;}
+   #endif
+
+   uint8 Header[ShaderCache::HeaderSize];
+   uint32 Values[4];
+   bool Valid = fread(Header, 1, ShaderCache::HeaderSize, File) == ShaderCache::HeaderSize;
+
+   if (Valid)
+      {
+      memcpy(Values, Header + 4, sizeof(Values));
+      Valid = memcmp(Header, ShaderCache::Magic, 4) == 0 && Values[0] == ShaderCache::Version && Values[2] > 0 && Values[2] <= ShaderCache::MaxSize;
+      }
+
+   if (Valid)
+      {
+      Item.Binary.Destroy();
+      Item.Binary.Create(Values[2]);
+      Valid = fread(Item.Binary.Pointer(), 1, Values[2], File) == Values[2];
+      }
+
+   fclose(File);
+
+   if (!Valid || crc32(crc32(0L, Z_NULL, 0), Item.Binary.Pointer(), (uInt)Item.Binary.Size()) != Values[3])
+      {
+      debug("Ignored damaged shader cache file: %s.\n", Name.c_str());
+      return false;
+      }
+
+   Item.Key = Key;
+   Item.Format = (GLenum)Values[1];
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Writes a binary into the cache directory. It is called without holding
+   the mutex, so the file is written under a temporary name first, and then
+   renamed. Concurrent writers of the same key never mix their data, and
+   Read( ) never sees a partial file. Failures are only logged, as the
+   program can always be compiled again.
+
+   Dir      : Cache directory.
+   Key      : Cache key, see Key( ).
+   Format   : Binary format reported by glGetProgramBinary( ).
+   Binary   : Program binary.
+   Sequence : Unique number for the temporary file name.
+  ---------------------------------------------------------------------------*/
+void ShaderCache::Write(const std::string &Dir, uint64 Key, GLenum Format, const Array<uint8, 256> &Binary, uint32 Sequence)
+   {
+   std::string Name = FileName(Dir, Key);
+   char Suffix[16];
+   FILE* File = nullptr;
+
+   #if defined (WINDOWS)
+      sprintf_s(Suffix, sizeof(Suffix), ".%u.tmp", Sequence);
+   #else
+      snprintf(Suffix, sizeof(Suffix), ".%u.tmp", Sequence);
+   #endif
+
+   std::string Temp = Name + Suffix;
+
+   #if defined (WINDOWS)
+      if (fopen_s(&File, Temp.c_str(), "wb") != 0) {File = nullptr;}
+   #else
+      File = fopen(Temp.c_str(), "wb");
+   #endif
+
+   if (File == nullptr) {debug("Failed to create shader cache file: %s.\n", Temp.c_str()); return;}
+
+   uint8 Header[ShaderCache::HeaderSize];
+   uint32 Values[4];
+   Values[0] = ShaderCache::Version;
+   Values[1] = (uint32)Format;
+   Values[2] = (uint32)Binary.Size();
+   Values[3] = (uint32)crc32(crc32(0L, Z_NULL, 0), Binary.Pointer(), (uInt)Binary.Size());
+   memcpy(Header, ShaderCache::Magic, 4);
+   memcpy(Header + 4, Values, sizeof(Values));
+
+   bool Valid = fwrite(Header, 1, ShaderCache::HeaderSize, File) == ShaderCache::HeaderSize;
+   Valid &= fwrite(Binary.Pointer(), 1, Binary.Size(), File) == Binary.Size();
+   Valid &= fclose(File) == 0;
+
+   //Renaming does not replace an existing file on Windows
+   #if defined (WINDOWS)
+      if (Valid) {remove(Name.c_str());}
+   #endif
+
+   if (!Valid || rename(Temp.c_str(), Name.c_str()) != 0)
+      {
+      remove(Temp.c_str());
+      debug("Failed to write shader cache file: %s.\n", Name.c_str());
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Looks up a program binary in memory, then on disk. The file is read
+   without holding the mutex, so other threads are not held up by the disk,
+   and the binary is added to memory afterwards unless another thread added
+   one in the meantime. Returns false if the binary is not cached.
+
+   Key    : Cache key, see Key( ).
+   Format : Receives the binary format.
+   Binary : Receives the program binary.
+  ---------------------------------------------------------------------------*/
+bool ShaderCache::Find(uint64 Key, GLenum &Format, Array<uint8, 256> &Binary)
+   {
+   QMutexLocker Lock(&Mutex);
+
+   const Entry* Item = Lookup(Key);
+
+   if (Item == nullptr)
+      {
+      Entry Loaded;
+      std::string Dir = Path;
+      if (Dir.size() < 1) {return false;}
+
+      Lock.unlock();
+      if (!Read(Dir, Key, Loaded)) {return false;}
+      Lock.relock();
+
+      Item = Lookup(Key);
+
+      if (Item == nullptr)
+         {
+         Entries += Loaded;
+         Item = Entries.Pointer() + Entries.Size() - 1;
+         }
+      }
+
+   Format = Item->Format;
+   Binary.Destroy();
+   Binary.Create(Item->Binary.Size());
+   memcpy(Binary.Pointer(), Item->Binary.Pointer(), Binary.Size());
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Adds or replaces a program binary, in memory and on disk. The file is
+   written after the mutex is released, see Write( ).
+
+   Key    : Cache key, see Key( ).
+   Format : Binary format reported by glGetProgramBinary( ).
+   Binary : Program binary.
+  ---------------------------------------------------------------------------*/
+void ShaderCache::Store(uint64 Key, GLenum Format, const Array<uint8, 256> &Binary)
+   {
+   if (Binary.Size() < 1) {return;}
+
+   QMutexLocker Lock(&Mutex);
+
+   Entry* Item = Lookup(Key);
+
+   if (Item == nullptr)
+      {
+      Entries += Entry();
+      Item = Entries.Pointer() + Entries.Size() - 1;
+      }
+
+   Item->Key = Key;
+   Item->Format = Format;
+   Item->Binary.Destroy();
+   Item->Binary.Create(Binary.Size());
+   memcpy(Item->Binary.Pointer(), Binary.Pointer(), Binary.Size());
+
+   std::string Dir = Path;
+   if (Dir.size() < 1) {return;}
+
+   uint32 Sequence = Writes++;
+   Lock.unlock();
+
+   Write(Dir, Key, Format, Binary, Sequence);
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,92 @@
+/*===========================================================================
+   OpenGL Shader Program Binary Cache
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___SHADER_CACHE_H___
+#define ___SHADER_CACHE_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+#include "shader.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Keeps the binaries of linked shader programs, so a program built from the
+  same sources can be restored with glProgramBinary( ) instead of being
+  compiled and linked again. Binaries are kept in memory for the lifetime of
+  the process, and in a directory on disk if one is set with SetPath( ).
+
+  Each binary is keyed by a hash of the shader sources and of the vendor,
+  renderer and version strings of the driver, so a driver update never
+  restores a stale binary. Drivers may still reject a binary, in which case
+  the program is simply compiled again.
+  ---------------------------------------------------------------------------*/
+class ShaderCache
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const char Magic[4];                     //File signature
+   static const uint32 Version = 1;                //File format version
+   static const usize HeaderSize = 20;             //Size of the file header in bytes
+   static const usize MaxSize = 0x01000000;        //Largest binary accepted from disk
+
+   private:
+
+   struct Entry                                    //Cached program binary
+      {
+      uint64 Key;                                  //Hash of the sources and the driver
+      GLenum Format;                               //Binary format reported by the driver
+      Array<uint8, 256> Binary;                    //Program binary
+      };
+
+   //---- Member data ----
+   private:
+
+   static std::string Path;                        //Cache directory, or empty if binaries are kept only in memory
+   static Array<Entry> Entries;                    //Binaries in memory
+   static QMutex Mutex;                            //Serialises access to the cache
+   static uint32 Writes;                           //Number of files written so far, numbers the temporary files
+
+   //---- Methods ----
+   public:
+
+   ShaderCache(void) {}
+   ~ShaderCache(void) {}
+
+   private:
+
+   ShaderCache(const ShaderCache &obj);            //Disable
+   ShaderCache &operator = (const ShaderCache &obj); //Disable
+
+   static Entry* Lookup(uint64 Key);
+   static std::string FileName(const std::string &Dir, uint64 Key);
+   static bool Read(const std::string &Dir, uint64 Key, Entry &Item);
+   static void Write(const std::string &Dir, uint64 Key, GLenum Format, const Array<uint8, 256> &Binary, uint32 Sequence);
+
+   public:
+
+   static void SetPath(const std::string &NewPath);
+   static bool Supported(void);
+   static uint64 Key(const Array<Shader::ShaderSource, 4> &Source);
+   static bool Find(uint64 Key, GLenum &Format, Array<uint8, 256> &Binary);
+   static void Store(uint64 Key, GLenum Format, const Array<uint8, 256> &Binary);
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
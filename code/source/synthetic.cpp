@@ -0,0 +1,265 @@
+/*===========================================================================
+   Synthetic Frame Source
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___SYNTHETIC_CPP___
+#define ___SYNTHETIC_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "math.h"
+#include "synthetic.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Noise generator, a 32-bit xorshift. Returns a value between -Amp and Amp.
+  ---------------------------------------------------------------------------*/
+static inline int SyntheticNoise(uint32 &State, int Amp)
+   {
+   State ^= State << 13;
+   State ^= State >> 17;
+   State ^= State << 5;
+   return (int)(State % (uint32)(2 * Amp + 1)) - Amp;
+   }
+
+/*---------------------------------------------------------------------------
+   Constructor.
+
+   Config : Generator configuration. The resolution is clamped to the
+            supported range.
+  ---------------------------------------------------------------------------*/
+Synthetic::Synthetic(const Settings &Config)
+   {
+   Clear();
+
+   Synthetic::Config = Config;
+   Synthetic::Config.Res.U = Math::Clamp(Config.Res.U, Synthetic::MinWidth, Synthetic::MaxWidth);
+   Synthetic::Config.Res.V = Math::Clamp(Config.Res.V, Synthetic::MinHeight, Synthetic::MaxHeight);
+   Synthetic::Config.Rate = Math::Max(Config.Rate, 0.0f);
+   Synthetic::Config.Noise = Math::Max(Config.Noise, 0.0f);
+
+   Depth.Create(Synthetic::Config.Res, Texture::TypeDepth);
+   Video.Create(Synthetic::Config.Res, Texture::TypeRGB);
+
+   Clock.start();
+
+   debug("Synthetic source, %ux%u at %.1f fps, noise %.1f.\n", Synthetic::Config.Res.U, Synthetic::Config.Res.V, Synthetic::Config.Rate, Synthetic::Config.Noise);
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+Synthetic::~Synthetic(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void Synthetic::Clear(void)
+   {
+   Frame = 0;
+   Start = 0;
+   Time = 0;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure.
+  ---------------------------------------------------------------------------*/
+void Synthetic::Destroy(void)
+   {
+   Depth.Destroy();
+   Video.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Draws the back wall and the floor. The floor covers the lower third of
+   the frame, and comes closer towards the bottom edge.
+  ---------------------------------------------------------------------------*/
+void Synthetic::Background(uint32 Seed)
+   {
+   const vector2u Res = Config.Res;
+   const uint Horizon = (Res.V * 2) / 3;
+   const int Amp = (int)Config.Noise;
+
+   for (uint V = 0; V < Res.V; V++)
+      {
+      uint16* D = Depth.Address16(0, V);
+      uint8* C = Video.Address(0, V);
+      uint32 State = Seed ^ ((V + 1) * 0x9E3779B9U);
+
+      bool Floor = V >= Horizon;
+      float F = Floor ? (float)(V - Horizon) / (float)Math::Max(Res.V - Horizon, 1U) : 0.0f;
+      int Base = (int)Synthetic::DepthWall - (int)(F * 200.0f);
+
+      for (uint U = 0; U < Res.U; U++, D++, C += 3)
+         {
+         int N = (Amp > 0) ? SyntheticNoise(State, Amp) : 0;
+
+         *D = (uint16)Math::Clamp(Base + N, 0, (int)Synthetic::DepthInvalid - 1);
+
+         if (Floor)
+            {
+            bool Tile = (((U * 8) / Res.U) + ((V - Horizon) * 16) / Res.V) & 1;
+            int Shade = Tile ? 150 : 110;
+            C[0] = (uint8)Math::Clamp(Shade + N, 0, 255);
+            C[1] = (uint8)Math::Clamp(Shade * 3 / 4 + N, 0, 255);
+            C[2] = (uint8)Math::Clamp(Shade / 2 + N, 0, 255);
+            }
+         else
+            {
+            int Shade = 80 + (int)((V * 60) / Res.V);
+            C[0] = (uint8)Math::Clamp(Shade + N, 0, 255);
+            C[1] = (uint8)Math::Clamp(Shade + 10 + N, 0, 255);
+            C[2] = (uint8)Math::Clamp(Shade + 40 + N, 0, 255);
+            }
+         }
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Draws a sphere, with a depth test against what is already drawn. Only
+   the bounding box of the sphere is visited.
+
+   I    : Sphere number, selects its path, size and colour.
+   T    : Scene time in seconds.
+   Seed : Noise seed.
+  ---------------------------------------------------------------------------*/
+void Synthetic::Sphere(uint I, float T, uint32 Seed)
+   {
+   static const uint8 Colours[Synthetic::Spheres][3] =
+      {{220, 60, 50}, {60, 200, 80}, {70, 100, 230}, {230, 200, 60}, {200, 80, 210}, {60, 210, 210}};
+
+   const vector2u Res = Config.Res;
+   const float FI = (float)I;
+   const float Bulge = 60.0f;
+   const int Amp = (int)Config.Noise;
+
+   float R = (0.06f + 0.03f * (float)(I % 3)) * (float)Res.V;
+   float CU = (float)Res.U * (0.5f + 0.38f * sinf(T * (0.5f + 0.13f * FI) + FI));
+   float CV = (float)Res.V * (0.45f + 0.3f * sinf(T * (0.7f + 0.11f * FI) + 2.0f * FI));
+   float Wave = 0.5f + 0.5f * sinf(T * 0.3f * (FI + 1.0f) + 3.0f * FI);
+   float CZ = (float)Synthetic::DepthNear + Bulge + Wave * ((float)Synthetic::DepthWall - (float)Synthetic::DepthNear - Bulge - 40.0f);
+
+   int U0 = Math::Max((int)(CU - R), 0);
+   int U1 = Math::Min((int)(CU + R) + 1, (int)Res.U);
+   int V0 = Math::Max((int)(CV - R), 0);
+   int V1 = Math::Min((int)(CV + R) + 1, (int)Res.V);
+
+   const float R2 = R * R;
+   const float InvR = 1.0f / R;
+
+   for (int V = V0; V < V1; V++)
+      {
+      uint16* D = Depth.Address16((uiter)U0, (uiter)V);
+      uint8* C = Video.Address((uiter)U0, (uiter)V);
+      uint32 State = Seed ^ (((uint32)V + 1) * 0x85EBCA6BU);
+      float DV = (float)V + 0.5f - CV;
+
+      for (int U = U0; U < U1; U++, D++, C += 3)
+         {
+         float DU = (float)U + 0.5f - CU;
+         float H2 = R2 - DU * DU - DV * DV;
+         if (H2 <= 0.0f) {continue;}
+
+         float H = sqrtf(H2) * InvR;
+         int Z = (int)(CZ - H * Bulge);
+         if (Z >= (int)*D) {continue;}
+
+         int N = (Amp > 0) ? SyntheticNoise(State, Amp) : 0;
+         float Shade = 0.35f + 0.65f * H;
+
+         *D = (uint16)Math::Clamp(Z + N, 0, (int)Synthetic::DepthInvalid - 1);
+         C[0] = (uint8)Math::Clamp((int)(Colours[I][0] * Shade) + N, 0, 255);
+         C[1] = (uint8)Math::Clamp((int)(Colours[I][1] * Shade) + N, 0, 255);
+         C[2] = (uint8)Math::Clamp((int)(Colours[I][2] * Shade) + N, 0, 255);
+         }
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Generates the next depth and video frame. Unpaced sources advance the
+   scene at a nominal 30 frames per second, so the motion looks the same.
+  ---------------------------------------------------------------------------*/
+void Synthetic::Render(void)
+   {
+   float Rate = (Config.Rate > 0.0f) ? Config.Rate : 30.0f;
+   float T = (float)((double)Frame / (double)Rate);
+   uint32 Seed = (uint32)(Frame + 1) * 0x27D4EB2DU;
+
+   Background(Seed);
+
+   for (uint I = 0; I < Synthetic::Spheres; I++) {Sphere(I, T, Seed + I);}
+
+   Time = (uint32)((double)Frame * 1000.0 / (double)Rate);
+   Frame++;
+   }
+
+/*---------------------------------------------------------------------------
+   Advances to the next frame without drawing it, used while no stream is
+   started. Keeps the pacing schedule running, and unpaced sources sleep for
+   a nominal frame, so an idle source does not spin.
+  ---------------------------------------------------------------------------*/
+void Synthetic::Skip(void)
+   {
+   float Rate = (Config.Rate > 0.0f) ? Config.Rate : 30.0f;
+
+   if (Config.Rate <= 0.0f)
+      {
+      SleepMutex.lock();
+      SleepWait.wait(&SleepMutex, (unsigned long)(1000.0f / Rate));
+      SleepMutex.unlock();
+      }
+
+   Time = (uint32)((double)Frame * 1000.0 / (double)Rate);
+   Frame++;
+   }
+
+/*---------------------------------------------------------------------------
+   Waits until the next frame is due, according to the frame rate. When the
+   caller falls behind by more than a frame, the schedule is restarted
+   rather than catching up with a burst of frames.
+  ---------------------------------------------------------------------------*/
+void Synthetic::Wait(void)
+   {
+   if (Config.Rate <= 0.0f) {return;}
+
+   const double Period = 1000.0 / (double)Config.Rate;
+
+   double Due = (double)(Frame - Start) * Period;
+   double Now = (double)Clock.elapsed();
+
+   if (Now > Due + Period)
+      {
+      Start = Frame;
+      Clock.restart();
+      return;
+      }
+
+   if (Due <= Now) {return;}
+
+   SleepMutex.lock();
+   SleepWait.wait(&SleepMutex, (unsigned long)(Due - Now));
+   SleepMutex.unlock();
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,107 @@
+/*===========================================================================
+   Synthetic Frame Source
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___SYNTHETIC_H___
+#define ___SYNTHETIC_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "texture.h"
+#include "vector.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Generates depth and video frames of a moving scene, for load testing the
+  pipeline without a sensor, at resolutions and rates that one Kinect can
+  not produce. The scene is a back wall with a floor, and a few spheres on
+  Lissajous paths. Depth frames hold raw 11-bit values like the sensor, so
+  they go through the depth table as usual. Video frames are RGB.
+
+  The frames only depend on the frame number, so a run can be repeated
+  exactly, including the noise.
+  ---------------------------------------------------------------------------*/
+class Synthetic
+   {
+   //---- Constants and definitions ----
+   public:
+
+   class Settings                                  //Generator configuration
+      {
+      public:
+      vector2u Res;                                //Frame resolution
+      float Rate;                                  //Frame rate, or 0 to generate frames as fast as possible
+      float Noise;                                 //Noise amplitude, in raw depth units and 8-bit colour steps
+      Settings(void) : Res(640, 480), Rate(30.0f), Noise(2.0f) {}
+      };
+
+   static const uint MinWidth = 640;               //Resolution limits
+   static const uint MinHeight = 480;
+   static const uint MaxWidth = 1280;
+   static const uint MaxHeight = 1024;
+   static const uint Spheres = 6;                  //Number of moving spheres
+   static const uint16 DepthWall = 1000;           //Raw depth of the back wall, about 3.3 m
+   static const uint16 DepthNear = 700;            //Raw depth of the nearest sphere surface, about 0.9 m
+   static const uint16 DepthInvalid = 2047;        //Raw value of pixels without depth
+
+   //---- Member data ----
+   private:
+
+   Settings Config;                                //Generator configuration
+   Texture Depth;                                  //Generated raw depth frame
+   Texture Video;                                  //Generated video frame
+   uint64 Frame;                                   //Number of the next frame
+   uint64 Start;                                   //Frame number where the pacing schedule started
+   uint32 Time;                                    //Time stamp of the last frame, in ms
+   QTime Clock;                                    //Paces the frames
+   QMutex SleepMutex;                              //Used with SleepWait for sleeping between frames
+   QWaitCondition SleepWait;
+
+   //---- Methods ----
+   public:
+
+   Synthetic(const Settings &Config);
+   ~Synthetic(void);
+
+   private:
+
+   Synthetic(const Synthetic &obj);                //Disable
+   Synthetic &operator = (const Synthetic &obj);   //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Scene generation
+   void Background(uint32 Seed);
+   void Sphere(uint I, float T, uint32 Seed);
+
+   public:
+
+   void Render(void);
+   void Skip(void);
+   void Wait(void);
+
+   inline const Texture &GetDepth(void) const {return Depth;}
+   inline const Texture &GetVideo(void) const {return Video;}
+   inline const Settings &GetSettings(void) const {return Config;}
+   inline uint64 GetFrame(void) const {return Frame;}
+   inline uint32 GetTime(void) const {return Time;}
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -102,8 +102,10 @@ void Texture::Clear(void)
    Wrap = false;
    MinFilter = MinLinMipLin;
    MagFilter = MagLinear;
+   MipLevels = Texture::MipAll;
    
    ID = 0;
+   Shared = false;
    }
 
 /*---------------------------------------------------------------------------
@@ -111,7 +113,7 @@ void Texture::Clear(void)
   ---------------------------------------------------------------------------*/
 void Texture::Destroy(void)
    {
-   if (ID > 0) {glDeleteTextures(1, &ID);}
+   if (ID > 0 && !Shared) {glDeleteTextures(1, &ID);}
 
    Data.Destroy();
    
@@ -161,6 +163,16 @@ void Texture::Create(const vector2u &Res, TexType Type)
          CompType = GL_FLOAT;
          break;
 
+      case Texture::TypeNormal : 
+
+         if (!GLEW_ARB_texture_float)
+            {throw dexception("Current OpenGL context does not support ARB_texture_float extensions.");}
+
+         BitsPerPixel = 128; 
+         Format = FormatNormal; 
+         CompType = GL_FLOAT;
+         break;
+
       case Texture::TypeRGB : 
          BitsPerPixel = 24; 
          Format = FormatRGB; 
@@ -214,6 +226,17 @@ void Texture::SetWrap(const vector2b &Wrap)
    Texture::Wrap = Wrap;
    }
 
+/*---------------------------------------------------------------------------
+   Sets how many mipmap levels below the base level are built when the
+   texture is buffered or updated. Textures that are never minified, or 
+   only sampled with a small LOD bias, need few or no levels, which saves 
+   building the full chain on every update. Must be called before Buffer( ).
+  ---------------------------------------------------------------------------*/
+void Texture::SetMipLevels(uint Levels)
+   {
+   MipLevels = Levels;
+   }
+
 /*---------------------------------------------------------------------------
    Generates OpenGL texture objects from texture data.
 
@@ -221,9 +244,10 @@ void Texture::SetWrap(const vector2b &Wrap)
   ---------------------------------------------------------------------------*/
 void Texture::Buffer(bool Keep)
    {
-   if (ID > 0) {glDeleteTextures(1, &ID);}
+   if (ID > 0 && !Shared) {glDeleteTextures(1, &ID);}
 
    ID = 0;
+   Shared = false;
 
    if (Data.Size() < 1) {return;}
 
@@ -238,9 +262,10 @@ void Texture::Buffer(bool Keep)
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilter);
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, Wrap.U ? GL_REPEAT : GL_CLAMP_TO_EDGE);
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, Wrap.V ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)MipLevels);
 
    glTexImage2D(GL_TEXTURE_2D, 0, Type, Res.U, Res.V, 0, Format, CompType, Data.Pointer());
-   glGenerateMipmap(GL_TEXTURE_2D);
+   if (MipLevels > 0) {glGenerateMipmap(GL_TEXTURE_2D);}
 
    GLenum Error = glGetError();
    if (Error != GL_NO_ERROR) {throw dexception("OpenGL generated an error: %s", Debug::ErrorGL(Error));}
@@ -284,10 +309,10 @@ void Texture::Unbind(uiter Unit) const
   ---------------------------------------------------------------------------*/
 void Texture::Update(void)
    {
-   if (ID < 1 || Data.Size() < 1) {return;}
+   if (ID < 1 || Shared || Data.Size() < 1) {return;}
 
    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Res.U, Res.V, Format, CompType, Data.Pointer());
-   glGenerateMipmap(GL_TEXTURE_2D);
+   if (MipLevels > 0) {glGenerateMipmap(GL_TEXTURE_2D);}
    }
 
 /*---------------------------------------------------------------------------
@@ -296,13 +321,39 @@ void Texture::Update(void)
   ---------------------------------------------------------------------------*/
 void Texture::Update(const Texture &obj)
    {
-   if (ID < 1 || obj.Size() < 1 || Type != obj.DataType()) {return;}
+   if (ID < 1 || Shared || obj.Size() < 1 || Type != obj.DataType()) {return;}
    
    const vector2u TexRes = obj.Resolution();
    if (Res.U != TexRes.U || Res.V != TexRes.V) {return;}
 
    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Res.U, Res.V, Format, CompType, obj.Pointer());
-   glGenerateMipmap(GL_TEXTURE_2D);
+   if (MipLevels > 0) {glGenerateMipmap(GL_TEXTURE_2D);}
+   }
+
+/*---------------------------------------------------------------------------
+   Makes the texture refer to a texture object owned elsewhere, such as the
+   colour buffer of a filter's frame buffer object, so it can be sampled
+   without a copy. The texture holds no data, Update( ) has no effect, and
+   the texture object is not deleted with this texture. The mipmap levels
+   are kept, so the owner can tell how many levels the sampler needs. If ID
+   is the texture's own object, the texture hands its ownership over.
+
+   ID   : Texture object ID.
+   Res  : Resolution of the texture object.
+   Type : Internal format of the texture object.
+  ---------------------------------------------------------------------------*/
+void Texture::Share(GLuint ID, const vector2u &Res, TexType Type)
+   {
+   uint Levels = MipLevels;
+
+   if (ID == Texture::ID) {Shared = true;}
+   Destroy();
+
+   MipLevels = Levels;
+   Texture::Type = Type;
+   Texture::Res = Res.Max(1);
+   Texture::ID = ID;
+   Shared = ID > 0;
    }
 
 
@@ -35,6 +35,7 @@ class Texture : public MutexHandle
       TypeLum = GL_LUMINANCE8,                     //8-bit luminance
       TypeDepth = GL_LUMINANCE16,                  //16-bit depth
       TypeDisp = GL_LUMINANCE32F_ARB,              //32-bit float vertex displacement map (requires ARB_texture_float)
+      TypeNormal = GL_RGBA32F_ARB,                 //4x32-bit float normal map (requires ARB_texture_float)
       TypeRGB = GL_RGB8,                           //24-bit colour
       TypeRGBA = GL_RGBA8                          //32-bit colour with alpha
       };
@@ -45,6 +46,7 @@ class Texture : public MutexHandle
       FormatLum = GL_LUMINANCE,                    //Luminance
       FormatDepth = GL_LUMINANCE,                  //Depth
       FormatDisp = GL_LUMINANCE,                   //Displacement map
+      FormatNormal = GL_RGBA,                      //Normal map
       FormatRGB = GL_RGB,                          //Colour
       FormatRGBA = GL_RGBA                         //Colour with alpha
       };
@@ -59,6 +61,8 @@ class Texture : public MutexHandle
       MinLinMipLin = GL_LINEAR_MIPMAP_LINEAR       //Bilinear texel sampling, linear mipmap interpolation
       };
 
+   static const uint MipAll = 1000;                //Mipmap levels of a full chain, same as the OpenGL default
+
    enum TexMagFilter                               //Texture magnification filter enumeration
       {
       MagNearest = GL_NEAREST,                     //Nearest neighbour sampling
@@ -79,8 +83,10 @@ class Texture : public MutexHandle
    TexMinFilter MinFilter;                         //Minification filter
    TexMagFilter MagFilter;                         //Magnification filter
    vector2b Wrap;                                  //Wrap or clamp texture in each dimension
+   uint MipLevels;                                 //Number of mipmap levels below the base level to maintain
 
    GLuint ID;                                      //Texture object ID
+   bool Shared;                                    //Texture object is owned elsewhere, such as by a frame buffer object
 
    //---- Methods ----
    public:
@@ -100,6 +106,7 @@ class Texture : public MutexHandle
    void SetMinFilter(TexMinFilter Filter);
    void SetMagFilter(TexMagFilter Filter);
    void SetWrap(const vector2b &Wrap);
+   void SetMipLevels(uint Levels);
    
    //Rendering related
    void Buffer(bool Keep);
@@ -107,9 +114,11 @@ class Texture : public MutexHandle
    void Unbind(uiter Unit) const;
    void Update(void);
    void Update(const Texture &obj);
+   void Share(GLuint ID, const vector2u &Res, TexType Type);
 
    //Data access
    inline GLuint GetID(void) const {return ID;}
+   inline bool IsShared(void) const {return Shared;}
    inline TexType DataType(void) const {return Type;}
    inline TexFormat DataFormat(void) const {return Format;}
    inline GLenum DataCompType(void) const {return CompType;}
@@ -120,6 +129,7 @@ class Texture : public MutexHandle
    inline usize GetBytesPerLine(void) const {return BytesPerLine;}
    inline vector2u Resolution(void) const {return Res;}
    inline vector2b WrapMode(void) const {return Wrap;}
+   inline uint GetMipLevels(void) const {return MipLevels;}
    inline uiter Offset(uiter U, uiter V) const {return V * BytesPerLine + U * BytesPerPixel;}
    inline uiter Offset(const vector2u &Coord) const {return Coord.V * BytesPerLine + Coord.U * BytesPerPixel;}
    inline uint8* Address(uiter U, uiter V) const {return Data.Pointer() + V * BytesPerLine + U * BytesPerPixel;}
@@ -0,0 +1,188 @@
+/*===========================================================================
+   Streamed Texture Uploads
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___TEXTURE_STREAM_CPP___
+#define ___TEXTURE_STREAM_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "texture_stream.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Constructor.
+  ---------------------------------------------------------------------------*/
+TextureStream::TextureStream(void)
+   {
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor. NOTE: Make sure it is called within a valid OpenGL context.
+  ---------------------------------------------------------------------------*/
+TextureStream::~TextureStream(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void TextureStream::Clear(void)
+   {
+   for (uint I = 0; I < TextureStream::Slots; I++) {IDs[I] = 0;}
+
+   Res = 0;
+   Type = Texture::TypeRGB;
+   Pitch = 0;
+   Size = 0;
+   Next = 0;
+   Staged = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Deletes the buffers. NOTE: Make sure it is called within a valid OpenGL
+   context.
+  ---------------------------------------------------------------------------*/
+void TextureStream::Destroy(void)
+   {
+   if (IDs[0] > 0) {glDeleteBuffers(TextureStream::Slots, IDs);}
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Creates the ring of buffers to fit the source texture.
+
+   Source : Texture the buffers are sized for.
+  ---------------------------------------------------------------------------*/
+void TextureStream::Create(const Texture &Source)
+   {
+   Destroy();
+
+   Res = Source.Resolution();
+   Type = Source.DataType();
+   Pitch = (Source.GetBytesPerLine() + 3) & ~(usize)3;
+   Size = Pitch * Res.V;
+
+   glGenBuffers(TextureStream::Slots, IDs);
+
+   for (uint I = 0; I < TextureStream::Slots; I++)
+      {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, IDs[I]);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER_ARB, Size, NULL, GL_STREAM_DRAW);
+      }
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+
+   GLenum Error = glGetError();
+   if (Error != GL_NO_ERROR) {throw dexception("OpenGL generated an error: %s", Debug::ErrorGL(Error));}
+
+   debug("Texture stream created %u buffers for %ux%u texture.\n", TextureStream::Slots, Res.U, Res.V);
+   }
+
+/*---------------------------------------------------------------------------
+   Copies the source data into the next buffer of the ring. The buffers are
+   recreated when the source resolution or type changes. Returns false if
+   streaming is not supported, or the buffer could not be written, in which
+   case nothing was staged. The caller must lock the Source texture.
+
+   Source : Texture holding the data to upload.
+  ---------------------------------------------------------------------------*/
+bool TextureStream::Stage(const Texture &Source)
+   {
+   Staged = false;
+
+   if (!Supported() || Source.Size() < 1) {return false;}
+
+   const vector2u SourceRes = Source.Resolution();
+   if (IDs[0] < 1 || Res.U != SourceRes.U || Res.V != SourceRes.V || Type != Source.DataType()) {Create(Source);}
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, IDs[Next]);
+
+   //Orphan the storage first, so mapping never waits for a transfer still
+   // reading the previous contents while the caller holds the source lock
+   glBufferData(GL_PIXEL_UNPACK_BUFFER_ARB, Size, NULL, GL_STREAM_DRAW);
+
+   uint8* Data = (uint8*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY);
+   if (Data == nullptr) {glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0); return false;}
+
+   const usize Line = Source.GetBytesPerLine();
+
+   if (Line == Pitch) {memcpy(Data, Source.Pointer(), Size);}
+   else
+      {
+      for (uiter V = 0; V < Res.V; V++) {memcpy(Data + V * Pitch, Source.Address(0, V), Line);}
+      }
+
+   bool Valid = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB) == GL_TRUE;
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+
+   if (!Valid) {return false;}
+
+   Staged = true;
+   Next = (Next + 1) % TextureStream::Slots;
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Starts the transfer of the last staged buffer into the texture object.
+   The call returns without waiting for the transfer. Mipmaps are generated
+   according to the mipmap levels of the target. Returns false if nothing
+   was staged, or the target does not match the staged data.
+
+   Target : Texture to update. It must be buffered, see Texture::Buffer( ).
+  ---------------------------------------------------------------------------*/
+bool TextureStream::Commit(Texture &Target)
+   {
+   if (!Staged) {return false;}
+
+   Staged = false;
+
+   const vector2u TexRes = Target.Resolution();
+   if (Target.GetID() < 1 || Target.IsShared() || Target.DataType() != Type || TexRes.U != Res.U || TexRes.V != Res.V) {return false;}
+
+   const uint Last = (Next + TextureStream::Slots - 1) % TextureStream::Slots;
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, IDs[Last]);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+   Target.Bind(0);
+   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Res.U, Res.V, Target.DataFormat(), Target.DataCompType(), NULL);
+   if (Target.GetMipLevels() > 0) {glGenerateMipmap(GL_TEXTURE_2D);}
+   Target.Unbind(0);
+
+   //Texture::Buffer( ) and Texture::Update( ) expect byte aligned client data
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Indicates whether pixel buffer objects are available.
+  ---------------------------------------------------------------------------*/
+bool TextureStream::Supported(void)
+   {
+   return GLEW_ARB_pixel_buffer_object ? true : false;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
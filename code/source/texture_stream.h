@@ -0,0 +1,86 @@
+/*===========================================================================
+   Streamed Texture Uploads
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___TEXTURE_STREAM_H___
+#define ___TEXTURE_STREAM_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "texture.h"
+#include "vector.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+  Uploads texture data through a ring of pixel unpack buffers. Stage( )
+  copies the source data into the next buffer of the ring, after which the
+  source may be released straight away. Commit( ) then starts the transfer
+  from the buffer into the texture object, which the driver performs
+  asynchronously, so neither call waits for the GPU. The ring lets a new
+  frame be staged while earlier transfers are still in flight.
+
+  Lines are padded to 4 bytes in the buffers, so 24-bit rows do not need a
+  byte aligned transfer. If pixel buffer objects are not supported, Stage( )
+  returns false, and the caller should update the texture directly. All
+  methods must be called within a valid OpenGL context.
+  ---------------------------------------------------------------------------*/
+class TextureStream
+   {
+   //---- Constants and definitions ----
+   public:
+
+   static const uint Slots = 3;                    //Number of buffers in the ring
+
+   //---- Member data ----
+   private:
+
+   GLuint IDs[TextureStream::Slots];               //Pixel buffer object IDs
+   vector2u Res;                                   //Resolution of the staged data
+   Texture::TexType Type;                          //Texture type of the staged data
+   usize Pitch;                                    //Bytes per line in the buffers, padded to 4 bytes
+   usize Size;                                     //Bytes per buffer
+   uint Next;                                      //Buffer to stage the next frame into
+   bool Staged;                                    //Buffer before Next holds data not yet committed
+
+   //---- Methods ----
+   public:
+
+   TextureStream(void);
+   ~TextureStream(void);
+
+   private:
+
+   TextureStream(const TextureStream &obj);        //Disable
+   TextureStream &operator = (const TextureStream &obj); //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Create(const Texture &Source);
+
+   public:
+
+   void Destroy(void);
+
+   //Uploading
+   bool Stage(const Texture &Source);
+   bool Commit(Texture &Target);
+
+   static bool Supported(void);
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
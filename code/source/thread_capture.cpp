@@ -22,35 +22,100 @@
   ---------------------------------------------------------------------------*/
 const char* CaptureThread::ExtTGA = "tga";
 const char* CaptureThread::ExtPNG = "png";
+const char* CaptureThread::ExtY4M = "y4m";
+const char* CaptureThread::ExtDelta = "kfxd";
+const char* CaptureThread::ExtPacked = "kfxp";
+const char* CaptureThread::FileIndex = "index.kfxi";
 
 
 /*---------------------------------------------------------------------------
    Opens a new target directory for streaming. The subdirectory names are 
    generated automatically, based on the current date and timestamp, and with 
    the Prefix added.
+
+   Source : Selects where the frames come from. For SourceVideo and 
+            SourceDepth, the thread pulls frames straight from the sensor 
+            Buffer, without any OpenGL involvement.
+   Colour : Filter colour, stored in the frame index.
+   Ring   : Optional pre-roll ring for the sensor source. The ring is 
+            triggered, so the session starts with the frames it holds, and
+            continues with the live frames queued behind them. The ring
+            returns to pre-roll mode when the thread is destroyed.
+
+   Each session directory also contains a binary frame index, which records
+   the frame numbers, sensor and wall clock times, file sizes and dropped
+   frames, see File::Index.
+
+   For the adaptive format, each frame is saved as TGA or PNG, and the codec
+   is switched on the fly to the strongest compression that keeps up with
+   the source frame rate, see File::Adaptive. Every frame record in the index
+   carries the codec level, and switches are flagged.
+
+   Filters with a limited set of output colours may supply 8-bit palette 
+   indices along with a colour map, see ColourMap( ). These frames are saved
+   as colour mapped TGA or palette PNG files, and flagged in the index.
+
+   For the delta format, all frames are written into a single tile delta 
+   stream, see File::Delta. The bandwidth saved is reported periodically
+   through SignalStatus( ).
+
+   For the packed format, the raw 11-bit depth frames are bit-packed into a
+   single stream, see File::Packed. This format requires SourceDepth.
+
+   For the YUV4MPEG2 format, all frames are written into a single stream.
+   If Path already contains a named pipe called "Prefix.y4m", the frames
+   are streamed into the pipe, and no subdirectory is created.
   ---------------------------------------------------------------------------*/
-CaptureThread::CaptureThread(QObject* Parent, const QString &Path, const QString &Prefix, CapFormat Format, bool Compress) : QThread(Parent)
+CaptureThread::CaptureThread(QObject* Parent, const QString &Path, const QString &Prefix, CapFormat Format, bool Compress, CapSource Source, NAMESPACE_PROJECT::Buffers* Buffer, const NAMESPACE_PROJECT::vector4f &Colour, NAMESPACE_PROJECT::PreRoll* Ring) : QThread(Parent)
    {
    Clear();
 
    if (Parent == nullptr) {throw dexception("Invalid parameters.");}
+   if (Source != CaptureThread::SourceFilter && Buffer == nullptr) {throw dexception("Invalid parameters.");}
+   if (Format == CaptureThread::FormatPacked && Source != CaptureThread::SourceDepth) {throw dexception("Bit-packed capture requires the raw depth source.");}
+   if (Format == CaptureThread::FormatY4M && Source == CaptureThread::SourceDepth) {throw dexception("YUV4MPEG2 capture does not support the raw depth source.");}
+   if (Ring != nullptr && (Source == CaptureThread::SourceFilter || Ring->IsDepth() != (Source == CaptureThread::SourceDepth))) {throw dexception("Invalid parameters.");}
 
    setTerminationEnabled(true);
 
    //Hook signal functions to the parent class' slot functions
    QObject::connect(this, SIGNAL(SignalError(QString)), Parent, SLOT(CaptureError(QString)));
+   QObject::connect(this, SIGNAL(SignalStatus(QString)), Parent, SLOT(CaptureStatus(QString)));
 
    CaptureThread::Format = Format;
    CaptureThread::Compress = Compress;
+   CaptureThread::Source = Source;
+   CaptureThread::Buffer = Buffer;
+   CaptureThread::Ring = Ring;
+   Name = Prefix;
    Dir = Path;
 
+   //Skip the sensor frame that is currently in the front buffer
+   if (Source == CaptureThread::SourceDepth) {UpdateID = Buffer->GetDepthCounter();}
+   else if (Source == CaptureThread::SourceVideo) {UpdateID = Buffer->GetVideoCounter();}
+
    switch (CaptureThread::Format)
       {
       case CaptureThread::FormatTGA : Ext = CaptureThread::ExtTGA; break;
       case CaptureThread::FormatPNG : Ext = CaptureThread::ExtPNG; break;
+      case CaptureThread::FormatY4M : Ext = CaptureThread::ExtY4M; break;
+      case CaptureThread::FormatAdaptive : Ext = CaptureThread::ExtTGA; break;
+      case CaptureThread::FormatDelta : Ext = CaptureThread::ExtDelta; break;
+      case CaptureThread::FormatPacked : Ext = CaptureThread::ExtPacked; break;
       default : throw dexception("The specified file format is unknown.");
       }
 
+   //Stream into an existing named pipe, such as one created for an encoder with mkfifo
+   FileName = Dir.absoluteFilePath(Prefix + "." + Ext);
+   StreamPath = FileName.toAscii();
+
+   if (CaptureThread::Format == CaptureThread::FormatY4M && NAMESPACE_PROJECT::File::Y4M::IsPipe(StreamPath.constData()))
+      {
+      debug("Streaming to named pipe: %s\n", StreamPath.constData());
+      start();
+      return;
+      }
+
    QString SubDir;
    bool Exists = false;
    uint I = 0;
@@ -78,6 +143,20 @@ CaptureThread::CaptureThread(QObject* Parent, const QString &Path, const QString
 
    if (!Dir.cd(SubDir))
       {throw dexception("Failed to change into subdirectory.");}
+
+   FileName = Dir.absoluteFilePath(Prefix + "." + Ext);
+   StreamPath = FileName.toAscii();
+
+   NAMESPACE_PROJECT::File::Index::FileHeader Header;
+   Header.Format = (NAMESPACE_PROJECT::uint8)Format;
+   Header.Source = (NAMESPACE_PROJECT::uint8)Source;
+   Header.StartTime = (NAMESPACE_PROJECT::uint64)QDateTime::currentDateTime().toMSecsSinceEpoch();
+   Header.Colour = Colour;
+   Header.Name = Prefix.toAscii().constData();
+
+   FileName = Dir.absoluteFilePath(CaptureThread::FileIndex);
+   CaptureThread::Path = FileName.toAscii();
+   Index.Open(CaptureThread::Path.constData(), Header);
    
    start();
    }
@@ -100,6 +179,17 @@ void CaptureThread::Clear(void)
    Format = CaptureThread::FormatTGA;
    Ext = CaptureThread::ExtTGA;
 
+   Source = CaptureThread::SourceFilter;
+   Buffer = nullptr;
+   Ring = nullptr;
+   UpdateID = 0;
+   Time = 0;
+   Stamp = 0;
+   Dropped = 0;
+   Encoding = nullptr;
+   Switched = false;
+   Arrivals = 0;
+
    Compress = false;
    Exit = false;
    }
@@ -109,9 +199,199 @@ void CaptureThread::Clear(void)
   ---------------------------------------------------------------------------*/
 void CaptureThread::Destroy(void)
    {
+   Index.Close();
+
+   Y4M.Close();
+
+   Delta.Close();
+
+   Packed.Close();
+
+   Palette.Destroy();
+   Written.Destroy();
+
+   if (Ring != nullptr) {Ring->Release();}
+
    Clear();
    }
 
+/*---------------------------------------------------------------------------
+   Copies the most recent sensor frame from the front buffer into the Frame
+   texture. Returns false if there was no new frame, or if the buffer was 
+   locked. Sensor frames that were skipped over are counted as dropped.
+   With a pre-roll ring attached, the oldest queued frame is taken instead.
+  ---------------------------------------------------------------------------*/
+bool CaptureThread::Fetch(void)
+   {
+   if (Ring != nullptr)
+      {
+      NAMESPACE_PROJECT::MutexControl MutexFrame(Frame.GetMutexHandle());
+      MutexFrame.Lock();
+      return Ring->Pop(Frame, Time, Stamp, Dropped);
+      }
+
+   bool Depth = Source == CaptureThread::SourceDepth;
+   NAMESPACE_PROJECT::uiter PrevID = UpdateID;
+
+   if (!(Depth ? Buffer->DepthUpdated(UpdateID) : Buffer->VideoUpdated(UpdateID))) {return false;}
+
+   if (UpdateID - PrevID > 1) {Dropped += (NAMESPACE_PROJECT::uint32)(UpdateID - PrevID - 1);}
+
+   NAMESPACE_PROJECT::Texture &Sensor = Depth ? Buffer->GetDepthRaw() : Buffer->GetVideo();
+   NAMESPACE_PROJECT::MutexControl MutexSensor(Sensor.GetMutexHandle());
+   if (!MutexSensor.LockRequest()) {debug("Sensor buffer already locked, dropping frame.\n"); Dropped++; return false;}
+
+   if (Sensor.Size() < 1) {return false;}
+
+   NAMESPACE_PROJECT::MutexControl MutexFrame(Frame.GetMutexHandle());
+   MutexFrame.Lock();
+
+   NAMESPACE_PROJECT::vector2u Res = Frame.Resolution();
+   NAMESPACE_PROJECT::vector2u SensorRes = Sensor.Resolution();
+   if (Res.U != SensorRes.U || Res.V != SensorRes.V || Frame.DataType() != Sensor.DataType())
+      {
+      Frame.Create(SensorRes, Sensor.DataType());
+      }
+
+   memcpy(Frame.Pointer(), Sensor.Pointer(), Sensor.Size());
+   
+   Time = Depth ? Buffer->GetDepthTime() : Buffer->GetVideoTime();
+   Stamp = (NAMESPACE_PROJECT::uint64)QDateTime::currentDateTime().toMSecsSinceEpoch();
+
+   return true;
+   }
+
+/*---------------------------------------------------------------------------
+   Saves the frame with the codec selected by the adaptive controller, and
+   feeds the encode and writer wait times back into the controller.
+  ---------------------------------------------------------------------------*/
+void CaptureThread::SaveAdaptive(void)
+   {
+   QTime Timer;
+   Timer.start();
+
+   Encoding = Writer.Acquire();
+   int WaitTime = Timer.restart();
+
+   switch (Control.GetLevel())
+      {
+      case NAMESPACE_PROJECT::File::Adaptive::LevelTGA : TGA.Save(Frame, Palette, *Encoding, false, false); break;
+      case NAMESPACE_PROJECT::File::Adaptive::LevelTGARLE : TGA.Save(Frame, Palette, *Encoding, false, true); break;
+      case NAMESPACE_PROJECT::File::Adaptive::LevelPNGFast : PNG.Save(Frame, Palette, *Encoding, NAMESPACE_PROJECT::File::PNG::CompSpeed); break;
+      case NAMESPACE_PROJECT::File::Adaptive::LevelPNG : PNG.Save(Frame, Palette, *Encoding, NAMESPACE_PROJECT::File::PNG::CompDefault); break;
+      case NAMESPACE_PROJECT::File::Adaptive::LevelPNGBest : PNG.Save(Frame, Palette, *Encoding, NAMESPACE_PROJECT::File::PNG::CompBest); break;
+      default : throw dexception("The specified codec level is unknown.");
+      }
+
+   int EncodeTime = Timer.elapsed();
+
+   Submit();
+
+   Switched = Control.Update(EncodeTime, WaitTime, Writer.GetMetrics().Depth);
+   }
+
+/*---------------------------------------------------------------------------
+   Submits the encoded frame file to the Writer. The index record of the
+   frame is held back until the file has been written, see Retire( ).
+  ---------------------------------------------------------------------------*/
+void CaptureThread::Submit(void)
+   {
+   Pending Entry;
+   bool Indexed = Index.Ready();
+
+   if (Indexed) {Entry.Item = Describe(Encoding->Size());}
+
+   Entry.Sequence = Writer.Submit(Encoding, Path.constData());
+   Encoding = nullptr;
+
+   if (Indexed) {Written += Entry;}
+
+   Retire();
+   }
+
+/*---------------------------------------------------------------------------
+   Appends the held back index records, in frame order, for the frame files
+   that the Writer has finished writing.
+  ---------------------------------------------------------------------------*/
+void CaptureThread::Retire(void)
+   {
+   if (Written.Size() < 1) {return;}
+
+   NAMESPACE_PROJECT::uint64 Retired = Writer.GetMetrics().Retired;
+
+   while (Written.Size() > 0 && Written[0].Sequence < Retired)
+      {
+      Index.Append(Written[0].Item);
+      Written.Remove(0);
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the index record for the current frame, and resets the per frame
+   counters.
+
+   Size : Encoded size of the frame, in bytes.
+  ---------------------------------------------------------------------------*/
+NAMESPACE_PROJECT::File::Index::Record CaptureThread::Describe(NAMESPACE_PROJECT::usize Size)
+   {
+   NAMESPACE_PROJECT::File::Index::Record Item;
+   Item.Frame = (NAMESPACE_PROJECT::uint32)Count;
+   Item.Flags = 0;
+   Item.SensorTime = Time;
+   Item.Dropped = Dropped;
+   Item.WallTime = Stamp > 0 ? Stamp : (NAMESPACE_PROJECT::uint64)QDateTime::currentDateTime().toMSecsSinceEpoch();
+   Item.Size = (NAMESPACE_PROJECT::uint32)Size;
+   Item.ResU = (NAMESPACE_PROJECT::uint16)Frame.Resolution().U;
+   Item.ResV = (NAMESPACE_PROJECT::uint16)Frame.Resolution().V;
+
+   if (Source != CaptureThread::SourceFilter) {Item.Flags |= NAMESPACE_PROJECT::File::Index::FlagSensorTime;}
+   if (Dropped > 0) {Item.Flags |= NAMESPACE_PROJECT::File::Index::FlagDropped;}
+   if (Format == CaptureThread::FormatDelta && Delta.IsKeyFrame()) {Item.Flags |= NAMESPACE_PROJECT::File::Index::FlagKeyFrame;}
+   if (Palette.Size() > 0) {Item.Flags |= NAMESPACE_PROJECT::File::Index::FlagIndexed;}
+
+   if (Format == CaptureThread::FormatAdaptive)
+      {
+      NAMESPACE_PROJECT::File::Adaptive::Level Level = Control.GetLevel();
+      Item.Flags |= ((NAMESPACE_PROJECT::uint32)Level & NAMESPACE_PROJECT::File::Index::MaskLevel) << NAMESPACE_PROJECT::File::Index::ShiftLevel;
+      if (Level != NAMESPACE_PROJECT::File::Adaptive::LevelTGA) {Item.Flags |= NAMESPACE_PROJECT::File::Index::FlagCompressed;}
+      if (Switched) {Item.Flags |= NAMESPACE_PROJECT::File::Index::FlagSwitch;}
+      }
+   else if (Compress && Format != CaptureThread::FormatY4M && Format != CaptureThread::FormatDelta && Format != CaptureThread::FormatPacked) {Item.Flags |= NAMESPACE_PROJECT::File::Index::FlagCompressed;}
+
+   Dropped = 0;
+   Switched = false;
+   Stamp = 0;
+
+   return Item;
+   }
+
+/*---------------------------------------------------------------------------
+   Appends a record for the current frame to the frame index, if the index
+   is open. Used by the stream formats, which write the frame before this
+   call returns.
+
+   Size : Encoded size of the frame, in bytes.
+  ---------------------------------------------------------------------------*/
+void CaptureThread::Record(NAMESPACE_PROJECT::usize Size)
+   {
+   if (!Index.Ready()) {return;}
+
+   Index.Append(Describe(Size));
+   }
+
+/*---------------------------------------------------------------------------
+   Reports the delta stream bandwidth every StatusFrames frames.
+  ---------------------------------------------------------------------------*/
+void CaptureThread::Report(void)
+   {
+   if (Delta.GetFrames() % StatusFrames != 0 || Delta.GetRawBytes() < 1) {return;}
+
+   double Ratio = (double)Delta.GetBytes() / (double)Delta.GetRawBytes();
+   double Saved = ((double)Delta.GetRawBytes() - (double)Delta.GetBytes()) / (1024.0 * 1024.0);
+
+   SignalStatus(QString("%1: %2% of raw bandwidth, %3 MB saved").arg(Name).arg(Ratio * 100.0, 0, 'f', 1).arg(Saved, 0, 'f', 1));
+   }
+
 /*---------------------------------------------------------------------------
    Thread entry point.
   ---------------------------------------------------------------------------*/
@@ -119,33 +399,90 @@ void CaptureThread::run(void)
    {
    debug("Started capture thread.\n");
 
+   //Pre-roll frames are drained first, followed by the live frames
+   if (Ring != nullptr)
+      {
+      debug("Flushing %u pre-roll frames.\n", (uint)Ring->Frames());
+      Ring->Trigger();
+      }
+
    try {
       while (!Exit) 
          {
          //Wait for new frame
          QMutexLocker MutexLocker(&UpdateMutex);
-         UpdateWait.wait(&UpdateMutex);
+
+         if (Source == CaptureThread::SourceFilter) 
+            {
+            UpdateWait.wait(&UpdateMutex);
+
+            //Frames offered while the thread was busy were not handed over
+            int Offered = Arrivals.fetchAndStoreOrdered(0);
+            if (Offered > 1) {Dropped += (NAMESPACE_PROJECT::uint32)(Offered - 1);}
+            }
+         else 
+            {
+            if (Ring == nullptr || Ring->Frames() < 1) {UpdateWait.wait(&UpdateMutex, TimeRawPoll);}
+            if (Exit || !Fetch()) {continue;}
+            }
          
          //Lock frame
          NAMESPACE_PROJECT::MutexControl Mutex(Frame.GetMutexHandle());
-         if (!Mutex.LockRequest()) {debug("Mutex already locked, dropping frame.\n"); continue;}
+         if (!Mutex.LockRequest()) {debug("Mutex already locked, dropping frame.\n"); Dropped++; continue;}
 
-         if (Frame.Size() < 1) {debug("No data in frame, dropping frame.\n"); continue;}
+         if (Frame.Size() < 1) {debug("No data in frame, dropping frame.\n"); Dropped++; continue;}
+
+         //Pick the codec extension, and measure the source frame interval including dropped frames
+         if (Format == CaptureThread::FormatAdaptive)
+            {
+            Ext = Control.GetLevel() < NAMESPACE_PROJECT::File::Adaptive::LevelPNGFast ? CaptureThread::ExtTGA : CaptureThread::ExtPNG;
+            Control.Arrival(Dropped + 1);
+            }
 
          //Construct file name
-         FileName = QString("%1.").arg((long)Count, FileNameDigits, FileNameBase, QLatin1Char('0')) + Ext;
-         FileName = Dir.absoluteFilePath(FileName);
-         Path = FileName.toAscii();
+         if (Format != CaptureThread::FormatY4M && Format != CaptureThread::FormatDelta && Format != CaptureThread::FormatPacked)
+            {
+            FileName = QString("%1.").arg((long)Count, FileNameDigits, FileNameBase, QLatin1Char('0')) + Ext;
+            FileName = Dir.absoluteFilePath(FileName);
+            Path = FileName.toAscii();
+            }
 
-         //Save frame
+         //Save frame, the encoded files are written in the background
          switch (Format)
             {
             case CaptureThread::FormatTGA : 
-               TGA.Save(Frame, Path.constData(), false, Compress); 
+               Encoding = Writer.Acquire();
+               TGA.Save(Frame, Palette, *Encoding, false, Compress); 
+               Submit();
                break;
       
             case CaptureThread::FormatPNG : 
-               PNG.Save(Frame, Path.constData(), Compress ? NAMESPACE_PROJECT::File::PNG::CompSpeed : NAMESPACE_PROJECT::File::PNG::CompNone); 
+               Encoding = Writer.Acquire();
+               PNG.Save(Frame, Palette, *Encoding, Compress ? NAMESPACE_PROJECT::File::PNG::CompSpeed : NAMESPACE_PROJECT::File::PNG::CompNone); 
+               Submit();
+               break;
+
+            case CaptureThread::FormatY4M : 
+               if (!Y4M.Ready()) {Y4M.Open(StreamPath.constData(), Frame.Resolution(), StreamRate);}
+               Y4M.Write(Frame, Source == CaptureThread::SourceFilter); 
+               Record(Y4M.GetFrameSize());
+               break;
+
+            case CaptureThread::FormatAdaptive : 
+               SaveAdaptive();
+               break;
+
+            case CaptureThread::FormatDelta : 
+               if (!Delta.Ready()) {Delta.Create(StreamPath.constData());}
+               Delta.Write(Frame, Source == CaptureThread::SourceFilter); 
+               Record(Delta.GetFrameSize());
+               Report();
+               break;
+
+            case CaptureThread::FormatPacked : 
+               if (!Packed.Ready()) {Packed.Create(StreamPath.constData());}
+               Packed.Write(Frame); 
+               Record(Packed.GetFrameSize());
                break;
       
             default : throw dexception("The specified file format is unknown.");
@@ -153,6 +490,18 @@ void CaptureThread::run(void)
 
          Count++;
          }
+
+      Writer.Flush();
+      Retire();
+
+      NAMESPACE_PROJECT::File::Writer::Metrics Stats = Writer.GetMetrics();
+      debug("Capture files written: %llu (%llu bytes), max queue depth %u, max bytes in flight %u, throttled %llu times.\n", 
+         (unsigned long long)Stats.Completed, (unsigned long long)Stats.BytesWritten, (uint)Stats.MaxDepth, (uint)Stats.MaxBytesInFlight, (unsigned long long)Stats.Throttled);
+
+      if (Format == CaptureThread::FormatAdaptive)
+         {
+         debug("Adaptive capture finished at %s, frame interval %.1f ms.\n", NAMESPACE_PROJECT::File::Adaptive::Name(Control.GetLevel()), Control.GetInterval());
+         }
       }
 
    catch (std::exception &e) 
@@ -167,6 +516,25 @@ void CaptureThread::run(void)
       Exit = true;
       }
 
+   //A block left behind by a failed encoder is returned unwritten
+   if (Encoding != nullptr)
+      {
+      Writer.Release(Encoding);
+      Encoding = nullptr;
+      }
+
+   //Frame files that made it to disk before a failure are still indexed
+   if (Written.Size() > 0)
+      {
+      try {Writer.Flush();}
+      catch (...) {}
+
+      try {Retire();}
+      catch (...) {}
+
+      Written.Destroy();
+      }
+
    debug("Stopping capture thread.\n");
    }
 
@@ -185,9 +553,20 @@ void CaptureThread::stop(void)
 void CaptureThread::update(void)
    {
    if (Exit) {return;}
+   if (Source == CaptureThread::SourceFilter) {Arrivals.ref();}
    UpdateWait.wakeAll();
    }
 
+/*---------------------------------------------------------------------------
+   Signals thread that a frame from the render path could not be handed 
+   over, so that it is counted as dropped.
+  ---------------------------------------------------------------------------*/
+void CaptureThread::skip(void)
+   {
+   if (Exit) {return;}
+   Arrivals.ref();
+   }
+
 
 //==== End of file ===========================================================
 #endif
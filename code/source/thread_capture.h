@@ -14,8 +14,10 @@
 /*---------------------------------------------------------------------------
    Header files
   ---------------------------------------------------------------------------*/
+#include "buffers.h"
 #include "common.h"
 #include "file.h"
+#include "preroll.h"
 #include "texture.h"
 
 
@@ -33,29 +35,75 @@ class CaptureThread : public QThread
    enum CapFormat                                  //CaptureThread format enumeration
       {
       FormatTGA = 0,                               //CaptureThread as raw TGA files
-      FormatPNG = 1                                //CaptureThread as PNG files
+      FormatPNG = 1,                               //CaptureThread as PNG files
+      FormatY4M = 2,                               //CaptureThread as a single YUV4MPEG2 stream
+      FormatAdaptive = 3,                          //CaptureThread as TGA or PNG files, codec chosen on the fly
+      FormatDelta = 4,                             //CaptureThread as a single tile delta stream
+      FormatPacked = 5                             //CaptureThread as a single bit-packed 11-bit depth stream, raw depth source only
+      };
+
+   enum CapSource                                  //Source of the captured frames
+      {
+      SourceFilter = 0,                            //Frames are supplied by the render path, see Texture( )
+      SourceVideo = 1,                             //Frames are pulled from the front video buffer
+      SourceDepth = 2                              //Frames are pulled from the raw 11-bit depth buffer
       };
 
    static const char* ExtTGA;
    static const char* ExtPNG;
+   static const char* ExtY4M;
+   static const char* ExtDelta;
+   static const char* ExtPacked;
+   static const char* FileIndex;
 
    static const uint MaxSubDirAttempts = 10;       //Number of times to attempt for creating a subdirectory
    static const uint TimeSubDirAttempts = 50;      //Sleep interval between subdirectory creation attempts
    static const uint FileNameDigits = 8;           //Number of digits to use in the file name counter
    static const uint FileNameBase = 10;            //Numeric base to use in the file name counter
+   static const uint TimeRawPoll = 5;              //Poll interval for new sensor frames, in ms
+   static const uint StreamRate = 30;              //Nominal frame rate of YUV4MPEG2 streams
+   static const uint StatusFrames = 30;            //Number of frames between bandwidth reports
+
+   private:
+
+   struct Pending                                  //Index record of a frame file that is still being written
+      {
+      NAMESPACE_PROJECT::File::Index::Record Item; //Frame record
+      NAMESPACE_PROJECT::uint64 Sequence;          //Writer sequence number of the frame file
+      };
 
    //---- Member data ----
    private:
 
    CapFormat Format;                               //Specifies the capture file format
    bool Compress;                                  //Apply data compression
+   CapSource Source;                               //Specifies where the frames come from
+   NAMESPACE_PROJECT::Buffers* Buffer;             //Sensor buffers, used when not capturing from the render path
+   NAMESPACE_PROJECT::PreRoll* Ring;               //Pre-roll ring that supplies the sensor frames, or nullptr
+   NAMESPACE_PROJECT::uiter UpdateID;              //Last sensor buffer update ID
+   NAMESPACE_PROJECT::uint32 Time;                 //Sensor time step of the current frame
+   NAMESPACE_PROJECT::uint64 Stamp;                //Acquisition time of the current frame, or 0 to use the save time
+   NAMESPACE_PROJECT::uint32 Dropped;              //Number of frames dropped since the last saved frame
+   NAMESPACE_PROJECT::File::Index Index;           //Frame index of the capture session
    NAMESPACE_PROJECT::File::PNG PNG;               //PNG file I/O
    NAMESPACE_PROJECT::File::TGA TGA;               //TGA file I/O
+   NAMESPACE_PROJECT::File::Y4M Y4M;               //YUV4MPEG2 stream output
+   NAMESPACE_PROJECT::File::Delta Delta;           //Tile delta stream output
+   NAMESPACE_PROJECT::File::Packed Packed;         //Bit-packed depth stream output
+   NAMESPACE_PROJECT::File::Writer Writer;         //Write-behind output for the TGA and PNG files
+   NAMESPACE_PROJECT::File::Writer::Block* Encoding; //Block acquired from the Writer, but not yet submitted
+   NAMESPACE_PROJECT::Array<Pending, 16> Written;  //Index records waiting for their frame files to be written
+   NAMESPACE_PROJECT::File::Adaptive Control;      //Codec selection for adaptive capture
+   bool Switched;                                  //Codec level was changed for the current frame
+   QAtomicInt Arrivals;                            //Number of frames offered by the render path since the last saved frame
+   QByteArray StreamPath;                          //Path of the YUV4MPEG2 file or named pipe
    NAMESPACE_PROJECT::Texture Frame;               //Frame data
+   NAMESPACE_PROJECT::Texture Palette;             //Colour map of indexed frames, empty for other frames, guarded by the Frame mutex
    NAMESPACE_PROJECT::uint64 Count;                //Frame counter
 
    QDir Dir;                                       //Path where the frames will be streamed
    QString FileName, Ext;                          //File name and format extension
+   QString Name;                                   //File name prefix, used in status reports
    QByteArray Path;                                //Temporary byte array for string conversion
 
    QWaitCondition UpdateWait;                      //Thread wait condition
@@ -65,7 +113,7 @@ class CaptureThread : public QThread
    //---- Methods ----
    public:
 
-   CaptureThread(QObject* Parent, const QString &Path, const QString &Prefix, CapFormat Format = CaptureThread::FormatTGA, bool Compress = true);
+   CaptureThread(QObject* Parent, const QString &Path, const QString &Prefix, CapFormat Format = CaptureThread::FormatTGA, bool Compress = true, CapSource Source = CaptureThread::SourceFilter, NAMESPACE_PROJECT::Buffers* Buffer = nullptr, const NAMESPACE_PROJECT::vector4f &Colour = 1.0f, NAMESPACE_PROJECT::PreRoll* Ring = nullptr);
    ~CaptureThread(void);
 
    private:
@@ -77,19 +125,35 @@ class CaptureThread : public QThread
    void Clear(void);
    void Destroy(void);
 
+   //Sensor capture
+   bool Fetch(void);
+
+   //Frame output
+   void SaveAdaptive(void);
+   void Submit(void);
+   void Retire(void);
+   NAMESPACE_PROJECT::File::Index::Record Describe(NAMESPACE_PROJECT::usize Size);
+   void Record(NAMESPACE_PROJECT::usize Size);
+   void Report(void);
+
    public:
 
    //Thread control
    void run(void);
    void stop(void);
    void update(void);
+   void skip(void);
 
    //Data access
    inline NAMESPACE_PROJECT::Texture& Texture(void) {return Frame;}
+   inline NAMESPACE_PROJECT::Texture& ColourMap(void) {return Palette;}
+   inline bool UsesColourMap(void) const {return Source == CaptureThread::SourceFilter && (Format == CaptureThread::FormatTGA || Format == CaptureThread::FormatPNG || Format == CaptureThread::FormatAdaptive);}
+   inline CapSource GetSource(void) const {return Source;}
 
    signals:
 
    void SignalError(QString Message);
+   void SignalStatus(QString Message);
    };
 
 
@@ -0,0 +1,224 @@
+/*===========================================================================
+   Filter Construction Thread
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___THREAD_FILTER_CPP___
+#define ___THREAD_FILTER_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "thread_filter.h"
+
+
+/*---------------------------------------------------------------------------
+   Constructor. Creates the worker context, which must happen in the GUI 
+   thread. Leaves no OpenGL context current.
+
+   Parent : Pointer to the parent object, must not be nullptr.
+   Share  : Display widget to share OpenGL objects with, must not be 
+            nullptr.
+   Buffer : Kinect buffers, must not be nullptr.
+  ---------------------------------------------------------------------------*/
+FilterThread::FilterThread(QObject* Parent, const QGLWidget* Share, NAMESPACE_PROJECT::Buffers* Buffer) : QThread(Parent)
+   {
+   Clear();
+
+   if (Parent == nullptr || Share == nullptr || Buffer == nullptr) {throw dexception("Invalid parameters.");}
+
+   FilterThread::Buffer = Buffer;
+
+   //The widget is never shown, and is only made current by the worker. 
+   // Making it current here creates its native window in the GUI thread.
+   Context = new QGLWidget(Share->format(), nullptr, Share);
+   Context->setAutoBufferSwap(false);
+   Context->makeCurrent();
+   Context->doneCurrent();
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor. Cancels a pending setup, and deletes the filter if it was
+   never taken. NOTE: Make sure it is called within a valid OpenGL context 
+   that shares objects with the worker context.
+  ---------------------------------------------------------------------------*/
+FilterThread::~FilterThread(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void FilterThread::Clear(void)
+   {
+   Context = nullptr;
+   Buffer = nullptr;
+   FX = nullptr;
+   Queued = nullptr;
+   Message.clear();
+   Pending = false;
+   Busy = false;
+   Superseded = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure. The worker context can only go once the worker
+   has returned, so this waits for a setup that is already in progress, but
+   queued filters are dropped without being set up.
+  ---------------------------------------------------------------------------*/
+void FilterThread::Destroy(void)
+   {
+   prepare(nullptr);
+   wait();
+
+   delete FX;
+   delete Queued;
+   delete Context;
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Starts setting up a filter, without waiting for the worker. While the
+   worker is busy, the filter is queued in place of any queued before, and
+   the filter in progress is superseded. Otherwise a finished filter that
+   was not taken is deleted, and the worker is started. NOTE: Make sure it
+   is called within a valid OpenGL context that shares objects with the 
+   worker context.
+
+   FX : Pointer to the new filter object. This class takes ownership of
+        the filter object until Take( ) is called. A nullptr cancels the
+        pending filter.
+  ---------------------------------------------------------------------------*/
+void FilterThread::prepare(NAMESPACE_PROJECT::Filter* FX)
+   {
+   QMutexLocker Lock(&Mutex);
+
+   Pending = FX != nullptr;
+
+   if (Busy)
+      {
+      delete Queued;
+      Queued = FX;
+      Superseded = true;
+      return;
+      }
+
+   //The worker no longer owns anything, and is at most returning from run( )
+   wait();
+
+   delete FilterThread::FX;
+   FilterThread::FX = FX;
+   Message.clear();
+   Superseded = false;
+   Busy = Pending;
+
+   if (Pending) {start();}
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the filter once the thread has finished, and hands over its 
+   ownership. Returns nullptr if the setup failed, with the reason in 
+   Error, or if no filter is ready yet, see Ready( ).
+  ---------------------------------------------------------------------------*/
+NAMESPACE_PROJECT::Filter* FilterThread::Take(QString &Error)
+   {
+   Error.clear();
+   if (!Ready()) {return nullptr;}
+
+   NAMESPACE_PROJECT::Filter* Ready = FX;
+   FX = nullptr;
+   Error = Message;
+   Pending = false;
+
+   return Ready;
+   }
+
+/*---------------------------------------------------------------------------
+   Sets up the filter owned by the worker, and detaches it from the worker
+   context. Returns the error message, or an empty string on success.
+  ---------------------------------------------------------------------------*/
+QString FilterThread::Build(void)
+   {
+   try {
+      FX->Setup(*Buffer);
+      FX->Assets(*Buffer);
+      FX->Detach();
+
+      //All commands must complete before another context uses the objects
+      glFinish();
+      }
+
+   catch (std::exception &e) 
+      {
+      return QString(e.what());
+      }
+   
+   catch (...) 
+      {
+      return QString("Trapped an unhandled exception in the filter thread.");
+      }
+
+   return QString();
+   }
+
+/*---------------------------------------------------------------------------
+   Thread entry point. Sets up filters until one is neither superseded nor
+   followed by a queued filter.
+  ---------------------------------------------------------------------------*/
+void FilterThread::run(void)
+   {
+   debug("Started filter thread.\n");
+
+   Context->makeCurrent();
+
+   bool Running = true;
+
+   while (Running)
+      {
+      Mutex.lock();
+      bool Skip = Superseded;
+      Mutex.unlock();
+
+      QString Error = Skip ? QString() : Build();
+      NAMESPACE_PROJECT::Filter* Discard = nullptr;
+
+      Mutex.lock();
+
+      if (Superseded)
+         {
+         Discard = FX;
+         FX = Queued;
+         Queued = nullptr;
+         Superseded = false;
+         Message.clear();
+         Running = FX != nullptr;
+         }
+
+      else
+         {
+         if (!Error.isEmpty()) {Discard = FX; FX = nullptr;}
+         Message = Error;
+         Running = false;
+         }
+
+      Busy = Running;
+      Mutex.unlock();
+
+      //A superseded or failed filter may hold objects of this context, so delete it here
+      delete Discard;
+      }
+
+   Context->doneCurrent();
+
+   debug("Stopping filter thread.\n");
+   }
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,79 @@
+/*===========================================================================
+   Filter Construction Thread
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___THREAD_FILTER_H___
+#define ___THREAD_FILTER_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "buffers.h"
+#include "common.h"
+#include "filter.h"
+
+
+/*---------------------------------------------------------------------------
+   Worker thread for setting up filters. The thread renders nothing, it
+   only runs Filter::Setup( ) and Filter::Assets( ) in an OpenGL context of 
+   its own, which shares objects with the display widget, so that the 
+   widget can keep rendering the current filter in the mean time. The 
+   finished filter is detached from the worker context, and must be 
+   attached to the display context after Take( ), see Filter::Attach( ).
+
+   The GUI thread never waits for a setup. A filter given to prepare( )
+   while another is being set up is queued, and the one in progress is
+   marked as superseded. The worker deletes it once its setup returns, and
+   continues with the queued filter.
+  ---------------------------------------------------------------------------*/
+class FilterThread : public QThread
+   {
+   //---- Member data ----
+   private:
+
+   QGLWidget* Context;                             //Hidden widget that owns the worker context
+   NAMESPACE_PROJECT::Buffers* Buffer;             //Kinect buffers
+   NAMESPACE_PROJECT::Filter* FX;                  //Filter being set up, or nullptr
+   NAMESPACE_PROJECT::Filter* Queued;              //Filter to set up next, or nullptr
+   QString Message;                                //Error message of the last setup, empty on success
+   bool Pending;                                   //A filter was given to prepare( ) and was not taken yet
+   bool Busy;                                      //The worker owns FX, and will look at Queued before it returns
+   bool Superseded;                                //The filter being set up was replaced or cancelled
+   QMutex Mutex;                                   //Guards the hand-over of filters to the worker
+
+   //---- Methods ----
+   public:
+
+   FilterThread(QObject* Parent, const QGLWidget* Share, NAMESPACE_PROJECT::Buffers* Buffer);
+   ~FilterThread(void);
+
+   private:
+
+   FilterThread(const FilterThread &obj);          //Disable
+   FilterThread &operator = (const FilterThread &obj); //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Filter setup
+   QString Build(void);
+
+   public:
+
+   //Thread control
+   void run(void);
+   void prepare(NAMESPACE_PROJECT::Filter* FX);
+
+   //Data access
+   NAMESPACE_PROJECT::Filter* Take(QString &Error);
+   inline bool Shared(void) const {return Context != nullptr && Context->isSharing();}
+   inline bool Ready(void) const {return Pending && isFinished();}
+   };
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,240 @@
+/*===========================================================================
+   Worker Thread Pool
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___THREAD_POOL_CPP___
+#define ___THREAD_POOL_CPP___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "common.h"
+#include "debug.h"
+#include "math.h"
+#include "thread_pool.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Static data.
+  ---------------------------------------------------------------------------*/
+ThreadPool* ThreadPool::Global = nullptr;
+QMutex ThreadPool::GlobalMutex;
+
+
+/*---------------------------------------------------------------------------
+   Constructor. Spawns the worker threads.
+
+   Threads : Total number of threads, including the calling thread. If zero,
+             the number of processor cores will be used.
+  ---------------------------------------------------------------------------*/
+ThreadPool::ThreadPool(usize Threads)
+   {
+   Clear();
+
+   if (Threads < 1) {Threads = (usize)Math::Max(QThread::idealThreadCount(), 1);}
+   Threads = Math::Min(Threads, ThreadPool::MaxThreads);
+
+   Workers.Create(Threads - 1);
+
+   for (uiter I = 0; I < Workers.Size(); I++) {Workers[I] = nullptr;}
+
+   for (uiter I = 0; I < Workers.Size(); I++)
+      {
+      Workers[I] = new Worker(this);
+      Workers[I]->start();
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Destructor.
+  ---------------------------------------------------------------------------*/
+ThreadPool::~ThreadPool(void)
+   {
+   Destroy();
+   }
+
+/*---------------------------------------------------------------------------
+   Clears the structure.
+  ---------------------------------------------------------------------------*/
+void ThreadPool::Clear(void)
+   {
+   Current = nullptr;
+   TaskCount = 0;
+   TaskNext = 0;
+   TaskDone = 0;
+   Error.clear();
+   Exit = false;
+   }
+
+/*---------------------------------------------------------------------------
+   Destroys the structure. Waits for the worker threads to finish.
+  ---------------------------------------------------------------------------*/
+void ThreadPool::Destroy(void)
+   {
+   Mutex.lock();
+   Exit = true;
+   TaskWait.wakeAll();
+   Mutex.unlock();
+
+   for (uiter I = 0; I < Workers.Size(); I++)
+      {
+      if (Workers[I] == nullptr) {continue;}
+      Workers[I]->wait();
+      delete Workers[I];
+      }
+
+   Workers.Destroy();
+
+   Clear();
+   }
+
+/*---------------------------------------------------------------------------
+   Executes a single task, and traps any exceptions. Only the first error
+   message is retained.
+  ---------------------------------------------------------------------------*/
+void ThreadPool::Execute(Job* Current, uiter Task)
+   {
+   try {
+      Current->Run(Task);
+      }
+
+   catch (std::exception &e)
+      {
+      QMutexLocker Locker(&Mutex);
+      if (Error.empty()) {Error = e.what();}
+      }
+
+   catch (...)
+      {
+      QMutexLocker Locker(&Mutex);
+      if (Error.empty()) {Error = "Trapped an unhandled exception in a worker thread.";}
+      }
+   }
+
+/*---------------------------------------------------------------------------
+   Worker thread loop. Picks up tasks from the current job until the pool
+   is destroyed.
+  ---------------------------------------------------------------------------*/
+void ThreadPool::Work(void)
+   {
+   Mutex.lock();
+
+   while (true)
+      {
+      while (!Exit && (Current == nullptr || TaskNext >= TaskCount))
+         {
+         TaskWait.wait(&Mutex);
+         }
+
+      if (Exit) {break;}
+
+      Job* Task = Current;
+      uiter I = TaskNext++;
+
+      Mutex.unlock();
+      Execute(Task, I);
+      Mutex.lock();
+
+      TaskDone++;
+      if (TaskDone >= TaskCount) {DoneWait.wakeAll();}
+      }
+
+   Mutex.unlock();
+   }
+
+/*---------------------------------------------------------------------------
+   Runs a job and blocks until all tasks are completed. Tasks are numbered
+   from 0 to Count - 1, and may be executed in any order. If any task throws
+   an exception, the error is rethrown here after all tasks are completed.
+
+   Current : The job to be executed.
+   Count   : Number of tasks.
+  ---------------------------------------------------------------------------*/
+void ThreadPool::Run(Job &Current, usize Count)
+   {
+   if (Count < 1) {return;}
+
+   QMutexLocker RunLocker(&RunMutex);
+
+   //Run serially if there is nothing to gain from the workers
+   if (Workers.Size() < 1 || Count < 2)
+      {
+      for (uiter I = 0; I < Count; I++) {Current.Run(I);}
+      return;
+      }
+
+   Mutex.lock();
+
+   ThreadPool::Current = &Current;
+   TaskCount = Count;
+   TaskNext = 0;
+   TaskDone = 0;
+   Error.clear();
+
+   TaskWait.wakeAll();
+
+   //Calling thread takes tasks as well
+   while (TaskNext < TaskCount)
+      {
+      uiter I = TaskNext++;
+
+      Mutex.unlock();
+      Execute(&Current, I);
+      Mutex.lock();
+
+      TaskDone++;
+      }
+
+   while (TaskDone < TaskCount) {DoneWait.wait(&Mutex);}
+
+   ThreadPool::Current = nullptr;
+   std::string Message = Error;
+
+   Mutex.unlock();
+
+   if (!Message.empty()) {throw dexception("%s", Message.c_str());}
+   }
+
+/*---------------------------------------------------------------------------
+   Returns the process-wide pool, with one thread per processor core. The
+   pool is created on the first call.
+  ---------------------------------------------------------------------------*/
+ThreadPool& ThreadPool::Shared(void)
+   {
+   QMutexLocker Locker(&GlobalMutex);
+
+   if (Global == nullptr) 
+      {
+      Global = new ThreadPool();
+      debug("Created the shared thread pool with %u threads.\n", (uint)Global->Threads());
+      }
+
+   return *Global;
+   }
+
+/*---------------------------------------------------------------------------
+   Stops the threads of the process-wide pool. Must be called after all 
+   users of the pool are destroyed, before the program exits.
+  ---------------------------------------------------------------------------*/
+void ThreadPool::DestroyShared(void)
+   {
+   QMutexLocker Locker(&GlobalMutex);
+
+   delete Global;
+   Global = nullptr;
+   }
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
@@ -0,0 +1,109 @@
+/*===========================================================================
+   Worker Thread Pool
+
+   Dominik Deak
+  ===========================================================================*/
+
+#ifndef ___THREAD_POOL_H___
+#define ___THREAD_POOL_H___
+
+
+/*---------------------------------------------------------------------------
+   Header files
+  ---------------------------------------------------------------------------*/
+#include "array.h"
+#include "common.h"
+
+
+//Namespaces
+NAMESPACE_BEGIN(NAMESPACE_PROJECT)
+
+
+/*---------------------------------------------------------------------------
+   Pool of worker threads for splitting a job into a number of independent
+   tasks. The calling thread participates in the work and blocks until all
+   tasks are completed.
+
+   The encoders and the software filters share one process-wide pool, see
+   Shared( ), so concurrent capture threads don't each spawn a thread per
+   core. Calls to Run( ) are serialised, and a task must not run another 
+   job on the pool that executes it.
+  ---------------------------------------------------------------------------*/
+class ThreadPool
+   {
+   //---- Constants and definitions ----
+   public:
+
+   class Job                                       //Interface for parallel jobs
+      {
+      public:
+      virtual ~Job(void) {}
+      virtual void Run(uiter Task) = 0;            //Executes a single task, may be called concurrently
+      };
+
+   static const usize MaxThreads = 64;             //Upper limit on worker threads
+
+   private:
+
+   class Worker : public QThread                   //Worker thread, no signals or slots
+      {
+      private:
+      ThreadPool* Pool;
+      public:
+      Worker(ThreadPool* Pool) : Pool(Pool) {}
+      void run(void) {Pool->Work();}
+      };
+
+   //---- Member data ----
+   private:
+
+   Array<Worker*, 8> Workers;                      //Worker threads
+   QMutex RunMutex;                                //Serialises calls to Run( )
+   QMutex Mutex;                                   //Guards the job state
+   QWaitCondition TaskWait;                        //Signals workers when tasks are available
+   QWaitCondition DoneWait;                        //Signals the caller when all tasks are done
+   Job* Current;                                   //Current job
+   usize TaskCount;                                //Number of tasks in the current job
+   uiter TaskNext;                                 //Next task to be picked up
+   usize TaskDone;                                 //Number of completed tasks
+   std::string Error;                              //Error message of the first failed task
+   bool Exit;                                      //Signals workers to exit
+
+   static ThreadPool* Global;                      //Process-wide pool, created on demand
+   static QMutex GlobalMutex;                      //Guards the creation of the process-wide pool
+
+   //---- Methods ----
+   public:
+
+   ThreadPool(usize Threads = 0);
+   ~ThreadPool(void);
+
+   private:
+
+   ThreadPool(const ThreadPool &obj);              //Disable
+   ThreadPool &operator = (const ThreadPool &obj); //Disable
+
+   //Data allocation
+   void Clear(void);
+   void Destroy(void);
+
+   //Task processing
+   void Work(void);
+   void Execute(Job* Current, uiter Task);
+
+   public:
+
+   void Run(Job &Current, usize Count);
+   inline usize Threads(void) const {return Workers.Size() + 1;}
+
+   static ThreadPool& Shared(void);
+   static void DestroyShared(void);
+   };
+
+
+//Close namespaces
+NAMESPACE_END(NAMESPACE_PROJECT)
+
+
+//==== End of file ===========================================================
+#endif
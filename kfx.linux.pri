@@ -15,11 +15,31 @@ DocsInstallDir = $${InstallDir}/$${DocsDir}
 #------------------------------------------------------------------------------
 DEFINES += LINUX
 
+# Asynchronous capture file output through io_uring, requires kernel 5.6 headers.
+# Enable with: qmake CONFIG+=uring
+uring {
+   exists(/usr/include/linux/io_uring.h) {
+      DEFINES += URING
+      }
+
+   !exists(/usr/include/linux/io_uring.h) {
+      warning(io_uring headers not found, capture files are written on a thread)
+      }
+   }
+
+# Offscreen EGL context for the headless --render mode, works without an X server.
+# Enable with: qmake CONFIG+=egl
+egl {
+   DEFINES += EGL
+   LIBS += -lEGL
+   }
+
 INCLUDEPATH += /usr/include
 INCLUDEPATH += /usr/local/include/libfreenect
 
 LIBS += -L/usr/local/lib/ -lfreenect
 LIBS += -L/usr/local/lib/ -lpng
+LIBS += -lz
 LIBS += -L/usr/lib/ -lGLEW
 
 
@@ -21,6 +21,7 @@ INCLUDEPATH += /usr/local/include/libfreenect
 
 LIBS += -L/usr/local/lib/ -lfreenect
 LIBS += -L/usr/local/lib/ -lpng
+LIBS += -lz
 LIBS += -L/usr/lib/ -lGLEW
 
 ICON = code/resource/logo.icns